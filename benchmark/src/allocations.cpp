@@ -0,0 +1,76 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include "harness.h"
+
+// Replacement allocation functions that count allocations and bytes. Only the
+// simple forms are replaced; the others call these by default.
+//
+// The requested size is stored in a header in front of each block, so it is
+// known when the block is freed.
+
+namespace {
+
+std::atomic<std::size_t> allocations { 0 };
+std::atomic<std::size_t> deallocations { 0 };
+std::atomic<std::size_t> allocated_bytes { 0 };
+std::atomic<std::size_t> deallocated_bytes { 0 };
+
+constexpr auto header_size = alignof(std::max_align_t);
+
+}
+
+namespace benchmark {
+
+auto allocation_count() noexcept -> std::size_t
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+auto live_allocation_count() noexcept -> std::size_t
+{
+    return allocations.load(std::memory_order_relaxed) -
+           deallocations.load(std::memory_order_relaxed);
+}
+
+auto allocated_byte_count() noexcept -> std::size_t
+{
+    return allocated_bytes.load(std::memory_order_relaxed);
+}
+
+auto live_byte_count() noexcept -> std::size_t
+{
+    return allocated_bytes.load(std::memory_order_relaxed) -
+           deallocated_bytes.load(std::memory_order_relaxed);
+}
+
+}
+
+void * operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+
+    if(auto p = static_cast<char *>(std::malloc(header_size + size)))
+    {
+        *reinterpret_cast<std::size_t *>(p) = size;
+        return p + header_size;
+    }
+
+    throw std::bad_alloc { };
+}
+
+void operator delete(void * p) noexcept
+{
+    if(!p)
+        return;
+
+    auto const block = static_cast<char *>(p) - header_size;
+    deallocations.fetch_add(1, std::memory_order_relaxed);
+    deallocated_bytes.fetch_add(*reinterpret_cast<std::size_t *>(block),
+                                std::memory_order_relaxed);
+    std::free(block);
+}
+
+void operator delete(void * p, std::size_t) noexcept { operator delete(p); }
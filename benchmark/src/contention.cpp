@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <observable/subject.hpp>
+#include "harness.h"
+
+// Contention benchmark for subject<void(int)> and its observer collection.
+//
+// Usage: bench_contention [--json <file>] [--duration <ms>] [--max-threads <n>]
+//
+// Each run starts N notifier threads, which call notify() in a loop, and M
+// churn threads, which subscribe and immediately unsubscribe an observer, all
+// against the same subject, for a fixed duration. It reports:
+//
+//  - notify and churn throughput, to show how they scale with thread count;
+//  - notify latency percentiles, sampled every 64 calls; readers never wait
+//    for gc(), so a growing p99 shows contention on shared cache lines, not
+//    blocking;
+//  - the peak number of live allocations above the starting point, sampled
+//    every millisecond, and the number left when the threads stop. Removed
+//    observers are only freed once no reader can still see them, so long
+//    notify() calls starve gc() and make these numbers grow.
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+thread_local std::size_t calls = 0;
+
+struct config
+{
+    std::size_t notifiers;
+    std::size_t churners;
+    std::chrono::nanoseconds hold;
+};
+
+struct outcome
+{
+    config cfg;
+    double notifies_per_sec;
+    double churns_per_sec;
+    double notify_p50_ns;
+    double notify_p99_ns;
+    double notify_max_ns;
+    std::size_t peak_backlog;
+    std::size_t final_backlog;
+};
+
+// Per-thread results, padded so threads do not share cache lines.
+struct alignas(64) worker
+{
+    std::size_t operations = 0;
+    std::vector<double> latencies;
+};
+
+void spin_for(std::chrono::nanoseconds d)
+{
+    auto const end = clock::now() + d;
+    while(clock::now() < end)
+        ;
+}
+
+auto percentile(std::vector<double> const & sorted, double p)
+{
+    if(sorted.empty())
+        return 0.0;
+
+    return sorted[static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5)];
+}
+
+auto run(config const & cfg, std::chrono::milliseconds duration) -> outcome
+{
+    auto subject = observable::subject<void(int)> { };
+
+    // A fixed set of observers, one optionally holding readers inside the
+    // collection for a while.
+    std::vector<observable::infinite_subscription> subs;
+    for(auto i = 0; i < 16; ++i)
+        subs.push_back(subject.subscribe([](int v) { calls += static_cast<std::size_t>(v); }));
+
+    if(cfg.hold.count() > 0)
+        subs.push_back(subject.subscribe([h = cfg.hold](int) { spin_for(h); }));
+
+    std::vector<worker> notifiers(cfg.notifiers);
+    std::vector<worker> churners(cfg.churners);
+    for(auto && w : notifiers)
+        w.latencies.reserve(1 << 16);
+
+    std::atomic<bool> start { false };
+    std::atomic<bool> stop { false };
+    std::vector<std::thread> threads;
+
+    for(auto && w : notifiers)
+        threads.emplace_back([&, w = &w]() {
+            while(!start.load())
+                std::this_thread::yield();
+
+            for(auto n = std::size_t { 0 }; !stop.load(std::memory_order_relaxed); ++n)
+            {
+                if(n % 64 == 0 && w->latencies.size() < w->latencies.capacity())
+                {
+                    auto const t0 = clock::now();
+                    subject.notify(1);
+                    auto const t = clock::now() - t0;
+                    w->latencies.push_back(std::chrono::duration<double, std::nano> { t }.count());
+                }
+                else
+                {
+                    subject.notify(1);
+                }
+
+                ++w->operations;
+            }
+        });
+
+    for(auto && w : churners)
+        threads.emplace_back([&, w = &w]() {
+            while(!start.load())
+                std::this_thread::yield();
+
+            while(!stop.load(std::memory_order_relaxed))
+            {
+                auto sub = subject.subscribe([](int v) { calls += static_cast<std::size_t>(v); });
+                sub.unsubscribe();
+                ++w->operations;
+            }
+        });
+
+    auto const baseline = benchmark::live_allocation_count();
+    auto peak = std::size_t { 0 };
+
+    auto const begin = clock::now();
+    start.store(true);
+
+    while(clock::now() - begin < duration)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds { 1 });
+        auto const live = benchmark::live_allocation_count();
+        peak = std::max(peak, live > baseline ? live - baseline : 0);
+    }
+
+    stop.store(true);
+    for(auto && t : threads)
+        t.join();
+
+    auto const elapsed = std::chrono::duration<double> { clock::now() - begin }.count();
+    auto const live = benchmark::live_allocation_count();
+
+    auto total = [](std::vector<worker> const & ws) {
+        auto sum = std::size_t { 0 };
+        for(auto && w : ws)
+            sum += w.operations;
+        return static_cast<double>(sum);
+    };
+
+    std::vector<double> latencies;
+    for(auto && w : notifiers)
+        latencies.insert(latencies.end(), w.latencies.begin(), w.latencies.end());
+    std::sort(latencies.begin(), latencies.end());
+
+    return outcome { cfg,
+                     total(notifiers) / elapsed,
+                     total(churners) / elapsed,
+                     percentile(latencies, 0.50),
+                     percentile(latencies, 0.99),
+                     latencies.empty() ? 0.0 : latencies.back(),
+                     peak,
+                     live > baseline ? live - baseline : 0 };
+}
+
+void print_header()
+{
+    std::cout << std::right
+              << std::setw(10) << "notifiers"
+              << std::setw(10) << "churners"
+              << std::setw(10) << "hold ns"
+              << std::setw(14) << "notify/s"
+              << std::setw(14) << "churn/s"
+              << std::setw(12) << "p50 ns"
+              << std::setw(12) << "p99 ns"
+              << std::setw(14) << "peak backlog"
+              << std::setw(14) << "end backlog" << "\n";
+}
+
+void print(outcome const & o)
+{
+    std::cout << std::right << std::fixed << std::setprecision(0)
+              << std::setw(10) << o.cfg.notifiers
+              << std::setw(10) << o.cfg.churners
+              << std::setw(10) << o.cfg.hold.count()
+              << std::setw(14) << o.notifies_per_sec
+              << std::setw(14) << o.churns_per_sec
+              << std::setw(12) << o.notify_p50_ns
+              << std::setw(12) << o.notify_p99_ns
+              << std::setw(14) << o.peak_backlog
+              << std::setw(14) << o.final_backlog << std::endl;
+}
+
+void write_json(std::ostream & out, std::vector<outcome> const & outcomes)
+{
+    out << "{\n"
+        << "  \"context\": {\n"
+        << "    \"num_cpus\": " << std::thread::hardware_concurrency() << "\n"
+        << "  },\n"
+        << "  \"benchmarks\": [";
+
+    auto first = true;
+    for(auto && o : outcomes)
+    {
+        out << (first ? "\n" : ",\n");
+        first = false;
+
+        out << "    {\n"
+            << "      \"name\": \"subject/contention/notifiers:" << o.cfg.notifiers
+                << "/churners:" << o.cfg.churners
+                << "/hold_ns:" << o.cfg.hold.count() << "\",\n"
+            << "      \"parameters\": { \"notifiers\": " << o.cfg.notifiers
+                << ", \"churners\": " << o.cfg.churners
+                << ", \"hold_ns\": " << o.cfg.hold.count() << " },\n"
+            << "      \"notifies_per_second\": " << o.notifies_per_sec << ",\n"
+            << "      \"churns_per_second\": " << o.churns_per_sec << ",\n"
+            << "      \"notify_p50_ns\": " << o.notify_p50_ns << ",\n"
+            << "      \"notify_p99_ns\": " << o.notify_p99_ns << ",\n"
+            << "      \"notify_max_ns\": " << o.notify_max_ns << ",\n"
+            << "      \"peak_backlog_allocations\": " << o.peak_backlog << ",\n"
+            << "      \"final_backlog_allocations\": " << o.final_backlog << "\n"
+            << "    }";
+    }
+
+    out << "\n  ]\n}\n";
+}
+
+}
+
+int main(int argc, char * argv[])
+{
+    auto duration = std::chrono::milliseconds { 200 };
+    auto max_threads = std::size_t { 64 };
+    auto json_path = std::string { };
+
+    for(auto i = 1; i < argc; ++i)
+    {
+        auto const arg = std::string { argv[i] };
+        auto const has_value = i + 1 < argc;
+
+        if(arg == "--json" && has_value)
+            json_path = argv[++i];
+        else if(arg == "--duration" && has_value)
+            duration = std::chrono::milliseconds { std::stoul(argv[++i]) };
+        else if(arg == "--max-threads" && has_value)
+            max_threads = std::stoul(argv[++i]);
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--json <file>] [--duration <ms>]"
+                      << " [--max-threads <n>]\n";
+            return 1;
+        }
+    }
+
+    std::vector<config> configs;
+
+    // Throughput scaling.
+    for(auto notifiers = std::size_t { 1 }; notifiers <= max_threads; notifiers *= 2)
+        for(auto churners : { 0u, 1u, 4u })
+            if(notifiers + churners <= max_threads)
+                configs.push_back({ notifiers, churners, std::chrono::nanoseconds { 0 } });
+
+    // Starved gc(): readers stay inside the collection for a while.
+    for(auto hold : { 1'000, 10'000, 100'000 })
+        configs.push_back({ std::min<std::size_t>(4, max_threads), 4,
+                            std::chrono::nanoseconds { hold } });
+
+    std::vector<outcome> outcomes;
+    print_header();
+
+    for(auto && cfg : configs)
+    {
+        outcomes.push_back(run(cfg, duration));
+        print(outcomes.back());
+    }
+
+    if(!json_path.empty())
+    {
+        auto out = std::ofstream { json_path };
+        write_json(out, outcomes);
+
+        if(!out)
+        {
+            std::cerr << "Could not write " << json_path << "\n";
+            return 1;
+        }
+    }
+
+    return 0;
+}
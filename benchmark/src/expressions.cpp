@@ -37,6 +37,28 @@ void bench()
     }
 
     benchmark::print("Normal expression", duration, "Observable expression", expr_duration);
+
+    std::chrono::nanoseconds fused_duration;
+    {
+        auto i = observable::value<int> { };
+        auto j = observable::value<int> { };
+        auto k = observable::value<int> { };
+
+        using observable::fuse;
+        auto result = observable::observe(500 + (fuse(i) * j * k) - (1 + fuse(k) + j));
+        result.subscribe([](auto && x) { consume(x); }).release();
+
+        fused_duration = benchmark::time_run([&]() {
+            for(i = 0; i.get() < loop_count; i = i.get() + 1)
+                for(j = 0; j.get() < loop_count; j = j.get() + 1)
+                    for(k = 0; k.get() < loop_count; k = k.get() + 1)
+                        ;
+        }, repeat_count);
+    }
+
+    benchmark::print("Normal expression", duration, "Fused expression", fused_duration);
+    benchmark::print("Observable expression", expr_duration,
+                     "Fused expression", fused_duration);
 }
 
 int main()
@@ -1,6 +1,7 @@
 #include <cassert>
 #include <chrono>
 #include <iostream>
+#include <observable/static_subject.hpp>
 #include <observable/subject.hpp>
 #include "utility.h"
 
@@ -25,6 +26,17 @@ void bench()
     dummy = 0;
 
     benchmark::print("Function", function_duration, "Subject", subject_duration);
+
+    auto static_subject = observable::make_static_subject<void(int)>(function);
+
+    auto static_duration = benchmark::time_run([&]() { static_subject.notify(1); },
+                                               repeat_count);
+
+    assert(dummy == repeat_count);
+    dummy = 0;
+
+    benchmark::print("Function", function_duration,
+                     "Static subject", static_duration);
 }
 
 int main()
@@ -0,0 +1,491 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <ctime>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace benchmark {
+
+//! Number of calls to the global operator new since the program started.
+//!
+//! This is counted by the replacement operators in allocations.cpp; targets
+//! that do not link it must not call this function.
+auto allocation_count() noexcept -> std::size_t;
+
+//! Number of allocations made by the global operator new that have not been
+//! freed yet.
+//!
+//! \see allocation_count()
+auto live_allocation_count() noexcept -> std::size_t;
+
+//! Number of bytes requested from the global operator new since the program
+//! started.
+//!
+//! This does not include the overhead of the underlying allocator.
+//!
+//! \see allocation_count()
+auto allocated_byte_count() noexcept -> std::size_t;
+
+//! Number of bytes requested from the global operator new that have not been
+//! freed yet.
+//!
+//! \see allocated_byte_count()
+auto live_byte_count() noexcept -> std::size_t;
+
+//! Named parameter of a benchmark run, like ``{ "subscribers", 64 }``.
+using parameter = std::pair<std::string, std::size_t>;
+
+//! Statistics of one benchmark run.
+struct result
+{
+    std::string name;
+    std::vector<parameter> parameters;
+    std::size_t batch_size;
+    std::size_t samples;
+    std::size_t operations;
+    double ns_min;
+    double ns_mean;
+    double ns_p50;
+    double ns_p99;
+    double allocations;
+
+    //! Size of the measured object; only set by footprint runs.
+    std::size_t object_size = 0;
+
+    //! Heap bytes kept alive per measured object; only set by footprint runs.
+    double heap_bytes = 0;
+};
+
+//! Settings shared by all runs of a suite.
+struct settings
+{
+    //! Number of timed batches to collect for each run.
+    std::size_t samples = 200;
+
+    //! Once warmed up, a run stops collecting samples after this time.
+    std::chrono::milliseconds max_time { 500 };
+
+    //! Batches are grown during warmup until they take at least this long.
+    std::chrono::microseconds min_batch_time { 20 };
+
+    //! Maximum number of operations in a batch.
+    std::size_t max_batch_size = 1 << 16;
+
+    //! Only run benchmarks whose full name contains this string.
+    std::string filter;
+};
+
+//! Drives the timing loop of a benchmark run.
+//!
+//! The benchmark body calls next_batch() in a loop. Inside the loop, it
+//! prepares batch_size() operations, then performs them inside time(). Only
+//! the code inside time() is measured, so preparation and cleanup can be done
+//! around it.
+//!
+//!     while(s.next_batch())
+//!     {
+//!         auto const n = s.batch_size();
+//!         s.time([&]() { for(auto i = n; i > 0; --i) subject.notify(1); }, n);
+//!     }
+//!
+//! The first batches are a warmup: their size is doubled until a batch takes
+//! at least settings::min_batch_time, then a few more are run and discarded.
+//! Each remaining batch becomes one sample.
+class state
+{
+public:
+    explicit state(settings const & s) : settings_ { s } { }
+
+    //! Return true while more batches must be run.
+    auto next_batch() -> bool
+    {
+        if(warmup_ > 0)
+            return true;
+
+        if(samples_.empty())
+            measure_start_ = clock::now();
+
+        return samples_.size() < settings_.samples &&
+               clock::now() - measure_start_ < settings_.max_time;
+    }
+
+    //! Number of operations the current batch should perform.
+    auto batch_size() const noexcept { return batch_size_; }
+
+    //! Time a batch of operations.
+    //!
+    //! \param fun Callable that performs the operations.
+    //! \param operations Number of operations that ``fun`` performs. This is
+    //!                   usually batch_size().
+    template <typename Fun>
+    void time(Fun && fun, std::size_t operations)
+    {
+        auto const allocs = allocation_count();
+        auto const start = clock::now();
+        fun();
+        auto const duration = clock::now() - start;
+        auto const allocated = allocation_count() - allocs;
+
+        if(warmup_ > 0)
+        {
+            if(duration < settings_.min_batch_time &&
+               batch_size_ < settings_.max_batch_size)
+                batch_size_ *= 2;
+            else
+                --warmup_;
+
+            return;
+        }
+
+        auto const ns = std::chrono::duration<double, std::nano> { duration }.count();
+        samples_.push_back(ns / static_cast<double>(std::max<std::size_t>(operations, 1)));
+        operations_ += operations;
+        allocations_ += allocated;
+    }
+
+    //! Compute the statistics of all collected samples.
+    auto summarize(std::string name, std::vector<parameter> parameters) const -> result
+    {
+        auto sorted = samples_;
+        std::sort(sorted.begin(), sorted.end());
+
+        auto const percentile = [&](double p) {
+            if(sorted.empty())
+                return 0.0;
+
+            auto const index = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+            return sorted[index];
+        };
+
+        auto sum = 0.0;
+        for(auto s : sorted)
+            sum += s;
+
+        auto const count = static_cast<double>(std::max<std::size_t>(sorted.size(), 1));
+        auto const ops = static_cast<double>(std::max<std::size_t>(operations_, 1));
+
+        return result { std::move(name),
+                        std::move(parameters),
+                        batch_size_,
+                        sorted.size(),
+                        operations_,
+                        sorted.empty() ? 0.0 : sorted.front(),
+                        sum / count,
+                        percentile(0.50),
+                        percentile(0.99),
+                        static_cast<double>(allocations_) / ops,
+                        0,
+                        0 };
+    }
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    settings const & settings_;
+    std::size_t batch_size_ = 1;
+    std::size_t warmup_ = 3;
+    std::vector<double> samples_;
+    std::size_t operations_ = 0;
+    std::size_t allocations_ = 0;
+    clock::time_point measure_start_;
+};
+
+//! Collection of benchmark runs, and where their results go.
+class suite
+{
+public:
+    explicit suite(settings s) : settings_ { std::move(s) } { }
+
+    //! Run a benchmark, unless it is excluded by the filter.
+    //!
+    //! \param name Name of the benchmark, like ``"subject/notify"``.
+    //! \param parameters Values of the swept parameters for this run.
+    //! \param body Callable compatible with ``void(state &)``.
+    template <typename Body>
+    void run(std::string name, std::vector<parameter> parameters, Body && body)
+    {
+        if(full_name(name, parameters).find(settings_.filter) == std::string::npos)
+            return;
+
+        auto s = state { settings_ };
+        body(s);
+
+        results_.push_back(s.summarize(std::move(name), std::move(parameters)));
+        print(results_.back());
+    }
+
+    //! Measure the memory footprint of ``count`` objects, unless it is
+    //! excluded by the filter.
+    //!
+    //! Each object is constructed in place, from the object returned by
+    //! ``construct``, so moving it is not part of the measurement. All objects
+    //! are kept alive until the last one has been constructed; costs shared by
+    //! them are spread over all of them.
+    //!
+    //! The result's allocations are per object, and its operations are the
+    //! number of objects.
+    //!
+    //! \param name Name of the benchmark, like ``"value/int"``.
+    //! \param parameters Values of the swept parameters for this run. A
+    //!                   ``count`` parameter is appended.
+    //! \param construct Callable that returns a new object.
+    template <typename Construct>
+    void footprint(std::string name, std::vector<parameter> parameters,
+                   std::size_t count, Construct && construct)
+    {
+        parameters.emplace_back("count", count);
+        if(full_name(name, parameters).find(settings_.filter) == std::string::npos)
+            return;
+
+        using object_type = decltype(construct());
+        using storage_type = std::aligned_storage_t<sizeof(object_type),
+                                                    alignof(object_type)>;
+
+        auto const storage = std::make_unique<storage_type[]>(count);
+        auto constructed = std::size_t { 0 };
+
+        struct destroy
+        {
+            ~destroy()
+            {
+                for(auto i = size; i > 0; --i)
+                    reinterpret_cast<object_type *>(&objects[i - 1])->~object_type();
+            }
+
+            storage_type * objects;
+            std::size_t const & size;
+        } const d { storage.get(), constructed };
+
+        auto const allocs = allocation_count();
+        auto const bytes = live_byte_count();
+
+        for(; constructed < count; ++constructed)
+            ::new (&storage[constructed]) object_type(construct());
+
+        auto const n = static_cast<double>(std::max<std::size_t>(count, 1));
+
+        auto r = result { };
+        r.name = std::move(name);
+        r.parameters = std::move(parameters);
+        r.operations = count;
+        r.allocations = static_cast<double>(allocation_count() - allocs) / n;
+        r.object_size = sizeof(object_type);
+        r.heap_bytes = static_cast<double>(live_byte_count() - bytes) / n;
+
+        results_.push_back(std::move(r));
+        print(results_.back());
+    }
+
+    //! Print the table header of timing runs.
+    void print_header() const
+    {
+        std::cout << std::left << std::setw(48) << "benchmark" << std::right
+                  << std::setw(12) << "p50 ns/op"
+                  << std::setw(12) << "p99 ns/op"
+                  << std::setw(12) << "mean ns/op"
+                  << std::setw(12) << "allocs/op"
+                  << std::setw(10) << "samples" << "\n";
+    }
+
+    //! Print the table header of footprint runs.
+    void print_footprint_header() const
+    {
+        std::cout << std::left << std::setw(48) << "benchmark" << std::right
+                  << std::setw(12) << "sizeof"
+                  << std::setw(12) << "allocs/obj"
+                  << std::setw(12) << "heap B/obj"
+                  << std::setw(12) << "total B/obj" << "\n";
+    }
+
+    //! Write all results as JSON.
+    void write_json(std::ostream & out) const
+    {
+        auto const now = std::time(nullptr);
+        char date[32] { };
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+        out << "{\n"
+            << "  \"context\": {\n"
+            << "    \"date\": \"" << date << "\",\n"
+            << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+#if defined(NDEBUG)
+            << "    \"build_type\": \"release\",\n"
+#else
+            << "    \"build_type\": \"debug\",\n"
+#endif
+            << "    \"samples\": " << settings_.samples << "\n"
+            << "  },\n"
+            << "  \"benchmarks\": [";
+
+        auto first = true;
+        for(auto && r : results_)
+        {
+            out << (first ? "\n" : ",\n");
+            first = false;
+
+            out << "    {\n"
+                << "      \"name\": \"" << full_name(r.name, r.parameters) << "\",\n"
+                << "      \"run_name\": \"" << r.name << "\",\n"
+                << "      \"parameters\": {";
+
+            for(auto i = 0u; i < r.parameters.size(); ++i)
+                out << (i ? ", " : " ") << "\"" << r.parameters[i].first << "\": "
+                    << r.parameters[i].second << (i + 1 == r.parameters.size() ? " " : "");
+
+            out << "},\n";
+
+            if(r.object_size)
+            {
+                out << "      \"object_size\": " << r.object_size << ",\n"
+                    << "      \"allocations_per_object\": " << r.allocations << ",\n"
+                    << "      \"heap_bytes_per_object\": " << r.heap_bytes << ",\n"
+                    << "      \"bytes_per_object\": "
+                    << static_cast<double>(r.object_size) + r.heap_bytes << "\n"
+                    << "    }";
+                continue;
+            }
+
+            out << "      \"batch_size\": " << r.batch_size << ",\n"
+                << "      \"samples\": " << r.samples << ",\n"
+                << "      \"operations\": " << r.operations << ",\n"
+                << "      \"time_unit\": \"ns\",\n"
+                << "      \"min\": " << r.ns_min << ",\n"
+                << "      \"mean\": " << r.ns_mean << ",\n"
+                << "      \"p50\": " << r.ns_p50 << ",\n"
+                << "      \"p99\": " << r.ns_p99 << ",\n"
+                << "      \"allocations_per_op\": " << r.allocations << "\n"
+                << "    }";
+        }
+
+        out << "\n  ]\n}\n";
+    }
+
+    //! All results collected so far.
+    auto results() const noexcept -> std::vector<result> const & { return results_; }
+
+private:
+    static auto full_name(std::string const & name,
+                          std::vector<parameter> const & parameters) -> std::string
+    {
+        auto full = name;
+        for(auto && p : parameters)
+            full += "/" + p.first + ":" + std::to_string(p.second);
+
+        return full;
+    }
+
+    static void print(result const & r)
+    {
+        if(r.object_size)
+        {
+            std::cout << std::left << std::setw(48) << full_name(r.name, r.parameters)
+                      << std::right << std::fixed << std::setprecision(2)
+                      << std::setw(12) << r.object_size
+                      << std::setw(12) << r.allocations
+                      << std::setw(12) << r.heap_bytes
+                      << std::setw(12) << static_cast<double>(r.object_size) + r.heap_bytes
+                      << std::endl;
+            return;
+        }
+
+        std::cout << std::left << std::setw(48) << full_name(r.name, r.parameters)
+                  << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(12) << r.ns_p50
+                  << std::setw(12) << r.ns_p99
+                  << std::setw(12) << r.ns_mean
+                  << std::setprecision(2)
+                  << std::setw(12) << r.allocations
+                  << std::setw(10) << r.samples << std::endl;
+    }
+
+private:
+    settings settings_;
+    std::vector<result> results_;
+};
+
+//! Set of threads that repeatedly run the same function together.
+//!
+//! Threads are started once and wait, spinning, between runs, so a run does
+//! not include the cost of starting threads.
+class thread_team
+{
+public:
+    //! Create a team. The calling thread is part of the team, so
+    //! ``count - 1`` threads are started.
+    explicit thread_team(std::size_t count)
+    {
+        for(auto i = std::size_t { 1 }; i < count; ++i)
+            threads_.emplace_back([this, i]() { work(i); });
+    }
+
+    //! Number of threads in the team, including the caller.
+    auto size() const noexcept { return threads_.size() + 1; }
+
+    //! Call ``fun(thread_index)`` on every thread and wait for all to return.
+    void run(std::function<void(std::size_t)> fun)
+    {
+        fun_ = std::move(fun);
+        pending_.store(threads_.size(), std::memory_order_relaxed);
+        generation_.fetch_add(1, std::memory_order_release);
+
+        fun_(0);
+
+        while(pending_.load(std::memory_order_acquire) > 0)
+            std::this_thread::yield();
+    }
+
+    //! Destructor. Stops all threads.
+    ~thread_team()
+    {
+        stop_.store(true, std::memory_order_relaxed);
+        generation_.fetch_add(1, std::memory_order_release);
+
+        for(auto && t : threads_)
+            t.join();
+    }
+
+    thread_team(thread_team const &) =delete;
+    auto operator=(thread_team const &) -> thread_team & =delete;
+
+private:
+    void work(std::size_t index)
+    {
+        auto seen = std::size_t { 0 };
+        for(;;)
+        {
+            auto current = generation_.load(std::memory_order_acquire);
+            while(current == seen)
+            {
+                std::this_thread::yield();
+                current = generation_.load(std::memory_order_acquire);
+            }
+
+            seen = current;
+            if(stop_.load(std::memory_order_relaxed))
+                return;
+
+            fun_(index);
+            pending_.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+
+private:
+    std::vector<std::thread> threads_;
+    std::function<void(std::size_t)> fun_;
+    std::atomic<std::size_t> generation_ { 0 };
+    std::atomic<std::size_t> pending_ { 0 };
+    std::atomic<bool> stop_ { false };
+};
+
+}
@@ -0,0 +1,147 @@
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <observable/observable.hpp>
+#include "harness.h"
+
+// Memory footprint of the core types of the library.
+//
+// Usage: bench_memory [--json <file>] [--filter <text>]
+//
+// Each type is measured for a sweep of object counts. For each run, the table
+// shows the inline size of an object and, per object, the number of heap
+// allocations made to create it and the number of heap bytes it keeps alive.
+// Heap bytes are the requested sizes; allocator overhead is not included.
+// Costs that are shared by all objects, like the state of the subject that
+// subscriptions are added to, are spread over the objects, so runs with a
+// single object show the fixed costs.
+
+using benchmark::suite;
+
+namespace {
+
+auto const counts = { 1u, 16u, 256u, 4096u };
+
+// Build a chain of ``depth`` additions on top of a value.
+auto make_chain(observable::value<int> & v, std::size_t depth)
+{
+    auto node = v + 1;
+    for(auto i = std::size_t { 1 }; i < depth; ++i)
+        node = std::move(node) + 1;
+
+    return node;
+}
+
+void measure_subjects(suite & s)
+{
+    for(auto count : counts)
+        s.footprint("subject/empty", { }, count, []() {
+            return observable::subject<void(int)> { };
+        });
+
+    for(auto count : counts)
+    {
+        auto subject = observable::subject<void(int)> { };
+        s.footprint("subject/subscription", { }, count, [&]() {
+            return observable::infinite_subscription {
+                subject.subscribe([](int) { })
+            };
+        });
+    }
+}
+
+void measure_values(suite & s)
+{
+    for(auto count : counts)
+        s.footprint("value/int", { }, count, []() {
+            return observable::value<int> { 1 };
+        });
+
+    for(auto count : counts)
+    {
+        auto v = observable::value<int> { 1 };
+        s.footprint("value/subscription", { }, count, [&]() {
+            return observable::infinite_subscription {
+                v.subscribe([](int) { })
+            };
+        });
+    }
+}
+
+void measure_expressions(suite & s)
+{
+    for(auto depth : { 1u, 4u, 16u, 64u })
+        for(auto count : counts)
+        {
+            auto v = observable::value<int> { 1 };
+            s.footprint("expression/node", { { "depth", depth } }, count, [&]() {
+                return make_chain(v, depth);
+            });
+        }
+
+    for(auto depth : { 1u, 4u, 16u })
+        for(auto count : counts)
+        {
+            auto v = observable::value<int> { 1 };
+            s.footprint("observe/immediate", { { "depth", depth } }, count, [&]() {
+                return observable::observe(make_chain(v, depth));
+            });
+        }
+
+    for(auto depth : { 1u, 4u, 16u })
+        for(auto count : counts)
+        {
+            auto ud = observable::updater { };
+            auto v = observable::value<int> { 1 };
+            s.footprint("observe/updater", { { "depth", depth } }, count, [&]() {
+                return observable::observe(ud, make_chain(v, depth));
+            });
+        }
+}
+
+}
+
+int main(int argc, char * argv[])
+{
+    auto settings = benchmark::settings { };
+    auto json_path = std::string { };
+
+    for(auto i = 1; i < argc; ++i)
+    {
+        auto const arg = std::string { argv[i] };
+        auto const has_value = i + 1 < argc;
+
+        if(arg == "--json" && has_value)
+            json_path = argv[++i];
+        else if(arg == "--filter" && has_value)
+            settings.filter = argv[++i];
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--json <file>] [--filter <text>]\n";
+            return 1;
+        }
+    }
+
+    auto s = suite { settings };
+    s.print_footprint_header();
+
+    measure_subjects(s);
+    measure_values(s);
+    measure_expressions(s);
+
+    if(!json_path.empty())
+    {
+        auto out = std::ofstream { json_path };
+        s.write_json(out);
+
+        if(!out)
+        {
+            std::cerr << "Could not write " << json_path << "\n";
+            return 1;
+        }
+    }
+
+    return 0;
+}
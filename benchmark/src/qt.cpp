@@ -37,6 +37,21 @@ void bench()
     receiver.dummy = 0;
 
     benchmark::print("Qt signal-slot", qt_duration, "Subject", subject_duration);
+
+    using fast_policy = observable::inline_contiguous_subject_policy;
+    auto fast_subject = observable::subject<void(int), fast_policy> { };
+
+    for(auto i = 0; i < sub_count; ++i)
+        fast_subject.subscribe(receiver, &Receiver::inc).release();
+
+    auto fast_duration = benchmark::time_run([&]() { fast_subject.notify(1); },
+                                             repeat_count);
+
+    assert(receiver.dummy == repeat_count * sub_count);
+    receiver.dummy = 0;
+
+    benchmark::print("Qt signal-slot", qt_duration,
+                     "Inline contiguous subject", fast_duration);
 }
 
 int main()
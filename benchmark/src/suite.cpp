@@ -0,0 +1,685 @@
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <observable/observable.hpp>
+#if defined(__unix__) || defined(__APPLE__)
+#include <cstdio>
+#include <observable/recording.hpp>
+#define OBSERVABLE_BENCHMARK_RECORDING
+#endif
+#include "harness.h"
+#include "utility.h"
+
+// Microbenchmark suite for the core operations of the library.
+//
+// Usage: bench_suite [--json <file>] [--filter <text>] [--samples <count>]
+//                    [--max-time <ms>]
+//
+// Each benchmark is run for a sweep of parameters. Results are printed as a
+// table and, if requested, written as JSON that can be compared between
+// releases.
+
+static volatile std::size_t dummy = 0;
+NOINLINE void consume(std::size_t v) { dummy += v; }
+
+using benchmark::state;
+using benchmark::suite;
+
+namespace {
+
+// Subscribe ``count`` observers that do not do anything interesting.
+template <typename Subject>
+auto subscribe_many(Subject & subject, std::size_t count)
+{
+    auto subs = std::vector<observable::infinite_subscription> { };
+    subs.reserve(count);
+
+    for(auto i = count; i > 0; --i)
+        subs.push_back(subject.subscribe([](auto && ...) { consume(1); }));
+
+    return subs;
+}
+
+// Build a chain of ``depth`` additions on top of a value.
+auto make_chain(observable::value<int> & v, std::size_t depth)
+{
+    auto node = v + 1;
+    for(auto i = std::size_t { 1 }; i < depth; ++i)
+        node = std::move(node) + 1;
+
+    return node;
+}
+
+void bench_subject(suite & s)
+{
+    for(auto subscribers : { 0u, 16u, 256u, 4096u })
+        s.run("subject/subscribe", { { "subscribers", subscribers } }, [&](state & st) {
+            auto subject = observable::subject<void(int)> { };
+            auto const existing = subscribe_many(subject, subscribers);
+            auto subs = std::vector<observable::infinite_subscription> { };
+
+            while(st.next_batch())
+            {
+                auto const n = st.batch_size();
+                subs.reserve(n);
+                st.time([&]() {
+                    for(auto i = n; i > 0; --i)
+                        subs.push_back(subject.subscribe([](int v) { consume(v); }));
+                }, n);
+
+                subs.clear();
+            }
+        });
+
+    for(auto subscribers : { 0u, 16u, 256u, 4096u })
+        s.run("subject/unsubscribe", { { "subscribers", subscribers } }, [&](state & st) {
+            auto subject = observable::subject<void(int)> { };
+            auto const existing = subscribe_many(subject, subscribers);
+
+            while(st.next_batch())
+            {
+                auto const n = st.batch_size();
+                auto subs = subscribe_many(subject, n);
+                st.time([&]() {
+                    for(auto && sub : subs)
+                        sub.unsubscribe();
+                }, n);
+            }
+        });
+
+    auto const churn = [&](auto policy, char const * name) {
+        using policy_type = decltype(policy);
+        s.run(name, { }, [&](state & st) {
+            auto subject = observable::subject<void(int), policy_type> { };
+            while(st.next_batch())
+            {
+                auto const n = st.batch_size();
+                st.time([&]() {
+                    for(auto i = n; i > 0; --i)
+                        subject.subscribe([](int v) { consume(v); }).unsubscribe();
+                }, n);
+            }
+        });
+    };
+
+    churn(observable::subject_policy { }, "subject/churn");
+    churn(observable::pooled_subject_policy { }, "subject/churn_pooled");
+
+    for(auto subscribers : { 1u, 16u, 256u, 4096u })
+        s.run("subject/notify", { { "subscribers", subscribers } }, [&](state & st) {
+            auto subject = observable::subject<void(int)> { };
+            auto const subs = subscribe_many(subject, subscribers);
+
+            while(st.next_batch())
+            {
+                auto const n = st.batch_size();
+                st.time([&]() {
+                    for(auto i = n; i > 0; --i)
+                        subject.notify(1);
+                }, n);
+            }
+        });
+
+    // One consumer that handles ticks one by one or in batches.
+    for(auto count : { 1u, 16u, 256u })
+        s.run("subject/notify_buffered", { { "count", count } }, [&](state & st) {
+            auto subject = observable::subject<void(int)> { };
+            auto batches = observable::buffered(subject, count);
+            auto const sub = batches.subscribe([](observable::span<int const> b) {
+                auto total = std::size_t { 0 };
+                for(auto v : b)
+                    total += static_cast<std::size_t>(v);
+                consume(total);
+            });
+
+            while(st.next_batch())
+            {
+                auto const n = st.batch_size();
+                st.time([&]() {
+                    for(auto i = n; i > 0; --i)
+                        subject.notify(1);
+                }, n);
+            }
+        });
+
+#if defined(OBSERVABLE_BENCHMARK_RECORDING)
+    // Each notification is recorded as a 24 byte record.
+    s.run("subject/notify_recorded", { }, [&](state & st) {
+        auto const path = std::string { "bench_suite.rec" };
+        auto subject = observable::subject<void(int)> { };
+        auto const subs = subscribe_many(subject, 1);
+
+        while(st.next_batch())
+        {
+            auto const n = st.batch_size();
+            auto rec = observable::recorder { path, 8 + 24 * n };
+            rec.record(subject, 1);
+
+            st.time([&]() {
+                for(auto i = n; i > 0; --i)
+                    subject.notify(1);
+            }, n);
+        }
+
+        std::remove(path.c_str());
+    });
+
+    s.run("recording/replay", { }, [&](state & st) {
+        auto const path = std::string { "bench_suite.rec" };
+        auto subject = observable::subject<void(int)> { };
+        auto const subs = subscribe_many(subject, 1);
+
+        while(st.next_batch())
+        {
+            auto const n = st.batch_size();
+            {
+                auto rec = observable::recorder { path, 8 + 24 * n };
+                rec.record(subject, 1);
+                for(auto i = n; i > 0; --i)
+                    subject.notify(1);
+            }
+
+            auto rep = observable::replayer { path };
+            rep.bind(1, subject);
+
+            st.time([&]() { rep.replay(observable::replay_rate::maximum); }, n);
+        }
+
+        std::remove(path.c_str());
+    });
+#endif
+
+    for(auto subscribers : { 1u, 16u, 256u, 4096u })
+        s.run("subject/notify_single_threaded", { { "subscribers", subscribers } },
+              [&](state & st) {
+            using policy = observable::single_threaded_subject_policy;
+            auto subject = observable::subject<void(int), policy> { };
+            auto const subs = subscribe_many(subject, subscribers);
+
+            while(st.next_batch())
+            {
+                auto const n = st.batch_size();
+                st.time([&]() {
+                    for(auto i = n; i > 0; --i)
+                        subject.notify(1);
+                }, n);
+            }
+        });
+
+    for(auto threads : { 1u, 2u, 4u, 8u })
+        s.run("subject/notify_threads",
+              { { "threads", threads }, { "subscribers", 16 } },
+              [&](state & st) {
+            auto subject = observable::subject<void(int)> { };
+            auto const subs = subscribe_many(subject, 16);
+            benchmark::thread_team team { threads };
+
+            while(st.next_batch())
+            {
+                auto const n = st.batch_size();
+                st.time([&]() {
+                    team.run([&](std::size_t) {
+                        for(auto i = n; i > 0; --i)
+                            subject.notify(1);
+                    });
+                }, n * threads);
+            }
+        });
+
+    for(auto payload : { 8u, 64u, 1024u, 16384u })
+        s.run("subject/notify_payload",
+              { { "bytes", payload }, { "subscribers", 4 } },
+              [&](state & st) {
+            auto subject = observable::subject<void(std::vector<char>)> { };
+            auto const subs = subscribe_many(subject, 4);
+            auto const data = std::vector<char>(payload, 'x');
+
+            while(st.next_batch())
+            {
+                auto const n = st.batch_size();
+                st.time([&]() {
+                    for(auto i = n; i > 0; --i)
+                        subject.notify(data);
+                }, n);
+            }
+        });
+}
+
+void bench_value(suite & s)
+{
+    for(auto subscribers : { 1u, 16u, 256u })
+        s.run("value/set", { { "subscribers", subscribers } }, [&](state & st) {
+            auto v = observable::value<int> { };
+            auto const subs = subscribe_many(v, subscribers);
+            auto next = 0;
+
+            while(st.next_batch())
+            {
+                auto const n = st.batch_size();
+                st.time([&]() {
+                    for(auto i = n; i > 0; --i)
+                        v.set(++next);
+                }, n);
+            }
+        });
+
+    for(auto pending : { 16u, 256u, 4096u })
+        s.run("value/destroy_pending", { { "pending", pending } }, [&](state & st) {
+            auto values = std::vector<std::unique_ptr<observable::value<int>>> { };
+
+            while(st.next_batch())
+            {
+                for(auto i = pending; i > 0; --i)
+                    values.push_back(std::make_unique<observable::value<int>>(0));
+
+                observable::batch b;
+                for(auto && v : values)
+                    v->set(1);
+
+                st.time([&]() { values.clear(); }, pending);
+                b.commit();
+            }
+        });
+
+    for(auto payload : { 8u, 64u, 1024u, 16384u })
+        s.run("value/set_payload", { { "bytes", payload } }, [&](state & st) {
+            auto v = observable::value<std::vector<char>> { };
+            auto const subs = subscribe_many(v, 1);
+            std::vector<char> const data[] = { std::vector<char>(payload, 'a'),
+                                               std::vector<char>(payload, 'b') };
+
+            while(st.next_batch())
+            {
+                auto const n = st.batch_size();
+                st.time([&]() {
+                    for(auto i = n; i > 0; --i)
+                        v.set(data[i % 2]);
+                }, n);
+            }
+        });
+
+    s.run("value/construct", { }, [&](state & st) {
+        while(st.next_batch())
+        {
+            auto const n = st.batch_size();
+            st.time([&]() {
+                for(auto i = n; i > 0; --i)
+                {
+                    auto const v = observable::value<int> { static_cast<int>(i) };
+                    consume(static_cast<std::size_t>(v.get()));
+                }
+            }, n);
+        }
+    });
+
+    s.run("value/construct_compact", { }, [&](state & st) {
+        while(st.next_batch())
+        {
+            auto const n = st.batch_size();
+            st.time([&]() {
+                for(auto i = n; i > 0; --i)
+                {
+                    auto const v = observable::compact_value<int> { static_cast<int>(i) };
+                    consume(static_cast<std::size_t>(v.get()));
+                }
+            }, n);
+        }
+    });
+
+    s.run("value/construct_arena", { }, [&](state & st) {
+        while(st.next_batch())
+        {
+            auto const n = st.batch_size();
+            observable::expression_arena arena { 1 << 16 };
+            observable::expression_arena::scope const scope { arena };
+            st.time([&]() {
+                for(auto i = n; i > 0; --i)
+                {
+                    auto const v = observable::value<int, observable::arena_subject_policy> {
+                        static_cast<int>(i)
+                    };
+                    consume(static_cast<std::size_t>(v.get()));
+                }
+            }, n);
+        }
+    });
+
+    for(auto rows : { 16u, 1024u })
+        s.run("value/update_all_rows", { { "rows", rows } }, [&](state & st) {
+            auto values = std::vector<observable::value<double>>(rows);
+            auto subs = std::vector<observable::infinite_subscription> { };
+            for(auto && v : values)
+                subs.push_back(v.subscribe([](double) { }));
+
+            while(st.next_batch())
+            {
+                auto const n = st.batch_size();
+                st.time([&]() {
+                    for(auto i = n; i > 0; --i)
+                    {
+                        observable::batch b;
+                        for(auto && v : values)
+                            v = v.get() + 1.0;
+                    }
+                }, n);
+            }
+
+            for(auto && sub : subs)
+                sub.unsubscribe();
+        });
+
+    for(auto rows : { 16u, 1024u })
+        s.run("property_column/transform", { { "rows", rows } }, [&](state & st) {
+            auto column = observable::property_column<double> {
+                std::vector<double>(rows)
+            };
+            auto subs = std::vector<observable::infinite_subscription> { };
+            for(auto r = 0u; r < rows; ++r)
+                subs.push_back(column.subscribe(r, [](double) { }));
+
+            while(st.next_batch())
+            {
+                auto const n = st.batch_size();
+                st.time([&]() {
+                    for(auto i = n; i > 0; --i)
+                        column.transform([](double p) { return p + 1.0; });
+                }, n);
+            }
+
+            for(auto && sub : subs)
+                sub.unsubscribe();
+        });
+
+    s.run("concurrent_value/load_seqlock", { }, [&](state & st) {
+        observable::concurrent_value<int> v { 1 };
+        while(st.next_batch())
+        {
+            auto const n = st.batch_size();
+            st.time([&]() {
+                for(auto i = n; i > 0; --i)
+                    consume(static_cast<std::size_t>(v.load()));
+            }, n);
+        }
+    });
+
+    s.run("concurrent_value/read_rcu", { }, [&](state & st) {
+        observable::concurrent_value<std::string> v { std::string(64, 'a') };
+        while(st.next_batch())
+        {
+            auto const n = st.batch_size();
+            st.time([&]() {
+                for(auto i = n; i > 0; --i)
+                    consume(v.read([](std::string const & x) { return x.size(); }));
+            }, n);
+        }
+    });
+
+    for(auto depth : { 1u, 4u, 16u, 64u })
+        s.run("value/set_expression", { { "depth", depth } }, [&](state & st) {
+            auto v = observable::value<int> { };
+            auto result = observable::observe(make_chain(v, depth));
+            auto const sub = result.subscribe([](int r) { consume(static_cast<std::size_t>(r)); });
+            auto next = 0;
+
+            while(st.next_batch())
+            {
+                auto const n = st.batch_size();
+                st.time([&]() {
+                    for(auto i = n; i > 0; --i)
+                        v.set(++next);
+                }, n);
+            }
+        });
+
+    // Rolling windows cost the same per change, whatever their size.
+    for(auto window : { 16u, 1024u, 65536u })
+        s.run("value/set_rolling_max", { { "window", window } }, [&](state & st) {
+            auto v = observable::value<int> { };
+            auto result = observable::observe(observable::rolling_max(v, window));
+            auto const sub = result.subscribe([](int r) { consume(static_cast<std::size_t>(r)); });
+            auto seed = 1u;
+
+            while(st.next_batch())
+            {
+                auto const n = st.batch_size();
+                st.time([&]() {
+                    for(auto i = n; i > 0; --i)
+                    {
+                        seed = seed * 1103515245u + 12345u;
+                        v.set(static_cast<int>(seed >> 8));
+                    }
+                }, n);
+            }
+        });
+
+    // Changes to the branch that select() does not choose.
+    for(auto depth : { 1u, 4u, 16u, 64u })
+        s.run("value/set_unselected", { { "depth", depth } }, [&](state & st) {
+            auto cond = observable::value<bool> { true };
+            auto w = observable::value<int> { };
+            auto v = observable::value<int> { };
+            auto result = observable::observe(observable::select(cond, w, make_chain(v, depth)));
+            auto const sub = result.subscribe([](int r) { consume(static_cast<std::size_t>(r)); });
+            auto next = 0;
+
+            while(st.next_batch())
+            {
+                auto const n = st.batch_size();
+                st.time([&]() {
+                    for(auto i = n; i > 0; --i)
+                        v.set(++next);
+                }, n);
+            }
+        });
+}
+
+void bench_updater(suite & s)
+{
+    for(auto depth : { 1u, 4u, 16u, 64u })
+        s.run("updater/update_all", { { "depth", depth } }, [&](state & st) {
+            auto ud = observable::updater { };
+            auto v = observable::value<int> { };
+            auto result = observable::observe(ud, make_chain(v, depth));
+            auto const sub = result.subscribe([](int r) { consume(static_cast<std::size_t>(r)); });
+            auto next = 0;
+
+            while(st.next_batch())
+            {
+                auto const n = st.batch_size();
+                st.time([&]() {
+                    for(auto i = n; i > 0; --i)
+                    {
+                        v.set(++next);
+                        ud.update_all();
+                    }
+                }, n);
+            }
+        });
+
+    for(auto expressions : { 1u, 16u, 256u })
+        s.run("updater/update_all_idle", { { "expressions", expressions } },
+              [&](state & st) {
+            auto ud = observable::updater { };
+            auto v = observable::value<int> { };
+            auto results = std::vector<observable::value<int>> { };
+            for(auto i = expressions; i > 0; --i)
+                results.push_back(observable::observe(ud, v + 1));
+
+            while(st.next_batch())
+            {
+                auto const n = st.batch_size();
+                st.time([&]() {
+                    for(auto i = n; i > 0; --i)
+                        ud.update_all();
+                }, n);
+            }
+        });
+
+    // Idle expressions with large results; unchanged results are not copied.
+    for(auto bytes : { 64u, 4096u })
+        s.run("updater/update_all_idle_payload", { { "bytes", bytes } },
+              [&](state & st) {
+            auto ud = observable::updater { };
+            auto v = observable::value<std::vector<char>> { std::vector<char>(bytes) };
+            auto results = std::vector<observable::value<std::vector<char>>> { };
+            for(auto i = 16; i > 0; --i)
+                results.push_back(observable::observe(ud, v));
+
+            while(st.next_batch())
+            {
+                auto const n = st.batch_size();
+                st.time([&]() {
+                    for(auto i = n; i > 0; --i)
+                        ud.update_all();
+                }, n);
+            }
+        });
+
+    // Register and remove one expression while many others are registered.
+    auto const register_remove = [&](auto updater, char const * name) {
+        using updater_type = decltype(updater);
+        for(auto expressions : { 16u, 1024u, 16384u })
+            s.run(name, { { "expressions", expressions } }, [&](state & st) {
+                auto ud = updater_type { };
+                auto v = observable::value<int> { };
+                auto results = std::vector<observable::value<int>> { };
+                for(auto i = expressions; i > 0; --i)
+                    results.push_back(observable::observe(ud, v + 1));
+
+                while(st.next_batch())
+                {
+                    auto const n = st.batch_size();
+                    st.time([&]() {
+                        for(auto i = n; i > 0; --i)
+                            consume(static_cast<std::size_t>(
+                                        observable::observe(ud, v + 2).get()));
+                    }, n);
+                }
+            });
+    };
+
+    register_remove(observable::updater { }, "updater/register_remove");
+    register_remove(observable::sharded_updater { }, "updater/register_remove_sharded");
+}
+
+// The same clamped formula over many independent inputs, as one expression
+// tree per lane and as a single vectorized expression. Each operation
+// changes every lane and updates all of them.
+void bench_vectorized(suite & s)
+{
+    auto const shape = [](float a, float k, float b) {
+        return std::min(std::max(a * k + b, 0.0f), 100.0f);
+    };
+
+    for(auto lanes : { 64u, 1024u, 16384u })
+    {
+        s.run("vectorized/scalar_trees", { { "lanes", lanes } }, [&](state & st) {
+            auto ud = observable::updater { };
+            auto a = std::vector<observable::value<float>>(lanes);
+            auto k = observable::value<float> { 2.0f };
+            auto b = observable::value<float> { 1.0f };
+            auto results = std::vector<observable::value<float>> { };
+            for(auto && v : a)
+                results.push_back(observable::observe(
+                                    ud, observable::clamp(v * k + b, 0.0f, 100.0f)));
+            auto next = 0.0f;
+
+            while(st.next_batch())
+            {
+                auto const n = st.batch_size();
+                st.time([&]() {
+                    for(auto i = n; i > 0; --i)
+                    {
+                        next += 1.0f;
+                        for(auto && v : a)
+                            v.set(next);
+                        ud.update_all();
+                    }
+                }, n);
+            }
+        });
+
+        s.run("vectorized/lanes", { { "lanes", lanes } }, [&](state & st) {
+            auto ud = observable::updater { };
+            observable::vectorized_expression<float(float, float, float),
+                                              observable::updater> e { ud, lanes, shape };
+            for(auto i = std::size_t { 0 }; i < lanes; ++i)
+            {
+                e.set<1>(i, 2.0f);
+                e.set<2>(i, 1.0f);
+            }
+            auto next = 0.0f;
+
+            while(st.next_batch())
+            {
+                auto const n = st.batch_size();
+                st.time([&]() {
+                    for(auto i = n; i > 0; --i)
+                    {
+                        next += 1.0f;
+                        for(auto l = std::size_t { 0 }; l < lanes; ++l)
+                            e.set<0>(l, next);
+                        ud.update_all();
+                    }
+                }, n);
+            }
+
+            consume(static_cast<std::size_t>(e.get(0)));
+        });
+    }
+}
+
+}
+
+int main(int argc, char * argv[])
+{
+    auto settings = benchmark::settings { };
+    auto json_path = std::string { };
+
+    for(auto i = 1; i < argc; ++i)
+    {
+        auto const arg = std::string { argv[i] };
+        auto const has_value = i + 1 < argc;
+
+        if(arg == "--json" && has_value)
+            json_path = argv[++i];
+        else if(arg == "--filter" && has_value)
+            settings.filter = argv[++i];
+        else if(arg == "--samples" && has_value)
+            settings.samples = std::stoul(argv[++i]);
+        else if(arg == "--max-time" && has_value)
+            settings.max_time = std::chrono::milliseconds { std::stoul(argv[++i]) };
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--json <file>] [--filter <text>]"
+                      << " [--samples <count>] [--max-time <ms>]\n";
+            return 1;
+        }
+    }
+
+    auto s = suite { settings };
+    s.print_header();
+
+    bench_subject(s);
+    bench_value(s);
+    bench_updater(s);
+    bench_vectorized(s);
+
+    if(!json_path.empty())
+    {
+        auto out = std::ofstream { json_path };
+        s.write_json(out);
+
+        if(!out)
+        {
+            std::cerr << "Could not write " << json_path << "\n";
+            return 1;
+        }
+    }
+
+    return 0;
+}
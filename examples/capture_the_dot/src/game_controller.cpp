@@ -9,7 +9,8 @@ using namespace std::chrono_literals;
 GameController::GameController(std::shared_ptr<GameView> view,
                                std::shared_ptr<GameModel> model) :
     view_ { std::move(view) },
-    model_ { std::move(model) }
+    model_ { std::move(model) },
+    loop_ { observable::qt_post(view_.get()) }
 {
     assert(view_);
     assert(model_);
@@ -32,14 +33,15 @@ GameController::GameController(std::shared_ptr<GameView> view,
         view_->highlight_dot(captured);
     }));
 
-    subs_.emplace_back(model_->dot_position.subscribe([&](auto const & pos) {
+    // The position and the radius usually change together; update the dot
+    // once for both, from the event loop.
+    auto const update_dot = loop_.coalesce([&]() {
+        auto const pos = model_->dot_position.get();
         view_->update_dot(pos.x, pos.y, model_->dot_radius.get());
-    }));
+    });
 
-    subs_.emplace_back(model_->dot_radius.subscribe([&](auto r) {
-        auto const pos = model_->dot_position.get();
-        view_->update_dot(pos.x, pos.y, r);
-    }));
+    subs_.emplace_back(model_->dot_position.subscribe(update_dot));
+    subs_.emplace_back(model_->dot_radius.subscribe(update_dot));
 
     subs_.emplace_back(model_->min_scene_width.subscribe([&](auto w) {
         view_->setMinimumWidth(w);
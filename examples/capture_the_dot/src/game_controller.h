@@ -2,6 +2,7 @@
 #include <memory>
 #include <vector>
 #include <QTimer>
+#include <observable/qt.hpp>
 #include <observable/subscription.hpp>
 
 class GameView;
@@ -34,6 +35,7 @@ public:
 private:
     std::shared_ptr<GameView> view_;
     std::shared_ptr<GameModel> model_;
+    observable::loop_dispatcher loop_;
     std::vector<observable::unique_subscription> subs_;
     std::vector<QMetaObject::Connection> cons_;
 
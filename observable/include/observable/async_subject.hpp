@@ -0,0 +1,213 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <observable/detail/inline_function.hpp>
+#include <observable/detail/type_traits.hpp>
+#include <observable/subject.hpp>
+#include <observable/subscription.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable {
+
+//! Unit of work that an async subject hands to an executor.
+//!
+//! Calling the task delivers one notification to one observer. Tasks are
+//! move-only and never allocate.
+//!
+//! \ingroup observable
+using async_task = detail::inline_function<void()>;
+
+//! Executor that runs tasks immediately, on the thread that submits them.
+//!
+//! With this executor, an async subject behaves like a regular subject.
+//!
+//! \ingroup observable
+struct inline_executor
+{
+    //! Run the task.
+    void operator()(async_task task) const { task(); }
+};
+
+//! \cond
+template <typename ObserverType>
+class async_subject;
+//! \endcond
+
+//! Subject that delivers notifications through executors.
+//!
+//! Each observer is subscribed together with an executor. Calling notify()
+//! creates one task for each subscribed observer and submits it to that
+//! observer's executor; notify() returns as soon as all tasks have been
+//! submitted, without waiting for any observer to run.
+//!
+//! The notification arguments are moved into a single, reference-counted
+//! payload that is shared by all the tasks of that notification. Observers are
+//! called with const references to the payload's contents.
+//!
+//! An executor is any callable that accepts an \ref async_task, for example a
+//! lambda that pushes the task into a thread pool's queue. Executors can run
+//! tasks on any thread, in any order.
+//!
+//! All methods can be safely called in parallel, from multiple threads.
+//!
+//! \tparam Args Observer arguments. Arguments are stored in the payload as
+//!              ``std::decay_t<Args>``.
+//!
+//! \warning Tasks keep the payload and the observer alive, so they can run
+//!          after the subject has been destroyed. Tasks that are still queued
+//!          when their observer is unsubscribed will do nothing when run; a
+//!          task that has already started running is not interrupted.
+//!
+//! \ingroup observable
+template <typename ... Args>
+class async_subject<void(Args ...)>
+{
+public:
+    using observer_type = void(Args ...);
+
+    //! Type-erased executor.
+    using executor_type = std::function<void(async_task)>;
+
+    //! Create an empty subject.
+    //!
+    //! \param[in] executor Executor used by observers that are subscribed
+    //!                     without one.
+    explicit async_subject(executor_type executor=inline_executor { }) :
+        executor_ { std::move(executor) }
+    { }
+
+    //! Subscribe an observer that will be called through the provided
+    //! executor.
+    //!
+    //! \param[in] executor Callable that accepts an \ref async_task. A copy of
+    //!                     it is kept for as long as the observer is subscribed.
+    //! \param[in] observer An observer callable that will be subscribed to
+    //!                     notifications from this subject.
+    //!
+    //! \return An infinite subscription that can be used to unsubscribe the
+    //!         provided observer from receiving notifications from this subject.
+    //!
+    //! \warning Observers must be safe to be called in parallel, if the
+    //!          executor runs tasks on multiple threads.
+    template <typename Executor, typename Callable>
+    auto subscribe(Executor && executor, Callable && observer)
+        -> infinite_subscription
+    {
+        static_assert(detail::is_compatible_with_observer<Callable, observer_type>::value,
+                      "The provided observer object is not callable or not compatible"
+                      " with the subject");
+
+        auto const r = std::make_shared<record>(
+                            std::forward<Executor>(executor),
+                            std::forward<Callable>(observer));
+
+        auto token = observers_.subscribe([r](payload_ptr const & p) {
+            if(!r->active.load(std::memory_order_relaxed))
+                return;
+
+            auto task = [r, p]() {
+                if(r->active.load(std::memory_order_relaxed))
+                    call(r->observer, *p, std::index_sequence_for<Args ...> { });
+            };
+
+            static_assert(async_task::is_stored_inline<decltype(task)>(),
+                          "Tasks should not allocate");
+
+            r->executor(async_task { std::move(task) });
+        }).release();
+
+        return infinite_subscription { [r, t = std::move(token)]() {
+            r->active.store(false, std::memory_order_relaxed);
+            t();
+        } };
+    }
+
+    //! Subscribe an observer that will be called through the subject's
+    //! default executor.
+    //!
+    //! \see subscribe(Executor &&, Callable &&)
+    template <typename Callable>
+    auto subscribe(Callable && observer) -> infinite_subscription
+    {
+        return subscribe(executor_, std::forward<Callable>(observer));
+    }
+
+    //! Submit a notification task for each subscribed observer.
+    //!
+    //! The arguments are moved into one payload shared by all the tasks. If
+    //! there are no observers, nothing is allocated.
+    //!
+    //! \note Observers subscribed during a notify call will not receive the
+    //!       notification.
+    //!
+    //! \param[in] arguments Arguments that will be passed to the observers.
+    void notify(Args ... arguments) const
+    {
+        if(observers_.empty())
+            return;
+
+        observers_.notify(std::make_shared<payload>(
+                                std::forward<Args>(arguments) ...));
+    }
+
+    //! Return true if there are no subscribers.
+    auto empty() const noexcept { return observers_.empty(); }
+
+public:
+    //! Subjects are **not** copy-constructible.
+    async_subject(async_subject const &) =delete;
+
+    //! Subjects are **not** copy-assignable.
+    auto operator=(async_subject const &) -> async_subject & =delete;
+
+    //! Subjects are move-constructible.
+    async_subject(async_subject &&) =default;
+
+    //! Subjects are move-assignable.
+    auto operator=(async_subject &&) -> async_subject & =default;
+
+private:
+    using payload = std::tuple<std::decay_t<Args> ...>;
+    using payload_ptr = std::shared_ptr<payload const>;
+
+    // Observers are stored with const reference parameters, so the payload is
+    // not copied unless the observer itself takes its arguments by value.
+    using payload_observer = std::function<void(std::decay_t<Args> const & ...)>;
+
+    //! State shared by an observer's subscription and its queued tasks.
+    struct record
+    {
+        template <typename Executor, typename Callable>
+        record(Executor && e, Callable && o) :
+            executor { std::forward<Executor>(e) },
+            observer { std::forward<Callable>(o) }
+        { }
+
+        executor_type executor;
+        payload_observer observer;
+        std::atomic<bool> active { true };
+    };
+
+    template <std::size_t ... I>
+    static void call(payload_observer const & observer,
+                     payload const & p,
+                     std::index_sequence<I ...>)
+    {
+        observer(std::get<I>(p) ...);
+    }
+
+private:
+    executor_type executor_;
+    subject<void(payload_ptr const &), inline_subject_policy> observers_;
+};
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
@@ -0,0 +1,257 @@
+#pragma once
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+#include <observable/detail/epoch.hpp>
+#include <observable/detail/propagation.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable {
+
+//! Group value changes and notify their observers once, at commit time.
+//!
+//! While a batch is open, setting a value only stores the new value. When the
+//! batch is committed, the observers of each value that has changed are
+//! notified once, with the value's latest state, in the order the values were
+//! first changed. All notifications are delivered inside a single reclamation
+//! critical section, instead of each subject entering its own.
+//!
+//! Batches apply to the thread that created them. Values that are changed from
+//! other threads are not affected.
+//!
+//! Batches can be nested; a batch created while another one is open joins the
+//! outer batch and its commit() has no effect. The changes are delivered when
+//! the outermost batch is committed.
+//!
+//! Example:
+//!
+//!     auto b = batch { };
+//!     a = 1;
+//!     c = 2;
+//!     b.commit(); // Observers of a and c are called here.
+//!
+//! \warning If an observer can throw, call commit() explicitly. Committing
+//!          from the destructor will terminate the program if an observer
+//!          throws.
+//!
+//! \ingroup observable
+class batch final
+{
+public:
+    //! Open a batch on the calling thread.
+    batch() noexcept : outer_ { current() }
+    {
+        if(!outer_)
+            current() = this;
+    }
+
+    //! Notify the observers of all values changed since the batch was opened.
+    //!
+    //! After this call, the batch is closed and changing values will notify
+    //! their observers immediately again.
+    //!
+    //! Changes made by observers while the batch is being committed are
+    //! notified immediately, unless the changed value is still waiting to be
+    //! notified by this commit.
+    //!
+    //! If an observer throws, the remaining changes are dropped without
+    //! notifying their observers and the exception is propagated.
+    void commit()
+    {
+        if(closed_)
+            return;
+
+        closed_ = true;
+        if(outer_)
+            return;
+
+        // The batch stays current while delivering, so values destroyed or
+        // moved by observers can still cancel their entries.
+        struct reset_current
+        {
+            ~reset_current() { current() = nullptr; }
+        } const reset { };
+
+        detail::epoch_guard const guard { };
+
+        // Closed batches do not accept new entries, so the vector is not
+        // reallocated during the loop.
+        auto i = 0u;
+        try {
+            // Expressions that depend on several changed values are only
+            // evaluated once all of the values have been notified.
+            detail::propagation::run([&]() {
+                for(; i < pending_.size(); ++i)
+                    if(pending_[i].target)
+                        pending_[i].flush(pending_[i].target, true);
+            });
+        } catch(...) {
+            // The remaining targets must be able to notify again.
+            for(++i; i < pending_.size(); ++i)
+                if(pending_[i].target)
+                    pending_[i].flush(pending_[i].target, false);
+
+            clear();
+            throw;
+        }
+
+        clear();
+    }
+
+    //! Return true if the batch has not been committed yet.
+    auto is_open() const noexcept { return !closed_; }
+
+    //! Destructor. Will call commit().
+    ~batch() { commit(); }
+
+public:
+    //! Batches are not copy-constructible.
+    batch(batch const &) =delete;
+
+    //! Batches are not copy-assignable.
+    auto operator=(batch const &) -> batch & =delete;
+
+    //! Batches are not move-constructible.
+    batch(batch &&) =delete;
+
+    //! Batches are not move-assignable.
+    auto operator=(batch &&) -> batch & =delete;
+
+public:
+    //! Defer the notification of a changed object.
+    //!
+    //! \param[in] target Object that has changed.
+    //! \param[in] flush Function that will be called with the target, when the
+    //!                  batch is committed. If its second argument is false,
+    //!                  the target must only drop its deferred state, without
+    //!                  notifying anyone.
+    //!
+    //! \return True if the notification was deferred, false if there is no
+    //!         open batch on the calling thread and the target must notify
+    //!         immediately.
+    //!
+    //! \note This is for internal use by values. The caller is responsible for
+    //!       only deferring a target once and for calling cancel() or
+    //!       retarget() if the target is destroyed or moved.
+    static auto defer(void * target, void (*flush)(void *, bool)) -> bool
+    {
+        auto const b = current();
+        if(!b || b->closed_)
+            return false;
+
+        b->pending_.push_back(entry { target, flush });
+        if(b->indexed_)
+            b->index(target, b->pending_.size() - 1);
+
+        return true;
+    }
+
+    //! Drop a deferred notification.
+    static void cancel(void * target) noexcept { retarget(target, nullptr); }
+
+    //! Move a deferred notification to another object.
+    static void retarget(void * from, void * to) noexcept
+    {
+        auto const b = current();
+        if(!b)
+            return;
+
+        auto const i = b->find(from);
+        if(i == b->pending_.size())
+            return;
+
+        b->pending_[i].target = to;
+        if(!b->indexed_)
+            return;
+
+        b->index_.erase(from);
+        if(to)
+            b->index(to, i);
+    }
+
+private:
+    struct entry
+    {
+        void * target;
+        void (*flush)(void *, bool);
+    };
+
+    //! Batches with fewer entries are searched linearly.
+    static constexpr std::size_t min_indexed_size = 32;
+
+    //! Position of a target's entry, or the number of entries if there is no
+    //! entry for the target.
+    //!
+    //! The index of entries is only built the first time an entry is looked
+    //! up in a large batch, so batches in which no value is moved or destroyed
+    //! do not pay for it.
+    auto find(void * target) noexcept -> std::size_t
+    {
+        if(!indexed_ && pending_.size() >= min_indexed_size)
+            build_index();
+
+        if(indexed_)
+        {
+            auto const it = index_.find(target);
+            return it == end(index_) ? pending_.size() : it->second;
+        }
+
+        for(auto i = std::size_t { 0 }; i < pending_.size(); ++i)
+            if(pending_[i].target == target)
+                return i;
+
+        return pending_.size();
+    }
+
+    void build_index() noexcept
+    {
+        try {
+            index_.reserve(pending_.size());
+            for(auto i = std::size_t { 0 }; i < pending_.size(); ++i)
+                if(pending_[i].target)
+                    index_.emplace(pending_[i].target, i);
+
+            indexed_ = true;
+        } catch(...) {
+            // Without memory, lookups stay linear.
+            index_.clear();
+        }
+    }
+
+    void index(void * target, std::size_t i) noexcept
+    {
+        try {
+            index_[target] = i;
+        } catch(...) {
+            indexed_ = false;
+            index_.clear();
+        }
+    }
+
+    void clear() noexcept
+    {
+        pending_.clear();
+        index_.clear();
+        indexed_ = false;
+    }
+
+    //! The outermost open batch of the calling thread.
+    static auto current() noexcept -> batch * &
+    {
+        static thread_local batch * b = nullptr;
+        return b;
+    }
+
+private:
+    batch * outer_;
+    bool closed_ { false };
+    std::vector<entry> pending_;
+    std::unordered_map<void *, std::size_t> index_;
+    bool indexed_ { false };
+};
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
@@ -0,0 +1,341 @@
+#pragma once
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <observable/subject.hpp>
+#include <observable/subscription.hpp>
+#include <observable/value.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable {
+
+//! Non-owning view of a contiguous sequence of objects.
+//!
+//! \tparam ValueType Type of the viewed objects. Use a const type for a
+//!                   read-only view.
+//!
+//! \ingroup observable
+template <typename ValueType>
+class span
+{
+public:
+    using element_type = ValueType;
+    using value_type = std::remove_cv_t<ValueType>;
+    using iterator = ValueType *;
+
+    //! Create an empty span.
+    span() noexcept =default;
+
+    //! Create a span of ``size`` objects, starting at ``data``.
+    span(ValueType * data, std::size_t size) noexcept :
+        data_ { data },
+        size_ { size }
+    { }
+
+    //! Create a span of the elements of a vector.
+    template <typename T, typename Allocator,
+              typename = std::enable_if_t<std::is_convertible<T *, ValueType *>::value>>
+    span(std::vector<T, Allocator> & v) noexcept : span { v.data(), v.size() } { }
+
+    //! Create a read-only span of the elements of a vector.
+    template <typename T, typename Allocator,
+              typename = std::enable_if_t<std::is_convertible<T const *, ValueType *>::value>>
+    span(std::vector<T, Allocator> const & v) noexcept : span { v.data(), v.size() } { }
+
+    auto data() const noexcept { return data_; }
+    auto size() const noexcept { return size_; }
+    auto empty() const noexcept { return size_ == 0; }
+
+    auto begin() const noexcept -> iterator { return data_; }
+    auto end() const noexcept -> iterator { return data_ + size_; }
+
+    auto operator[](std::size_t index) const noexcept -> ValueType &
+    {
+        assert(index < size_);
+        return data_[index];
+    }
+
+    auto front() const noexcept -> ValueType & { return (*this)[0]; }
+    auto back() const noexcept -> ValueType & { return (*this)[size_ - 1]; }
+
+private:
+    ValueType * data_ { nullptr };
+    std::size_t size_ { 0 };
+};
+
+//! Collects the notifications of a subject or value into batches.
+//!
+//! Each notification's argument is appended to a buffer. Once the buffer holds
+//! ``count`` arguments, or its oldest argument is older than ``period``,
+//! observers are called once, with a span of the whole batch:
+//!
+//!     auto ticks = subject<void(tick)> { };
+//!     auto batches = buffered(ticks, 256);
+//!
+//!     auto const sub = batches.subscribe([](span<tick const> b) {
+//!         for(auto && t : b)
+//!             ...
+//!     });
+//!
+//! Buffers are reused from one batch to the next, so, once they have grown,
+//! collecting notifications does not allocate.
+//!
+//! The period is only checked when a notification is received. Call flush()
+//! to deliver a partial batch, for example from a timer.
+//!
+//! All methods can be safely called in parallel, from multiple threads, and
+//! the source can notify from multiple threads. Batches are delivered on the
+//! thread that completes them, or that calls flush(); no lock is held while
+//! observers are called. A batch never holds more than ``count`` arguments,
+//! but batches completed by different threads can be delivered concurrently,
+//! like the notifications of a subject that is notified from multiple threads.
+//!
+//! \tparam ValueType Type of the buffered arguments.
+//! \tparam Clock Clock used to measure the period. This must satisfy the
+//!               TrivialClock concept.
+//!
+//! \warning The span passed to observers is only valid until they return.
+//!
+//! \ingroup observable
+template <typename ValueType, typename Clock=std::chrono::steady_clock>
+class buffered_subject final
+{
+    struct state
+    {
+        //! Append an argument. If it completes the batch, the batch is moved
+        //! to ``out``, under the same lock, and true is returned.
+        template <typename T>
+        auto push(T && v, std::vector<ValueType> & out) -> bool
+        {
+            std::lock_guard<std::mutex> const lock { mutex };
+            if(pending.empty() && has_period)
+                first = Clock::now();
+
+            pending.push_back(std::forward<T>(v));
+            if(pending.size() < count &&
+               !(has_period && Clock::now() - first >= period))
+                return false;
+
+            take(out);
+            return true;
+        }
+
+        void flush()
+        {
+            auto batch = std::vector<ValueType> { };
+            {
+                std::lock_guard<std::mutex> const lock { mutex };
+                if(pending.empty())
+                    return;
+
+                take(batch);
+            }
+
+            deliver(batch);
+        }
+
+        //! Move the pending arguments to ``out``; the mutex must be held.
+        void take(std::vector<ValueType> & out)
+        {
+            out = std::move(pending);
+            pending = std::move(spare);
+            pending.clear();
+            pending.reserve(reserved);
+        }
+
+        //! Notify observers of a batch, then keep its buffer for reuse.
+        void deliver(std::vector<ValueType> & batch)
+        {
+            struct recycle
+            {
+                ~recycle()
+                {
+                    b.clear();
+                    std::lock_guard<std::mutex> const lock { s.mutex };
+                    if(s.spare.capacity() < b.capacity())
+                        s.spare = std::move(b);
+                }
+
+                state & s;
+                std::vector<ValueType> & b;
+            } const r { *this, batch };
+
+            observers.notify(span<ValueType const> { batch });
+        }
+
+        std::mutex mutex;
+        std::vector<ValueType> pending;
+        std::vector<ValueType> spare;
+        std::size_t count;
+        std::size_t reserved;
+        bool has_period;
+        typename Clock::duration period;
+        typename Clock::time_point first { };
+        subject<void(span<ValueType const>)> observers;
+    };
+
+public:
+    //! Type of the functions called with each batch.
+    using observer_type = void(span<ValueType const>);
+
+    //! Buffer the notifications of a source, in batches of ``count``
+    //! arguments.
+    //!
+    //! \param[in] source A subject or a value that notifies with one argument.
+    //!                   The source can be destroyed before this object.
+    //! \param[in] count Number of arguments in a batch. Must be greater than
+    //!                  zero.
+    template <typename Source>
+    buffered_subject(Source & source, std::size_t count) :
+        buffered_subject { source, count, false, { } }
+    { }
+
+    //! Buffer the notifications of a source, delivering a batch once its
+    //! oldest argument is older than ``period``, or once it holds ``count``
+    //! arguments.
+    //!
+    //! \param[in] source A subject or a value that notifies with one argument.
+    //!                   The source can be destroyed before this object.
+    //! \param[in] period Maximum age of a batch's oldest argument.
+    //! \param[in] count Maximum number of arguments in a batch. Must be greater
+    //!                  than zero.
+    template <typename Source, typename Rep, typename Period>
+    buffered_subject(Source & source,
+                     std::chrono::duration<Rep, Period> period,
+                     std::size_t count=std::numeric_limits<std::size_t>::max()) :
+        buffered_subject { source, count, true,
+                           std::chrono::duration_cast<typename Clock::duration>(period) }
+    { }
+
+    //! Subscribe to batches.
+    //!
+    //! \param[in] observer Callable compatible with ``observer_type``.
+    //! \return A subscription that can be used to unsubscribe the observer.
+    template <typename Callable>
+    auto subscribe(Callable && observer) -> infinite_subscription
+    {
+        return state_->observers.subscribe(std::forward<Callable>(observer));
+    }
+
+    //! Deliver the buffered arguments now, even if the batch is not complete.
+    //!
+    //! Does nothing if no argument is buffered.
+    void flush() { state_->flush(); }
+
+    //! Number of buffered arguments that have not been delivered yet.
+    auto size() const
+    {
+        std::lock_guard<std::mutex> const lock { state_->mutex };
+        return state_->pending.size();
+    }
+
+    //! Destructor. Stops buffering; arguments that have not been delivered yet
+    //! are dropped.
+    ~buffered_subject() { sub_.unsubscribe(); }
+
+public:
+    //! Buffered subjects are not copy-constructible.
+    buffered_subject(buffered_subject const &) =delete;
+
+    //! Buffered subjects are not copy-assignable.
+    auto operator=(buffered_subject const &) -> buffered_subject & =delete;
+
+    //! Buffered subjects are move-constructible.
+    buffered_subject(buffered_subject &&) =default;
+
+    //! Buffered subjects are not move-assignable.
+    auto operator=(buffered_subject &&) -> buffered_subject & =delete;
+
+private:
+    template <typename Source>
+    buffered_subject(Source & source,
+                     std::size_t count,
+                     bool has_period,
+                     typename Clock::duration period)
+    {
+        assert(count > 0);
+
+        state_->count = count;
+        state_->reserved = count < max_reserved ? count : max_reserved;
+        state_->has_period = has_period;
+        state_->period = period;
+        state_->pending.reserve(state_->reserved);
+
+        sub_ = unique_subscription {
+            source.subscribe([s = state_](auto && v) -> void {
+                auto batch = std::vector<ValueType> { };
+                if(s->push(std::forward<decltype(v)>(v), batch))
+                    s->deliver(batch);
+            })
+        };
+    }
+
+    //! Largest number of arguments reserved up-front for a batch.
+    static constexpr std::size_t max_reserved = 4096;
+
+    std::shared_ptr<state> state_ { std::make_shared<state>() };
+    unique_subscription sub_;
+};
+
+//! \cond
+template <typename ValueType, typename Clock>
+constexpr std::size_t buffered_subject<ValueType, Clock>::max_reserved;
+//! \endcond
+
+//! Buffer the notifications of a subject, in batches of ``count`` arguments.
+//!
+//! \see buffered_subject
+//! \ingroup observable
+template <typename Arg, typename Policy>
+inline auto buffered(detail::subject_base<void(Arg), Policy> & s, std::size_t count)
+{
+    return buffered_subject<std::decay_t<Arg>> { s, count };
+}
+
+//! Buffer the notifications of a subject, delivering a batch at least once per
+//! ``period``, when notifications are received.
+//!
+//! \see buffered_subject
+//! \ingroup observable
+template <typename Arg, typename Policy, typename Rep, typename Period>
+inline auto buffered(detail::subject_base<void(Arg), Policy> & s,
+                     std::chrono::duration<Rep, Period> period,
+                     std::size_t count=std::numeric_limits<std::size_t>::max())
+{
+    return buffered_subject<std::decay_t<Arg>> { s, period, count };
+}
+
+//! Buffer the changes of a value, in batches of ``count`` values.
+//!
+//! \see buffered_subject
+//! \ingroup observable
+template <typename ValueType, typename ... Rest>
+inline auto buffered(value<ValueType, Rest ...> & v, std::size_t count)
+{
+    return buffered_subject<ValueType> { v, count };
+}
+
+//! Buffer the changes of a value, delivering a batch at least once per
+//! ``period``, when changes are received.
+//!
+//! \see buffered_subject
+//! \ingroup observable
+template <typename ValueType, typename ... Rest, typename Rep, typename Period>
+inline auto buffered(value<ValueType, Rest ...> & v,
+                     std::chrono::duration<Rep, Period> period,
+                     std::size_t count=std::numeric_limits<std::size_t>::max())
+{
+    return buffered_subject<ValueType> { v, period, count };
+}
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
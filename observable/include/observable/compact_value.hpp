@@ -0,0 +1,466 @@
+#pragma once
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <observable/batch.hpp>
+#include <observable/subject.hpp>
+#include <observable/subscription.hpp>
+#include <observable/value.hpp>
+#include <observable/detail/propagation.hpp>
+#include <observable/detail/type_traits.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable {
+
+//! \cond
+template <typename ValueType,
+          typename EnclosingOrPolicy=void,
+          typename Policy=void,
+          typename=void>
+class compact_value;
+//! \endcond
+
+namespace detail {
+
+//! Implementation of the public compact value interface.
+//!
+//! \tparam Policy Subject policy used by all the value's subjects.
+//! \tparam Derived The public value type that derives from this class.
+//!
+//! \see compact_value<ValueType>
+//! \ingroup observable_detail
+template <typename ValueType, typename Policy, typename Derived>
+class compact_value_base
+{
+    using void_subject = subject<void(), Policy>;
+    using value_subject = subject<void(ValueType const &), Policy>;
+
+public:
+    //! The observable value's stored value type.
+    using value_type = ValueType;
+
+    //! Subject notified after the value has been moved.
+    //!
+    //! \see value_base::moved
+    using moved_subject = subject<void(Derived &), compact_value_base, Policy>;
+
+    //! Subject notified before the value is destroyed.
+    //!
+    //! \see value_base::destroyed
+    using destroyed_subject = subject<void(), compact_value_base, Policy>;
+
+    //! Create a default-constructed value.
+    compact_value_base() =default;
+
+    //! Create an initialized value.
+    //!
+    //! \param initial_value The value's initial value.
+    explicit compact_value_base(ValueType initial_value)
+        noexcept(std::is_nothrow_move_constructible<ValueType>::value) :
+        value_ { std::move(initial_value) }
+    { }
+
+    //! Convert the value to its stored value type.
+    explicit operator ValueType const &() const noexcept { return value_; }
+
+    //! Retrieve the stored value.
+    auto get() const noexcept -> ValueType const & { return value_; }
+
+    //! Subscribe to changes to the value.
+    //!
+    //! The first subscription allocates the value's observer storage.
+    //!
+    //! \see value_base::subscribe()
+    template <typename Callable>
+    auto subscribe(Callable && observer) const
+    {
+        static_assert(detail::is_compatible_with_subject<Callable, void_subject>::value ||
+                      detail::is_compatible_with_subject<Callable, value_subject>::value,
+                      "Observer is not valid. Please provide a void observer or an "
+                      "observer that takes a ValueType as its only argument.");
+
+        return subscribe_impl(std::forward<Callable>(observer));
+    }
+
+    //! Subscribe to changes to the value and also call the observer
+    //! immediately with the current value.
+    //!
+    //! \see value_base::subscribe_and_call()
+    template <typename Callable>
+    auto subscribe_and_call(Callable && observer) const
+    {
+        call_impl(observer);
+        return subscribe(std::forward<Callable>(observer));
+    }
+
+    //! Set a new value, possibly notifying any subscribed observers.
+    //!
+    //! \see value_base::set()
+    void set(ValueType new_value)
+    {
+        if(detail::equal_to { }(value_, new_value))
+            return;
+
+        value_ = std::move(new_value);
+        changed();
+    }
+
+    //! Modify the stored value in place and notify observers.
+    //!
+    //! \see value_base::modify()
+    template <typename Fun>
+    void modify(Fun && fun)
+    {
+        fun(value_);
+        changed();
+    }
+
+    //! Modify the stored value in place and notify observers only if the
+    //! functor reports a change.
+    //!
+    //! \see value_base::update()
+    template <typename Fun>
+    auto update(Fun && fun) -> bool
+    {
+        if(!fun(value_))
+            return false;
+
+        changed();
+        return true;
+    }
+
+    //! Set a new value. Will just call set(ValueType &&).
+    auto operator=(ValueType new_value) -> Derived &
+    {
+        set(std::move(new_value));
+        return static_cast<Derived &>(*this);
+    }
+
+    //! Subject notified after the value has been moved.
+    //!
+    //! The first call allocates the value's observer storage.
+    auto moved() -> moved_subject & { return block().moved; }
+
+    //! Subject notified before the value is destroyed.
+    //!
+    //! The first call allocates the value's observer storage.
+    auto destroyed() -> destroyed_subject & { return block().destroyed; }
+
+    //! Return true if the value's observer storage has been allocated.
+    //!
+    //! Values that nobody has subscribed to only store their value and a null
+    //! pointer.
+    auto has_observer_storage() const noexcept { return block_ != nullptr; }
+
+    //! Destructor.
+    ~compact_value_base()
+    {
+        if(pending_)
+            batch::cancel(this);
+
+        if(block_)
+            block_->destroyed.notify();
+    }
+
+public:
+    //! Values are **not** copy-constructible.
+    compact_value_base(compact_value_base const &) =delete;
+
+    //! Values are **not** copy-assignable.
+    auto operator=(compact_value_base const &) -> compact_value_base & =delete;
+
+    //! Values are move-constructible.
+    //!
+    //! The observer storage is moved with the value; nothing is allocated.
+    template <typename = std::enable_if_t<std::is_move_constructible<ValueType>::value>>
+    compact_value_base(compact_value_base && other)
+        noexcept(std::is_nothrow_move_constructible<ValueType>::value) :
+        value_ { std::move(other.value_) },
+        block_ { std::move(other.block_) }
+    {
+        if(other.pending_)
+        {
+            batch::retarget(&other, this);
+            pending_ = true;
+            other.pending_ = false;
+        }
+
+        if(block_)
+            block_->moved.notify(static_cast<Derived &>(*this));
+    }
+
+    //! Values are move-assignable.
+    template <typename = std::enable_if_t<std::is_move_assignable<ValueType>::value>>
+    auto operator=(compact_value_base && other)
+        noexcept(std::is_nothrow_move_assignable<ValueType>::value)
+        -> compact_value_base &
+    {
+        value_ = std::move(other.value_);
+
+        // The observers of the moved-into value are replaced, like for value.
+        block_ = std::move(other.block_);
+
+        if(other.pending_)
+        {
+            if(pending_)
+                batch::cancel(&other);
+            else
+                batch::retarget(&other, this);
+
+            pending_ = true;
+            other.pending_ = false;
+        }
+
+        if(block_)
+            block_->moved.notify(static_cast<Derived &>(*this));
+
+        return *this;
+    }
+
+private:
+    //! All subjects of the value, allocated together when first needed.
+    struct control_block
+    {
+        void_subject void_observers;
+        value_subject value_observers;
+        moved_subject moved;
+        destroyed_subject destroyed;
+    };
+
+    auto block() const -> control_block &
+    {
+        if(!block_)
+            block_ = std::make_unique<control_block>();
+
+        return *block_;
+    }
+
+    template <typename Callable>
+    auto subscribe_impl(Callable && observer) const ->
+        std::enable_if_t<detail::is_compatible_with_subject<Callable, void_subject>::value &&
+                         !detail::is_compatible_with_subject<Callable, value_subject>::value,
+                         infinite_subscription>
+    {
+        return block().void_observers.subscribe(std::forward<Callable>(observer));
+    }
+
+    template <typename Callable>
+    auto subscribe_impl(Callable && observer) const ->
+        std::enable_if_t<detail::is_compatible_with_subject<Callable,
+                                                            value_subject>::value,
+                         infinite_subscription>
+    {
+        return block().value_observers.subscribe(std::forward<Callable>(observer));
+    }
+
+    template <typename Callable>
+    auto call_impl(Callable && observer) const ->
+            std::enable_if_t<detail::is_compatible_with_subject<Callable, void_subject>::value &&
+            !detail::is_compatible_with_subject<Callable, value_subject>::value>
+    {
+        observer();
+    }
+
+    template <typename Callable>
+    auto call_impl(Callable && observer) const ->
+            std::enable_if_t<detail::is_compatible_with_subject<Callable,
+            value_subject>::value>
+    {
+        observer(value_);
+    }
+
+    //! Notify observers of a change, or defer the notification if a batch is
+    //! open. Values without observer storage have nobody to notify.
+    void changed()
+    {
+        if(!block_)
+            return;
+
+        if(!pending_)
+            pending_ = batch::defer(this, &flush);
+
+        if(pending_)
+            return;
+
+        notify_observers();
+    }
+
+    void notify_observers() const
+    {
+        if(!block_)
+            return;
+
+        detail::propagation::run([&]() {
+            block_->void_observers.notify();
+            block_->value_observers.notify(value_);
+        });
+    }
+
+    //! Deliver a change deferred by a batch.
+    static void flush(void * target, bool notify)
+    {
+        auto & v = *static_cast<compact_value_base *>(target);
+        v.pending_ = false;
+
+        if(notify)
+            v.notify_observers();
+    }
+
+private:
+    ValueType value_;
+
+    // True while the change notification is deferred by a batch.
+    bool pending_ { false };
+
+    mutable std::unique_ptr<control_block> block_;
+};
+
+}
+
+//! Observable value with a compact layout, for very large numbers of values.
+//!
+//! A regular \ref value "value" owns four subjects, each of which allocates
+//! its observer storage when the value is created. A compact value only owns
+//! its stored value and a pointer, and allocates a single control block, with
+//! all its subjects, the first time it is subscribed to. Values that are
+//! never observed cost little more than the stored value:
+//!
+//!     auto prices = std::vector<compact_value<double>>(1'000'000);
+//!
+//! Compact values work like regular values, with some restrictions:
+//!
+//! - equality is always checked with ``std::equal_to<ValueType>``, if the
+//!   ValueType is EqualityComparable;
+//! - they cannot be updated by an expression, or be used inside one;
+//! - the moved and destroyed subjects are accessed through moved() and
+//!   destroyed().
+//!
+//! \warning None of the methods in this class can be safely called concurrently.
+//!
+//! \tparam ValueType The value-type that will be stored inside the observable.
+//!
+//! \see detail::compact_value_base for the full interface.
+//! \ingroup observable
+template <typename ValueType>
+class compact_value<ValueType> :
+    public detail::compact_value_base<ValueType,
+                                      subject_policy,
+                                      compact_value<ValueType>>
+{
+    using base = detail::compact_value_base<ValueType,
+                                            subject_policy,
+                                            compact_value<ValueType>>;
+
+public:
+    using base::base;
+    using base::operator=;
+
+    //! \see detail::compact_value_base::compact_value_base()
+    compact_value() =default;
+};
+
+//! Compact value specialization that uses a custom subject policy.
+//!
+//! \tparam ValueType The value-type that will be stored inside the observable.
+//! \tparam Policy A type for which \ref is_subject_policy is true.
+//!
+//! \see compact_value<ValueType>
+//! \ingroup observable
+template <typename ValueType, typename Policy>
+class compact_value<ValueType, Policy, void,
+                    std::enable_if_t<is_subject_policy<Policy>::value>> :
+    public detail::compact_value_base<ValueType,
+                                      Policy,
+                                      compact_value<ValueType, Policy>>
+{
+    using base = detail::compact_value_base<ValueType,
+                                            Policy,
+                                            compact_value<ValueType, Policy>>;
+
+public:
+    using base::base;
+    using base::operator=;
+
+    //! \see detail::compact_value_base::compact_value_base()
+    compact_value() =default;
+};
+
+//! Compact value specialization that can be used inside a class, as a member,
+//! to prevent external code from calling set(), but still allow anyone to
+//! subscribe.
+//!
+//! \tparam ValueType The value-type that will be stored inside the observable.
+//! \tparam EnclosingType A type that will have access to the value's setters.
+//! \tparam Policy Optional subject policy, used like in
+//!                ``compact_value<ValueType, Policy>``.
+//!
+//! \see value<ValueType, EnclosingType, Policy>
+//! \ingroup observable
+template <typename ValueType, typename EnclosingType, typename Policy>
+class compact_value<ValueType, EnclosingType, Policy,
+                    std::enable_if_t<!std::is_void<EnclosingType>::value &&
+                                     !is_subject_policy<EnclosingType>::value &&
+                                     (std::is_void<Policy>::value ||
+                                      is_subject_policy<Policy>::value)>> :
+    public std::conditional_t<std::is_void<Policy>::value,
+                              compact_value<ValueType>,
+                              compact_value<ValueType, Policy>>
+{
+    using base = std::conditional_t<std::is_void<Policy>::value,
+                                    compact_value<ValueType>,
+                                    compact_value<ValueType, Policy>>;
+
+public:
+    using base::base;
+
+    compact_value() =default;
+
+private:
+    using base::set;
+    using base::modify;
+    using base::update;
+    using base::operator=;
+
+    compact_value(compact_value &&) =default;
+
+    auto operator=(compact_value &&) -> compact_value & =default;
+
+    friend EnclosingType;
+};
+
+namespace detail {
+    //! \cond
+    template <typename EnclosingType>
+    struct compact_prop_
+    {
+        template <typename ValueType>
+        using type = compact_value<ValueType, EnclosingType>;
+    };
+    //! \endcond
+}
+
+//! Declare a compact observable property member of a class.
+//!
+//! This works like \ref observable_property, but declares a
+//! \ref compact_value "compact_value". You must use the
+//! \ref OBSERVABLE_PROPERTIES macro before declaring any properties.
+//!
+//! Example:
+//!
+//!     class instrument
+//!     {
+//!         OBSERVABLE_PROPERTIES(instrument)
+//!
+//!     public:
+//!         observable_compact_property<double> last_price;
+//!     };
+//!
+//! \ingroup observable
+#define observable_compact_property \
+    typename ::observable::detail::compact_prop_<Observable_Property_EnclosingType_>::type
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
@@ -0,0 +1,421 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <type_traits>
+#include <utility>
+#include <observable/batch.hpp>
+#include <observable/subject.hpp>
+#include <observable/subscription.hpp>
+#include <observable/value.hpp>
+#include <observable/detail/epoch.hpp>
+#include <observable/detail/propagation.hpp>
+#include <observable/detail/type_traits.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable { namespace detail {
+
+//! Snapshot storage for small, trivially-copyable values, protected by a
+//! sequence lock.
+//!
+//! The value is stored in an array of atomic words. The writer makes the
+//! sequence number odd, stores the words and makes it even again; readers copy
+//! the words and retry if the sequence number has changed in the meantime.
+//!
+//! Readers never write to shared memory, so they never slow down the writer or
+//! each other. A read only retries if it overlaps a write, which only stores a
+//! few words.
+//!
+//! \warning Only one thread can call store() at a time.
+//!
+//! \ingroup observable_detail
+template <typename ValueType>
+class seqlock_snapshot final
+{
+    using word = std::uintptr_t;
+    static constexpr auto word_count = (sizeof(ValueType) + sizeof(word) - 1) /
+                                       sizeof(word);
+
+public:
+    //! Create a snapshot of the provided value.
+    explicit seqlock_snapshot(ValueType const & initial_value) noexcept :
+        local_ { initial_value }
+    {
+        write_words(initial_value);
+    }
+
+    //! Copy the last stored value. Can be called from any thread.
+    auto load() const noexcept -> ValueType
+    {
+        word buffer[word_count];
+        for(;;)
+        {
+            auto const before = sequence_.load(std::memory_order_acquire);
+            if(before & 1)
+                continue;
+
+            // Acquire loads keep the second sequence load after the copy.
+            for(auto i = std::size_t { 0 }; i < word_count; ++i)
+                buffer[i] = words_[i].load(std::memory_order_acquire);
+
+            if(sequence_.load(std::memory_order_relaxed) == before)
+                break;
+        }
+
+        auto result = ValueType { };
+        std::memcpy(&result, buffer, sizeof(ValueType));
+        return result;
+    }
+
+    //! Call a functor with a consistent copy of the last stored value.
+    template <typename Fun>
+    auto read(Fun && fun) const
+    {
+        auto const v = load();
+        return fun(v);
+    }
+
+    //! Retrieve the last stored value. Can only be called by the writer.
+    auto local() const noexcept -> ValueType const & { return local_; }
+
+    //! Store a new value. Can only be called by the writer.
+    void store(ValueType new_value) noexcept
+    {
+        local_ = new_value;
+
+        auto const s = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(s + 1, std::memory_order_relaxed);
+        write_words(local_);
+        sequence_.store(s + 2, std::memory_order_release);
+    }
+
+public:
+    seqlock_snapshot(seqlock_snapshot const &) =delete;
+    auto operator=(seqlock_snapshot const &) -> seqlock_snapshot & =delete;
+
+private:
+    //! Release stores keep the odd sequence store before the words.
+    void write_words(ValueType const & v) noexcept
+    {
+        word buffer[word_count] = { };
+        std::memcpy(buffer, &v, sizeof(ValueType));
+
+        for(auto i = std::size_t { 0 }; i < word_count; ++i)
+            words_[i].store(buffer[i], std::memory_order_release);
+    }
+
+private:
+    ValueType local_;
+    std::atomic<std::size_t> sequence_ { 0 };
+    std::atomic<word> words_[word_count];
+};
+
+//! Snapshot storage that publishes each value in its own immutable copy.
+//!
+//! Storing a value allocates a copy and swaps the published pointer. Readers
+//! load the pointer inside an \ref epoch_domain critical section, which only
+//! writes to memory owned by the reader's thread, so reads are wait-free.
+//! Replaced copies are freed by later stores, once no reader can still be
+//! using them.
+//!
+//! \warning Only one thread can call store() at a time.
+//!
+//! \ingroup observable_detail
+template <typename ValueType>
+class rcu_snapshot final
+{
+public:
+    //! Create a snapshot of the provided value.
+    explicit rcu_snapshot(ValueType initial_value) :
+        current_ { new ValueType(std::move(initial_value)) }
+    { }
+
+    //! Copy the last stored value. Can be called from any thread.
+    auto load() const -> ValueType
+    {
+        return read([](ValueType const & v) { return v; });
+    }
+
+    //! Call a functor with a reference to the last stored value. Can be called
+    //! from any thread.
+    //!
+    //! The reference stays valid until the functor returns, even if the value
+    //! is replaced meanwhile.
+    template <typename Fun>
+    auto read(Fun && fun) const
+    {
+        epoch_guard const guard;
+        return fun(*current_.load(std::memory_order_acquire));
+    }
+
+    //! Retrieve the last stored value. Can only be called by the writer.
+    auto local() const noexcept -> ValueType const &
+    {
+        return *current_.load(std::memory_order_relaxed);
+    }
+
+    //! Store a new value. Can only be called by the writer.
+    void store(ValueType new_value)
+    {
+        auto const next = new ValueType(std::move(new_value));
+        auto const old = current_.exchange(next, std::memory_order_acq_rel);
+
+        // The epoch must be read after the old copy has been unpublished.
+        auto & domain = epoch_domain::instance();
+        retired_.push_back(retired { old, domain.current() });
+
+        domain.try_advance();
+        domain.try_advance();
+
+        // Retired copies are ordered by epoch, oldest first.
+        while(!retired_.empty() && domain.is_safe(retired_.front().epoch))
+        {
+            delete retired_.front().v;
+            retired_.pop_front();
+        }
+    }
+
+    //! Destructor. No reader can be running.
+    ~rcu_snapshot()
+    {
+        for(auto && r : retired_)
+            delete r.v;
+
+        delete current_.load();
+    }
+
+public:
+    rcu_snapshot(rcu_snapshot const &) =delete;
+    auto operator=(rcu_snapshot const &) -> rcu_snapshot & =delete;
+
+private:
+    struct retired
+    {
+        ValueType const * v;
+        epoch_domain::epoch_type epoch;
+    };
+
+    std::atomic<ValueType const *> current_;
+    std::deque<retired> retired_;
+};
+
+//! Small, trivially-copyable values use a sequence lock; the rest are copied
+//! on every store.
+//!
+//! \ingroup observable_detail
+template <typename ValueType>
+using snapshot_storage = std::conditional_t<
+                                std::is_trivially_copyable<ValueType>::value &&
+                                std::is_default_constructible<ValueType>::value &&
+                                sizeof(ValueType) <= 8 * sizeof(std::uintptr_t),
+                                seqlock_snapshot<ValueType>,
+                                rcu_snapshot<ValueType>>;
+
+}
+
+//! Observable value that can be read from any thread.
+//!
+//! A \ref value "value"'s get() returns a reference to storage that the next
+//! set() overwrites, so reading a value from a thread other than the one that
+//! sets it is a data race. A concurrent value keeps a snapshot that other
+//! threads can read at any time, without locking:
+//!
+//!     concurrent_value<position> p { };
+//!
+//!     // Writer thread; observers are notified like with regular values.
+//!     p.set({ 1, 2 });
+//!
+//!     // Any other thread.
+//!     auto const current = p.load();
+//!
+//! Small, trivially-copyable values are protected by a sequence lock: reads do
+//! not write to shared memory, and only retry while a set() is storing the
+//! value's few words. Other values are published as immutable copies, which
+//! readers access wait-free through an epoch-based critical section; each
+//! set() allocates one copy.
+//!
+//! Readers never block the writer.
+//!
+//! \warning set(), update(), subscribe() and get() must all be called from
+//!          the same thread, or be externally synchronized, as for regular
+//!          values. Observers are called on that thread. Only load() and read()
+//!          can be called from other threads. The value must not be destroyed
+//!          while other threads can still read it.
+//!
+//! \tparam ValueType The value-type that will be stored inside the observable.
+//! \tparam Policy Subject policy used by the value's subjects.
+//!
+//! \ingroup observable
+template <typename ValueType, typename Policy=subject_policy>
+class concurrent_value final
+{
+    using void_subject = subject<void(), Policy>;
+    using value_subject = subject<void(ValueType const &), Policy>;
+
+public:
+    //! The observable value's stored value type.
+    using value_type = ValueType;
+
+    //! Create a default-constructed value.
+    concurrent_value() : concurrent_value { ValueType { } } { }
+
+    //! Create an initialized value.
+    explicit concurrent_value(ValueType initial_value) :
+        snapshot_ { std::move(initial_value) }
+    { }
+
+    //! Copy the stored value.
+    //!
+    //! \note This method can be safely called in parallel, from multiple
+    //!       threads, and concurrently with set().
+    auto load() const { return snapshot_.load(); }
+
+    //! Call a functor with a consistent snapshot of the stored value.
+    //!
+    //! Large values can be inspected without copying them.
+    //!
+    //! \param[in] fun Functor called with a ``ValueType const &``. The
+    //!                reference must not be used after the functor returns.
+    //! \return The value returned by the functor.
+    //!
+    //! \note This method can be safely called in parallel, from multiple
+    //!       threads, and concurrently with set().
+    template <typename Fun>
+    auto read(Fun && fun) const { return snapshot_.read(std::forward<Fun>(fun)); }
+
+    //! Retrieve the stored value, from the writer thread.
+    auto get() const noexcept -> ValueType const & { return snapshot_.local(); }
+
+    //! Subscribe to changes to the value.
+    //!
+    //! \see value_base::subscribe()
+    template <typename Callable>
+    auto subscribe(Callable && observer) const
+    {
+        static_assert(detail::is_compatible_with_subject<Callable, void_subject>::value ||
+                      detail::is_compatible_with_subject<Callable, value_subject>::value,
+                      "Observer is not valid. Please provide a void observer or an "
+                      "observer that takes a ValueType as its only argument.");
+
+        return subscribe_impl(std::forward<Callable>(observer));
+    }
+
+    //! Set a new value, possibly notifying any subscribed observers.
+    //!
+    //! The new value is visible to readers before observers are notified.
+    //!
+    //! \see value_base::set()
+    void set(ValueType new_value)
+    {
+        if(detail::equal_to { }(snapshot_.local(), new_value))
+            return;
+
+        snapshot_.store(std::move(new_value));
+        changed();
+    }
+
+    //! Modify a copy of the stored value and store it, if the functor reports
+    //! a change.
+    //!
+    //! \param[in] fun Functor called with a ``ValueType &``; must return true
+    //!                if it has changed the value.
+    //! \return The value returned by the functor.
+    template <typename Fun>
+    auto update(Fun && fun) -> bool
+    {
+        auto v = snapshot_.local();
+        if(!fun(v))
+            return false;
+
+        snapshot_.store(std::move(v));
+        changed();
+        return true;
+    }
+
+    //! Set a new value. Will just call set(ValueType).
+    auto operator=(ValueType new_value) -> concurrent_value &
+    {
+        set(std::move(new_value));
+        return *this;
+    }
+
+    //! Destructor.
+    ~concurrent_value()
+    {
+        if(pending_)
+            batch::cancel(this);
+    }
+
+public:
+    //! Concurrent values are **not** copy-constructible.
+    concurrent_value(concurrent_value const &) =delete;
+
+    //! Concurrent values are **not** copy-assignable.
+    auto operator=(concurrent_value const &) -> concurrent_value & =delete;
+
+private:
+    template <typename Callable>
+    auto subscribe_impl(Callable && observer) const ->
+        std::enable_if_t<detail::is_compatible_with_subject<Callable, void_subject>::value &&
+                         !detail::is_compatible_with_subject<Callable, value_subject>::value,
+                         infinite_subscription>
+    {
+        return void_observers_.subscribe(std::forward<Callable>(observer));
+    }
+
+    template <typename Callable>
+    auto subscribe_impl(Callable && observer) const ->
+        std::enable_if_t<detail::is_compatible_with_subject<Callable,
+                                                            value_subject>::value,
+                         infinite_subscription>
+    {
+        return value_observers_.subscribe(std::forward<Callable>(observer));
+    }
+
+    //! Notify observers of a change, or defer the notification if a batch is
+    //! open.
+    void changed()
+    {
+        if(!pending_)
+            pending_ = batch::defer(this, &flush);
+
+        if(pending_)
+            return;
+
+        notify_observers();
+    }
+
+    void notify_observers() const
+    {
+        detail::propagation::run([&]() {
+            void_observers_.notify();
+            value_observers_.notify(snapshot_.local());
+        });
+    }
+
+    //! Deliver a change deferred by a batch.
+    static void flush(void * target, bool notify)
+    {
+        auto & v = *static_cast<concurrent_value *>(target);
+        v.pending_ = false;
+
+        if(notify)
+            v.notify_observers();
+    }
+
+private:
+    detail::snapshot_storage<ValueType> snapshot_;
+    mutable void_subject void_observers_;
+    mutable value_subject value_observers_;
+
+    // True while the change notification is deferred by a batch.
+    bool pending_ { false };
+};
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
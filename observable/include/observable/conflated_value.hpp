@@ -0,0 +1,222 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <observable/observe.hpp>
+#include <observable/value.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable {
+
+inline namespace expr { namespace expr_detail {
+
+//! Value updater that keeps only the latest value it has been given.
+//!
+//! Setting a value only stores it and raises a flag. The stored value is
+//! delivered, once, the next time the updater it is registered with runs, or
+//! when deliver() is called.
+//!
+//! The updater is registered with an evaluator like an expression, with a rank
+//! of zero, so it is delivered before any expression that depends on it.
+//!
+//! \ingroup observable_detail
+template <typename ValueType, typename EvaluatorType>
+class conflating_updater final : public value_updater<ValueType>
+{
+public:
+    //! Create an updater with an initial value.
+    conflating_updater(ValueType initial_value,
+                       EvaluatorType const & evaluator) :
+        latest_ { std::move(initial_value) },
+        evaluator_ { evaluator }
+    {
+        id_ = evaluator_.insert(this);
+    }
+
+    //! Store a new value, replacing any value that has not been delivered.
+    //!
+    //! \note This method can be safely called in parallel, from multiple
+    //!       threads.
+    void set(ValueType new_value)
+    {
+        {
+            std::lock_guard<std::mutex> const lock { mutex_ };
+            latest_ = std::move(new_value);
+            dirty_.store(true, std::memory_order_release);
+        }
+
+        if(EvaluatorType::tracks_changes)
+            evaluator_.changed(id_);
+    }
+
+    //! Nothing to evaluate; the value is already known.
+    void prepare() noexcept { }
+
+    //! Notify the value of the latest stored value, if it has not been
+    //! delivered yet.
+    //!
+    //! \return True if a value has been delivered.
+    auto deliver() -> bool
+    {
+        if(!dirty_.load(std::memory_order_acquire))
+            return false;
+
+        std::unique_lock<std::mutex> lock { mutex_ };
+        if(!dirty_.load(std::memory_order_relaxed))
+            return false;
+
+        auto v = std::move(latest_);
+        dirty_.store(false, std::memory_order_relaxed);
+        lock.unlock();
+
+        value_notifier_(std::move(v));
+        return true;
+    }
+
+    //! Retrieve the initial value.
+    //!
+    //! \warning After the first delivery, this returns a moved-from value.
+    virtual auto get() const -> ValueType override
+    {
+        std::lock_guard<std::mutex> const lock { mutex_ };
+        return latest_;
+    }
+
+    virtual void set_value_notifier(std::function<void(ValueType &&)> const & notifier) override
+    {
+        value_notifier_ = notifier;
+        evaluator_.ready(id_);
+    }
+
+    //! Conflated values do not depend on anything.
+    virtual auto rank() const -> std::size_t override { return 0; }
+
+    //! Destructor.
+    virtual ~conflating_updater() override { evaluator_.remove(id_); }
+
+public:
+    //! Updaters are not copy-constructible.
+    conflating_updater(conflating_updater const &) =delete;
+
+    //! Updaters are not copy-assignable.
+    auto operator=(conflating_updater const &) -> conflating_updater & =delete;
+
+private:
+    mutable std::mutex mutex_;
+    ValueType latest_;
+    std::atomic<bool> dirty_ { false };
+    EvaluatorType evaluator_;
+    typename EvaluatorType::id id_;
+    std::function<void(ValueType &&)> value_notifier_ { [](auto &&) { } };
+};
+
+} }
+
+//! Value that only delivers the latest change.
+//!
+//! Calling set() only stores the new value. Observers of the output are called
+//! later, once, with the latest stored value, when the associated updater's
+//! update_all() runs or when flush() is called. If a thousand values are set
+//! between two updates, observers are only notified once.
+//!
+//! Example:
+//!
+//!     auto ud = updater { };
+//!     auto position = conflated_value<int> { ud };
+//!
+//!     // Any thread, any number of times.
+//!     position.set(42);
+//!
+//!     // Once per frame.
+//!     ud.update_all();
+//!
+//! The output is a regular, readonly, observable value. It can be subscribed to
+//! and used in expressions; equal values do not notify observers. Expressions
+//! built on the output that use the same updater are evaluated after it, in
+//! the same update_all() call.
+//!
+//! \note set() can be safely called in parallel, from multiple threads. All
+//!       other methods must be called from the thread that updates the
+//!       associated updater.
+//!
+//! \tparam ValueType The value-type that will be stored inside the observable.
+//! \tparam UpdaterType The type of the \ref updater used to deliver changes.
+//!
+//! \ingroup observable
+template <typename ValueType, typename UpdaterType=updater>
+class conflated_value final
+{
+    static_assert(std::is_base_of<updater, UpdaterType>::value,
+                  "UpdaterType must derive from updater.");
+
+    using updater_type = expr::expr_detail::conflating_updater<ValueType,
+                                                               UpdaterType>;
+
+public:
+    //! Create a conflated value.
+    //!
+    //! \param[in] ud Updater that will deliver the latest value when it is
+    //!               updated.
+    //! \param[in] initial_value Initial value of the output.
+    explicit conflated_value(UpdaterType & ud,
+                             ValueType initial_value=ValueType { }) :
+        conflated_value { std::make_unique<updater_type>(std::move(initial_value),
+                                                         ud) }
+    { }
+
+    //! Store a new value, which will be delivered by the next update.
+    //!
+    //! \param[in] new_value Value that will replace any value that has not
+    //!                      been delivered yet.
+    void set(ValueType new_value) { updater_->set(std::move(new_value)); }
+
+    //! Deliver the latest value without waiting for the updater.
+    //!
+    //! This can be used to drain the value from an executor, or from an event
+    //! loop.
+    //!
+    //! \return True if there was a value to deliver.
+    auto flush() -> bool { return updater_->deliver(); }
+
+    //! Retrieve the output's current value.
+    auto get() const noexcept -> ValueType const & { return output_.get(); }
+
+    //! Readonly observable value that changes are delivered to.
+    auto output() noexcept -> value<ValueType> & { return output_; }
+
+    //! \see output()
+    auto output() const noexcept -> value<ValueType> const & { return output_; }
+
+public:
+    //! Conflated values are not copy-constructible.
+    conflated_value(conflated_value const &) =delete;
+
+    //! Conflated values are not copy-assignable.
+    auto operator=(conflated_value const &) -> conflated_value & =delete;
+
+    //! Conflated values are move-constructible.
+    conflated_value(conflated_value &&) =default;
+
+    //! Conflated values are move-assignable.
+    auto operator=(conflated_value &&) -> conflated_value & =default;
+
+private:
+    explicit conflated_value(std::unique_ptr<updater_type> && u) :
+        updater_ { u.get() },
+        output_ { std::move(u) }
+    { }
+
+private:
+    updater_type * updater_;
+    value<ValueType> output_;
+};
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
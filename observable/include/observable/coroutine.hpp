@@ -0,0 +1,416 @@
+#pragma once
+#if !defined(__cpp_impl_coroutine) || !__has_include(<coroutine>)
+#error "observable/coroutine.hpp requires a compiler with C++20 coroutines."
+#endif
+
+#include <coroutine>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <observable/async_subject.hpp>
+#include <observable/subject.hpp>
+#include <observable/subscription.hpp>
+#include <observable/value.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable {
+
+namespace detail {
+
+    //! Convert the stored arguments of a notification to the result of a
+    //! co_await expression: nothing, the single argument, or a tuple.
+    template <typename ... T>
+    struct awaited_result
+    {
+        using type = std::tuple<T ...>;
+
+        static auto unwrap(std::tuple<T ...> && t) { return std::move(t); }
+    };
+
+    template <>
+    struct awaited_result<>
+    {
+        using type = void;
+
+        static void unwrap(std::tuple<> &&) noexcept { }
+    };
+
+    template <typename T>
+    struct awaited_result<T>
+    {
+        using type = T;
+
+        static auto unwrap(std::tuple<T> && t) -> T { return std::get<0>(std::move(t)); }
+    };
+
+    //! State shared by a suspended coroutine and the observer that will
+    //! resume it.
+    //!
+    //! The awaiter, the observer and the resuming task can run on different
+    //! threads, and the awaiter can be destroyed while the others are
+    //! running, so everything they share is kept here, guarded by the mutex.
+    template <typename ... T>
+    struct await_state
+    {
+        enum class status
+        {
+            waiting,   //!< Subscribed, or about to be.
+            notified,  //!< The resuming task has been submitted.
+            resumed,   //!< The coroutine has been, or is being, resumed.
+            cancelled  //!< The awaiter was destroyed before resuming.
+        };
+
+        std::mutex mutex;
+        status current = status::waiting;
+        std::optional<std::tuple<T ...>> result;
+        std::coroutine_handle<> handle;
+        unique_subscription sub;
+    };
+
+    //! Observer that stores the first notification and resumes the waiting
+    //! coroutine through an executor.
+    template <typename Executor, typename ... T>
+    struct await_observer
+    {
+        using status = typename await_state<T ...>::status;
+
+        template <typename ... A>
+        void operator()(A && ... arguments)
+        {
+            {
+                std::lock_guard<std::mutex> const lock { state->mutex };
+                if(state->current != status::waiting)
+                    return;
+
+                state->result.emplace(std::forward<A>(arguments) ...);
+                state->current = status::notified;
+            }
+
+            // Not under the lock: inline executors resume the coroutine
+            // right away, which destroys the awaiter.
+            executor(async_task { [s = state]() {
+                {
+                    std::lock_guard<std::mutex> const lock { s->mutex };
+                    if(s->current == status::cancelled)
+                        return;
+
+                    s->current = status::resumed;
+                }
+
+                s->handle.resume();
+            } });
+        }
+
+        std::shared_ptr<await_state<T ...>> state;
+        Executor executor;
+    };
+
+    //! Awaitable returned by next() and changed().
+    //!
+    //! The observer is subscribed when the coroutine suspends and
+    //! unsubscribed when the awaiter is destroyed, once the coroutine has
+    //! resumed or has been destroyed while suspended.
+    template <typename Observable, typename Executor, typename ... T>
+    class notification_awaiter
+    {
+        using status = typename await_state<T ...>::status;
+
+    public:
+        notification_awaiter(Observable & observable, Executor executor) :
+            observable_ { observable },
+            executor_ { std::move(executor) }
+        { }
+
+        auto await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            // Once subscribed, the coroutine can be resumed, and this awaiter
+            // destroyed, by another thread: only locals are used after that.
+            auto const state = state_;
+            state->handle = handle;
+
+            auto sub = unique_subscription {
+                observable_.subscribe(await_observer<Executor, T ...> { state,
+                                                                        executor_ })
+            };
+
+            // If the awaiter was already destroyed, sub unsubscribes when it
+            // goes out of scope, after the lock has been released.
+            std::lock_guard<std::mutex> const lock { state->mutex };
+            if(state->current != status::cancelled)
+                state->sub = std::move(sub);
+        }
+
+        auto await_resume() -> typename awaited_result<T ...>::type
+        {
+            return awaited_result<T ...>::unwrap(std::move(*state_->result));
+        }
+
+        ~notification_awaiter()
+        {
+            if(!state_)
+                return;
+
+            auto sub = unique_subscription { };
+            {
+                // Tasks that have not resumed the coroutine yet must not
+                // resume a coroutine that is being destroyed.
+                std::lock_guard<std::mutex> const lock { state_->mutex };
+                if(state_->current != status::resumed)
+                    state_->current = status::cancelled;
+
+                sub = std::move(state_->sub);
+            }
+        }
+
+        notification_awaiter(notification_awaiter &&) =default;
+        auto operator=(notification_awaiter &&) -> notification_awaiter & =delete;
+
+    private:
+        Observable & observable_;
+        Executor executor_;
+        std::shared_ptr<await_state<T ...>> state_ {
+            std::make_shared<await_state<T ...>>()
+        };
+    };
+
+}
+
+//! Wait for the next notification of a subject, inside a coroutine.
+//!
+//! The coroutine is suspended, without blocking any thread, until the subject
+//! is notified. It is then resumed through the provided executor, and the
+//! co_await expression returns the notification's arguments: nothing for
+//! ``void()`` subjects, the argument for subjects with a single argument, or a
+//! tuple of all arguments.
+//!
+//! Example:
+//!
+//!     auto price = co_await next(trades, pool_executor);
+//!
+//! \param[in] s Subject to wait for. It must outlive the co_await expression.
+//! \param[in] executor Callable that accepts an \ref async_task; used to
+//!                     resume the coroutine. The default executor resumes it
+//!                     inside notify().
+//!
+//! \note Only the first notification after the coroutine suspends is
+//!       returned. Notifications that happen before that are not seen.
+//!
+//! \ingroup observable
+template <typename ... Args, typename Policy, typename Executor=inline_executor>
+inline auto next(detail::subject_base<void(Args ...), Policy> & s,
+                 Executor executor=Executor { })
+{
+    using subject_type = detail::subject_base<void(Args ...), Policy>;
+    return detail::notification_awaiter<subject_type,
+                                        Executor,
+                                        std::decay_t<Args> ...> { s,
+                                                                  std::move(executor) };
+}
+
+//! Wait for the next change of a value, inside a coroutine.
+//!
+//! The co_await expression returns the new value.
+//!
+//! Example:
+//!
+//!     while(running)
+//!         redraw(co_await changed(model.position));
+//!
+//! \param[in] v Value to wait for. It must outlive the co_await expression.
+//! \param[in] executor Callable that accepts an \ref async_task; used to
+//!                     resume the coroutine.
+//!
+//! \see next()
+//! \ingroup observable
+template <typename ValueType, typename ... Rest, typename Executor=inline_executor>
+inline auto changed(value<ValueType, Rest ...> & v, Executor executor=Executor { })
+{
+    return detail::notification_awaiter<value<ValueType, Rest ...>,
+                                        Executor,
+                                        std::decay_t<ValueType>> { v,
+                                                                   std::move(executor) };
+}
+
+//! Asynchronous sequence of the notifications of a subject or value.
+//!
+//! The stream subscribes to its source when it is created and queues every
+//! notification until it is consumed. Consuming the stream inside a coroutine
+//! suspends the coroutine until a notification is available:
+//!
+//!     auto trades = notifications(trade_subject, pool_executor);
+//!     for(;;)
+//!         process(co_await trades.next());
+//!
+//! Unlike repeated calls to next(), a stream never misses notifications.
+//!
+//! \tparam T Types of the notification's arguments. They are stored, by value,
+//!           until they have been consumed.
+//! \tparam Executor Callable that accepts an \ref async_task; used to resume
+//!                  the consuming coroutine.
+//!
+//! \warning Only one coroutine can wait for the stream at a time.
+//!
+//! \ingroup observable
+template <typename Executor, typename ... T>
+class notification_stream
+{
+    struct state
+    {
+        //! Queue a notification and return the coroutine to resume, if one is
+        //! waiting.
+        template <typename ... A>
+        auto push(A && ... arguments) -> std::coroutine_handle<>
+        {
+            std::lock_guard<std::mutex> const lock { mutex };
+            if(closed)
+                return { };
+
+            queue.emplace_back(std::forward<A>(arguments) ...);
+            return std::exchange(waiting, nullptr);
+        }
+
+        std::mutex mutex;
+        std::deque<std::tuple<T ...>> queue;
+        std::coroutine_handle<> waiting;
+        bool closed = false;
+    };
+
+public:
+    //! Awaitable returned by next().
+    class awaiter
+    {
+    public:
+        auto await_ready() const
+        {
+            std::lock_guard<std::mutex> const lock { s_->mutex };
+            return !s_->queue.empty();
+        }
+
+        auto await_suspend(std::coroutine_handle<> handle) -> bool
+        {
+            std::lock_guard<std::mutex> const lock { s_->mutex };
+            if(!s_->queue.empty())
+                return false;
+
+            s_->waiting = handle;
+            return true;
+        }
+
+        auto await_resume() -> typename detail::awaited_result<T ...>::type
+        {
+            std::unique_lock<std::mutex> lock { s_->mutex };
+            auto front = std::move(s_->queue.front());
+            s_->queue.pop_front();
+            lock.unlock();
+
+            return detail::awaited_result<T ...>::unwrap(std::move(front));
+        }
+
+    private:
+        explicit awaiter(state * s) noexcept : s_ { s } { }
+
+        state * s_;
+
+        friend class notification_stream;
+    };
+
+    //! Subscribe to the provided source.
+    //!
+    //! \param[in] source A subject or a value. The source can be destroyed
+    //!                   before the stream.
+    //! \param[in] executor Executor used to resume the consuming coroutine.
+    template <typename Source>
+    notification_stream(Source & source, Executor executor) :
+        executor_ { std::make_shared<Executor>(std::move(executor)) }
+    {
+        sub_ = unique_subscription {
+            source.subscribe([s = state_, e = executor_](auto && ... arguments) -> void {
+                auto const h = s->push(std::forward<decltype(arguments)>(arguments) ...);
+                if(h)
+                    (*e)(async_task { [h]() { h.resume(); } });
+            })
+        };
+    }
+
+    //! Wait for the next notification.
+    //!
+    //! The co_await expression returns immediately if a notification has
+    //! already been queued.
+    auto next() noexcept -> awaiter { return awaiter { state_.get() }; }
+
+    //! Number of queued notifications.
+    auto size() const
+    {
+        std::lock_guard<std::mutex> const lock { state_->mutex };
+        return state_->queue.size();
+    }
+
+    //! Destructor. Stops queueing notifications.
+    ~notification_stream()
+    {
+        if(!state_)
+            return;
+
+        sub_.unsubscribe();
+        std::lock_guard<std::mutex> const lock { state_->mutex };
+        state_->closed = true;
+    }
+
+public:
+    //! Streams are not copy-constructible.
+    notification_stream(notification_stream const &) =delete;
+
+    //! Streams are not copy-assignable.
+    auto operator=(notification_stream const &) -> notification_stream & =delete;
+
+    //! Streams are move-constructible.
+    notification_stream(notification_stream &&) =default;
+
+    //! Streams are not move-assignable.
+    auto operator=(notification_stream &&) -> notification_stream & =delete;
+
+private:
+    std::shared_ptr<state> state_ { std::make_shared<state>() };
+    std::shared_ptr<Executor> executor_;
+    unique_subscription sub_;
+};
+
+//! Create a stream of the notifications of a subject.
+//!
+//! \see notification_stream
+//! \ingroup observable
+template <typename ... Args, typename Policy, typename Executor=inline_executor>
+inline auto notifications(detail::subject_base<void(Args ...), Policy> & s,
+                          Executor executor=Executor { })
+{
+    return notification_stream<Executor, std::decay_t<Args> ...> {
+        s, std::move(executor)
+    };
+}
+
+//! Create a stream of the changes of a value.
+//!
+//! Each change is queued as a copy of the new value.
+//!
+//! \see notification_stream
+//! \ingroup observable
+template <typename ValueType, typename ... Rest, typename Executor=inline_executor>
+inline auto notifications(value<ValueType, Rest ...> & v,
+                          Executor executor=Executor { })
+{
+    return notification_stream<Executor, std::decay_t<ValueType>> {
+        v, std::move(executor)
+    };
+}
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
@@ -0,0 +1,491 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <observable/detail/epoch.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable { namespace detail {
+
+//! Thread-safe collection that stores its elements in contiguous chunks.
+//!
+//! This collection has the same interface and guarantees as \ref collection,
+//! but instead of allocating a node for each element, it stores elements inside
+//! fixed-size chunks of slots. Applying a functor walks the slots of each chunk
+//! linearly, which is a lot friendlier to the cache than chasing one pointer
+//! per element.
+//!
+//! Slots freed by remove() are reused by later insert() calls, once no thread
+//! can still be reading them, as tracked by the \ref epoch_domain. Chunks are
+//! only released when the collection is destroyed.
+//!
+//! All methods of the collection can be safely called in parallel, from multiple
+//! threads.
+//!
+//! \warning The order of elements inside the collection is unspecified.
+//!
+//! \tparam ValueType Type of the elements that will be stored inside the
+//!                   collection. This type must be at least move constructible.
+//! \tparam ChunkSize Number of elements stored inside a single chunk.
+//! \ingroup observable_detail
+template <typename ValueType, std::size_t ChunkSize=32>
+class chunked_collection final
+{
+    static_assert(ChunkSize > 0, "ChunkSize must be greater than zero.");
+
+public:
+    //! Identifier for an element that has been inserted. You can use this id to
+    //! remove a previously inserted element.
+    using id = std::size_t;
+
+    //! Direct reference to an inserted element.
+    //!
+    //! Removing an element through its handle takes constant time. Handles
+    //! can be safely used after their element has been removed by other means,
+    //! but they must not be used after the collection has been destroyed.
+    //!
+    //! Handles are trivially copyable.
+    class handle final
+    {
+    public:
+        //! Create an empty handle.
+        handle() noexcept =default;
+
+        //! Return true if the handle is not empty.
+        explicit operator bool() const noexcept { return !!slot_; }
+
+    private:
+        handle(void * s, id i) noexcept : slot_ { s }, id_ { i } { }
+
+        void * slot_ { nullptr };
+        id id_ { 0 };
+
+        friend class chunked_collection<ValueType, ChunkSize>;
+    };
+
+    //! Create an empty collection.
+    chunked_collection() noexcept = default;
+
+    //! Insert a new element into the collection.
+    //!
+    //! \param[in] element The object to be inserted.
+    //! \tparam ValueType_ Type of the inserted element. Must be convertible to
+    //!                    the collection's ValueType.
+    //!
+    //! \return An \ref id that can be used to remove the inserted element.
+    //!         This \ref id is stable; you can use it after modifying the
+    //!         collection.
+    //!
+    //! \note Any apply() call running concurrently with an insert() that has
+    //!       already called its functor for at least one element, is guaranteed
+    //!       to not call the functor for this newly inserted element.
+    template <typename ValueType_>
+    auto insert(ValueType_ && element)
+    {
+        return insert_handle(std::forward<ValueType_>(element)).id_;
+    }
+
+    //! Insert a new element into the collection and return a handle to it.
+    //!
+    //! This works exactly like insert(), except it also returns a \ref handle
+    //! that can be used to remove the element in constant time.
+    //!
+    //! \see insert()
+    template <typename ValueType_>
+    auto insert_handle(ValueType_ && element)
+    {
+        auto const i = ++last_id_;
+
+        chunk * c = nullptr;
+        auto s = acquire_slot(c);
+        try {
+            new (&s->storage) ValueType(std::forward<ValueType_>(element));
+        } catch(...) {
+            s->tag.store(slot_free);
+            --c->used;
+            throw;
+        }
+
+        ++size_;
+        s->tag.store(make_tag(i, slot_live));
+
+        gc();
+        return handle { s, i };
+    }
+
+    //! Remove a previously inserted element from the collection.
+    //!
+    //! If no element with the provided \ref id exists, this method does nothing.
+    //!
+    //! \note This method needs to search for the element. Prefer removing
+    //!       elements through a \ref handle.
+    //!
+    //! \param[in] element_id Id of the element to remove. This is returned by
+    //!                       insert.
+    //!
+    //! \return True if an element of the collection was removed, false if no
+    //!         element has been removed.
+    //!
+    //! \note Any apply() call running concurrently with a remove() call that has
+    //!       not already called its functor with the removed element, is
+    //!       guaranteed to not call the functor with the removed element.
+    auto remove(id const & element_id) noexcept
+    {
+        auto deleted = false;
+        auto found = false;
+        {
+            epoch_guard const guard { };
+
+            for(auto c = head_.load(); c && !found; c = c->next.load())
+            {
+                for(auto && s : c->slots)
+                {
+                    if(s.tag.load() != make_tag(element_id, slot_live))
+                        continue;
+
+                    found = true;
+                    deleted = mark_deleted(s, element_id);
+                    break;
+                }
+            }
+        }
+
+        gc();
+        return deleted;
+    }
+
+    //! Remove an element from the collection, in constant time.
+    //!
+    //! If the element has already been removed, this method does nothing.
+    //!
+    //! \param[in] element_handle Handle returned by insert_handle().
+    //! \return True if an element of the collection was removed, false if no
+    //!         element has been removed.
+    //!
+    //! \see remove(id const &)
+    auto remove(handle const & element_handle) noexcept
+    {
+        auto const deleted = element_handle.slot_ &&
+                             mark_deleted(*static_cast<slot *>(element_handle.slot_),
+                                          element_handle.id_);
+        gc();
+        return deleted;
+    }
+
+    //! Apply a unary functor over all elements of the collection.
+    //!
+    //! The functor will be called multiple times, with each element, in an
+    //! unspecified order.
+    //!
+    //! \note This method is reentrant; you can call insert() and remove() on the
+    //!       collection from inside the functor.
+    //!
+    //! \note It is well defined and supported to remove() the element passed
+    //!       to the functor, even before the functor returns.
+    //!
+    //! \param[in] fun A functor that will be called with each element of the
+    //!                collection. The functor must be assignable to a
+    //!                ``std::function<void(ValueType const &)>``.
+    //!
+    //! \tparam UnaryFunctor Type of the ``fun`` parameter.
+    template <typename UnaryFunctor>
+    void apply(UnaryFunctor && fun) const
+        noexcept(noexcept(fun(std::declval<ValueType>())))
+    {
+        {
+            epoch_guard const guard { };
+            auto const last_id = last_id_.load();
+
+            for(auto c = head_.load(); c; c = c->next.load())
+            {
+                for(auto && s : c->slots)
+                {
+                    auto const tag = s.tag.load();
+                    if(tag_state(tag) != slot_live || tag_id(tag) > last_id)
+                        continue;
+
+                    fun(s.element());
+                }
+            }
+        }
+
+        // The collection is logically const; freeing already removed slots
+        // does not change its contents.
+        if(retired_.load() > 0)
+            const_cast<chunked_collection *>(this)->gc();
+    }
+
+    //! Apply a unary functor over all elements of the collection, in chunks
+    //! that can be visited concurrently.
+    //!
+    //! Each chunk of elements spans whole chunks of slots, holding at most
+    //! ``chunk_size`` slots unless that is less than ``ChunkSize``.
+    //!
+    //! \see collection::apply_chunks()
+    template <typename Run, typename UnaryFunctor>
+    void apply_chunks(std::size_t chunk_size, Run && run, UnaryFunctor && fun) const
+    {
+        {
+            // Slots visited by other threads are kept alive by this guard.
+            epoch_guard const guard { };
+            auto const last_id = last_id_.load();
+
+            auto chunks = std::vector<chunk *> { };
+            for(auto c = head_.load(); c; c = c->next.load())
+                chunks.push_back(c);
+
+            auto const per_group = chunk_size > ChunkSize ? chunk_size / ChunkSize : 1;
+            auto visit = [&](std::size_t group) {
+                auto const first = group * per_group;
+                auto const last = std::min(first + per_group, chunks.size());
+                for(auto i = first; i < last; ++i)
+                {
+                    for(auto && s : chunks[i]->slots)
+                    {
+                        auto const tag = s.tag.load();
+                        if(tag_state(tag) != slot_live || tag_id(tag) > last_id)
+                            continue;
+
+                        fun(s.element());
+                    }
+                }
+            };
+
+            run((chunks.size() + per_group - 1) / per_group, visit);
+        }
+
+        if(retired_.load() > 0)
+            const_cast<chunked_collection *>(this)->gc();
+    }
+
+    //! Return true if the collection has no elements.
+    auto empty() const noexcept { return size_.load() == 0; }
+
+    //! Return the number of elements in the collection.
+    auto size() const noexcept { return size_.load(); }
+
+    //! Destructor.
+    ~chunked_collection() noexcept
+    {
+        for(auto c = head_.load(); c;)
+        {
+            for(auto && s : c->slots)
+                if(tag_state(s.tag.load()) != slot_free)
+                    s.element().~ValueType();
+
+            auto const next = c->next.load();
+            delete c;
+            c = next;
+        }
+    }
+
+public:
+    //! Collections are not copy-constructible.
+    chunked_collection(chunked_collection const &) =delete;
+
+    //! Collections are not copy-assignable.
+    auto operator=(chunked_collection const &) -> chunked_collection & =delete;
+
+    //! Collections are not move-constructible.
+    chunked_collection(chunked_collection &&) =delete;
+
+    //! Collections are not move-assignable.
+    auto operator=(chunked_collection &&) -> chunked_collection & =delete;
+
+private:
+    //! Slot states.
+    enum : std::uint64_t
+    {
+        slot_free,    //!< Slot can be claimed by insert().
+        slot_busy,    //!< Slot has been claimed, element is being constructed.
+        slot_live,    //!< Slot holds an element that apply() will visit.
+        slot_deleted, //!< Slot holds an element waiting for gc().
+        slot_retired  //!< Slot holds an element that readers may still use.
+    };
+
+    // A slot's tag packs the element id together with the slot state, so a
+    // single compare-and-swap can check both that a slot still holds a
+    // particular element and change its state.
+    static constexpr std::uint64_t const state_bits = 3;
+    static constexpr std::uint64_t const state_mask = (1 << state_bits) - 1;
+
+    static constexpr auto make_tag(id i, std::uint64_t state) noexcept
+    {
+        return (static_cast<std::uint64_t>(i) << state_bits) | state;
+    }
+
+    static constexpr auto tag_state(std::uint64_t tag) noexcept
+    {
+        return tag & state_mask;
+    }
+
+    static constexpr auto tag_id(std::uint64_t tag) noexcept
+    {
+        return static_cast<id>(tag >> state_bits);
+    }
+
+    //! Element storage.
+    struct slot
+    {
+        std::atomic<std::uint64_t> tag { slot_free };
+        epoch_domain::epoch_type retire_epoch { 0 };
+        std::aligned_storage_t<sizeof(ValueType), alignof(ValueType)> storage;
+
+        auto element() noexcept -> ValueType &
+        {
+            return *reinterpret_cast<ValueType *>(&storage);
+        }
+
+        auto element() const noexcept -> ValueType const &
+        {
+            return *reinterpret_cast<ValueType const *>(&storage);
+        }
+    };
+
+    //! A fixed number of contiguous slots.
+    struct chunk
+    {
+        std::array<slot, ChunkSize> slots;
+        std::atomic<std::size_t> used { 0 };
+        std::atomic<chunk *> next { nullptr };
+    };
+
+    //! Mark the slot holding an element as deleted.
+    //!
+    //! \return True if the slot was holding the live element.
+    auto mark_deleted(slot & s, id element_id) noexcept
+    {
+        auto expected = make_tag(element_id, slot_live);
+        if(!s.tag.compare_exchange_strong(expected,
+                                          make_tag(element_id, slot_deleted)))
+            return false;
+
+        --size_;
+        ++deleted_;
+        return true;
+    }
+
+    //! Claim a free slot, allocating a new chunk if all chunks are full.
+    //!
+    //! The returned slot will be in the busy state.
+    //!
+    //! \param[out] owner The chunk containing the returned slot.
+    auto acquire_slot(chunk * & owner) -> slot *
+    {
+        auto link = &head_;
+        for(;;)
+        {
+            auto c = link->load();
+            if(!c)
+            {
+                auto fresh = new chunk { };
+                if(link->compare_exchange_strong(c, fresh))
+                    c = fresh;
+                else
+                    delete fresh;
+            }
+
+            if(c->used.load() < ChunkSize)
+            {
+                for(auto && s : c->slots)
+                {
+                    auto expected = s.tag.load();
+                    if(tag_state(expected) != slot_free ||
+                       !s.tag.compare_exchange_strong(expected, slot_busy))
+                        continue;
+
+                    ++c->used;
+                    owner = c;
+                    return &s;
+                }
+            }
+
+            link = &c->next;
+        }
+    }
+
+    //! Retire slots marked as deleted and free the retired slots that no
+    //! reader can still be using.
+    //!
+    //! Slots are only scanned when enough of them are waiting to be retired,
+    //! or when all retired slots have become safe to free, so the cost of a
+    //! scan is amortized over many remove() calls.
+    //!
+    //! If another thread is already running gc(), this method does nothing.
+    void gc() noexcept
+    {
+        if((deleted_.load() == 0 && retired_.load() == 0) ||
+           gc_active_.exchange(true))
+            return;
+
+        auto & domain = epoch_domain::instance();
+        if(retired_.load() > 0)
+        {
+            domain.try_advance();
+            domain.try_advance();
+        }
+
+        auto const deleted = deleted_.load();
+        auto const retire = deleted > 0 && deleted * 2 >= size_.load();
+        auto const free = retired_.load() > 0 && domain.is_safe(last_retire_epoch_);
+
+        if(retire || free)
+            scan(domain);
+
+        gc_active_.store(false);
+    }
+
+    //! Retire all deleted slots and free all retired slots that are safe.
+    void scan(epoch_domain & domain) noexcept
+    {
+        for(auto c = head_.load(); c; c = c->next.load())
+        {
+            for(auto && s : c->slots)
+            {
+                auto const tag = s.tag.load();
+                auto const state = tag_state(tag);
+                if(state == slot_deleted)
+                {
+                    // Deleted slots are not reachable by new apply() calls, so
+                    // only readers that are already running can use them. The
+                    // epoch must be read after the tag.
+                    s.retire_epoch = domain.current();
+                    last_retire_epoch_ = s.retire_epoch;
+                    s.tag.store(make_tag(tag_id(tag), slot_retired));
+                    --deleted_;
+                    ++retired_;
+                }
+                else if(state == slot_retired && domain.is_safe(s.retire_epoch))
+                {
+                    s.element().~ValueType();
+                    s.tag.store(slot_free);
+                    --c->used;
+                    --retired_;
+                }
+            }
+        }
+    }
+
+private:
+    std::atomic<chunk *> head_ { nullptr };
+    std::atomic<std::size_t> size_ { 0 };
+    std::atomic<std::size_t> deleted_ { 0 };
+    std::atomic<std::size_t> retired_ { 0 };
+    std::atomic<bool> gc_active_ { false };
+    std::atomic<id> last_id_ { 0 };
+
+    // Only accessed by the thread that is running gc().
+    epoch_domain::epoch_type last_retire_epoch_ { 0 };
+};
+
+} }
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
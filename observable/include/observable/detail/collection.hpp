@@ -1,6 +1,13 @@
 #pragma once
+#include <algorithm>
 #include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
 #include <type_traits>
+#include <utility>
+#include <vector>
+#include <observable/detail/epoch.hpp>
 
 #include <observable/detail/compiler_config.hpp>
 OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
@@ -13,19 +20,103 @@ namespace observable { namespace detail {
 //! All methods of the collection can be safely called in parallel, from multiple
 //! threads.
 //!
+//! Removed elements are destroyed once no thread can still be visiting them,
+//! as tracked by the \ref epoch_domain. The nodes that held them are unlinked
+//! in batches and freed the same way. Readers never wait for a running gc()
+//! and gc() never waits for readers.
+//!
 //! \warning The order of elements inside the collection is unspecified.
 //!
 //! \tparam ValueType Type of the elements that will be stored inside the
 //!                   collection. This type must be at least move constructible.
+//! \tparam Allocator Allocator used for the collection's nodes; it is rebound
+//!                   to the node type. Nodes can be freed by any thread and by
+//!                   handles, after the collection has been destroyed, so the
+//!                   allocator must be stateless: each node is freed through a
+//!                   default-constructed instance.
 //! \ingroup observable_detail
-template <typename ValueType>
+template <typename ValueType, typename Allocator=std::allocator<ValueType>>
 class collection final
 {
+    struct node;
+
+    using node_allocator = typename std::allocator_traits<Allocator>::
+                                template rebind_alloc<node>;
+    using node_traits = std::allocator_traits<node_allocator>;
+
+    static_assert(std::is_empty<node_allocator>::value &&
+                  std::is_default_constructible<node_allocator>::value,
+                  "The collection's allocator must be stateless.");
+
 public:
     //! Identifier for an element that has been inserted. You can use this id to
     //! remove a previously inserted element.
     using id = std::size_t;
 
+    //! Direct reference to an inserted element.
+    //!
+    //! Removing an element through its handle takes constant time. The handle
+    //! keeps the memory of its element's node alive, so it can be safely used
+    //! even after the element has been removed by other means, but it must not
+    //! be used after the collection has been destroyed.
+    //!
+    //! Handles are cheap to copy and move.
+    class handle final
+    {
+    public:
+        //! Create an empty handle.
+        handle() noexcept =default;
+
+        //! Return true if the handle is not empty.
+        explicit operator bool() const noexcept { return !!node_; }
+
+        //! Handles are copy-constructible.
+        handle(handle const & other) noexcept : node_ { other.node_ }
+        {
+            if(node_)
+                node_->acquire();
+        }
+
+        //! Handles are copy-assignable.
+        auto operator=(handle const & other) noexcept -> handle &
+        {
+            handle { other }.swap(*this);
+            return *this;
+        }
+
+        //! Handles are move-constructible.
+        handle(handle && other) noexcept : node_ { other.node_ }
+        {
+            other.node_ = nullptr;
+        }
+
+        //! Handles are move-assignable.
+        auto operator=(handle && other) noexcept -> handle &
+        {
+            handle { std::move(other) }.swap(*this);
+            return *this;
+        }
+
+        //! Destructor.
+        ~handle() noexcept
+        {
+            if(node_)
+                node_->release();
+        }
+
+    private:
+        explicit handle(node * n) noexcept : node_ { n }
+        {
+            node_->acquire();
+        }
+
+        void swap(handle & other) noexcept { std::swap(node_, other.node_); }
+
+        node * node_ { nullptr };
+
+        friend class collection;
+    };
+
     //! Create an empty collection.
     collection() noexcept = default;
 
@@ -45,29 +136,28 @@ public:
     template <typename ValueType_>
     auto insert(ValueType_ && element)
     {
-        auto const i = ++last_id_;
-        auto n = std::make_unique<node>();
-        n->node_id = i;
-        n->element = std::forward<ValueType_>(element);
-
-        {
-            auto const block_gc = gc_blocker { this };
-
-            n->next = head_.load();
-            while(!head_.compare_exchange_weak(n->next, n.get()))
-                ;
-
-            n.release();
-        }
+        return insert_node(std::forward<ValueType_>(element))->node_id;
+    }
 
-        gc();
-        return i;
+    //! Insert a new element into the collection and return a handle to it.
+    //!
+    //! This works exactly like insert(), except it also returns a \ref handle
+    //! that can be used to remove the element in constant time.
+    //!
+    //! \see insert()
+    template <typename ValueType_>
+    auto insert_handle(ValueType_ && element)
+    {
+        return handle { insert_node(std::forward<ValueType_>(element)) };
     }
 
     //! Remove a previously inserted element from the collection.
     //!
     //! If no element with the provided \ref id exists, this method does nothing.
     //!
+    //! \note This method needs to search for the element. Prefer removing
+    //!       elements through a \ref handle.
+    //!
     //! \param[in] element_id Id of the element to remove. This is returned by
     //!                       insert.
     //!
@@ -81,14 +171,14 @@ public:
     {
         auto deleted = false;
         {
-            auto const block_gc = gc_blocker { this };
+            epoch_guard const guard { };
 
-            for(auto n = head_.load(); n; n = n->next)
+            for(auto n = head_.load(); n; n = n->next.load())
             {
                 if(n->node_id != element_id)
                     continue;
 
-                deleted = !n->deleted.exchange(true);
+                deleted = mark_deleted(n);
                 break;
             }
         }
@@ -97,6 +187,23 @@ public:
         return deleted;
     }
 
+    //! Remove an element from the collection, in constant time.
+    //!
+    //! If the element has already been removed, this method does nothing.
+    //!
+    //! \param[in] element_handle Handle returned by insert_handle().
+    //! \return True if an element of the collection was removed, false if no
+    //!         element has been removed.
+    //!
+    //! \see remove(id const &)
+    auto remove(handle const & element_handle) noexcept
+    {
+        auto const deleted = element_handle.node_ &&
+                             mark_deleted(element_handle.node_);
+        gc();
+        return deleted;
+    }
+
     //! Apply a unary functor over all elements of the collection.
     //!
     //! The functor will be called multiple times, with each element, in an
@@ -117,32 +224,85 @@ public:
     void apply(UnaryFunctor && fun) const
         noexcept(noexcept(fun(std::declval<ValueType>())))
     {
-        auto const block_gc = gc_blocker { this };
-
-        for(auto n = head_.load(); n; n = n->next)
         {
-            if(n->deleted.load())
-                continue;
+            epoch_guard const guard { };
+
+            for(auto n = head_.load(); n; n = n->next.load())
+            {
+                if(n->deleted.load())
+                    continue;
 
-            fun(n->element);
+                fun(n->element());
+            }
         }
+
+        // The collection is logically const; freeing already removed nodes
+        // does not change its contents.
+        if(has_garbage())
+            const_cast<collection *>(this)->gc();
     }
 
-    //! Return true if the collection has no elements.
-    auto empty() const noexcept
+    //! Apply a unary functor over all elements of the collection, in chunks
+    //! that can be visited concurrently.
+    //!
+    //! The elements are split into chunks of at most ``chunk_size`` elements.
+    //! ``run`` is called with the number of chunks and a functor that visits
+    //! the chunk with the provided index; it must visit every chunk, possibly
+    //! in parallel, and return once all of them have been visited.
+    //!
+    //! This method has the same guarantees as apply() for elements that are
+    //! inserted or removed while it is running.
+    //!
+    //! \param[in] chunk_size Maximum number of elements in a chunk.
+    //! \param[in] run Functor compatible with ``void (std::size_t, F &)``,
+    //!                where ``F`` is compatible with ``void (std::size_t)``.
+    //! \param[in] fun A functor that will be called with each element of the
+    //!                collection. Calls from different chunks can run
+    //!                concurrently.
+    template <typename Run, typename UnaryFunctor>
+    void apply_chunks(std::size_t chunk_size, Run && run, UnaryFunctor && fun) const
     {
-        auto const block_gc = gc_blocker { this };
-        auto const h = head_.load();
-        return !h || h->deleted;
+        {
+            // Nodes visited by other threads are kept alive by this guard.
+            epoch_guard const guard { };
+
+            auto nodes = std::vector<node *> { };
+            nodes.reserve(size_.load());
+            for(auto n = head_.load(); n; n = n->next.load())
+                if(!n->deleted.load())
+                    nodes.push_back(n);
+
+            auto visit = [&](std::size_t chunk) {
+                auto const first = chunk * chunk_size;
+                auto const last = std::min(first + chunk_size, nodes.size());
+                for(auto i = first; i < last; ++i)
+                    if(!nodes[i]->deleted.load())
+                        fun(nodes[i]->element());
+            };
+
+            run((nodes.size() + chunk_size - 1) / chunk_size, visit);
+        }
+
+        if(has_garbage())
+            const_cast<collection *>(this)->gc();
     }
 
+    //! Return true if the collection has no elements.
+    auto empty() const noexcept { return size_.load() == 0; }
+
+    //! Return the number of elements in the collection.
+    auto size() const noexcept { return size_.load(); }
+
     //! Destructor.
     ~collection() noexcept
     {
-        for(auto n = head_.load(); n; n = n->next)
-            n->deleted.store(true);
+        free_list(head_.load(), &node::next);
+        free_list(retired_.load(), &node::next_retired);
 
-        gc();
+        // Every node is also in one of the lists above, so the elements have
+        // been destroyed; only the references of these lists remain.
+        release_list(removed_.load());
+        release_list(expiring_.load());
     }
 
 public:
@@ -159,71 +319,302 @@ public:
     auto operator=(collection &&) -> collection & =delete;
 
 private:
-    //! Delete any nodes marked as deleted.
+    //! Node data.
+    struct node
+    {
+        template <typename ValueType_>
+        explicit node(ValueType_ && element)
+        {
+            new (&storage) ValueType(std::forward<ValueType_>(element));
+        }
+
+        auto element() noexcept -> ValueType &
+        {
+            return *reinterpret_cast<ValueType *>(&storage);
+        }
+
+        //! Add a reference to the node's memory.
+        void acquire() noexcept { ++refs; }
+
+        //! Drop a reference to the node's memory.
+        //!
+        //! The element must have already been destroyed if this drops the
+        //! last reference.
+        void release() noexcept
+        {
+            if(--refs == 0)
+            {
+                auto a = node_allocator { };
+                node_traits::destroy(a, this);
+                node_traits::deallocate(a, this, 1);
+            }
+        }
+
+        std::atomic<node *> next { nullptr };
+        std::aligned_storage_t<sizeof(ValueType), alignof(ValueType)> storage;
+        std::atomic<bool> deleted { false };
+        id node_id { 0 };
+
+        // One reference is held by the collection, one by the removed and
+        // expiring lists while the node is in them, the rest by handles.
+        std::atomic<unsigned int> refs { 1 };
+
+        // Only accessed by the thread that is running gc().
+        std::atomic<node *> next_retired { nullptr };
+        epoch_domain::epoch_type retire_epoch { 0 };
+        node * next_expiring { nullptr };
+        epoch_domain::epoch_type expire_epoch { 0 };
+        bool destroyed { false };
+    };
+
+    //! Create a node for an element and link it at the head of the list.
+    template <typename ValueType_>
+    auto insert_node(ValueType_ && element) -> node *
+    {
+        auto n = allocate_node(std::forward<ValueType_>(element));
+        n->node_id = ++last_id_;
+        ++size_;
+
+        // The head node is never dereferenced here, so there's no need for a
+        // critical section.
+        auto next = head_.load();
+        do
+            n->next.store(next);
+        while(!head_.compare_exchange_weak(next, n));
+
+        gc();
+        return n;
+    }
+
+    //! Allocate and construct a node.
+    template <typename ValueType_>
+    static auto allocate_node(ValueType_ && element) -> node *
+    {
+        auto a = node_allocator { };
+        auto const n = node_traits::allocate(a, 1);
+        try {
+            node_traits::construct(a, n, std::forward<ValueType_>(element));
+        } catch(...) {
+            node_traits::deallocate(a, n, 1);
+            throw;
+        }
+
+        return n;
+    }
+
+    //! Mark a node as deleted.
+    //!
+    //! \return True if the node was not already marked.
+    auto mark_deleted(node * n) noexcept
+    {
+        if(n->deleted.exchange(true))
+            return false;
+
+        --size_;
+        ++deleted_;
+
+        // The caller keeps the node alive until it has been pushed.
+        n->acquire();
+        auto head = removed_.load();
+        do
+            n->next_expiring = head;
+        while(!removed_.compare_exchange_weak(head, n));
+
+        return true;
+    }
+
+    //! Destroy a node's element, if it has not been destroyed already.
+    //!
+    //! Must only be called by the thread running gc(), or by the destructor.
+    static void destroy_element(node * n) noexcept
+    {
+        if(n->destroyed)
+            return;
+
+        n->destroyed = true;
+        n->element().~ValueType();
+    }
+
+    //! Destroy a node's element and drop the collection's reference to it.
+    static void free_node(node * n) noexcept
+    {
+        destroy_element(n);
+        n->release();
+    }
+
+    //! Return true if gc() has elements or nodes waiting to be freed.
+    auto has_garbage() const noexcept
+    {
+        return removed_.load() || expiring_.load() || retired_.load();
+    }
+
+    //! Destroy removed elements and free unlinked nodes, once no reader can
+    //! still be visiting them, and unlink nodes marked as deleted.
+    //!
+    //! Removed elements are destroyed as soon as the epoch allows it, so
+    //! whatever they own is released promptly. The nodes that held them are
+    //! only unlinked once they make up a sizeable part of the list, so the
+    //! cost of walking the list is amortized over many remove() calls.
+    //!
+    //! If another thread is already running gc(), this method does nothing.
     void gc() noexcept
     {
-        if(block_gc_.load() > 0 || gc_active_.exchange(true))
+        if(gc_active_.exchange(true))
             return;
 
-        auto head = head_.load();
-        for(auto p = &head; *p && block_gc_ == 0;)
+        auto & domain = epoch_domain::instance();
+
+        if(auto removed = removed_.exchange(nullptr))
         {
-            if(!(*p)->deleted.load())
+            // The epoch must be read after the nodes have been marked.
+            auto const epoch = domain.current();
+            while(removed)
             {
-                p = &((*p)->next);
-                continue;
+                auto const n = removed;
+                removed = n->next_expiring;
+
+                n->expire_epoch = epoch;
+                n->next_expiring = nullptr;
+                if(expiring_tail_)
+                    expiring_tail_->next_expiring = n;
+                else
+                    expiring_.store(n);
+                expiring_tail_ = n;
             }
+        }
 
-            auto d = *p;
-            *p = (*p)->next;
-            delete d;
+        auto const deleted = deleted_.load();
+        if(deleted > 0 && deleted * 2 >= size_.load())
+        {
+            auto unlinked = unlink_deleted();
+
+            // The epoch must be read after the nodes have been unlinked.
+            auto const epoch = domain.current();
+            while(unlinked)
+            {
+                auto const n = unlinked;
+                unlinked = n->next_retired.load();
+
+                n->retire_epoch = epoch;
+                n->next_retired.store(nullptr);
+                if(retired_tail_)
+                    retired_tail_->next_retired.store(n);
+                else
+                    retired_.store(n);
+                retired_tail_ = n;
+            }
+        }
 
-            if(p == &head)
-                head_.store(*p);
+        if(retired_.load() || expiring_.load())
+        {
+            domain.try_advance();
+            domain.try_advance();
+        }
+
+        // Expiring nodes are ordered by epoch, oldest first.
+        for(auto n = expiring_.load(); n && domain.is_safe(n->expire_epoch);
+            n = expiring_.load())
+        {
+            expiring_.store(n->next_expiring);
+            if(expiring_tail_ == n)
+                expiring_tail_ = nullptr;
+
+            destroy_element(n);
+            n->release();
+        }
+
+        // Retired nodes are ordered by epoch, oldest first.
+        for(auto n = retired_.load(); n && domain.is_safe(n->retire_epoch);
+            n = retired_.load())
+        {
+            retired_.store(n->next_retired.load());
+            if(retired_tail_ == n)
+                retired_tail_ = nullptr;
+
+            free_node(n);
         }
 
         gc_active_.store(false);
     }
 
-    //! Block the gc() method from running for the duration of an instance's
-    //! lifetime.
-    struct gc_blocker
+    //! Unlink all nodes marked as deleted from the list.
+    //!
+    //! Only the thread running gc() changes links between existing nodes;
+    //! insert() only ever changes the head.
+    //!
+    //! \return The unlinked nodes, chained through their next_retired member.
+    auto unlink_deleted() noexcept -> node *
     {
-        explicit gc_blocker(collection<ValueType> const * c) noexcept :
-            collection_{ c }
-        {
-            ++collection_->block_gc_;
-            while(collection_->gc_active_.load())
-                ;
-        }
+        node * unlinked = nullptr;
 
-        ~gc_blocker() noexcept
+        auto prev = &head_;
+        for(auto n = prev->load(); n;)
         {
-            --collection_->block_gc_;
+            auto const next = n->next.load();
+            if(!n->deleted.load())
+            {
+                prev = &n->next;
+                n = next;
+                continue;
+            }
+
+            if(prev == &head_)
+            {
+                auto expected = n;
+                if(!head_.compare_exchange_strong(expected, next))
+                {
+                    // A new node has been inserted, n is now past the head.
+                    n = head_.load();
+                    continue;
+                }
+            }
+            else
+            {
+                prev->store(next);
+            }
+
+            n->next_retired.store(unlinked);
+            unlinked = n;
+            n = next;
+            --deleted_;
         }
 
-        gc_blocker() =delete;
-        gc_blocker(gc_blocker const &) =delete;
-        auto operator=(gc_blocker const &) -> gc_blocker & =delete;
-        gc_blocker(gc_blocker &&) =default;
-        auto operator=(gc_blocker &&) -> gc_blocker & =default;
+        return unlinked;
+    }
 
-    private:
-        collection<ValueType> const * collection_;
-    };
+    //! Free all nodes in a list.
+    static void free_list(node * n, std::atomic<node *> node::* next) noexcept
+    {
+        while(n)
+        {
+            auto const d = n;
+            n = (n->*next).load();
+            free_node(d);
+        }
+    }
 
-    //! Node data.
-    struct node
+    //! Drop the references held by a removed or expiring list.
+    static void release_list(node * n) noexcept
     {
-        node * next { nullptr };
-        ValueType element;
-        std::atomic<bool> deleted { false };
-        id node_id;
-    };
+        while(n)
+        {
+            auto const d = n;
+            n = n->next_expiring;
+            d->release();
+        }
+    }
 
 private:
     std::atomic<node *> head_ { nullptr };
-    mutable std::atomic<std::size_t> block_gc_ { 0 };
+    std::atomic<node *> retired_ { nullptr };
+    node * retired_tail_ { nullptr };
+    // Removed nodes whose elements are waiting to be destroyed: pushed by
+    // remove(), then queued by gc() with the epoch they were taken at.
+    std::atomic<node *> removed_ { nullptr };
+    std::atomic<node *> expiring_ { nullptr };
+    node * expiring_tail_ { nullptr };
+    std::atomic<std::size_t> size_ { 0 };
+    std::atomic<std::size_t> deleted_ { 0 };
     std::atomic<bool> gc_active_ { false };
     std::atomic<id> last_id_ { 0 };
 };
@@ -0,0 +1,185 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable { namespace detail {
+
+//! Epoch-based memory reclamation.
+//!
+//! Readers announce the global epoch they have observed in a record that is
+//! owned by their thread, so entering and leaving a read-side critical section
+//! never writes to memory shared with other threads and never waits.
+//!
+//! Writers that unlink an object tag it with the current() epoch and can free
+//! it as soon as is_safe() returns true for that epoch. The global epoch only
+//! advances once every thread that is inside a critical section has observed
+//! it, so an object retired at epoch ``e`` cannot be reached by any reader once
+//! the global epoch is ``e + 2``.
+//!
+//! There is a single, process-wide domain. All methods can be safely called
+//! in parallel, from multiple threads.
+//!
+//! \ingroup observable_detail
+class epoch_domain final
+{
+public:
+    //! Epoch counter type.
+    using epoch_type = std::size_t;
+
+    //! Retrieve the process-wide domain.
+    static auto instance() noexcept -> epoch_domain &
+    {
+        // Intentionally leaked, so collections destroyed during static
+        // destruction can still use it.
+        static auto const domain = new epoch_domain { };
+        return *domain;
+    }
+
+    //! Enter a read-side critical section.
+    //!
+    //! Critical sections can be nested.
+    void enter() noexcept
+    {
+        auto & r = local_record();
+        if(r.nesting++ == 0)
+            r.state.store((global_.load() << 1) | 1);
+    }
+
+    //! Leave a read-side critical section.
+    void leave() noexcept
+    {
+        auto & r = local_record();
+        if(--r.nesting == 0)
+            r.state.store(0);
+    }
+
+    //! Return the current global epoch.
+    auto current() const noexcept -> epoch_type { return global_.load(); }
+
+    //! Try to advance the global epoch.
+    //!
+    //! The epoch will only be advanced if all threads currently inside a
+    //! critical section have observed the current epoch.
+    //!
+    //! \return The global epoch after the call.
+    auto try_advance() noexcept -> epoch_type
+    {
+        auto e = global_.load();
+        for(auto r = records_.load(); r; r = r->next)
+        {
+            auto const s = r->state.load();
+            if((s & 1) && (s >> 1) != e)
+                return e;
+        }
+
+        global_.compare_exchange_strong(e, e + 1);
+        return global_.load();
+    }
+
+    //! Return true if objects retired at the provided epoch can be freed.
+    auto is_safe(epoch_type retire_epoch) const noexcept
+    {
+        return global_.load() >= retire_epoch + 2;
+    }
+
+public:
+    //! Domains are not copy-constructible.
+    epoch_domain(epoch_domain const &) =delete;
+
+    //! Domains are not copy-assignable.
+    auto operator=(epoch_domain const &) -> epoch_domain & =delete;
+
+private:
+    epoch_domain() noexcept =default;
+
+    //! Per-thread state.
+    struct record
+    {
+        //! Observed epoch shifted left by one, lowest bit set while active.
+        std::atomic<epoch_type> state { 0 };
+
+        //! Nesting level of the owning thread's critical sections.
+        std::size_t nesting { 0 };
+
+        //! True while the record is owned by a thread.
+        std::atomic<bool> in_use { true };
+
+        //! Next record in the domain's list. Never changes once published.
+        record * next { nullptr };
+
+        // Keep records of different threads on different cache lines.
+        char padding[64];
+    };
+
+    //! Owns a record for the duration of a thread's lifetime.
+    struct record_owner
+    {
+        explicit record_owner(epoch_domain & domain) noexcept :
+            r { domain.acquire_record() }
+        { }
+
+        ~record_owner() noexcept
+        {
+            r->state.store(0);
+            r->in_use.store(false);
+        }
+
+        record_owner(record_owner const &) =delete;
+        auto operator=(record_owner const &) -> record_owner & =delete;
+
+        record * r;
+    };
+
+    //! Return the calling thread's record.
+    auto local_record() noexcept -> record &
+    {
+        static thread_local record_owner owner { *this };
+        return *owner.r;
+    }
+
+    //! Reuse a record released by a finished thread or create a new one.
+    auto acquire_record() noexcept -> record *
+    {
+        for(auto r = records_.load(); r; r = r->next)
+        {
+            auto expected = false;
+            if(r->in_use.compare_exchange_strong(expected, true))
+                return r;
+        }
+
+        auto r = new record { };
+        r->next = records_.load();
+        while(!records_.compare_exchange_weak(r->next, r))
+            ;
+
+        return r;
+    }
+
+private:
+    std::atomic<epoch_type> global_ { 0 };
+    std::atomic<record *> records_ { nullptr };
+};
+
+//! Keep a read-side critical section open for the duration of an instance's
+//! lifetime.
+//!
+//! \ingroup observable_detail
+class epoch_guard final
+{
+public:
+    //! Enter a critical section.
+    epoch_guard() noexcept { epoch_domain::instance().enter(); }
+
+    //! Leave the critical section.
+    ~epoch_guard() noexcept { epoch_domain::instance().leave(); }
+
+    epoch_guard(epoch_guard const &) =delete;
+    auto operator=(epoch_guard const &) -> epoch_guard & =delete;
+};
+
+} }
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
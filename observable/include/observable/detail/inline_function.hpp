@@ -0,0 +1,200 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable { namespace detail {
+
+//! \cond
+template <typename Signature, std::size_t Capacity=4 * sizeof(void *)>
+class inline_function;
+//! \endcond
+
+//! Move-only, type-erased callable that stores small callables in place.
+//!
+//! Callables that are at most ``Capacity`` bytes large and are nothrow
+//! move-constructible are guaranteed to be stored inside the object, without
+//! allocating. Larger callables are stored on the heap.
+//!
+//! Like ``std::function``, calling a const inline_function can call a mutable
+//! callable.
+//!
+//! \tparam R Return type of the callable.
+//! \tparam Args Arguments of the callable.
+//! \tparam Capacity Size, in bytes, of the in-place storage.
+//!
+//! \ingroup observable_detail
+template <typename R, typename ... Args, std::size_t Capacity>
+class inline_function<R(Args ...), Capacity> final
+{
+    using storage_type = std::aligned_storage_t<Capacity, alignof(std::max_align_t)>;
+
+    template <typename F>
+    using fits_inline = std::integral_constant<bool,
+                            sizeof(F) <= sizeof(storage_type) &&
+                            alignof(F) <= alignof(storage_type) &&
+                            std::is_nothrow_move_constructible<F>::value>;
+
+public:
+    //! Create an empty function.
+    inline_function() noexcept =default;
+
+    //! Create a function from a callable.
+    //!
+    //! \param[in] fun Callable that will be stored.
+    template <typename Fun, typename = std::enable_if_t<
+                                        !std::is_same<std::decay_t<Fun>,
+                                                      inline_function>::value>>
+    inline_function(Fun && fun)
+    {
+        emplace<std::decay_t<Fun>>(std::forward<Fun>(fun),
+                                   fits_inline<std::decay_t<Fun>> { });
+    }
+
+    //! Call the stored callable.
+    //!
+    //! \warning Calling an empty function is undefined behavior.
+    auto operator()(Args ... args) const -> R
+    {
+        return ops_->call(const_cast<storage_type *>(&storage_),
+                          std::forward<Args>(args) ...);
+    }
+
+    //! Return true if the function is not empty.
+    explicit operator bool() const noexcept { return !!ops_; }
+
+    //! Return true if a callable of the provided type would be stored without
+    //! allocating.
+    template <typename Fun>
+    static constexpr auto is_stored_inline() noexcept
+    {
+        return fits_inline<std::decay_t<Fun>>::value;
+    }
+
+    //! Destructor.
+    ~inline_function() noexcept { reset(); }
+
+public:
+    //! Functions are not copy-constructible.
+    inline_function(inline_function const &) =delete;
+
+    //! Functions are not copy-assignable.
+    auto operator=(inline_function const &) -> inline_function & =delete;
+
+    //! Functions are move-constructible.
+    inline_function(inline_function && other) noexcept
+    {
+        move_from(other);
+    }
+
+    //! Functions are move-assignable.
+    auto operator=(inline_function && other) noexcept -> inline_function &
+    {
+        if(this != &other)
+        {
+            reset();
+            move_from(other);
+        }
+
+        return *this;
+    }
+
+private:
+    //! Operations for a particular stored callable type.
+    struct operations
+    {
+        R (*call)(void *, Args && ...);
+        void (*move)(void * to, void * from) noexcept;
+        void (*destroy)(void *) noexcept;
+    };
+
+    template <typename F>
+    struct inline_ops
+    {
+        static auto call(void * s, Args && ... args) -> R
+        {
+            return (*static_cast<F *>(s))(std::forward<Args>(args) ...);
+        }
+
+        static void move(void * to, void * from) noexcept
+        {
+            new (to) F(std::move(*static_cast<F *>(from)));
+            static_cast<F *>(from)->~F();
+        }
+
+        static void destroy(void * s) noexcept { static_cast<F *>(s)->~F(); }
+
+        static auto table() noexcept -> operations const *
+        {
+            static constexpr operations const ops { &call, &move, &destroy };
+            return &ops;
+        }
+    };
+
+    template <typename F>
+    struct heap_ops
+    {
+        static auto call(void * s, Args && ... args) -> R
+        {
+            return (**static_cast<F **>(s))(std::forward<Args>(args) ...);
+        }
+
+        static void move(void * to, void * from) noexcept
+        {
+            *static_cast<F **>(to) = *static_cast<F **>(from);
+        }
+
+        static void destroy(void * s) noexcept { delete *static_cast<F **>(s); }
+
+        static auto table() noexcept -> operations const *
+        {
+            static constexpr operations const ops { &call, &move, &destroy };
+            return &ops;
+        }
+    };
+
+    template <typename F, typename Fun>
+    void emplace(Fun && fun, std::true_type)
+    {
+        new (&storage_) F(std::forward<Fun>(fun));
+        ops_ = inline_ops<F>::table();
+    }
+
+    template <typename F, typename Fun>
+    void emplace(Fun && fun, std::false_type)
+    {
+        *reinterpret_cast<F **>(&storage_) = new F(std::forward<Fun>(fun));
+        ops_ = heap_ops<F>::table();
+    }
+
+    void move_from(inline_function & other) noexcept
+    {
+        if(!other.ops_)
+            return;
+
+        other.ops_->move(&storage_, &other.storage_);
+        ops_ = other.ops_;
+        other.ops_ = nullptr;
+    }
+
+    void reset() noexcept
+    {
+        if(!ops_)
+            return;
+
+        ops_->destroy(&storage_);
+        ops_ = nullptr;
+    }
+
+private:
+    storage_type storage_;
+    operations const * ops_ { nullptr };
+};
+
+} }
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
@@ -0,0 +1,126 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <observable/detail/inline_function.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable { namespace detail {
+
+//! Indices claimed by the tasks of a parallel_apply() call.
+//!
+//! The state is shared by all tasks, so tasks that only start after all
+//! indices have been processed can still run safely; they do nothing.
+//!
+//! \ingroup observable_detail
+class parallel_apply_state final
+{
+public:
+    template <typename Fun>
+    parallel_apply_state(std::size_t count, Fun & fun) noexcept :
+        count_ { count },
+        fun_ { &fun },
+        call_ { &call<Fun> }
+    { }
+
+    //! Process indices until there are none left.
+    void run() noexcept
+    {
+        for(auto i = next_.fetch_add(1); i < count_; i = next_.fetch_add(1))
+        {
+            auto error = std::exception_ptr { };
+            try {
+                call_(fun_, i);
+            } catch(...) {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> const lock { mutex_ };
+            if(error && !error_)
+                error_ = std::move(error);
+
+            if(++done_ == count_)
+                all_done_.notify_all();
+        }
+    }
+
+    //! Block until all indices have been processed, then rethrow the first
+    //! exception thrown by the functor, if any.
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock { mutex_ };
+        all_done_.wait(lock, [&]() { return done_ == count_; });
+
+        if(error_)
+            std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+
+private:
+    template <typename Fun>
+    static void call(void * fun, std::size_t index)
+    {
+        (*static_cast<Fun *>(fun))(index);
+    }
+
+    std::size_t const count_;
+    void * const fun_;
+    void (* const call_)(void *, std::size_t);
+    std::atomic<std::size_t> next_ { 0 };
+
+    std::mutex mutex_;
+    std::condition_variable all_done_;
+    std::size_t done_ { 0 };
+    std::exception_ptr error_;
+};
+
+//! Call a functor with every index in ``[0, count)``, in parallel.
+//!
+//! One task is submitted to the executor for each index but the first; the
+//! calling thread processes indices too, until there are none left, and then
+//! waits for the indices that tasks are still processing. The call does not
+//! depend on the executor running tasks quickly, or at all.
+//!
+//! If any call throws, the remaining indices are still processed and the first
+//! exception is rethrown.
+//!
+//! \param[in] executor Callable that accepts an ``inline_function<void()>``
+//!                     and runs it, on any thread.
+//! \param[in] count Number of indices.
+//! \param[in] fun Functor that will be called with each index. Calls with
+//!                different indices can run concurrently.
+//!
+//! \ingroup observable_detail
+template <typename Executor, typename Fun>
+inline void parallel_apply(Executor & executor, std::size_t count, Fun & fun)
+{
+    if(count < 2)
+    {
+        for(auto i = std::size_t { 0 }; i < count; ++i)
+            fun(i);
+        return;
+    }
+
+    auto const state = std::make_shared<parallel_apply_state>(count, fun);
+    try {
+        for(auto i = std::size_t { 1 }; i < count; ++i)
+            executor(inline_function<void()> { [state]() { state->run(); } });
+    } catch(...) {
+        // Tasks that have been submitted must not outlive the functor.
+        state->run();
+        state->wait();
+        throw;
+    }
+
+    state->run();
+    state->wait();
+}
+
+} }
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
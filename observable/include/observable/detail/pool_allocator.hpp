@@ -0,0 +1,184 @@
+#pragma once
+#include <cstddef>
+#include <new>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable { namespace detail {
+
+//! Thread-local cache of freed memory blocks of the same size.
+//!
+//! Each thread keeps its own free list, so allocating and freeing never
+//! synchronize with other threads. A block can be freed by a different thread
+//! than the one that allocated it; it will then be reused by the freeing
+//! thread. Each thread caches at most ``max_cached`` blocks; the rest, and all
+//! cached blocks of a thread that exits, are returned to the global heap.
+//!
+//! \tparam Size Size of the blocks, in bytes.
+//!
+//! \ingroup observable_detail
+template <std::size_t Size>
+class block_pool final
+{
+    struct block
+    {
+        block * next;
+    };
+
+public:
+    //! Maximum number of freed blocks kept by each thread.
+    static constexpr std::size_t max_cached = 256;
+
+    //! Size of the allocated blocks.
+    static constexpr std::size_t block_size = Size < sizeof(block) ?
+                                                  sizeof(block) :
+                                                  Size;
+
+    //! Allocate a block, reusing one freed by this thread if possible.
+    static auto allocate() -> void *
+    {
+        auto & c = local_cache();
+        if(!c.head)
+            return ::operator new(block_size);
+
+        auto const b = c.head;
+        c.head = b->next;
+        --c.count;
+        return b;
+    }
+
+    //! Free a block that has been returned by allocate().
+    static void deallocate(void * p) noexcept
+    {
+        auto & c = local_cache();
+        if(!c.registered)
+            register_drain(c);
+
+        if(c.exited || c.count >= max_cached)
+        {
+            ::operator delete(p);
+            return;
+        }
+
+        c.head = ::new (p) block { c.head };
+        ++c.count;
+    }
+
+    //! Number of blocks cached by the calling thread.
+    static auto cached() noexcept { return local_cache().count; }
+
+private:
+    //! Per-thread free list. Trivially destructible, so it can still be used
+    //! by destructors that run after the thread's drain.
+    struct cache
+    {
+        block * head;
+        std::size_t count;
+        bool registered;
+        bool exited;
+    };
+
+    //! Returns a thread's cached blocks to the heap when the thread exits.
+    struct drain
+    {
+        ~drain()
+        {
+            auto & c = local_cache();
+            while(c.head)
+            {
+                auto const b = c.head;
+                c.head = b->next;
+                ::operator delete(b);
+            }
+
+            c.count = 0;
+            c.exited = true;
+        }
+    };
+
+    static auto local_cache() noexcept -> cache &
+    {
+        static thread_local cache c { nullptr, 0, false, false };
+        return c;
+    }
+
+    static void register_drain(cache & c) noexcept
+    {
+        static thread_local drain d;
+        (void)d;
+        c.registered = true;
+    }
+};
+
+//! \cond
+template <std::size_t Size>
+constexpr std::size_t block_pool<Size>::max_cached;
+
+template <std::size_t Size>
+constexpr std::size_t block_pool<Size>::block_size;
+//! \endcond
+
+//! Stateless allocator that allocates single objects from a \ref block_pool.
+//!
+//! Allocating a node that was recently freed on the same thread does not touch
+//! the global heap. Arrays are allocated with the global ``operator new``.
+//!
+//! All instances are interchangeable; memory allocated through one instance
+//! can be freed through any other, on any thread.
+//!
+//! \ingroup observable_detail
+template <typename T>
+class pool_allocator
+{
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+                  "Over-aligned types are not supported.");
+
+    using pool = block_pool<sizeof(T)>;
+
+public:
+    using value_type = T;
+
+    //! Create an allocator.
+    pool_allocator() noexcept =default;
+
+    //! Create an allocator from an allocator for a different type.
+    template <typename U>
+    pool_allocator(pool_allocator<U> const &) noexcept { }
+
+    //! Allocate memory for ``n`` objects.
+    auto allocate(std::size_t n) -> T *
+    {
+        if(n != 1)
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+
+        return static_cast<T *>(pool::allocate());
+    }
+
+    //! Free memory returned by allocate().
+    void deallocate(T * p, std::size_t n) noexcept
+    {
+        if(n != 1)
+            ::operator delete(p);
+        else
+            pool::deallocate(p);
+    }
+};
+
+//! \cond
+template <typename T, typename U>
+inline auto operator==(pool_allocator<T> const &, pool_allocator<U> const &) noexcept
+{
+    return true;
+}
+
+template <typename T, typename U>
+inline auto operator!=(pool_allocator<T> const &, pool_allocator<U> const &) noexcept
+{
+    return false;
+}
+//! \endcond
+
+} }
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
@@ -0,0 +1,158 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable { namespace detail {
+
+//! Orders the evaluation of work triggered by a change, so that everything
+//! that depends on the change is evaluated exactly once, after all of its
+//! inputs.
+//!
+//! A change is propagated in two phases. While run() calls its functor, change
+//! notifications only mark dependents as dirty and schedule() the work that
+//! needs to be done. Once the functor returns, the scheduled work is executed
+//! in increasing rank order. Work that is scheduled while this happens (for
+//! example, because evaluating an expression changed a value) is added to the
+//! same queue.
+//!
+//! Ranks must be larger for work that depends on the results of other work.
+//! Expressions use the height of their tree.
+//!
+//! Each thread propagates its changes independently.
+//!
+//! \ingroup observable_detail
+class propagation final
+{
+public:
+    //! Function that executes scheduled work. If its second argument is false,
+    //! the target must only drop its scheduled state.
+    using run_function = void (*)(void *, bool);
+
+    //! Call a functor that propagates a change, then execute the work that
+    //! has been scheduled by it.
+    //!
+    //! If a propagation is already running on the calling thread, the functor
+    //! is called and its work is added to the running propagation.
+    //!
+    //! If the functor or scheduled work throws, the remaining scheduled work
+    //! is dropped and the exception is propagated.
+    template <typename Fun>
+    static void run(Fun && fun)
+    {
+        auto & s = local_state();
+        if(s.active)
+        {
+            fun();
+            return;
+        }
+
+        s.active = true;
+        try {
+            fun();
+            drain(s);
+        } catch(...) {
+            discard(s);
+            s.active = false;
+            throw;
+        }
+
+        s.active = false;
+    }
+
+    //! Schedule work to be executed by the running propagation.
+    //!
+    //! \param[in] rank Work with lower ranks is executed first.
+    //! \param[in] target Object that will be passed to the run function.
+    //! \param[in] fun Function that will execute the work.
+    //!
+    //! \return True if the work has been scheduled, false if no propagation is
+    //!         running and the caller must execute the work immediately.
+    //!
+    //! \note The caller is responsible for only scheduling a target once and
+    //!       for calling cancel() if the target is destroyed.
+    static auto schedule(std::size_t rank, void * target, run_function fun)
+        -> bool
+    {
+        auto & s = local_state();
+        if(!s.active)
+            return false;
+
+        s.queue.push_back(entry { rank, s.sequence++, target, fun });
+        std::push_heap(begin(s.queue), end(s.queue), later { });
+        return true;
+    }
+
+    //! Drop work that has been scheduled for a target.
+    static void cancel(void * target) noexcept
+    {
+        auto & s = local_state();
+        for(auto && e : s.queue)
+            if(e.target == target)
+                e.target = nullptr;
+    }
+
+    //! Return true if a propagation is running on the calling thread.
+    static auto is_running() noexcept { return local_state().active; }
+
+private:
+    struct entry
+    {
+        std::size_t rank;
+        std::size_t sequence;
+        void * target;
+        run_function fun;
+    };
+
+    //! Heap comparator; puts the lowest rank, then the oldest entry, first.
+    struct later
+    {
+        auto operator()(entry const & a, entry const & b) const noexcept
+        {
+            return a.rank != b.rank ? a.rank > b.rank : a.sequence > b.sequence;
+        }
+    };
+
+    struct state
+    {
+        bool active { false };
+        std::size_t sequence { 0 };
+        std::vector<entry> queue;
+    };
+
+    static auto local_state() noexcept -> state &
+    {
+        static thread_local state s;
+        return s;
+    }
+
+    static void drain(state & s)
+    {
+        while(!s.queue.empty())
+        {
+            std::pop_heap(begin(s.queue), end(s.queue), later { });
+            auto const e = s.queue.back();
+            s.queue.pop_back();
+
+            if(e.target)
+                e.fun(e.target, true);
+        }
+    }
+
+    static void discard(state & s) noexcept
+    {
+        auto queue = std::move(s.queue);
+        s.queue.clear();
+
+        for(auto && e : queue)
+            if(e.target)
+                e.fun(e.target, false);
+    }
+};
+
+} }
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
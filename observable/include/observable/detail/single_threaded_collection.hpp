@@ -0,0 +1,341 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable { namespace detail {
+
+//! Collection with the same interface as \ref collection, for use by a single
+//! thread.
+//!
+//! Elements are stored in slots, inside chunks that double in size, so the
+//! first few elements only need one small allocation and apply() walks them
+//! linearly. There are no atomic operations and no epochs; removing an element
+//! outside of apply() destroys it immediately.
+//!
+//! Like the other collections, this one is reentrant: elements can be inserted
+//! and removed from inside apply(). Elements removed while apply() is running
+//! are only destroyed, and their slots only reused, once the outermost apply()
+//! call returns.
+//!
+//! \warning None of the methods of this class can be called concurrently.
+//!
+//! \warning The order of elements inside the collection is unspecified.
+//!
+//! \tparam ValueType Type of the elements that will be stored inside the
+//!                   collection. This type must be at least move constructible.
+//! \ingroup observable_detail
+template <typename ValueType>
+class single_threaded_collection final
+{
+    struct slot;
+
+    static constexpr std::size_t first_chunk_size = 4;
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+public:
+    //! Identifier for an element that has been inserted. You can use this id to
+    //! remove a previously inserted element.
+    using id = std::size_t;
+
+    //! Direct reference to an inserted element.
+    //!
+    //! Removing an element through its handle takes logarithmic time, in the
+    //! number of chunks. The handle is only an index, so it can safely outlive
+    //! its element and the collection, but it must not be used after the
+    //! collection has been destroyed.
+    class handle final
+    {
+    public:
+        //! Create an empty handle.
+        handle() noexcept =default;
+
+        //! Return true if the handle is not empty.
+        explicit operator bool() const noexcept { return id_ != 0; }
+
+    private:
+        handle(std::size_t index, id element_id) noexcept :
+            index_ { index },
+            id_ { element_id }
+        { }
+
+        std::size_t index_ { 0 };
+        id id_ { 0 };
+
+        friend class single_threaded_collection<ValueType>;
+    };
+
+    //! Create an empty collection.
+    single_threaded_collection() noexcept =default;
+
+    //! Insert a new element into the collection.
+    //!
+    //! \return An \ref id that can be used to remove the inserted element.
+    //!
+    //! \note An element inserted while apply() is running will not be passed
+    //!       to the functor of that apply() call.
+    //!
+    //! \see collection::insert()
+    template <typename ValueType_>
+    auto insert(ValueType_ && element)
+    {
+        return insert_handle(std::forward<ValueType_>(element)).id_;
+    }
+
+    //! Insert a new element into the collection and return a handle to it.
+    //!
+    //! \see insert()
+    template <typename ValueType_>
+    auto insert_handle(ValueType_ && element)
+    {
+        // Free slots can come before the position of a running apply(), so
+        // they are only reused when no apply() is running.
+        auto const reuse = depth_ == 0 && free_ != npos;
+        if(!reuse && used_ == capacity_)
+            add_chunk();
+
+        auto const index = reuse ? free_ : used_;
+        auto & s = slot_at(index);
+        new (&s.storage) ValueType(std::forward<ValueType_>(element));
+
+        if(reuse)
+            free_ = s.next;
+        else
+            ++used_;
+
+        s.node_id = ++last_id_;
+        s.live = true;
+        ++size_;
+
+        return handle { index, s.node_id };
+    }
+
+    //! Remove a previously inserted element from the collection.
+    //!
+    //! \note This method needs to search for the element. Prefer removing
+    //!       elements through a \ref handle.
+    //!
+    //! \return True if an element of the collection was removed, false if no
+    //!         element has been removed.
+    //!
+    //! \see collection::remove(id const &)
+    auto remove(id const & element_id) noexcept
+    {
+        if(element_id == 0)
+            return false;
+
+        for(auto i = std::size_t { 0 }; i < used_; ++i)
+        {
+            auto const & s = slot_at(i);
+            if(s.node_id == element_id)
+                return s.live && remove_slot(i);
+        }
+
+        return false;
+    }
+
+    //! Remove an element from the collection through its handle.
+    //!
+    //! If the element has already been removed, this method does nothing.
+    //!
+    //! \return True if an element of the collection was removed, false if no
+    //!         element has been removed.
+    auto remove(handle const & element_handle) noexcept
+    {
+        if(!element_handle || element_handle.index_ >= used_)
+            return false;
+
+        auto const & s = slot_at(element_handle.index_);
+        return s.node_id == element_handle.id_ && s.live &&
+               remove_slot(element_handle.index_);
+    }
+
+    //! Apply a unary functor over all elements of the collection.
+    //!
+    //! \note This method is reentrant; you can call insert() and remove() on the
+    //!       collection from inside the functor, including removing the element
+    //!       that is passed to the functor.
+    //!
+    //! \see collection::apply()
+    template <typename UnaryFunctor>
+    void apply(UnaryFunctor && fun) const
+        noexcept(noexcept(fun(std::declval<ValueType>())))
+    {
+        // The collection is logically const; destroying already removed
+        // elements does not change its contents.
+        apply_scope const scope { const_cast<single_threaded_collection &>(*this) };
+
+        // Elements inserted by the functor are stored after this point.
+        auto const count = used_;
+
+        auto first = std::size_t { 0 };
+        for(auto c = std::size_t { 0 }; first < count; ++c)
+        {
+            auto const chunk = chunks_[c].get();
+            auto const n = std::min(chunk_size(c), count - first);
+
+            for(auto i = std::size_t { 0 }; i < n; ++i)
+                if(chunk[i].live)
+                    fun(chunk[i].element());
+
+            first += chunk_size(c);
+        }
+    }
+
+    //! Return true if the collection has no elements.
+    auto empty() const noexcept { return size_ == 0; }
+
+    //! Return the number of elements in the collection.
+    auto size() const noexcept { return size_; }
+
+    //! Destructor.
+    ~single_threaded_collection() noexcept
+    {
+        for(auto i = std::size_t { 0 }; i < used_; ++i)
+        {
+            auto & s = slot_at(i);
+            if(s.node_id != 0)
+                s.element().~ValueType();
+        }
+    }
+
+public:
+    //! Collections are not copy-constructible.
+    single_threaded_collection(single_threaded_collection const &) =delete;
+
+    //! Collections are not copy-assignable.
+    auto operator=(single_threaded_collection const &)
+        -> single_threaded_collection & =delete;
+
+    //! Collections are not move-constructible.
+    single_threaded_collection(single_threaded_collection &&) =delete;
+
+    //! Collections are not move-assignable.
+    auto operator=(single_threaded_collection &&)
+        -> single_threaded_collection & =delete;
+
+private:
+    //! Element storage.
+    //!
+    //! A slot is free if its id is zero. A slot with an id that is not live
+    //! holds an element that has been removed during apply() and has not been
+    //! destroyed yet.
+    struct slot
+    {
+        auto element() noexcept -> ValueType &
+        {
+            return *reinterpret_cast<ValueType *>(&storage);
+        }
+
+        std::aligned_storage_t<sizeof(ValueType), alignof(ValueType)> storage;
+        id node_id { 0 };
+        bool live { false };
+
+        // Next slot in the free list, or in the list of removed slots.
+        std::size_t next { npos };
+    };
+
+    //! Tracks running apply() calls and destroys the elements removed during
+    //! them, once the outermost call returns.
+    class apply_scope final
+    {
+    public:
+        explicit apply_scope(single_threaded_collection & c) noexcept : c_ { c }
+        {
+            ++c_.depth_;
+        }
+
+        ~apply_scope() noexcept
+        {
+            if(--c_.depth_ == 0 && c_.removed_ != npos)
+                c_.destroy_removed();
+        }
+
+        apply_scope(apply_scope const &) =delete;
+        auto operator=(apply_scope const &) -> apply_scope & =delete;
+
+    private:
+        single_threaded_collection & c_;
+    };
+
+    static constexpr auto chunk_size(std::size_t chunk) noexcept
+    {
+        return first_chunk_size << chunk;
+    }
+
+    auto slot_at(std::size_t index) const noexcept -> slot &
+    {
+        auto c = std::size_t { 0 };
+        while(index >= chunk_size(c))
+            index -= chunk_size(c++);
+
+        return chunks_[c][index];
+    }
+
+    void add_chunk()
+    {
+        auto const n = chunk_size(chunks_.size());
+        chunks_.reserve(chunks_.size() + 1);
+        chunks_.emplace_back(new slot[n]);
+        capacity_ += n;
+    }
+
+    auto remove_slot(std::size_t index) noexcept
+    {
+        slot_at(index).live = false;
+        --size_;
+
+        if(depth_ > 0)
+        {
+            slot_at(index).next = removed_;
+            removed_ = index;
+        }
+        else
+        {
+            free_slot(index);
+        }
+
+        return true;
+    }
+
+    void free_slot(std::size_t index) noexcept
+    {
+        auto & s = slot_at(index);
+        s.element().~ValueType();
+        s.node_id = 0;
+        s.next = free_;
+        free_ = index;
+    }
+
+    void destroy_removed() noexcept
+    {
+        // Elements can remove other elements when they are destroyed.
+        while(removed_ != npos)
+        {
+            auto const index = removed_;
+            removed_ = slot_at(index).next;
+            free_slot(index);
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<slot[]>> chunks_;
+    std::size_t free_ { npos };
+    std::size_t removed_ { npos };
+    std::size_t used_ { 0 };
+    std::size_t capacity_ { 0 };
+    std::size_t size_ { 0 };
+    id last_id_ { 0 };
+    std::size_t depth_ { 0 };
+};
+
+} }
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
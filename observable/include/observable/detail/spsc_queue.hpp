@@ -0,0 +1,151 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable { namespace detail {
+
+//! Bounded, lock-free queue with a single producer and a single consumer.
+//!
+//! Elements are stored in a ring buffer of fixed capacity. Both try_push() and
+//! try_pop() are wait-free: they never block and always return after a bounded
+//! number of steps.
+//!
+//! Each side keeps a cached copy of the other side's index, so the shared
+//! indices are only read when the cached one says the queue looks full (for
+//! the producer) or empty (for the consumer).
+//!
+//! \warning try_push() must only be called from one thread at a time and
+//!          try_pop() must only be called from one thread at a time.
+//!
+//! \ingroup observable_detail
+template <typename T>
+class spsc_queue final
+{
+public:
+    //! Create an empty queue.
+    //!
+    //! \param[in] capacity Minimum number of elements the queue can hold. This
+    //!                     is rounded up to a power of two.
+    explicit spsc_queue(std::size_t capacity) :
+        mask_ { round_up(capacity) - 1 },
+        slots_ { new slot[mask_ + 1] }
+    { }
+
+    //! Maximum number of elements the queue can hold.
+    auto capacity() const noexcept { return mask_ + 1; }
+
+    //! Add an element to the back of the queue.
+    //!
+    //! \return False if the queue was full; the element is not added.
+    template <typename U>
+    auto try_push(U && element) -> bool
+    {
+        auto const tail = tail_.load(std::memory_order_relaxed);
+        if(tail - head_cache_ > mask_)
+        {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if(tail - head_cache_ > mask_)
+                return false;
+        }
+
+        new (&slots_[tail & mask_]) T(std::forward<U>(element));
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    //! Remove the element at the front of the queue and pass it to a functor.
+    //!
+    //! \param[in] fun Functor that will be called with an rvalue reference to
+    //!                the element. The element is destroyed after the call,
+    //!                even if it throws.
+    //! \return False if the queue was empty.
+    template <typename Fun>
+    auto try_pop(Fun && fun) -> bool
+    {
+        auto const head = head_.load(std::memory_order_relaxed);
+        if(head == tail_cache_)
+        {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if(head == tail_cache_)
+                return false;
+        }
+
+        struct release
+        {
+            ~release()
+            {
+                element->~T();
+                queue->head_.store(index + 1, std::memory_order_release);
+            }
+
+            spsc_queue * queue;
+            T * element;
+            std::size_t index;
+        } const r { this, at(head), head };
+
+        fun(std::move(*r.element));
+        return true;
+    }
+
+    //! Destructor. Destroys all the remaining elements.
+    ~spsc_queue()
+    {
+        while(try_pop([](auto &&) { }))
+            ;
+    }
+
+public:
+    //! Queues are not copy-constructible.
+    spsc_queue(spsc_queue const &) =delete;
+
+    //! Queues are not copy-assignable.
+    auto operator=(spsc_queue const &) -> spsc_queue & =delete;
+
+private:
+    using slot = std::aligned_storage_t<sizeof(T), alignof(T)>;
+
+    // Keeps the producer and consumer indices on separate cache lines.
+    static constexpr auto cache_line = std::size_t { 64 };
+
+    static auto round_up(std::size_t n) noexcept
+    {
+        auto p = std::size_t { 1 };
+        while(p < n)
+            p <<= 1;
+        return p;
+    }
+
+    auto at(std::size_t index) noexcept
+    {
+        return reinterpret_cast<T *>(&slots_[index & mask_]);
+    }
+
+private:
+    std::size_t const mask_;
+    std::unique_ptr<slot[]> const slots_;
+
+    char pad0_[cache_line];
+
+    // Written by the producer.
+    std::atomic<std::size_t> tail_ { 0 };
+    std::size_t head_cache_ { 0 };
+
+    char pad1_[cache_line];
+
+    // Written by the consumer.
+    std::atomic<std::size_t> head_ { 0 };
+    std::size_t tail_cache_ { 0 };
+
+    char pad2_[cache_line];
+};
+
+} }
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
@@ -0,0 +1,239 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable { namespace detail {
+
+//! Fixed set of worker threads that run parallel loops.
+//!
+//! The indices of a loop are split into one contiguous range per thread,
+//! including the calling thread. A thread that runs out of work steals the
+//! upper half of another thread's remaining range, so uneven work is balanced
+//! without a shared queue.
+//!
+//! Only one loop runs at a time; concurrent parallel_for() calls are executed
+//! one after the other.
+//!
+//! \ingroup observable_detail
+class thread_pool final
+{
+public:
+    //! Start a pool.
+    //!
+    //! \param[in] workers Number of threads to start, in addition to the
+    //!                    thread that calls parallel_for(). If this is zero,
+    //!                    loops are executed on the calling thread.
+    explicit thread_pool(std::size_t workers) :
+        ranges_ { new range[workers + 1] },
+        slots_ { workers + 1 }
+    {
+        threads_.reserve(workers);
+        for(auto i = 1u; i <= workers; ++i)
+            threads_.emplace_back([this, i]() { worker(i); });
+    }
+
+    //! Number of threads that execute loops, including the calling thread.
+    auto concurrency() const noexcept { return slots_; }
+
+    //! Call a functor with every index in ``[0, count)``, in parallel.
+    //!
+    //! Blocks until all calls have returned. If any call throws, the remaining
+    //! indices are still processed and the first exception is rethrown.
+    //!
+    //! \param[in] count Number of indices.
+    //! \param[in] fun Functor that will be called with each index. Calls with
+    //!                different indices can run concurrently.
+    template <typename Fun>
+    void parallel_for(std::size_t count, Fun && fun)
+    {
+        std::lock_guard<std::mutex> const loop_lock { loop_mutex_ };
+
+        if(threads_.empty() || count < 2)
+        {
+            for(auto i = std::size_t { 0 }; i < count; ++i)
+                fun(i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> const lock { mutex_ };
+
+            target_ = const_cast<void *>(static_cast<void const *>(&fun));
+            call_ = &call<std::remove_reference_t<Fun>>;
+            error_ = nullptr;
+            pending_.store(count);
+
+            for(auto i = std::size_t { 0 }; i < slots_; ++i)
+            {
+                std::lock_guard<std::mutex> const range_lock { ranges_[i].mutex };
+                ranges_[i].begin = count * i / slots_;
+                ranges_[i].end = count * (i + 1) / slots_;
+            }
+
+            ++generation_;
+        }
+
+        wake_.notify_all();
+        work(0);
+
+        std::unique_lock<std::mutex> lock { mutex_ };
+        done_.wait(lock, [&]() { return pending_.load() == 0 && active_ == 0; });
+
+        target_ = nullptr;
+        if(error_)
+            std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+
+    //! Destructor. Stops all worker threads.
+    ~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> const lock { mutex_ };
+            stop_ = true;
+        }
+
+        wake_.notify_all();
+        for(auto && t : threads_)
+            t.join();
+    }
+
+public:
+    //! Thread pools are not copy-constructible.
+    thread_pool(thread_pool const &) =delete;
+
+    //! Thread pools are not copy-assignable.
+    auto operator=(thread_pool const &) -> thread_pool & =delete;
+
+private:
+    //! Remaining indices of one thread.
+    struct range
+    {
+        std::mutex mutex;
+        std::size_t begin { 0 };
+        std::size_t end { 0 };
+    };
+
+    template <typename Fun>
+    static void call(void * fun, std::size_t index)
+    {
+        (*static_cast<Fun *>(fun))(index);
+    }
+
+    void worker(std::size_t slot)
+    {
+        auto seen = std::size_t { 0 };
+        std::unique_lock<std::mutex> lock { mutex_ };
+
+        for(;;)
+        {
+            wake_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+            if(stop_)
+                return;
+
+            seen = generation_;
+            ++active_;
+            lock.unlock();
+
+            work(slot);
+
+            lock.lock();
+            if(--active_ == 0 && pending_.load() == 0)
+                done_.notify_all();
+        }
+    }
+
+    //! Process indices until no range has any left.
+    void work(std::size_t slot)
+    {
+        auto index = std::size_t { 0 };
+        while(pop(slot, index) || steal(slot, index))
+        {
+            try {
+                call_(target_, index);
+            } catch(...) {
+                std::lock_guard<std::mutex> const lock { mutex_ };
+                if(!error_)
+                    error_ = std::current_exception();
+            }
+
+            if(--pending_ == 0)
+            {
+                std::lock_guard<std::mutex> const lock { mutex_ };
+                done_.notify_all();
+            }
+        }
+    }
+
+    auto pop(std::size_t slot, std::size_t & index) -> bool
+    {
+        auto & r = ranges_[slot];
+        std::lock_guard<std::mutex> const lock { r.mutex };
+        if(r.begin == r.end)
+            return false;
+
+        index = r.begin++;
+        return true;
+    }
+
+    //! Take the upper half of another thread's remaining indices.
+    auto steal(std::size_t slot, std::size_t & index) -> bool
+    {
+        for(auto i = 1u; i < slots_; ++i)
+        {
+            auto & victim = ranges_[(slot + i) % slots_];
+            std::size_t begin, end;
+            {
+                std::lock_guard<std::mutex> const lock { victim.mutex };
+                if(victim.begin == victim.end)
+                    continue;
+
+                end = victim.end;
+                begin = victim.begin + (end - victim.begin) / 2;
+                victim.end = begin;
+            }
+
+            auto & own = ranges_[slot];
+            std::lock_guard<std::mutex> const lock { own.mutex };
+            own.begin = begin + 1;
+            own.end = end;
+            index = begin;
+            return true;
+        }
+
+        return false;
+    }
+
+private:
+    std::unique_ptr<range[]> ranges_;
+    std::size_t const slots_;
+    std::vector<std::thread> threads_;
+
+    // Serializes parallel_for() calls.
+    std::mutex loop_mutex_;
+
+    // Protects everything below, except pending_.
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::size_t generation_ { 0 };
+    std::size_t active_ { 0 };
+    bool stop_ { false };
+    void * target_ { nullptr };
+    void (*call_)(void *, std::size_t) { nullptr };
+    std::exception_ptr error_;
+    std::atomic<std::size_t> pending_ { 0 };
+};
+
+} }
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
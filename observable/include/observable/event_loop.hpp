@@ -0,0 +1,301 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <observable/async_subject.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable {
+
+//! Runs work on an event loop, in passes, posting at most one task to the
+//! loop at a time.
+//!
+//! The dispatcher only needs a way to post a function to the loop: any
+//! callable that accepts an \ref async_task and arranges for it to be called
+//! on the loop's thread. See qt_post() in ``observable/qt.hpp`` for Qt.
+//!
+//! Work is requested from any thread, and done by the next pass, on the loop's
+//! thread. A pass:
+//!
+//!  1. runs the tasks submitted with post(), in order;
+//!  2. calls update_all() on the updaters added with add();
+//!  3. calls each function returned by coalesce() that has been triggered
+//!     since the previous pass, once.
+//!
+//! Many changes made between two loop iterations are handled by a single
+//! pass, so, for example, hundreds of property changes between frames cause a
+//! single repaint:
+//!
+//!     auto loop = loop_dispatcher { qt_post(&window) };
+//!     loop.add(ud);
+//!
+//!     auto const repaint = loop.coalesce([&]() { window.update(); });
+//!     auto const s1 = position.subscribe(repaint);
+//!     auto const s2 = radius.subscribe(repaint);
+//!
+//!     // From a network thread.
+//!     loop.post([&, p]() { position = p; });
+//!
+//! Passes can also be run directly with run(), for example from a game loop
+//! that polls instead of posting.
+//!
+//! All methods can be safely called in parallel, from multiple threads, except
+//! add() and run(), which must be called from the loop's thread.
+//!
+//! \warning Posted tasks hold a weak reference to the dispatcher; they do
+//!          nothing if it has been destroyed.
+//!
+//! \ingroup observable
+class loop_dispatcher final
+{
+    struct coalesced_call
+    {
+        std::atomic<bool> pending { false };
+        std::function<void()> fun;
+    };
+
+    struct state
+    {
+        //! Make sure that a pass is posted to the loop.
+        void schedule(std::shared_ptr<state> const & self)
+        {
+            if(scheduled.exchange(true, std::memory_order_acq_rel))
+                return;
+
+            auto const weak = std::weak_ptr<state> { self };
+            try {
+                post(async_task { [weak]() {
+                    if(auto const s = weak.lock())
+                        s->run(s);
+                } });
+            } catch(...) {
+                scheduled.store(false, std::memory_order_release);
+                throw;
+            }
+        }
+
+        void run(std::shared_ptr<state> const & self)
+        {
+            // Cleared first, so work requested during the pass schedules
+            // another one.
+            scheduled.store(false, std::memory_order_release);
+            ++passes;
+
+            run_tasks(self);
+
+            for(auto && update_all : updaters)
+                update_all();
+
+            run_calls(self);
+        }
+
+        void run_tasks(std::shared_ptr<state> const & self)
+        {
+            {
+                std::lock_guard<std::mutex> const lock { mutex };
+                running.swap(tasks);
+            }
+
+            auto i = std::size_t { 0 };
+            try {
+                for(; i < running.size(); ++i)
+                    running[i]();
+            } catch(...) {
+                // Tasks that did not run are kept, in order, for the next pass.
+                {
+                    std::lock_guard<std::mutex> const lock { mutex };
+                    tasks.insert(tasks.begin(),
+                                 std::make_move_iterator(running.begin() + i + 1),
+                                 std::make_move_iterator(running.end()));
+                }
+
+                running.clear();
+                schedule(self);
+                throw;
+            }
+
+            running.clear();
+        }
+
+        void run_calls(std::shared_ptr<state> const & self)
+        {
+            {
+                std::lock_guard<std::mutex> const lock { mutex };
+                auto out = std::size_t { 0 };
+                for(auto && c : calls)
+                {
+                    auto p = c.lock();
+                    if(!p)
+                        continue;
+
+                    calls[out++] = c;
+                    if(p->pending.load(std::memory_order_relaxed))
+                        triggered.push_back(std::move(p));
+                }
+
+                calls.resize(out);
+            }
+
+            struct clear
+            {
+                ~clear() { v.clear(); }
+                std::vector<std::shared_ptr<coalesced_call>> & v;
+            } const c { triggered };
+
+            for(auto i = std::size_t { 0 }; i < triggered.size(); ++i)
+            {
+                if(!triggered[i]->pending.exchange(false, std::memory_order_acq_rel))
+                    continue;
+
+                try {
+                    triggered[i]->fun();
+                } catch(...) {
+                    // Calls that are still pending will be made by the next
+                    // pass.
+                    if(i + 1 < triggered.size())
+                        schedule(self);
+                    throw;
+                }
+            }
+        }
+
+        std::function<void(async_task)> post;
+        std::atomic<bool> scheduled { false };
+        std::size_t passes { 0 };
+
+        std::mutex mutex;
+        std::vector<async_task> tasks;
+        std::vector<std::weak_ptr<coalesced_call>> calls;
+
+        // Only used on the loop's thread.
+        std::vector<async_task> running;
+        std::vector<std::shared_ptr<coalesced_call>> triggered;
+        std::vector<std::function<void()>> updaters;
+    };
+
+public:
+    //! Create a dispatcher.
+    //!
+    //! \param[in] post Callable that accepts an \ref async_task and calls it
+    //!                 later, on the loop's thread. It can be called from any
+    //!                 thread.
+    template <typename Post,
+              typename = std::enable_if_t<
+                    !std::is_same<std::decay_t<Post>, loop_dispatcher>::value>>
+    explicit loop_dispatcher(Post && post)
+    {
+        state_->post = std::forward<Post>(post);
+    }
+
+    //! Run a task during the next pass.
+    //!
+    //! \param[in] task Callable that takes no arguments. Tasks run in the order
+    //!                 in which they were posted.
+    template <typename Callable>
+    void post(Callable && task)
+    {
+        {
+            std::lock_guard<std::mutex> const lock { state_->mutex };
+            state_->tasks.emplace_back(std::forward<Callable>(task));
+        }
+
+        state_->schedule(state_);
+    }
+
+    //! Call ``ud.update_all()`` during each pass.
+    //!
+    //! \param[in] ud An updater. It must outlive the dispatcher.
+    template <typename UpdaterType>
+    void add(UpdaterType & ud)
+    {
+        state_->updaters.emplace_back([&ud]() { ud.update_all(); });
+    }
+
+    //! Wrap a function, so it is called at most once per pass.
+    //!
+    //! Calling the returned object, with any arguments, triggers the function:
+    //! it will be called, without arguments, by the next pass. The returned
+    //! object can be used as an observer, for any subject or value.
+    //!
+    //! \param[in] fun Callable that takes no arguments. It is destroyed once
+    //!                all copies of the returned object have been destroyed.
+    //! \return A copyable callable that can be called from any thread.
+    template <typename Callable>
+    auto coalesce(Callable && fun)
+    {
+        auto const call = std::make_shared<coalesced_call>();
+        call->fun = std::forward<Callable>(fun);
+        {
+            std::lock_guard<std::mutex> const lock { state_->mutex };
+            state_->calls.emplace_back(call);
+        }
+
+        return [call, weak = std::weak_ptr<state> { state_ }](auto && ...) {
+            if(call->pending.exchange(true, std::memory_order_acq_rel))
+                return;
+
+            if(auto const s = weak.lock())
+                s->schedule(s);
+        };
+    }
+
+    //! Request a pass, even if no work has been submitted.
+    void schedule() { state_->schedule(state_); }
+
+    //! Run a pass now, on the calling thread.
+    //!
+    //! If a task, an updater or a coalesced function throws, the exception is
+    //! propagated; tasks and functions that did not run are kept for the next
+    //! pass.
+    void run() { state_->run(state_); }
+
+    //! Executor that runs tasks during passes, for example to deliver the
+    //! notifications of an \ref async_subject on the loop's thread.
+    auto executor() const
+    {
+        return [weak = std::weak_ptr<state> { state_ }](async_task task) {
+            auto const s = weak.lock();
+            if(!s)
+                return;
+
+            {
+                std::lock_guard<std::mutex> const lock { s->mutex };
+                s->tasks.push_back(std::move(task));
+            }
+
+            s->schedule(s);
+        };
+    }
+
+    //! Number of passes that have been run.
+    //!
+    //! \warning This must only be called from the loop's thread.
+    auto passes() const noexcept { return state_->passes; }
+
+public:
+    //! Dispatchers are not copy-constructible.
+    loop_dispatcher(loop_dispatcher const &) =delete;
+
+    //! Dispatchers are not copy-assignable.
+    auto operator=(loop_dispatcher const &) -> loop_dispatcher & =delete;
+
+    //! Dispatchers are move-constructible.
+    loop_dispatcher(loop_dispatcher &&) =default;
+
+    //! Dispatchers are move-assignable.
+    auto operator=(loop_dispatcher &&) -> loop_dispatcher & =default;
+
+private:
+    std::shared_ptr<state> state_ { std::make_shared<state>() };
+};
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
@@ -0,0 +1,220 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <set>
+#include <utility>
+#include <observable/subscription.hpp>
+#include <observable/value.hpp>
+#include <observable/vector.hpp>
+#include <observable/expressions/tree.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable { inline namespace expr {
+
+//! \cond
+namespace aggregate_detail {
+
+    template <typename ValueType>
+    struct sum_
+    {
+        using result_type = ValueType;
+
+        void insert(ValueType const & v) { total += v; }
+        void erase(ValueType const & v) { total -= v; }
+        void clear() { total = ValueType { }; }
+        auto get() const { return total; }
+
+        ValueType total { };
+    };
+
+    template <typename ValueType, typename Predicate>
+    struct count_if_
+    {
+        using result_type = std::size_t;
+
+        void insert(ValueType const & v) { if(pred(v)) ++count; }
+        void erase(ValueType const & v) { if(pred(v)) --count; }
+        void clear() { count = 0; }
+        auto get() const { return count; }
+
+        Predicate pred;
+        std::size_t count { 0 };
+    };
+
+    template <typename ValueType>
+    struct mean_
+    {
+        using result_type = double;
+
+        void insert(ValueType const & v) { sum.insert(v); ++count; }
+        void erase(ValueType const & v) { sum.erase(v); --count; }
+        void clear() { sum.clear(); count = 0; }
+
+        auto get() const
+        {
+            return count ? static_cast<double>(sum.get()) / static_cast<double>(count)
+                         : 0.0;
+        }
+
+        sum_<ValueType> sum;
+        std::size_t count { 0 };
+    };
+
+    template <typename ValueType, typename Compare>
+    struct extreme_
+    {
+        using result_type = ValueType;
+
+        void insert(ValueType const & v) { items.insert(v); }
+        void erase(ValueType const & v) { items.erase(items.find(v)); }
+        void clear() { items.clear(); }
+        auto get() const { return items.empty() ? ValueType { } : *items.begin(); }
+
+        std::multiset<ValueType, Compare> items;
+    };
+
+    //! Keeps an aggregate of a vector up to date, by applying each change to
+    //! the aggregate's state.
+    //!
+    //! The state must provide insert(), erase() and clear() methods, that
+    //! update it for one element, and a get() method that returns the current
+    //! result.
+    template <typename ValueType, typename State>
+    struct aggregator
+    {
+        using result_type = typename State::result_type;
+
+        aggregator(vector<ValueType> const & v, State s) : state(std::move(s))
+        {
+            for(auto && item : v)
+                state.insert(item);
+
+            result.set(state.get());
+            sub = v.subscribe([this](auto const & c) { apply(c); });
+        }
+
+        void apply(vector_change<ValueType> const & change)
+        {
+            if(change.type == vector_change<ValueType>::kind::reset)
+                state.clear();
+            else
+                for(auto i = std::size_t { 0 }; i < change.removed_count; ++i)
+                    state.erase(change.removed[i]);
+
+            for(auto i = std::size_t { 0 }; i < change.count; ++i)
+                state.insert(change.values[i]);
+
+            result.set(state.get());
+        }
+
+        State state;
+        value<result_type> result;
+        unique_subscription sub;
+    };
+
+    template <typename ValueType, typename State>
+    inline auto make_aggregate(char const * name,
+                               vector<ValueType> const & v,
+                               State state)
+    {
+        using aggregator_type = aggregator<ValueType, State>;
+        using result_type = typename aggregator_type::result_type;
+
+        auto const a = std::make_shared<aggregator_type>(v, std::move(state));
+        auto node = expression_node<result_type> {
+                        [a](result_type const & r) { return r; },
+                        expression_node<result_type> { a->result } };
+        node.name(name);
+        return node;
+    }
+}
+//! \endcond
+
+//! Sum of all elements of an observable vector.
+//!
+//! The sum is updated from each change made to the vector: changing one
+//! element costs one subtraction and one addition, no matter how many elements
+//! the vector has.
+//!
+//! \note For floating-point elements, rounding errors can add up over many
+//!       changes. Assigning the whole vector resets the sum.
+//!
+//! \param v Vector to sum. The vector can be moved or destroyed; the node
+//!          will keep its last value.
+//! \return Expression node that contains the sum of the vector's elements.
+//!
+//! \ingroup observable_expressions
+template <typename ValueType>
+inline auto sum(vector<ValueType> const & v)
+{
+    return aggregate_detail::make_aggregate("sum", v,
+                                            aggregate_detail::sum_<ValueType> { });
+}
+
+//! Number of elements of an observable vector that satisfy a predicate.
+//!
+//! The predicate is only called for the elements that change.
+//!
+//! \param v Vector whose elements are counted.
+//! \param pred Predicate compatible with ``bool (ValueType const &)``.
+//! \return Expression node that contains the element count.
+//!
+//! \ingroup observable_expressions
+template <typename ValueType, typename Predicate>
+inline auto count_if(vector<ValueType> const & v, Predicate pred)
+{
+    using state = aggregate_detail::count_if_<ValueType, Predicate>;
+    return aggregate_detail::make_aggregate("count_if", v, state { std::move(pred) });
+}
+
+//! Mean of all elements of an observable vector.
+//!
+//! The mean is computed from a running sum, so it is updated in constant time.
+//! The mean of an empty vector is zero.
+//!
+//! \param v Vector whose elements are averaged.
+//! \return Expression node that contains the mean, as a double.
+//!
+//! \ingroup observable_expressions
+template <typename ValueType>
+inline auto mean(vector<ValueType> const & v)
+{
+    return aggregate_detail::make_aggregate("mean", v,
+                                            aggregate_detail::mean_<ValueType> { });
+}
+
+//! Smallest element of an observable vector.
+//!
+//! The elements are kept in an ordered multiset, so each change costs a
+//! logarithmic time, including erasing the current minimum. The minimum of an
+//! empty vector is a value-initialized ``ValueType``.
+//!
+//! \param v Vector whose minimum is computed.
+//! \return Expression node that contains the minimum element.
+//!
+//! \ingroup observable_expressions
+template <typename ValueType>
+inline auto min(vector<ValueType> const & v)
+{
+    using state = aggregate_detail::extreme_<ValueType, std::less<ValueType>>;
+    return aggregate_detail::make_aggregate("min", v, state { });
+}
+
+//! Largest element of an observable vector.
+//!
+//! \see min(vector<ValueType> const &)
+//!
+//! \ingroup observable_expressions
+template <typename ValueType>
+inline auto max(vector<ValueType> const & v)
+{
+    using state = aggregate_detail::extreme_<ValueType, std::greater<ValueType>>;
+    return aggregate_detail::make_aggregate("max", v, state { });
+}
+
+} }
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
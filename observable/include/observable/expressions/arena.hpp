@@ -0,0 +1,354 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <observable/subject.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable { inline namespace expr {
+
+//! Memory region that expression trees can be built into.
+//!
+//! An arena hands out memory from large blocks, by bumping a pointer. Nodes
+//! that are created while the arena is in \ref scope store their data inside
+//! the arena, instead of allocating it separately, so a whole expression tree
+//! ends up in a few contiguous blocks. Memory is never reused; it is all freed
+//! at once, when the arena is destroyed.
+//!
+//! Example:
+//!
+//!     expression_arena arena;
+//!     auto result = observe(arena, [&]() { return (a + b) * c; });
+//!
+//! Subjects and values that use \ref arena_subject_policy, and that are
+//! created while the arena is in scope, also live inside it. Observers
+//! subscribed to those subjects while the arena is in scope do too. Updaters
+//! live inside an arena when it is passed to their constructor. A whole
+//! subgraph can then be released at once:
+//!
+//!     expression_arena arena;
+//!     expression_arena::scope const s { arena };
+//!
+//!     auto ud = updater { arena };
+//!     auto price = value<double, arena_subject_policy> { };
+//!     auto sub = price.subscribe([](double p) { ... });
+//!
+//! \warning The arena must outlive all expressions that have been built into
+//!          it, including the values returned by observe(), and all subjects,
+//!          values, updaters and subscriptions that use its memory.
+//!
+//! \warning Arenas are not thread-safe. Building expressions into the same
+//!          arena from multiple threads at the same time is undefined
+//!          behavior.
+//!
+//! \ingroup observable_expressions
+class expression_arena final
+{
+public:
+    //! Makes an arena current for the calling thread, for the lifetime of the
+    //! scope object.
+    //!
+    //! Expression nodes created while an arena is current allocate from it.
+    //! Scopes can be nested; the innermost one wins.
+    class scope final
+    {
+    public:
+        //! Make the provided arena current.
+        explicit scope(expression_arena & arena) noexcept :
+            previous_ { current() }
+        {
+            current() = &arena;
+        }
+
+        //! Restore the previously current arena.
+        ~scope() noexcept { current() = previous_; }
+
+        //! Scopes are not copy-constructible.
+        scope(scope const &) =delete;
+
+        //! Scopes are not copy-assignable.
+        auto operator=(scope const &) -> scope & =delete;
+
+    private:
+        expression_arena * previous_;
+    };
+
+    //! Create an empty arena.
+    //!
+    //! \param[in] block_size Size, in bytes, of the blocks that the arena will
+    //!                       allocate. Allocations that do not fit inside a
+    //!                       block get a block of their own.
+    explicit expression_arena(std::size_t block_size=4096) noexcept :
+        block_size_ { block_size }
+    { }
+
+    //! Allocate uninitialized memory from the arena.
+    //!
+    //! \param[in] size Number of bytes to allocate.
+    //! \param[in] alignment Required alignment of the returned memory.
+    //! \return Pointer to the allocated memory. This is never null.
+    auto allocate(std::size_t size, std::size_t alignment) -> void *
+    {
+        auto padded = size + alignment;
+        if(padded > block_size_)
+            return align(add_block(padded), padded, size, alignment);
+
+        if(auto p = std::align(alignment, size, cursor_, space_))
+            return bump(p, size);
+
+        cursor_ = add_block(block_size_);
+        space_ = block_size_;
+
+        return bump(std::align(alignment, size, cursor_, space_), size);
+    }
+
+    //! Number of bytes that have been allocated from the arena.
+    auto size() const noexcept { return size_; }
+
+    //! Return the arena that is current for the calling thread, or null if
+    //! there is none.
+    static auto current() noexcept -> expression_arena * &
+    {
+        static thread_local expression_arena * a = nullptr;
+        return a;
+    }
+
+    //! Destructor. Frees all memory allocated from the arena.
+    ~expression_arena() noexcept
+    {
+        while(blocks_)
+        {
+            auto const b = blocks_;
+            blocks_ = b->next;
+            ::operator delete(b);
+        }
+    }
+
+public:
+    //! Arenas are not copy-constructible.
+    expression_arena(expression_arena const &) =delete;
+
+    //! Arenas are not copy-assignable.
+    auto operator=(expression_arena const &) -> expression_arena & =delete;
+
+    //! Arenas are not move-constructible.
+    expression_arena(expression_arena &&) =delete;
+
+    //! Arenas are not move-assignable.
+    auto operator=(expression_arena &&) -> expression_arena & =delete;
+
+private:
+    struct block
+    {
+        block * next;
+    };
+
+    //! Allocate a block with the provided usable size and return a pointer to
+    //! its usable memory.
+    auto add_block(std::size_t usable) -> void *
+    {
+        auto const b = static_cast<block *>(::operator new(sizeof(block) +
+                                                           usable));
+        b->next = blocks_;
+        blocks_ = b;
+        return b + 1;
+    }
+
+    auto align(void * p, std::size_t space, std::size_t size,
+               std::size_t alignment) noexcept -> void *
+    {
+        size_ += size;
+        return std::align(alignment, size, p, space);
+    }
+
+    auto bump(void * p, std::size_t size) noexcept -> void *
+    {
+        cursor_ = static_cast<char *>(p) + size;
+        space_ -= size;
+        size_ += size;
+        return p;
+    }
+
+private:
+    std::size_t block_size_;
+    block * blocks_ { nullptr };
+    void * cursor_ { nullptr };
+    std::size_t space_ { 0 };
+    std::size_t size_ { 0 };
+};
+
+namespace expr_detail {
+
+//! Allocator that uses the arena it was created with, or the heap if it was
+//! created without one.
+//!
+//! Deallocating arena memory does nothing, the memory is released with the
+//! arena.
+//!
+//! \ingroup observable_detail
+template <typename T>
+class arena_allocator
+{
+public:
+    using value_type = T;
+
+    //! Create an allocator for an arena.
+    //!
+    //! \param[in] arena Arena to allocate from, or null to use the heap.
+    explicit arena_allocator(expression_arena * arena) noexcept :
+        arena_ { arena }
+    { }
+
+    //! Create an allocator that uses the same arena as another one.
+    template <typename U>
+    arena_allocator(arena_allocator<U> const & other) noexcept :
+        arena_ { other.arena() }
+    { }
+
+    auto allocate(std::size_t n) -> T *
+    {
+        if(!arena_)
+            return std::allocator<T> { }.allocate(n);
+
+        return static_cast<T *>(arena_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T * p, std::size_t n) noexcept
+    {
+        if(!arena_)
+            std::allocator<T> { }.deallocate(p, n);
+    }
+
+    //! The arena used by this allocator, or null if it uses the heap.
+    auto arena() const noexcept { return arena_; }
+
+private:
+    expression_arena * arena_;
+};
+
+//! Allocator that uses the arena which is current when memory is allocated, or
+//! the heap if no arena is current.
+//!
+//! Unlike \ref arena_allocator, this allocator has no state: each allocation
+//! is prefixed with the address of its arena, so memory can be deallocated
+//! through any instance, from any thread. This costs one pointer per
+//! allocation.
+//!
+//! \ingroup observable_detail
+template <typename T>
+class tagged_arena_allocator
+{
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+                  "Over-aligned types are not supported.");
+
+    // Room for the arena's address, keeping the allocated objects aligned.
+    static constexpr std::size_t header = alignof(T) > sizeof(void *) ?
+                                              alignof(T) :
+                                              sizeof(void *);
+
+public:
+    using value_type = T;
+
+    //! Create an allocator.
+    tagged_arena_allocator() noexcept =default;
+
+    //! Create an allocator from an allocator for a different type.
+    template <typename U>
+    tagged_arena_allocator(tagged_arena_allocator<U> const &) noexcept { }
+
+    auto allocate(std::size_t n) -> T *
+    {
+        auto const a = expression_arena::current();
+        auto const size = header + n * sizeof(T);
+        auto const p = static_cast<char *>(a ? a->allocate(size, header) :
+                                               ::operator new(size));
+
+        std::memcpy(p, &a, sizeof(a));
+        return reinterpret_cast<T *>(p + header);
+    }
+
+    void deallocate(T * p, std::size_t) noexcept
+    {
+        auto const base = reinterpret_cast<char *>(p) - header;
+
+        expression_arena * a = nullptr;
+        std::memcpy(&a, base, sizeof(a));
+        if(!a)
+            ::operator delete(base);
+    }
+};
+
+template <typename T, typename U>
+inline auto operator==(tagged_arena_allocator<T> const &,
+                       tagged_arena_allocator<U> const &) noexcept
+{
+    return true;
+}
+
+template <typename T, typename U>
+inline auto operator!=(tagged_arena_allocator<T> const &,
+                       tagged_arena_allocator<U> const &) noexcept
+{
+    return false;
+}
+
+template <typename T, typename U>
+inline auto operator==(arena_allocator<T> const & a,
+                       arena_allocator<U> const & b) noexcept
+{
+    return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+inline auto operator!=(arena_allocator<T> const & a,
+                       arena_allocator<U> const & b) noexcept
+{
+    return !(a == b);
+}
+
+}
+
+} }
+
+namespace observable {
+
+//! Subject policy that allocates from the current \ref expression_arena.
+//!
+//! The subject's collection is allocated from the arena that is in scope when
+//! the subject is created, and each subscribed observer from the arena that
+//! is in scope when it subscribes. Observers are stored in place, like with
+//! \ref inline_subject_policy. Without an arena in scope, memory comes from the
+//! heap, as usual.
+//!
+//! Values use the policy for all their subjects, so a value created in an
+//! arena's scope does not allocate from the heap:
+//!
+//!     expression_arena::scope const s { arena };
+//!     auto price = value<double, arena_subject_policy> { };
+//!
+//! \warning The arena must outlive the subject and every subscription to it.
+//!
+//! \ingroup observable
+struct arena_subject_policy : inline_subject_policy
+{
+    //! \see subject_policy::allocator
+    template <typename T>
+    using allocator = expr::expr_detail::tagged_arena_allocator<T>;
+
+    //! \see subject_policy::collection
+    template <typename ValueType>
+    using collection = detail::collection<ValueType, allocator<ValueType>>;
+};
+
+//! \cond
+template <>
+struct is_subject_policy<arena_subject_policy> : std::true_type { };
+//! \endcond
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
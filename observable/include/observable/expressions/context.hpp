@@ -0,0 +1,287 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <observable/subscription.hpp>
+#include <observable/value.hpp>
+#include <observable/expressions/tree.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable { inline namespace expr {
+
+//! Shares structurally identical expression subtrees.
+//!
+//! Expression nodes that are created while a context is in \ref scope are
+//! looked up inside the context before being built. A node that has the same
+//! operation and the same children as a node built earlier is not built
+//! again; the earlier node is shared instead. Shared nodes are evaluated once
+//! per change, and each value only gets a single subscription, no matter how
+//! many expressions use it.
+//!
+//! Example:
+//!
+//!     expression_context ctx;
+//!     auto r1 = observe(ctx, [&]() { return sqrt(x * x + y * y); });
+//!     auto r2 = observe(ctx, [&]() { return sqrt(x * x + y * y) * 2; });
+//!
+//! Here, ``r2`` reuses the whole tree of ``r1``.
+//!
+//! These nodes are shared:
+//!
+//!  - value nodes of the same observable value;
+//!  - constant nodes of arithmetic or enumeration types, with the same value;
+//!  - n-ary nodes with the same result type, the same children and an
+//!    operation of the same, empty type. All operators and most filters have
+//!    empty operation types. Nodes with a stateful operation, for example
+//!    throttle(), are never shared.
+//!
+//! The context keeps the nodes it has seen alive, until it is destroyed or
+//! cleared. Values that are moved or destroyed are forgotten.
+//!
+//! \note Shared nodes are the same node: renaming one renames all of them.
+//!
+//! \warning Contexts are not thread-safe. Building expressions inside the same
+//!          context from multiple threads, or destroying values used by the
+//!          context in another thread while building, is undefined behavior.
+//!
+//! \ingroup observable_expressions
+class expression_context final
+{
+public:
+    //! Makes a context current for the calling thread, for the lifetime of the
+    //! scope object.
+    //!
+    //! Scopes can be nested; the innermost one wins.
+    class scope final
+    {
+    public:
+        //! Make the provided context current.
+        explicit scope(expression_context & context) noexcept :
+            previous_ { current() }
+        {
+            current() = &context;
+        }
+
+        //! Restore the previously current context.
+        ~scope() noexcept { current() = previous_; }
+
+        //! Scopes are not copy-constructible.
+        scope(scope const &) =delete;
+
+        //! Scopes are not copy-assignable.
+        auto operator=(scope const &) -> scope & =delete;
+
+    private:
+        expression_context * previous_;
+    };
+
+    //! Create an empty context.
+    expression_context() =default;
+
+    //! Return the context that is current for the calling thread, or null if
+    //! there is none.
+    static auto current() noexcept -> expression_context * &
+    {
+        static thread_local expression_context * c = nullptr;
+        return c;
+    }
+
+    //! Number of nodes the context can share.
+    auto size() const noexcept { return nodes_.size(); }
+
+    //! Forget all nodes. Nodes that are not used by an expression anymore are
+    //! destroyed.
+    void clear() noexcept { nodes_.clear(); }
+
+    //! Return the node with the provided key, or build and remember it.
+    //!
+    //! \param[in] key Identifies the node's structure. The first part of the
+    //!                key identifies the kind of node and its result type.
+    //! \param[in] build Functor that returns the node to remember.
+    //! \return A shallow copy of the remembered node.
+    template <typename ResultType, typename Builder>
+    auto intern(std::vector<std::uintptr_t> key, Builder && build)
+        -> expression_node<ResultType>
+    {
+        auto it = nodes_.find(key);
+        if(it == nodes_.end())
+        {
+            auto e = entry { };
+            e.node = std::make_shared<expression_node<ResultType>>(build());
+            it = nodes_.emplace(std::move(key), std::move(e)).first;
+        }
+
+        return *std::static_pointer_cast<expression_node<ResultType>>(it->second.node);
+    }
+
+    //! Return the node of an observable value, or build and remember it.
+    //!
+    //! The node is forgotten when the value is moved or destroyed, so a later
+    //! value that reuses the same address gets a node of its own.
+    template <typename ResultType, typename ValueType, typename ... Rest>
+    auto intern(std::vector<std::uintptr_t> key, value<ValueType, Rest ...> & val)
+        -> expression_node<ResultType>
+    {
+        auto it = nodes_.find(key);
+        if(it == nodes_.end())
+        {
+            auto e = entry { };
+            e.node = std::make_shared<expression_node<ResultType>>(val);
+
+            auto const forget = [this, key]() { nodes_.erase(key); };
+            e.subs.emplace_back(val.moved.subscribe([=](auto &&) { forget(); }));
+            e.subs.emplace_back(val.destroyed.subscribe(forget));
+
+            it = nodes_.emplace(std::move(key), std::move(e)).first;
+        }
+
+        return *std::static_pointer_cast<expression_node<ResultType>>(it->second.node);
+    }
+
+public:
+    //! Contexts are not copy-constructible.
+    expression_context(expression_context const &) =delete;
+
+    //! Contexts are not copy-assignable.
+    auto operator=(expression_context const &) -> expression_context & =delete;
+
+    //! Contexts are not move-constructible.
+    expression_context(expression_context &&) =delete;
+
+    //! Contexts are not move-assignable.
+    auto operator=(expression_context &&) -> expression_context & =delete;
+
+private:
+    struct entry
+    {
+        std::shared_ptr<void> node;
+        std::vector<unique_subscription> subs;
+    };
+
+    struct key_hash
+    {
+        auto operator()(std::vector<std::uintptr_t> const & key) const noexcept
+            -> std::size_t
+        {
+            auto h = std::size_t { 0 };
+            for(auto && k : key)
+                h ^= std::hash<std::uintptr_t> { }(k) + 0x9e3779b9 + (h << 6) + (h >> 2);
+            return h;
+        }
+    };
+
+    std::unordered_map<std::vector<std::uintptr_t>, entry, key_hash> nodes_;
+};
+
+//! \cond
+namespace expr_detail {
+
+    //! Unique address for each type.
+    template <typename T>
+    struct type_tag
+    {
+        static constexpr char id = 0;
+    };
+
+    template <typename T>
+    constexpr char type_tag<T>::id;
+
+    template <typename T>
+    inline auto type_id() noexcept
+    {
+        return reinterpret_cast<std::uintptr_t>(&type_tag<T>::id);
+    }
+
+    struct constant_node;
+    struct value_node;
+    template <typename Op>
+    struct nary_node;
+
+    //! Constants can be shared if they can be compared bit by bit.
+    template <typename T>
+    struct is_shareable_constant :
+        std::integral_constant<bool, (std::is_arithmetic<T>::value ||
+                                      std::is_enum<T>::value) &&
+                                     sizeof(T) <= sizeof(std::uintptr_t)>
+    { };
+
+    //! Operations can be shared if they have no state.
+    template <typename Op>
+    struct is_shareable_op : std::is_empty<std::decay_t<Op>> { };
+
+    template <typename T>
+    inline auto node_id(expression_node<T> const & node) noexcept
+    {
+        return reinterpret_cast<std::uintptr_t>(&node.base());
+    }
+
+    //! Build a constant node, sharing it with the current context if possible.
+    template <typename ResultType, typename T>
+    inline auto make_shared_constant(T && val, std::true_type)
+    {
+        auto const ctx = expression_context::current();
+        if(!ctx)
+            return expression_node<ResultType> { std::forward<T>(val) };
+
+        auto const c = static_cast<ResultType>(val);
+        auto bits = std::uintptr_t { 0 };
+        std::memcpy(&bits, &c, sizeof(c));
+
+        return ctx->intern<ResultType>(
+                    { type_id<std::pair<constant_node, ResultType>>(), bits },
+                    [&]() { return expression_node<ResultType> { c }; });
+    }
+
+    template <typename ResultType, typename T>
+    inline auto make_shared_constant(T && val, std::false_type)
+    {
+        return expression_node<ResultType> { std::forward<T>(val) };
+    }
+
+    //! Build a value node, sharing it with the current context.
+    template <typename ResultType, typename ValueType, typename ... Rest>
+    inline auto make_shared_value(value<ValueType, Rest ...> & val)
+    {
+        auto const ctx = expression_context::current();
+        if(!ctx)
+            return expression_node<ResultType> { val };
+
+        return ctx->intern<ResultType>(
+                    { type_id<std::pair<value_node, ResultType>>(),
+                      reinterpret_cast<std::uintptr_t>(&val) },
+                    val);
+    }
+
+    //! Build an n-ary node, sharing it with the current context if possible.
+    template <typename Node, typename Op, typename ... ValueType>
+    inline auto make_shared_nary(Op && op, expression_node<ValueType> && ... nodes)
+        -> Node
+    {
+        using ResultType = std::decay_t<decltype(std::declval<Node const &>().get())>;
+
+        auto const ctx = expression_context::current();
+        if(!ctx || !is_shareable_op<Op>::value)
+            return expression_node<ResultType> { std::forward<Op>(op), std::move(nodes) ... };
+
+        return ctx->intern<ResultType>(
+                    { type_id<std::pair<nary_node<std::decay_t<Op>>, ResultType>>(),
+                      node_id(nodes) ... },
+                    [&]() {
+                        return expression_node<ResultType> { std::forward<Op>(op),
+                                                             std::move(nodes) ... };
+                    });
+    }
+}
+//! \endcond
+
+} }
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
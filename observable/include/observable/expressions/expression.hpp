@@ -1,5 +1,7 @@
 #pragma once
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <deque>
 #include <functional>
 #include <memory>
@@ -8,6 +10,8 @@
 #include <utility>
 #include <observable/subscription.hpp>
 #include <observable/value.hpp>
+#include <observable/detail/propagation.hpp>
+#include <observable/expressions/arena.hpp>
 #include <observable/expressions/tree.hpp>
 
 #include <observable/detail/compiler_config.hpp>
@@ -15,6 +19,22 @@ OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
 
 namespace observable { inline namespace expr {
 
+//! \cond
+namespace expr_detail {
+template <typename ValueType, typename EvaluatorType>
+class conflating_updater;
+
+template <typename ValueType, typename EvaluatorType>
+class shared_memory_updater;
+
+template <typename ValueType, typename EvaluatorType>
+class replica_updater;
+}
+
+template <typename Signature, typename EvaluatorType>
+class vectorized_expression;
+//! \endcond
+
 //! Expression evaluators can be used to manually evaluate multiple expressions at
 //! the same time.
 //!
@@ -24,24 +44,82 @@ namespace observable { inline namespace expr {
 class expression_evaluator
 {
 public:
+    //! Create an evaluator that keeps its state on the heap.
+    expression_evaluator() : expression_evaluator { nullptr } { }
+
+    //! Create an evaluator that keeps its state inside an arena.
+    //!
+    //! \param[in] arena Arena that the evaluator's state is allocated from.
+    //!                  The arena must outlive the evaluator and its copies.
+    explicit expression_evaluator(expression_arena & arena) :
+        expression_evaluator { &arena }
+    { }
+
     //! Evaluate all expressions associated with this instance.
     //!
     //! \note This method can be safely called in parallel, from multiple threads.
     void eval_all() const
+    {
+        with_entries([](auto && entries) {
+            for(auto && e : entries)
+            {
+                e.prepare(e.expression);
+                e.deliver(e.expression);
+            }
+        });
+    }
+
+protected:
+    //! An expression registered with an evaluator.
+    //!
+    //! Evaluating an expression is split in two steps. prepare() evaluates
+    //! the expression's tree and can run concurrently with the prepare()
+    //! calls of other expressions. deliver() notifies the expression's value
+    //! of the new result.
+    struct entry
+    {
+        void * expression;
+        std::size_t rank;
+        void (*prepare)(void *);
+        void (*deliver)(void *);
+    };
+
+    //! Call a functor with all registered entries, in registration order.
+    //!
+    //! No expressions can be registered or unregistered while the functor is
+    //! running.
+    template <typename Fun>
+    void with_entries(Fun && fun) const
     {
         std::lock_guard<std::mutex> const lock { data_->mutex };
-        for(auto && p : data_->funs)
-            p.second();
+        fun(static_cast<entry_list const &>(data_->entries));
+    }
+
+    //! Create the entry of an expression.
+    template <typename ExpressionType>
+    static auto make_entry(ExpressionType * expr) -> entry
+    {
+        return entry {
+            expr,
+            expr->rank(),
+            [](void * e) { static_cast<ExpressionType *>(e)->prepare(); },
+            [](void * e) { static_cast<ExpressionType *>(e)->deliver(); }
+        };
     }
 
-private:
     // Expressions are inserted and removed in the order in which they are
     // created. Evaluating them in this order guarantees that the evaluation
     // order is correct (insert is called from the constructor, nothing can
     // have a dependency on the inserted expression yet).
 
+    //! Identifies a registered expression. Derived evaluators can redefine
+    //! this, together with insert(), remove() and changed().
     using id = void const *;
 
+    //! True if registered expressions must call changed() when their result
+    //! might have changed. Derived evaluators can redefine this.
+    static constexpr bool tracks_changes = false;
+
     //! Register a new expression to be evaluated by this evaluator.
     //!
     //! \return Instance id that can be used to unregister the expression.
@@ -52,7 +130,7 @@ private:
         assert(expr);
         std::lock_guard<std::mutex> const lock { data_->mutex };
 
-        data_->funs.emplace_back(expr, [=]() { expr->eval(); });
+        data_->entries.push_back(make_entry(expr));
         return id { expr };
     }
 
@@ -64,24 +142,63 @@ private:
     {
         std::lock_guard<std::mutex> const lock { data_->mutex };
 
-        auto const it = find_if(begin(data_->funs),
-                                end(data_->funs),
-                                [&](auto && p) { return p.first == instance_id; });
-        assert(it != end(data_->funs));
-        if(it != end(data_->funs))
-            data_->funs.erase(it);
+        auto const it = find_if(begin(data_->entries),
+                                end(data_->entries),
+                                [&](auto && e) { return e.expression == instance_id; });
+        assert(it != end(data_->entries));
+        if(it != end(data_->entries))
+            data_->entries.erase(it);
     }
 
+    //! Called by a registered expression when its result might have changed,
+    //! if tracks_changes is true.
+    void changed(id) const noexcept { }
+
+    //! Called by a registered expression once it has been fully set up and
+    //! can be evaluated. Expressions are registered from their constructor,
+    //! before their value is bound to them; evaluators that run expressions
+    //! concurrently with their registration can wait for this call.
+    void ready(id) const noexcept { }
+
 private:
+    using entry_list = std::deque<entry, expr_detail::arena_allocator<entry>>;
+
     struct data {
-        std::deque<std::pair<id, std::function<void()>>> funs;
+        explicit data(expr_detail::arena_allocator<data> const & a) :
+            entries { a }
+        { }
+
+        entry_list entries;
         std::mutex mutex;
     };
 
-    std::shared_ptr<data> data_ { std::make_shared<data>() };
+    // The arena is never picked up from the current scope: evaluators, like
+    // the one shared by all immediate expressions, can outlive it.
+    explicit expression_evaluator(expression_arena * arena)
+    {
+        auto const a = expr_detail::arena_allocator<data> { arena };
+        data_ = std::allocate_shared<data>(a, a);
+    }
+
+    std::shared_ptr<data> data_;
 
     template <typename ValueType, typename UpdaterType>
     friend class expression;
+
+    template <typename Root, typename UpdaterType>
+    friend class fused_expression;
+
+    template <typename ValueType, typename UpdaterType>
+    friend class expr_detail::conflating_updater;
+
+    template <typename ValueType, typename UpdaterType>
+    friend class expr_detail::shared_memory_updater;
+
+    template <typename ValueType, typename UpdaterType>
+    friend class expr_detail::replica_updater;
+
+    template <typename Signature, typename UpdaterType>
+    friend class vectorized_expression;
 };
 
 //! Expressions manage expression tree evaluation and results.
@@ -114,14 +231,41 @@ public:
         evaluator_ { evaluator }
     {
         expression_id_ = evaluator_.insert(this);
+
+        if(EvaluatorType::tracks_changes)
+            changes_ = root_.subscribe([this]() {
+                evaluator_.changed(expression_id_);
+            });
     }
 
     //! Evaluate the expression. This will ensure that the expression's result
     //! is up-to-date.
     void eval()
     {
-        root_.eval();
-        value_notifier_(root_.get());
+        prepare();
+        deliver();
+    }
+
+    //! Evaluate the expression tree, without notifying the value.
+    //!
+    //! Expressions that do not share any nodes, or only share nodes with
+    //! expressions of the same evaluator, can be prepared concurrently.
+    void prepare() { root_.eval(); }
+
+    //! Notify the value of the expression's current result.
+    //!
+    //! Nothing is done if the tree's root has not been evaluated since the
+    //! previous call, so polling an unchanged expression does not copy or
+    //! compare its result.
+    void deliver()
+    {
+        auto const version = root_.version();
+        if(version == delivered_)
+            return;
+
+        delivered_ = version;
+        auto result = root_.get();
+        value_notifier_(std::move(result));
     }
 
     //! Retrieve the expression's result.
@@ -132,8 +276,13 @@ public:
     virtual void set_value_notifier(std::function<void(ValueType &&)> const & notifier) override
     {
         value_notifier_ = notifier;
+        delivered_ = no_version;
+        evaluator_.ready(expression_id_);
     }
 
+    //! The expression's value is ranked above all nodes of its tree.
+    virtual auto rank() const -> std::size_t override { return root_.rank() + 1; }
+
     //! Destructor.
     virtual ~expression() override { evaluator_.remove(expression_id_); }
 
@@ -157,13 +306,26 @@ protected:
     //! Return the expression tree's root node.
     auto root_node() -> expression_node<ValueType> & { return root_; }
 
+    //! \see root_node()
+    auto root_node() const -> expression_node<ValueType> const & { return root_; }
+
 private:
     expression_node<ValueType> root_;
     EvaluatorType evaluator_;
-    typename EvaluatorType::id expression_id_;
+    typename EvaluatorType::id expression_id_ { };
     std::function<void(ValueType &&)> value_notifier_ { [](auto &&) { } };
+    unique_subscription changes_;
+
+    //! Version of the root node whose result was last delivered.
+    static constexpr std::uint64_t no_version = ~std::uint64_t { 0 };
+    std::uint64_t delivered_ { no_version };
 };
 
+//! \cond
+template <typename ValueType, typename EvaluatorType>
+constexpr std::uint64_t expression<ValueType, EvaluatorType>::no_version;
+//! \endcond
+
 //! Evaluator used for expressions that are updated immediately, whenever an
 //! expression node changes.
 //!
@@ -198,7 +360,17 @@ public:
         expression<ValueType, expression_evaluator>(std::move(root),
                                                     get_dummy_evaluator_())
     {
-        sub = this->root_node().subscribe([&]() { this->eval(); });
+        sub = this->root_node().subscribe([&]() {
+            if(!demand_ || demand_())
+                schedule();
+        });
+    }
+
+    //! Destructor.
+    virtual ~expression() override
+    {
+        if(scheduled_)
+            detail::propagation::cancel(this);
     }
 
 public:
@@ -217,8 +389,101 @@ public:
     //! Expressions are move-assignable.
     auto operator=(expression &&) -> expression & =default;
 
+protected:
+    //! Functor called when the tree changes. If it is set and returns false,
+    //! the expression is not evaluated.
+    std::function<bool()> demand_;
+
+private:
+    //! Evaluate the expression once the change that made the tree dirty has
+    //! been fully propagated, so the evaluation sees all changed inputs.
+    void schedule()
+    {
+        if(scheduled_)
+            return;
+
+        scheduled_ = detail::propagation::schedule(this->root_node().rank(),
+                                                   this,
+                                                   &run_scheduled);
+        if(!scheduled_)
+            this->eval();
+    }
+
+    static void run_scheduled(void * target, bool run)
+    {
+        auto const e = static_cast<expression *>(target);
+        e->scheduled_ = false;
+
+        if(run)
+            e->eval();
+    }
+
 private:
     unique_subscription sub;
+    bool scheduled_ { false };
+};
+
+//! Evaluator used for expressions that are only evaluated when their result
+//! is needed.
+//!
+//! \see expression<ValueType, lazy_evaluator>
+//! \ingroup observable_detail
+struct lazy_evaluator final : expression_evaluator { };
+
+//! Specialized expression that is only evaluated when its value is read, or
+//! when the value has observers.
+//!
+//! Changes to the tree still mark its nodes as dirty, upward, but nothing is
+//! computed until the value is needed. If the value has observers, including
+//! other expressions, the expression is evaluated immediately, like with the
+//! \ref immediate_evaluator. Otherwise, the value is only marked as stale and
+//! reading it evaluates the dirty part of the tree.
+//!
+//! \see expression<ValueType, EvaluatorType>
+//! \ingroup observable_detail
+template <typename ValueType>
+class expression<ValueType, lazy_evaluator> :
+    public expression<ValueType, immediate_evaluator>
+{
+public:
+    //! Create a new expression from the root node of an expression tree.
+    //!
+    //! \param[in] root Expression tree root node. Its nodes do not need to have
+    //!                 been evaluated.
+    explicit expression(expression_node<ValueType> && root) :
+        expression<ValueType, immediate_evaluator>(std::move(root))
+    { }
+
+    //! Evaluate the dirty part of the tree and retrieve its result.
+    virtual auto get() const -> ValueType override
+    {
+        this->root_node().eval();
+        return this->root_node().get();
+    }
+
+    //! Remember how to mark the value as stale, and mark it right away; the
+    //! tree might not have been evaluated yet.
+    virtual void set_stale_notifier(std::function<bool()> const & notifier) override
+    {
+        this->demand_ = notifier;
+        notifier();
+    }
+
+public:
+    //! Expressions are default-constructible.
+    expression() =default;
+
+    //! Expressions are not copy-constructible.
+    expression(expression const &) =delete;
+
+    //! Expressions are not copy-assignable.
+    auto operator=(expression const &) -> expression & =delete;
+
+    //! Expressions are move-constructible.
+    expression(expression &&) =default;
+
+    //! Expressions are move-assignable.
+    auto operator=(expression &&) -> expression & =default;
 };
 
 } }
@@ -28,7 +28,8 @@ inline auto NAME(Args && ... args) \
                         ::observable::expr::expr_detail::are_any_observable<Args ...>::value, \
                         ::observable::expr::expr_detail::result_node_t<decltype(OP), Args ...>> \
 { \
-    return ::observable::expr::expr_detail::make_node(OP, std::forward<Args>(args) ...); \
+    return ::observable::expr::expr_detail::make_named_node(#NAME, OP, \
+                                                            std::forward<Args>(args) ...); \
 }
 
 //! Create an expression filter from a callable.
@@ -53,7 +54,8 @@ inline auto NAME(Args && ... args) \
                         ::observable::expr::expr_detail::are_any_observable<Args ...>::value, \
                         ::observable::expr::expr_detail::result_node_t<decltype(OP<T>), Args ...>> \
 { \
-    return ::observable::expr::expr_detail::make_node(OP<T>, std::forward<Args>(args) ...); \
+    return ::observable::expr::expr_detail::make_named_node(#NAME, OP<T>, \
+                                                            std::forward<Args>(args) ...); \
 }
 
 namespace observable { inline namespace expr {
@@ -87,8 +89,9 @@ inline auto construct(Args && ... args)
     -> std::enable_if_t<expr_detail::are_any_observable<Args ...>::value,
                         expression_node<ValueType>>
 {
-    return expr_detail::make_node(filter_detail::construct<ValueType> { },
-                                  std::forward<Args>(args) ...);
+    return expr_detail::make_named_node("construct",
+                                        filter_detail::construct<ValueType> { },
+                                        std::forward<Args>(args) ...);
 }
 
 //! Cast an expression node to another type using static_cast.
@@ -103,8 +106,10 @@ inline auto static_expr_cast(From && from)
     expr_detail::is_observable<From>::value,
     expression_node<To>>
 {
-    return expr_detail::make_node([](auto && f) { return static_cast<To>(f); },
-                                  std::forward<From>(from));
+    // Takes a copy, so conversion operators that are not const can be used.
+    return expr_detail::make_named_node("static_expr_cast",
+                                        [](auto f) { return static_cast<To>(f); },
+                                        std::forward<From>(from));
 }
 
 //! Cast an expression node to another type using reinterpret_cast.
@@ -119,8 +124,9 @@ inline auto reinterpret_expr_cast(From && from)
     expr_detail::is_observable<From>::value,
     expression_node<To>>
 {
-    return expr_detail::make_node([](auto && f) { return reinterpret_cast<To>(f); },
-                                  std::forward<From>(from));
+    return expr_detail::make_named_node("reinterpret_expr_cast",
+                                        [](auto && f) { return reinterpret_cast<To>(f); },
+                                        std::forward<From>(from));
 }
 
 //! \cond
@@ -134,7 +140,7 @@ namespace filter_detail {
                         TrueType && true_val,
                         FalseType && false_val) const
         {
-            return cond ? true_val : false_val;
+            return cond() ? true_val() : false_val();
         }
     };
 
@@ -208,6 +214,9 @@ namespace filter_detail {
 //!
 //! This is basically the ternary operator for expressions.
 //!
+//! Only the selected value is evaluated. Changes to the other value do not
+//! trigger an update until the condition selects it.
+//!
 //! \param cond A value that evaluates to true or false. This will be used to
 //!             choose the return value.
 //! \param true_val Value that will be returned if ``cond`` evaluates to true.
@@ -217,8 +226,21 @@ namespace filter_detail {
 //! \ingroup observable_expressions
 template <typename Cond, typename TrueVal, typename FalseVal>
 auto select(Cond && cond, TrueVal && true_val, FalseVal && false_val);
+#else
+template <typename Cond, typename TrueVal, typename FalseVal>
+inline auto select(Cond && cond, TrueVal && true_val, FalseVal && false_val)
+    -> std::enable_if_t<
+            expr_detail::are_any_observable<Cond, TrueVal, FalseVal>::value,
+            expr_detail::lazy_result_node_t<filter_detail::select_,
+                                            Cond, TrueVal, FalseVal>>
+{
+    return expr_detail::make_named_lazy_node("select",
+                                             filter_detail::select_ { },
+                                             std::forward<Cond>(cond),
+                                             std::forward<TrueVal>(true_val),
+                                             std::forward<FalseVal>(false_val));
+}
 #endif
-OBSERVABLE_ADAPT_FILTER(select, filter_detail::select_ { })
 
 #if defined(DOXYGEN)
 //! Return the argument with the minimum value.
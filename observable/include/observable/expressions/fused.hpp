@@ -0,0 +1,644 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <observable/subscription.hpp>
+#include <observable/value.hpp>
+#include <observable/detail/propagation.hpp>
+#include <observable/expressions/expression.hpp>
+#include <observable/expressions/tree.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable { inline namespace expr {
+
+//! \cond
+template <typename ValueType>
+class fused_leaf;
+
+template <typename Op, typename ... Operands>
+class fused_node;
+
+template <typename T>
+struct is_fused_expression_ : std::false_type { };
+
+template <typename ValueType>
+struct is_fused_expression_<fused_leaf<ValueType>> : std::true_type { };
+
+template <typename Op, typename ... Operands>
+struct is_fused_expression_<fused_node<Op, Operands ...>> : std::true_type { };
+//! \endcond
+
+//! Check if a type is a fused expression.
+//!
+//! The static member ``value`` will be true if the provided type is a
+//! fused_leaf or a fused_node.
+//!
+//! \ingroup observable_detail
+template <typename T>
+struct is_fused_expression : is_fused_expression_<std::decay_t<T>> { };
+
+namespace expr_detail {
+
+//! Evaluate a fused expression operand; constants evaluate to themselves.
+//!
+//! \ingroup observable_detail
+template <typename T>
+inline auto fused_value(T const & constant) noexcept -> T const &
+{
+    return constant;
+}
+
+//! \cond
+template <typename ValueType>
+inline auto fused_value(fused_leaf<ValueType> const & leaf)
+    -> decltype(leaf.eval())
+{
+    return leaf.eval();
+}
+
+template <typename Op, typename ... Operands>
+inline auto fused_value(fused_node<Op, Operands ...> const & node)
+    -> decltype(node.eval())
+{
+    return node.eval();
+}
+//! \endcond
+
+//! Operand of a lazy fused operator; evaluates the operand when called.
+//!
+//! \ingroup observable_detail
+template <typename T>
+struct fused_thunk
+{
+    auto operator()() const -> decltype(fused_value(std::declval<T const &>()))
+    {
+        return fused_value(operand);
+    }
+
+    T const & operand;
+};
+
+//! Operator of a fused node that is called with a \ref fused_thunk for each
+//! operand, instead of the operands' values, so it can skip evaluating some of
+//! them.
+//!
+//! \ingroup observable_detail
+template <typename Op>
+struct fused_lazy_op
+{
+    Op op;
+};
+
+//! \cond
+template <typename T>
+struct is_fused_lazy_op : std::false_type { };
+
+template <typename Op>
+struct is_fused_lazy_op<fused_lazy_op<Op>> : std::true_type { };
+//! \endcond
+
+//! Call a functor with every leaf of a fused expression operand; constants
+//! have no leaves.
+//!
+//! \ingroup observable_detail
+template <typename T, typename Fun>
+inline void visit_leaves(T &, Fun &&) noexcept { }
+
+//! \cond
+template <typename ValueType, typename Fun>
+inline void visit_leaves(fused_leaf<ValueType> & leaf, Fun && fun)
+{
+    fun(leaf);
+}
+
+template <typename Op, typename ... Operands, typename Fun>
+inline void visit_leaves(fused_node<Op, Operands ...> & node, Fun && fun)
+{
+    node.for_each_leaf(fun);
+}
+//! \endcond
+
+//! Number of leaves in a fused expression operand.
+//!
+//! \ingroup observable_detail
+template <typename T>
+struct fused_leaf_count : std::integral_constant<std::size_t, 0> { };
+
+//! \cond
+template <typename ValueType>
+struct fused_leaf_count<fused_leaf<ValueType>> :
+    std::integral_constant<std::size_t, 1>
+{ };
+
+template <typename Op, typename ... Operands>
+struct fused_leaf_count<fused_node<Op, Operands ...>> :
+    std::integral_constant<std::size_t, fused_node<Op, Operands ...>::leaf_count()>
+{ };
+//! \endcond
+
+//! Turn an operand into something that can be stored inside a fused node.
+//!
+//! Constants and fused expressions are stored by value.
+//!
+//! \ingroup observable_detail
+template <typename T>
+inline auto fuse_operand(T && operand) -> std::decay_t<T>
+{
+    return std::forward<T>(operand);
+}
+
+//! Observable values are stored as leaves that reference the value.
+//!
+//! \ingroup observable_detail
+template <typename T, typename ... R>
+inline auto fuse_operand(value<T, R ...> & operand)
+{
+    return fused_leaf<value<T, R ...>> { operand };
+}
+
+//! Create a fused node from an operator and its operands.
+//!
+//! \ingroup observable_detail
+template <typename Op, typename ... Args>
+inline auto make_fused_node(Op && op, Args && ... args)
+{
+    using node_type = fused_node<std::decay_t<Op>,
+                                 decltype(fuse_operand(std::declval<Args>())) ...>;
+    return node_type { std::forward<Op>(op),
+                       fuse_operand(std::forward<Args>(args)) ... };
+}
+
+//! Check if the provided operator operands should produce a fused node.
+//!
+//! At least one operand must be a fused expression. Fused expressions cannot
+//! be mixed with regular expression nodes.
+//!
+//! \ingroup observable_detail
+template <typename A, typename B>
+struct are_fusable :
+    std::integral_constant<bool,
+        (is_fused_expression<A>::value || is_fused_expression<B>::value) &&
+        !is_expression_node<A>::value && !is_expression_node<B>::value>
+{ };
+
+}
+
+//! Leaf of a fused expression; references an observable value.
+//!
+//! \see fuse()
+//! \ingroup observable_detail
+template <typename ValueType>
+class fused_leaf final
+{
+public:
+    //! Create a leaf that references the provided value.
+    explicit fused_leaf(ValueType & value) noexcept : value_ { &value } { }
+
+    //! Retrieve the referenced value's current value.
+    auto eval() const noexcept -> auto const & { return value_->get(); }
+
+    //! Propagation rank of the referenced value.
+    auto rank() const noexcept { return value_->rank(); }
+
+    //! Subscribe to changes of the referenced value.
+    //!
+    //! Moving the value is tracked by the leaf.
+    //!
+    //! \param[out] subs Container that will store the subscriptions.
+    //! \param[in] on_change Called when the value changes.
+    //! \param[in] on_destroyed Called before the value is destroyed. The leaf
+    //!                         must not be evaluated afterwards.
+    template <typename Subscriptions, typename OnChange, typename OnDestroyed>
+    void subscribe(Subscriptions & subs, OnChange && on_change,
+                   OnDestroyed && on_destroyed)
+    {
+        subs.emplace_back(value_->subscribe(std::forward<OnChange>(on_change)));
+        subs.emplace_back(value_->moved.subscribe([this](auto & v) {
+            value_ = static_cast<ValueType *>(&v);
+        }));
+        subs.emplace_back(
+            value_->destroyed.subscribe(std::forward<OnDestroyed>(on_destroyed)));
+    }
+
+    //! Call a functor with this leaf.
+    template <typename Fun>
+    void for_each_leaf(Fun && fun) { fun(*this); }
+
+    //! Number of leaves.
+    static constexpr auto leaf_count() noexcept { return std::size_t { 1 }; }
+
+private:
+    ValueType * value_;
+};
+
+//! Node of a fused expression; applies an operator to its operands.
+//!
+//! Fused nodes keep the whole expression inside their type. Evaluating the
+//! root of a fused expression calls all of the operators directly, without
+//! caching any intermediate results, so the compiler can inline the whole
+//! expression into a single function.
+//!
+//! Operands can be other fused nodes, fused leaves or constants. Operands are
+//! evaluated eagerly, except for the operands of ``&&`` and ``||``, which
+//! short-circuit like the built-in operators.
+//!
+//! \see fuse()
+//! \ingroup observable_detail
+template <typename Op, typename ... Operands>
+class fused_node final
+{
+public:
+    //! Create a node from an operator and its operands.
+    template <typename Op_, typename ... Operands_,
+              typename = std::enable_if_t<sizeof...(Operands_) ==
+                                          sizeof...(Operands)>>
+    explicit fused_node(Op_ && op, Operands_ && ... operands) :
+        op_ { std::forward<Op_>(op) },
+        operands_ { std::forward<Operands_>(operands) ... }
+    { }
+
+    //! Evaluate the operator with the current values of the operands.
+    auto eval() const
+    {
+        return eval_impl(std::index_sequence_for<Operands ...> { },
+                         expr_detail::is_fused_lazy_op<Op> { });
+    }
+
+    //! Call a functor with every leaf of the node, in order.
+    template <typename Fun>
+    void for_each_leaf(Fun && fun)
+    {
+        for_each_leaf_impl(fun, std::index_sequence_for<Operands ...> { });
+    }
+
+    //! Number of leaves.
+    static constexpr auto leaf_count() noexcept
+    {
+        std::size_t const counts[] = {
+            0, expr_detail::fused_leaf_count<Operands>::value ...
+        };
+
+        auto total = std::size_t { 0 };
+        for(auto c : counts)
+            total += c;
+
+        return total;
+    }
+
+private:
+    template <std::size_t ... I>
+    auto eval_impl(std::index_sequence<I ...>, std::false_type) const
+    {
+        return op_(expr_detail::fused_value(std::get<I>(operands_)) ...);
+    }
+
+    template <std::size_t ... I>
+    auto eval_impl(std::index_sequence<I ...>, std::true_type) const
+    {
+        return op_.op(expr_detail::fused_thunk<Operands> { std::get<I>(operands_) } ...);
+    }
+
+    template <typename Fun, std::size_t ... I>
+    void for_each_leaf_impl(Fun & fun, std::index_sequence<I ...>)
+    {
+        using expand = int[];
+        (void) expand {
+            0, (expr_detail::visit_leaves(std::get<I>(operands_), fun), 0) ...
+        };
+    }
+
+private:
+    Op op_;
+    std::tuple<Operands ...> operands_;
+};
+
+//! Start a fused expression from an observable value.
+//!
+//! Operators applied to the returned leaf produce fused nodes instead of
+//! expression nodes. Other observable values and constants used in the same
+//! expression are fused automatically. Passing the result to observe() creates
+//! a value that subscribes directly to all the values in the expression and
+//! evaluates the whole expression at once, with a single cached result.
+//!
+//! Example:
+//!
+//!     auto result = observe(500 + fuse(i) * j * k - (1 + fuse(k) + j));
+//!
+//! \note Operators only produce fused nodes if one of their operands is
+//!       already fused, so every parenthesized sub-expression must contain a
+//!       fused leaf. Fused expressions cannot contain regular expression
+//!       nodes, and only support operators: functions like select() need
+//!       regular expression nodes.
+//!
+//! \param[in] val Value that will be referenced by the expression. The value
+//!                can be moved, but if it is destroyed, the observed
+//!                expression keeps its last result.
+//!
+//! \ingroup observable_expressions
+template <typename T, typename ... R>
+inline auto fuse(value<T, R ...> & val)
+{
+    return fused_leaf<value<T, R ...>> { val };
+}
+
+namespace expr_detail {
+
+//! Implementation shared by all fused expressions.
+//!
+//! \ingroup observable_detail
+template <typename Root>
+class fused_expression_base :
+    public value_updater<std::decay_t<decltype(std::declval<Root const &>().eval())>>
+{
+public:
+    //! Type of the expression's result.
+    using value_type = std::decay_t<decltype(std::declval<Root const &>().eval())>;
+
+    //! Retrieve the expression's result.
+    virtual auto get() const -> value_type override { return result_; }
+
+    virtual void set_value_notifier(std::function<void(value_type &&)> const & notifier) override
+    {
+        value_notifier_ = notifier;
+    }
+
+    //! The expression's value is ranked above all of its leaves.
+    virtual auto rank() const -> std::size_t override { return tree_rank_ + 1; }
+
+public:
+    //! Fused expressions are not copy-constructible.
+    fused_expression_base(fused_expression_base const &) =delete;
+
+    //! Fused expressions are not copy-assignable.
+    auto operator=(fused_expression_base const &) -> fused_expression_base & =delete;
+
+protected:
+    explicit fused_expression_base(Root && root) :
+        root_ { std::move(root) },
+        result_ { root_.eval() }
+    {
+        root_.for_each_leaf([&](auto & leaf) {
+            tree_rank_ = std::max(tree_rank_, leaf.rank() + 1);
+        });
+    }
+
+    //! Subscribe to all leaves of the expression.
+    template <typename OnChange>
+    void subscribe_leaves(OnChange on_change)
+    {
+        subs_.reserve(Root::leaf_count() * 3);
+        root_.for_each_leaf([&](auto & leaf) {
+            leaf.subscribe(subs_,
+                           [this, on_change]() {
+                               dirty_ = true;
+                               on_change();
+                           },
+                           [this]() { freeze(); });
+        });
+    }
+
+    //! Evaluate the expression, if any of its leaves has changed.
+    void eval_if_dirty()
+    {
+        prepare_result();
+        deliver_result();
+    }
+
+    //! Evaluate the expression, if any of its leaves has changed, without
+    //! notifying the value.
+    void prepare_result()
+    {
+        if(!dirty_ || frozen_)
+            return;
+
+        dirty_ = false;
+        result_ = root_.eval();
+        ready_ = true;
+    }
+
+    //! Notify the value of a result computed by prepare_result().
+    void deliver_result()
+    {
+        if(!ready_)
+            return;
+
+        ready_ = false;
+        value_notifier_(value_type { result_ });
+    }
+
+    //! Rank of the expression itself; higher than the rank of all leaves.
+    auto tree_rank() const noexcept { return tree_rank_; }
+
+private:
+    //! Stop evaluating the expression; one of its values is being destroyed.
+    void freeze()
+    {
+        frozen_ = true;
+        subs_.clear();
+    }
+
+private:
+    Root root_;
+    value_type result_;
+    std::size_t tree_rank_ { 0 };
+    bool dirty_ { false };
+    bool frozen_ { false };
+    bool ready_ { false };
+    std::vector<unique_subscription> subs_;
+    std::function<void(value_type &&)> value_notifier_ { [](auto &&) { } };
+};
+
+}
+
+//! Value updater for a fused expression that is evaluated with an
+//! expression_evaluator.
+//!
+//! The expression is only evaluated if any of its values have changed since
+//! the last evaluation.
+//!
+//! \tparam Root Root of the fused expression.
+//! \tparam EvaluatorType An instance of expression_evaluator, or a type derived
+//!                       from it.
+//! \warning None of the methods in this class can be safely called
+//!          concurrently.
+//!
+//! \ingroup observable_detail
+template <typename Root, typename EvaluatorType=expression_evaluator>
+class fused_expression final : public expr_detail::fused_expression_base<Root>
+{
+    static_assert(std::is_base_of<expression_evaluator, EvaluatorType>::value,
+                  "EvaluatorType needs to be derived from expression_evaluator.");
+
+public:
+    //! Type of the expression's result.
+    using value_type = typename expr_detail::fused_expression_base<Root>::value_type;
+
+    //! Create an expression from the root of a fused expression.
+    //!
+    //! \param[in] root Fused expression root.
+    //! \param[in] evaluator Expression evaluator to be used for globally
+    //!                      updating the expression.
+    fused_expression(Root root, EvaluatorType const & evaluator) :
+        expr_detail::fused_expression_base<Root>(std::move(root)),
+        evaluator_ { evaluator }
+    {
+        expression_id_ = evaluator_.insert(this);
+        this->subscribe_leaves([this]() {
+            if(EvaluatorType::tracks_changes)
+                evaluator_.changed(expression_id_);
+        });
+    }
+
+    //! Evaluate the expression, if it has changed.
+    void eval() { this->eval_if_dirty(); }
+
+    //! Evaluate the expression, if it has changed, without notifying the
+    //! value.
+    void prepare() { this->prepare_result(); }
+
+    //! Notify the value of the result computed by prepare().
+    void deliver() { this->deliver_result(); }
+
+    virtual void set_value_notifier(std::function<void(value_type &&)> const & notifier) override
+    {
+        expr_detail::fused_expression_base<Root>::set_value_notifier(notifier);
+        evaluator_.ready(expression_id_);
+    }
+
+    //! Destructor.
+    virtual ~fused_expression() override { evaluator_.remove(expression_id_); }
+
+private:
+    EvaluatorType evaluator_;
+    typename EvaluatorType::id expression_id_;
+};
+
+//! Specialized fused expression that is evaluated immediately, whenever one of
+//! its values changes.
+//!
+//! \see fused_expression<Root, EvaluatorType>
+//! \ingroup observable_detail
+template <typename Root>
+class fused_expression<Root, immediate_evaluator> final :
+    public expr_detail::fused_expression_base<Root>
+{
+public:
+    //! Create an expression from the root of a fused expression.
+    //!
+    //! \param[in] root Fused expression root.
+    explicit fused_expression(Root root) :
+        expr_detail::fused_expression_base<Root>(std::move(root))
+    {
+        this->subscribe_leaves([this]() { schedule(); });
+    }
+
+    //! Destructor.
+    virtual ~fused_expression() override
+    {
+        if(scheduled_)
+            detail::propagation::cancel(this);
+    }
+
+private:
+    //! Evaluate the expression once the change has been fully propagated.
+    void schedule()
+    {
+        if(scheduled_)
+            return;
+
+        scheduled_ = detail::propagation::schedule(this->tree_rank(),
+                                                   this,
+                                                   &run_scheduled);
+        if(!scheduled_)
+            this->eval_if_dirty();
+    }
+
+    static void run_scheduled(void * target, bool run)
+    {
+        auto const e = static_cast<fused_expression *>(target);
+        e->scheduled_ = false;
+
+        if(run)
+            e->eval_if_dirty();
+    }
+
+private:
+    bool scheduled_ { false };
+};
+
+//! Create a fused unary operator.
+//!
+//! \ingroup observable_detail
+#define OBSERVABLE_DEFINE_FUSED_UNARY_OP(OP) \
+template <typename T, typename = std::enable_if_t<is_fused_expression<T>::value>> \
+inline auto operator OP (T && arg) \
+{ \
+    return expr_detail::make_fused_node([](auto && v) { return (OP v); }, \
+                                        std::forward<T>(arg)); \
+}
+
+//! Create a fused binary operator.
+//!
+//! \ingroup observable_detail
+#define OBSERVABLE_DEFINE_FUSED_BINARY_OP(OP) \
+template <typename A, typename B, \
+          typename = std::enable_if_t<expr_detail::are_fusable<A, B>::value>> \
+inline auto operator OP (A && a, B && b) \
+{ \
+    return expr_detail::make_fused_node( \
+                [](auto && av, auto && bv) { return (av OP bv); }, \
+                std::forward<A>(a), std::forward<B>(b)); \
+}
+
+//! Create a fused binary operator that only evaluates its second operand if
+//! the first one does not decide the result.
+//!
+//! \ingroup observable_detail
+#define OBSERVABLE_DEFINE_FUSED_LAZY_BINARY_OP(OP) \
+template <typename A, typename B, \
+          typename = std::enable_if_t<expr_detail::are_fusable<A, B>::value>> \
+inline auto operator OP (A && a, B && b) \
+{ \
+    auto op = [](auto && av, auto && bv) { return (av() OP bv()); }; \
+    return expr_detail::make_fused_node( \
+                expr_detail::fused_lazy_op<decltype(op)> { op }, \
+                std::forward<A>(a), std::forward<B>(b)); \
+}
+
+// Unary operators.
+
+OBSERVABLE_DEFINE_FUSED_UNARY_OP(!)
+OBSERVABLE_DEFINE_FUSED_UNARY_OP(~)
+OBSERVABLE_DEFINE_FUSED_UNARY_OP(+)
+OBSERVABLE_DEFINE_FUSED_UNARY_OP(-)
+
+// Binary operators.
+
+OBSERVABLE_DEFINE_FUSED_BINARY_OP(*)
+OBSERVABLE_DEFINE_FUSED_BINARY_OP(/)
+OBSERVABLE_DEFINE_FUSED_BINARY_OP(%)
+OBSERVABLE_DEFINE_FUSED_BINARY_OP(+)
+OBSERVABLE_DEFINE_FUSED_BINARY_OP(-)
+OBSERVABLE_DEFINE_FUSED_BINARY_OP(<<)
+OBSERVABLE_DEFINE_FUSED_BINARY_OP(>>)
+OBSERVABLE_DEFINE_FUSED_BINARY_OP(<)
+OBSERVABLE_DEFINE_FUSED_BINARY_OP(<=)
+OBSERVABLE_DEFINE_FUSED_BINARY_OP(>)
+OBSERVABLE_DEFINE_FUSED_BINARY_OP(>=)
+OBSERVABLE_DEFINE_FUSED_BINARY_OP(==)
+OBSERVABLE_DEFINE_FUSED_BINARY_OP(!=)
+OBSERVABLE_DEFINE_FUSED_BINARY_OP(&)
+OBSERVABLE_DEFINE_FUSED_BINARY_OP(^)
+OBSERVABLE_DEFINE_FUSED_BINARY_OP(|)
+OBSERVABLE_DEFINE_FUSED_LAZY_BINARY_OP(&&)
+OBSERVABLE_DEFINE_FUSED_LAZY_BINARY_OP(||)
+
+} }
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
@@ -0,0 +1,252 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <initializer_list>
+#include <iomanip>
+#include <ios>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <observable/expressions/tree.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable { inline namespace expr {
+
+//! Profiling counters of an expression node.
+//!
+//! \see start_profiling()
+//! \ingroup observable_expressions
+struct node_profile
+{
+    //! Number of times the node has been evaluated.
+    std::size_t visits = 0;
+
+    //! Number of evaluations that found the node dirty, and computed its
+    //! result.
+    std::size_t evaluations = 0;
+
+    //! Time spent computing the node's result. This includes the time spent
+    //! evaluating the node's dirty children.
+    std::chrono::nanoseconds time { 0 };
+
+    //! Fraction of the evaluations that found the node dirty.
+    //!
+    //! Nodes with a low ratio are evaluated much more often than they change;
+    //! nodes with a high ratio and a high time are worth caching or sharing.
+    auto dirty_ratio() const noexcept
+    {
+        return visits ? static_cast<double>(evaluations) / static_cast<double>(visits)
+                      : 0.0;
+    }
+};
+
+//! Description of a node inside an expression graph.
+//!
+//! \see describe_graph()
+//! \ingroup observable_expressions
+struct node_description
+{
+    //! Identifies the node. Nodes that are shared by multiple expressions have
+    //! the same id everywhere.
+    void const * id = nullptr;
+
+    //! Name of the node's operation.
+    //!
+    //! \see expression_node::name()
+    char const * name = nullptr;
+
+    //! Height of the node inside its tree.
+    std::size_t rank = 0;
+
+    //! Number of subscribers of the node, including its parents.
+    std::size_t subscribers = 0;
+
+    //! Number of parents the node has inside the described graph.
+    std::size_t parents = 0;
+
+    //! Ids of the node's children, in operand order.
+    std::vector<void const *> children;
+
+    //! The node's profiling counters.
+    node_profile profile;
+};
+
+//! Start collecting profiling counters for all expression nodes.
+//!
+//! While profiling is stopped, evaluating a node costs a single extra branch.
+//!
+//! \ingroup observable_expressions
+inline void start_profiling() noexcept
+{
+    expr_detail::profiling_flag().store(true, std::memory_order_relaxed);
+}
+
+//! Stop collecting profiling counters. Counters keep their values.
+//!
+//! \ingroup observable_expressions
+inline void stop_profiling() noexcept
+{
+    expr_detail::profiling_flag().store(false, std::memory_order_relaxed);
+}
+
+//! \cond
+namespace expr_detail {
+
+    inline auto profile_of(node_base const & n) noexcept
+    {
+        auto p = node_profile { };
+        p.visits = n.visits.load(std::memory_order_relaxed);
+        p.evaluations = n.evaluations.load(std::memory_order_relaxed);
+        p.time = std::chrono::nanoseconds { n.eval_time.load(std::memory_order_relaxed) };
+        return p;
+    }
+
+    inline auto describe_graph(std::initializer_list<node_base const *> roots)
+        -> std::vector<node_description>
+    {
+        auto nodes = std::vector<node_description> { };
+        auto found = std::vector<node_base const *> { };
+        auto index = std::unordered_map<node_base const *, std::size_t> { };
+
+        auto const add = [&](node_base const & n) {
+            auto const inserted = index.emplace(&n, nodes.size());
+            if(!inserted.second)
+                return inserted.first->second;
+
+            auto d = node_description { };
+            d.id = &n;
+            d.name = n.name;
+            d.rank = n.rank;
+            d.subscribers = n.size();
+            d.profile = profile_of(n);
+
+            nodes.push_back(std::move(d));
+            found.push_back(&n);
+            return nodes.size() - 1;
+        };
+
+        for(auto && r : roots)
+            add(*r);
+
+        // Breadth-first, so deep trees do not recurse.
+        for(auto i = std::size_t { 0 }; i < found.size(); ++i)
+            found[i]->for_each_child([&](node_base const & child) {
+                auto const c = add(child);
+                nodes[c].parents += 1;
+                nodes[i].children.push_back(&child);
+            });
+
+        std::stable_sort(nodes.begin(), nodes.end(),
+                         [](auto && a, auto && b) { return a.rank > b.rank; });
+        return nodes;
+    }
+
+    inline void reset_profile(std::initializer_list<node_base const *> roots)
+    {
+        for(auto && d : describe_graph(roots))
+            static_cast<node_base const *>(d.id)->reset_profile();
+    }
+
+    inline void write_graph(std::ostream & out,
+                            std::initializer_list<node_base const *> roots)
+    {
+        auto const nodes = describe_graph(roots);
+
+        auto ids = std::unordered_map<void const *, std::size_t> { };
+        for(auto && d : nodes)
+            ids.emplace(d.id, ids.size());
+
+        auto const write_string = [&](char const * s) {
+            for(; *s; ++s)
+            {
+                if(*s == '"' || *s == '\\')
+                    out << '\\';
+                out << *s;
+            }
+        };
+
+        auto const flags = out.flags();
+        auto const precision = out.precision();
+        out << std::fixed << std::setprecision(3);
+
+        out << "digraph expression {\n";
+        for(auto && d : nodes)
+        {
+            out << "    n" << ids[d.id] << " [label=\"";
+            write_string(d.name);
+            out << "\\nrank " << d.rank
+                << ", " << d.subscribers << " subscribers"
+                << "\\n" << d.profile.evaluations << " evaluations / "
+                << d.profile.visits << " visits ("
+                << 100.0 * d.profile.dirty_ratio() << "% dirty)"
+                << "\\n" << static_cast<double>(d.profile.time.count()) / 1000.0
+                << " us\"];\n";
+
+            for(auto && c : d.children)
+                out << "    n" << ids[d.id] << " -> n" << ids[c] << ";\n";
+        }
+        out << "}\n";
+
+        out.flags(flags);
+        out.precision(precision);
+    }
+}
+//! \endcond
+
+//! Describe all nodes reachable from a number of root nodes.
+//!
+//! Each node is described once, even if it is shared by multiple roots or
+//! reached through multiple paths. Nodes are sorted by decreasing rank, so
+//! parents come before their children.
+//!
+//! Expression nodes are shallow copies, so you can keep a copy of a root to
+//! inspect it after it has been passed to observe().
+//!
+//! \param roots Expression nodes to start from.
+//! \return Descriptions of all reachable nodes.
+//!
+//! \warning Profiling counters are read without stopping concurrent
+//!          evaluations, so they can be slightly out of sync with each other.
+//! \ingroup observable_expressions
+template <typename ... ResultType>
+inline auto describe_graph(expression_node<ResultType> const & ... roots)
+    -> std::vector<node_description>
+{
+    return expr_detail::describe_graph({ &roots.base() ... });
+}
+
+//! Reset the profiling counters of all nodes reachable from a number of root
+//! nodes.
+//!
+//! \param roots Expression nodes to start from.
+//! \ingroup observable_expressions
+template <typename ... ResultType>
+inline void reset_profile(expression_node<ResultType> const & ... roots)
+{
+    expr_detail::reset_profile({ &roots.base() ... });
+}
+
+//! Write all nodes reachable from a number of root nodes as a Graphviz graph.
+//!
+//! Each node is labeled with its name, rank, number of subscribers and
+//! profiling counters. Edges go from parents to their children.
+//!
+//! \param out Stream the graph will be written to.
+//! \param roots Expression nodes to start from.
+//! \see describe_graph()
+//! \ingroup observable_expressions
+template <typename ... ResultType>
+inline void write_graph(std::ostream & out,
+                        expression_node<ResultType> const & ... roots)
+{
+    expr_detail::write_graph(out, { &roots.base() ... });
+}
+
+} }
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
@@ -15,7 +15,7 @@ inline auto operator OP (value<T ...> & arg) \
     noexcept(noexcept(OP arg.get())) \
     -> expression_node<std::decay_t<decltype(OP arg.get())>> \
 { \
-    return expr_detail::make_node([](auto && v) { return (OP v); }, arg); \
+    return expr_detail::make_named_node(#OP, [](auto && v) { return (OP v); }, arg); \
 } \
 \
 template <typename T> \
@@ -23,22 +23,23 @@ inline auto operator OP (expression_node<T> && arg) \
     noexcept(noexcept(OP arg.get())) \
     -> expression_node<std::decay_t<decltype(OP arg.get())>> \
 { \
-    return expr_detail::make_node([](auto && v) { return (OP v); }, \
-                                  std::move(arg)); \
+    return expr_detail::make_named_node(#OP, [](auto && v) { return (OP v); }, \
+                                             std::move(arg)); \
 }
 
-//! Create a binary operator.
+//! Create a binary operator whose nodes are built by ``MAKE_NODE``, from the
+//! callable passed as the remaining argument.
 //!
 //! \ingroup observable_detail
-#define OBSERVABLE_DEFINE_BINARY_OP(OP) \
+#define OBSERVABLE_DEFINE_BINARY_OP_IMPL(OP, MAKE_NODE, ...) \
 template <typename B, typename ... A> \
 inline auto operator OP (value<A ...> & a, B && b) \
     noexcept(noexcept(a.get() OP b)) \
     -> std::enable_if_t<!expr_detail::is_observable<B>::value, \
                         expression_node<decltype(a.get() OP b)>> \
 { \
-    return expr_detail::make_node([](auto && av, auto && bv) { return (av OP bv); }, \
-                                  a, std::forward<B>(b)); \
+    return MAKE_NODE(#OP, __VA_ARGS__, \
+                     a, std::forward<B>(b)); \
 } \
 \
 template <typename A, typename ... B> \
@@ -47,8 +48,8 @@ inline auto operator OP (A && a, value<B ...> & b) \
     -> std::enable_if_t<!expr_detail::is_observable<A>::value, \
                         expression_node<decltype(a OP b.get())>> \
 { \
-    return expr_detail::make_node([](auto && av, auto && bv) { return (av OP bv); }, \
-                                  std::forward<A>(a), b); \
+    return MAKE_NODE(#OP, __VA_ARGS__, \
+                     std::forward<A>(a), b); \
 } \
 \
 template <typename A, typename B> \
@@ -56,8 +57,8 @@ inline auto operator OP (value<A> & a, value<B> & b) \
     noexcept(noexcept(a.get() OP b.get())) \
     -> expression_node<decltype(a.get() OP b.get())> \
 { \
-    return expr_detail::make_node([](auto && av, auto && bv) { return (av OP bv); }, \
-                                  a, b); \
+    return MAKE_NODE(#OP, __VA_ARGS__, \
+                     a, b); \
 } \
 \
 template <typename A, typename Enc1, \
@@ -66,8 +67,8 @@ inline auto operator OP (value<A, Enc1> & a, value<B, Enc2> & b) \
     noexcept(noexcept(a.get() OP b.get())) \
     -> expression_node<decltype(a.get() OP b.get())> \
 { \
-    return expr_detail::make_node([](auto && av, auto && bv) { return (av OP bv); }, \
-                                  a, b); \
+    return MAKE_NODE(#OP, __VA_ARGS__, \
+                     a, b); \
 } \
 \
 template <typename A, typename B> \
@@ -76,8 +77,8 @@ inline auto operator OP (expression_node<A> && a, B && b) \
     -> std::enable_if_t<!expr_detail::is_observable<B>::value, \
                         expression_node<decltype(a.get() OP b)>> \
 { \
-    return expr_detail::make_node([](auto && av, auto && bv) { return (av OP bv); }, \
-                                  std::move(a), std::forward<B>(b)); \
+    return MAKE_NODE(#OP, __VA_ARGS__, \
+                     std::move(a), std::forward<B>(b)); \
 } \
 \
 template <typename A, typename B> \
@@ -86,8 +87,8 @@ inline auto operator OP (A && a, expression_node<B> && b) \
     -> std::enable_if_t<!expr_detail::is_observable<A>::value, \
                         expression_node<decltype(a OP b.get())>> \
 { \
-    return expr_detail::make_node([](auto && av, auto && bv) { return (av OP bv); }, \
-                                  std::forward<A>(a), std::move(b)); \
+    return MAKE_NODE(#OP, __VA_ARGS__, \
+                     std::forward<A>(a), std::move(b)); \
 } \
 \
 template <typename A, typename B> \
@@ -95,8 +96,8 @@ inline auto operator OP (expression_node<A> && a, expression_node<B> && b) \
     noexcept(noexcept(a.get() OP b.get())) \
     -> expression_node<decltype(a.get() OP b.get())> \
 { \
-    return expr_detail::make_node([](auto && av, auto && bv) { return (av OP bv); }, \
-                                  std::move(a), std::move(b)); \
+    return MAKE_NODE(#OP, __VA_ARGS__, \
+                     std::move(a), std::move(b)); \
 } \
 \
 template <typename B, typename ... A> \
@@ -104,8 +105,8 @@ inline auto operator OP (value<A ...> & a, expression_node<B> && b) \
     noexcept(noexcept(a.get() OP b.get())) \
     -> expression_node<decltype(a.get() OP b.get())> \
 { \
-    return expr_detail::make_node([](auto && av, auto && bv) { return (av OP bv); }, \
-                                  a, std::move(b)); \
+    return MAKE_NODE(#OP, __VA_ARGS__, \
+                     a, std::move(b)); \
 } \
 \
 template <typename A, typename ... B> \
@@ -113,10 +114,28 @@ inline auto operator OP (expression_node<A> && a, value<B ...> & b) \
     noexcept(noexcept(a.get() OP b.get())) \
     -> expression_node<decltype(a.get() OP b.get())> \
 { \
-    return expr_detail::make_node([](auto && av, auto && bv) { return (av OP bv); }, \
-                                  std::move(a), b); \
+    return MAKE_NODE(#OP, __VA_ARGS__, \
+                     std::move(a), b); \
 }
 
+//! Create a binary operator.
+//!
+//! \ingroup observable_detail
+#define OBSERVABLE_DEFINE_BINARY_OP(OP) \
+OBSERVABLE_DEFINE_BINARY_OP_IMPL(OP, expr_detail::make_named_node, \
+                                 [](auto && av, auto && bv) { return (av OP bv); })
+
+//! Create a binary operator that only evaluates its second operand if the
+//! first one does not determine the result.
+//!
+//! Changes to the second operand do not trigger an update while it is not
+//! needed.
+//!
+//! \ingroup observable_detail
+#define OBSERVABLE_DEFINE_SHORT_CIRCUIT_OP(OP) \
+OBSERVABLE_DEFINE_BINARY_OP_IMPL(OP, expr_detail::make_named_lazy_node, \
+                                 [](auto && av, auto && bv) { return (av() OP bv()); })
+
 namespace observable { inline namespace expr {
 
 // Unary operators.
@@ -144,8 +163,11 @@ OBSERVABLE_DEFINE_BINARY_OP(!=)
 OBSERVABLE_DEFINE_BINARY_OP(&)
 OBSERVABLE_DEFINE_BINARY_OP(^)
 OBSERVABLE_DEFINE_BINARY_OP(|)
-OBSERVABLE_DEFINE_BINARY_OP(&&)
-OBSERVABLE_DEFINE_BINARY_OP(||)
+
+// Short-circuiting operators.
+
+OBSERVABLE_DEFINE_SHORT_CIRCUIT_OP(&&)
+OBSERVABLE_DEFINE_SHORT_CIRCUIT_OP(||)
 
 } }
 
@@ -0,0 +1,279 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <observable/expressions/tree.hpp>
+#include <observable/expressions/utility.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable { inline namespace expr {
+
+//! \cond
+namespace filter_detail {
+
+    //! Fixed-capacity double-ended queue, stored in a ring buffer.
+    template <typename ValueType>
+    class ring_buffer
+    {
+    public:
+        explicit ring_buffer(std::size_t capacity) : items_(capacity) { }
+
+        auto empty() const noexcept { return count_ == 0; }
+        auto full() const noexcept { return count_ == items_.size(); }
+
+        auto front() const noexcept -> ValueType const & { return items_[first_]; }
+        auto back() const noexcept -> ValueType const & { return items_[at(count_ - 1)]; }
+
+        void push_back(ValueType v)
+        {
+            items_[at(count_)] = std::move(v);
+            ++count_;
+        }
+
+        void pop_front() noexcept
+        {
+            first_ = at(1);
+            --count_;
+        }
+
+        void pop_back() noexcept { --count_; }
+
+    private:
+        auto at(std::size_t offset) const noexcept
+        {
+            auto const i = first_ + offset;
+            return i < items_.size() ? i : i - items_.size();
+        }
+
+        std::vector<ValueType> items_;
+        std::size_t first_ { 0 };
+        std::size_t count_ { 0 };
+    };
+
+    template <typename AccType, typename Fun>
+    struct scan_
+    {
+        template <typename Val>
+        auto operator()(Val && val) -> AccType
+        {
+            acc = fun(std::move(acc), std::forward<Val>(val));
+            return acc;
+        }
+
+        AccType acc;
+        Fun fun;
+    };
+
+    template <typename ValueType>
+    struct ema_
+    {
+        auto operator()(ValueType const & val) -> double
+        {
+            auto const v = static_cast<double>(val);
+            result = started ? result + alpha * (v - result) : v;
+            started = true;
+            return result;
+        }
+
+        double alpha;
+        double result { 0.0 };
+        bool started { false };
+    };
+
+    template <typename ValueType>
+    struct rolling_mean_
+    {
+        explicit rolling_mean_(std::size_t size) : window { size } { }
+
+        auto operator()(ValueType const & val) -> double
+        {
+            if(window.full())
+            {
+                sum -= window.front();
+                window.pop_front();
+            }
+            else
+            {
+                ++count;
+            }
+
+            sum += val;
+            window.push_back(val);
+            return static_cast<double>(sum) / static_cast<double>(count);
+        }
+
+        ring_buffer<ValueType> window;
+        ValueType sum { };
+        std::size_t count { 0 };
+    };
+
+    //! Keeps the window's candidates for the extreme, in sample order. Each
+    //! candidate is more extreme than all the samples after it, so the front
+    //! is the extreme of the window.
+    template <typename ValueType, typename Compare>
+    struct rolling_extreme_
+    {
+        explicit rolling_extreme_(std::size_t window_size) :
+            size { window_size },
+            candidates { window_size }
+        { }
+
+        auto operator()(ValueType const & val) -> ValueType
+        {
+            if(!candidates.empty() && candidates.front().index + size <= next)
+                candidates.pop_front();
+
+            while(!candidates.empty() && !compare(candidates.back().value, val))
+                candidates.pop_back();
+
+            candidates.push_back(sample { next++, val });
+            return candidates.front().value;
+        }
+
+        struct sample
+        {
+            std::size_t index;
+            ValueType value;
+        };
+
+        std::size_t size;
+        ring_buffer<sample> candidates;
+        std::size_t next { 0 };
+        Compare compare { };
+    };
+}
+//! \endcond
+
+//! Accumulate the values taken by an expression.
+//!
+//! Each time the node is evaluated with a new input, the accumulated value is
+//! replaced by ``fun(accumulated, input)``. The initial input is accumulated
+//! when the node is created.
+//!
+//! Inputs are only seen when the node is evaluated, so changes made between
+//! two updates of an expression count as one input.
+//!
+//! \param expr Value or expression node to accumulate.
+//! \param init Initial accumulated value.
+//! \param fun Functor compatible with ``Acc (Acc, ValueType const &)``, where
+//!            ``Acc`` is the decayed type of ``init``.
+//! \return Expression node that contains the accumulated value.
+//!
+//! \ingroup observable_expressions
+template <typename Expr, typename Init, typename Fun>
+inline auto scan(Expr && expr, Init && init, Fun && fun)
+    -> std::enable_if_t<expr_detail::is_observable<Expr>::value,
+                        expression_node<std::decay_t<Init>>>
+{
+    using op = filter_detail::scan_<std::decay_t<Init>, std::decay_t<Fun>>;
+    return expr_detail::make_named_node("scan",
+                                        op { std::forward<Init>(init),
+                                             std::forward<Fun>(fun) },
+                                        std::forward<Expr>(expr));
+}
+
+//! Exponential moving average of the values taken by an expression.
+//!
+//! Each new input ``x`` moves the average by ``alpha * (x - average)``; the
+//! first input is taken as is. Updating the average takes constant time.
+//!
+//! \param expr Value or expression node to average. Its values must be
+//!             convertible to double.
+//! \param alpha Weight of each new input, between 0 and 1.
+//! \return Expression node that contains the average, as a double.
+//!
+//! \see scan() for how inputs are counted.
+//! \ingroup observable_expressions
+template <typename Expr>
+inline auto ema(Expr && expr, double alpha)
+    -> std::enable_if_t<expr_detail::is_observable<Expr>::value,
+                        expression_node<double>>
+{
+    using op = filter_detail::ema_<expr_detail::val_type_t<Expr>>;
+    return expr_detail::make_named_node("ema", op { alpha },
+                                        std::forward<Expr>(expr));
+}
+
+//! Mean of the last ``size`` values taken by an expression.
+//!
+//! The values are kept in a ring buffer, along with their sum, so each input
+//! costs one addition and one subtraction. Until ``size`` inputs have been
+//! seen, the mean is taken over the inputs seen so far.
+//!
+//! \note For floating-point values, rounding errors can add up over many
+//!       inputs.
+//!
+//! \param expr Value or expression node to average.
+//! \param size Number of inputs in the window. Must be greater than zero.
+//! \return Expression node that contains the mean, as a double.
+//!
+//! \see scan() for how inputs are counted.
+//! \ingroup observable_expressions
+template <typename Expr>
+inline auto rolling_mean(Expr && expr, std::size_t size)
+    -> std::enable_if_t<expr_detail::is_observable<Expr>::value,
+                        expression_node<double>>
+{
+    using value_type = expr_detail::val_type_t<Expr>;
+    assert(size > 0);
+
+    return expr_detail::make_named_node("rolling_mean",
+                                        filter_detail::rolling_mean_<value_type> { size },
+                                        std::forward<Expr>(expr));
+}
+
+//! Smallest of the last ``size`` values taken by an expression.
+//!
+//! Only the values that can still become the minimum are kept, so each input
+//! takes amortized constant time, whatever the window's size.
+//!
+//! \param expr Value or expression node whose minimum is computed. Its values
+//!             must be comparable with the less-than operator.
+//! \param size Number of inputs in the window. Must be greater than zero.
+//! \return Expression node that contains the minimum.
+//!
+//! \see scan() for how inputs are counted.
+//! \ingroup observable_expressions
+template <typename Expr>
+inline auto rolling_min(Expr && expr, std::size_t size)
+    -> std::enable_if_t<expr_detail::is_observable<Expr>::value,
+                        expression_node<expr_detail::val_type_t<Expr>>>
+{
+    using value_type = expr_detail::val_type_t<Expr>;
+    using op = filter_detail::rolling_extreme_<value_type, std::less<value_type>>;
+    assert(size > 0);
+
+    return expr_detail::make_named_node("rolling_min", op { size },
+                                        std::forward<Expr>(expr));
+}
+
+//! Largest of the last ``size`` values taken by an expression.
+//!
+//! \param expr Value or expression node whose maximum is computed. Its values
+//!             must be comparable with the greater-than operator.
+//! \param size Number of inputs in the window. Must be greater than zero.
+//! \return Expression node that contains the maximum.
+//!
+//! \see rolling_min()
+//! \ingroup observable_expressions
+template <typename Expr>
+inline auto rolling_max(Expr && expr, std::size_t size)
+    -> std::enable_if_t<expr_detail::is_observable<Expr>::value,
+                        expression_node<expr_detail::val_type_t<Expr>>>
+{
+    using value_type = expr_detail::val_type_t<Expr>;
+    using op = filter_detail::rolling_extreme_<value_type, std::greater<value_type>>;
+    assert(size > 0);
+
+    return expr_detail::make_named_node("rolling_max", op { size },
+                                        std::forward<Expr>(expr));
+}
+
+} }
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
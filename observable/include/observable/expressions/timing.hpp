@@ -0,0 +1,226 @@
+#pragma once
+#include <chrono>
+#include <type_traits>
+#include <utility>
+#include <observable/detail/type_traits.hpp>
+#include <observable/expressions/tree.hpp>
+#include <observable/expressions/utility.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable { inline namespace expr {
+
+//! \cond
+namespace filter_detail {
+
+    template <typename A, typename B>
+    inline auto equal_values(A const & a, B const & b)
+    {
+        static_assert(detail::are_equality_comparable<A const &, B const &>::value,
+                      "Values must be equality comparable.");
+        return a == b;
+    }
+
+    template <typename ValueType, typename Clock>
+    struct throttle_
+    {
+        template <typename Val, typename ... Tick>
+        auto operator()(Val && val, Tick && ...) -> ValueType
+        {
+            auto const now = Clock::now();
+            if(!started || now - last >= period)
+            {
+                started = true;
+                last = now;
+                result = std::forward<Val>(val);
+            }
+
+            return result;
+        }
+
+        typename Clock::duration period;
+        typename Clock::time_point last { };
+        ValueType result { };
+        bool started { false };
+    };
+
+    template <typename ValueType, typename Clock>
+    struct debounce_
+    {
+        template <typename Val, typename Tick>
+        auto operator()(Val && val, Tick &&) -> ValueType
+        {
+            auto const now = Clock::now();
+            if(!started)
+            {
+                started = true;
+                changed = now;
+                pending = result = std::forward<Val>(val);
+            }
+            else if(!equal_values(pending, val))
+            {
+                changed = now;
+                pending = std::forward<Val>(val);
+            }
+            else if(now - changed >= quiet)
+            {
+                result = pending;
+            }
+
+            return result;
+        }
+
+        typename Clock::duration quiet;
+        typename Clock::time_point changed { };
+        ValueType pending { };
+        ValueType result { };
+        bool started { false };
+    };
+
+    template <typename ValueType, typename TickType>
+    struct sample_
+    {
+        template <typename Val, typename Tick>
+        auto operator()(Val && val, Tick && tick) -> ValueType
+        {
+            if(!started || !equal_values(last_tick, tick))
+            {
+                started = true;
+                last_tick = std::forward<Tick>(tick);
+                result = std::forward<Val>(val);
+            }
+
+            return result;
+        }
+
+        TickType last_tick { };
+        ValueType result { };
+        bool started { false };
+    };
+
+    template <typename Expr>
+    using result_of_t = expression_node<expr_detail::val_type_t<Expr>>;
+}
+//! \endcond
+
+//! Let changes through at most once per time window.
+//!
+//! The first value is passed through immediately and starts a window. Changes
+//! that happen inside the window are dropped; the first change after the
+//! window has passed is let through and starts a new window.
+//!
+//! Because the node's result does not change inside a window, values that
+//! observe the node do not notify their observers.
+//!
+//! \note Dropped changes are not delivered when the window ends, unless the
+//!       input changes again. Use the overload that takes a tick to deliver
+//!       the latest value on the first tick after the window.
+//!
+//! \param expr Value or expression node to throttle.
+//! \param period Minimum time between two changes of the result.
+//! \return Expression node that follows ``expr``, with a limited rate.
+//! \tparam Clock Clock used to measure time. This must satisfy the TrivialClock
+//!               concept.
+//!
+//! \ingroup observable_expressions
+template <typename Clock=std::chrono::steady_clock,
+          typename Expr, typename Rep, typename Period>
+inline auto throttle(Expr && expr, std::chrono::duration<Rep, Period> period)
+    -> std::enable_if_t<expr_detail::is_observable<Expr>::value,
+                        filter_detail::result_of_t<Expr>>
+{
+    using op = filter_detail::throttle_<expr_detail::val_type_t<Expr>, Clock>;
+    return expr_detail::make_named_node("throttle",
+                op { std::chrono::duration_cast<typename Clock::duration>(period) },
+                std::forward<Expr>(expr));
+}
+
+//! Let changes through at most once per time window, also re-checking the
+//! window whenever a tick changes.
+//!
+//! This works like throttle(Expr &&, std::chrono::duration<Rep, Period>), but
+//! a change of ``tick`` (for example, a frame counter) also lets the latest
+//! value through, if the window has passed.
+//!
+//! \param expr Value or expression node to throttle.
+//! \param period Minimum time between two changes of the result.
+//! \param tick Value or expression node whose changes re-check the window.
+//! \return Expression node that follows ``expr``, with a limited rate.
+//! \tparam Clock Clock used to measure time.
+//!
+//! \ingroup observable_expressions
+template <typename Clock=std::chrono::steady_clock,
+          typename Expr, typename Rep, typename Period, typename Tick>
+inline auto throttle(Expr && expr,
+                     std::chrono::duration<Rep, Period> period,
+                     Tick && tick)
+    -> std::enable_if_t<expr_detail::is_observable<Expr>::value &&
+                        expr_detail::is_observable<Tick>::value,
+                        filter_detail::result_of_t<Expr>>
+{
+    using op = filter_detail::throttle_<expr_detail::val_type_t<Expr>, Clock>;
+    return expr_detail::make_named_node("throttle",
+                op { std::chrono::duration_cast<typename Clock::duration>(period) },
+                std::forward<Expr>(expr),
+                std::forward<Tick>(tick));
+}
+
+//! Only let a change through once the input has stopped changing.
+//!
+//! The result takes the input's value once the input has kept the same value
+//! for at least ``quiet``. Since nothing happens when an input stays
+//! unchanged, the time is checked whenever ``tick`` changes (for example, a
+//! frame counter or a timer's value).
+//!
+//! \param expr Value or expression node to debounce. Its type must be equality
+//!             comparable.
+//! \param quiet Time the input must remain unchanged.
+//! \param tick Value or expression node whose changes check the time.
+//! \return Expression node that follows ``expr`` once it settles.
+//! \tparam Clock Clock used to measure time.
+//!
+//! \ingroup observable_expressions
+template <typename Clock=std::chrono::steady_clock,
+          typename Expr, typename Rep, typename Period, typename Tick>
+inline auto debounce(Expr && expr,
+                     std::chrono::duration<Rep, Period> quiet,
+                     Tick && tick)
+    -> std::enable_if_t<expr_detail::is_observable<Expr>::value &&
+                        expr_detail::is_observable<Tick>::value,
+                        filter_detail::result_of_t<Expr>>
+{
+    using op = filter_detail::debounce_<expr_detail::val_type_t<Expr>, Clock>;
+    return expr_detail::make_named_node("debounce",
+                op { std::chrono::duration_cast<typename Clock::duration>(quiet) },
+                std::forward<Expr>(expr),
+                std::forward<Tick>(tick));
+}
+
+//! Take the value of an expression each time a tick changes.
+//!
+//! Changes of ``expr`` between ticks are ignored; the result only changes when
+//! ``tick`` does, to the value ``expr`` has at that moment.
+//!
+//! \param expr Value or expression node to sample.
+//! \param tick Value or expression node that triggers sampling. Its type must
+//!             be equality comparable.
+//! \return Expression node having the value of ``expr`` at the last tick.
+//!
+//! \ingroup observable_expressions
+template <typename Expr, typename Tick>
+inline auto sample(Expr && expr, Tick && tick)
+    -> std::enable_if_t<expr_detail::is_observable<Expr>::value &&
+                        expr_detail::is_observable<Tick>::value,
+                        filter_detail::result_of_t<Expr>>
+{
+    using op = filter_detail::sample_<expr_detail::val_type_t<Expr>,
+                                      expr_detail::val_type_t<Tick>>;
+    return expr_detail::make_named_node("sample", op { },
+                                        std::forward<Expr>(expr),
+                                        std::forward<Tick>(tick));
+}
+
+} }
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
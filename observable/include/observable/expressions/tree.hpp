@@ -1,6 +1,11 @@
 #pragma once
-#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <thread>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -8,6 +13,8 @@
 #include <observable/subject.hpp>
 #include <observable/subscription.hpp>
 #include <observable/value.hpp>
+#include <observable/detail/inline_function.hpp>
+#include <observable/expressions/arena.hpp>
 
 #include <observable/detail/compiler_config.hpp>
 OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
@@ -19,6 +26,141 @@ template <typename T>
 struct is_expression_node;
 //! \endcond
 
+namespace expr_detail {
+
+//! Flag that turns node profiling on.
+//!
+//! \ingroup observable_detail
+inline auto profiling_flag() noexcept -> std::atomic<bool> &
+{
+    static std::atomic<bool> flag { false };
+    return flag;
+}
+
+//! Flag that stops n-ary nodes created by the calling thread from being
+//! evaluated by their constructor.
+//!
+//! Lazy expressions set it while their tree is built, so nothing is computed
+//! before the result is needed.
+//!
+//! \ingroup observable_detail
+inline auto defer_eval_flag() noexcept -> bool &
+{
+    static thread_local bool flag = false;
+    return flag;
+}
+
+//! Sets the \ref defer_eval_flag() for the lifetime of the object.
+//!
+//! \ingroup observable_detail
+class defer_eval_scope final
+{
+public:
+    defer_eval_scope() noexcept : previous_ { defer_eval_flag() }
+    {
+        defer_eval_flag() = true;
+    }
+
+    ~defer_eval_scope() noexcept { defer_eval_flag() = previous_; }
+
+    defer_eval_scope(defer_eval_scope const &) =delete;
+    auto operator=(defer_eval_scope const &) -> defer_eval_scope & =delete;
+
+private:
+    bool previous_;
+};
+
+//! Tag for n-ary nodes whose operation evaluates its operands on demand.
+//!
+//! \see expression_node::expression_node(lazy_operands_tag, OpType &&, expression_node<ValueType> && ...)
+//! \ingroup observable_detail
+struct lazy_operands_tag { };
+
+//! Operand of a lazily-evaluated n-ary node.
+//!
+//! Calling the operand evaluates its node and returns the node's result. Only
+//! changes to operands that have been called during the last evaluation make
+//! the parent node dirty.
+//!
+//! \ingroup observable_detail
+template <typename Node>
+struct lazy_operand
+{
+    auto operator()() const -> decltype(std::declval<Node &>().get())
+    {
+        // Tracked before evaluating, so changes made meanwhile are not lost.
+        tracked.fetch_or(1u << index, std::memory_order_relaxed);
+        node.eval();
+        return node.get();
+    }
+
+    Node & node;
+    std::atomic<unsigned> & tracked;
+    unsigned index;
+};
+
+//! Part of an expression node that does not depend on the node's result type.
+//!
+//! It records the node's place inside its tree and, while profiling is on,
+//! how often and for how long the node has been evaluated.
+//!
+//! \ingroup observable_detail
+struct node_base : subject<void()>
+{
+    //! Create a node that stores its children with the provided allocator.
+    explicit node_base(arena_allocator<node_base const *> const & a) :
+        more_children { a }
+    { }
+
+    //! Call a functor with each child node.
+    template <typename Fun>
+    void for_each_child(Fun && fun) const
+    {
+        for(auto i = std::size_t { 0 }; i < child_count && i < inline_children; ++i)
+            fun(*first_children[i]);
+
+        for(auto && c : more_children)
+            fun(*c);
+    }
+
+    //! Add a child node.
+    void add_child(node_base const & child)
+    {
+        if(child_count < inline_children)
+            first_children[child_count] = &child;
+        else
+            more_children.push_back(&child);
+
+        ++child_count;
+    }
+
+    //! Reset the profiling counters to zero.
+    void reset_profile() const noexcept
+    {
+        visits.store(0, std::memory_order_relaxed);
+        evaluations.store(0, std::memory_order_relaxed);
+        eval_time.store(0, std::memory_order_relaxed);
+    }
+
+    static constexpr std::size_t inline_children = 3;
+
+    char const * name = "node";
+    std::size_t rank = 0;
+
+    std::size_t child_count = 0;
+    node_base const * first_children[inline_children] { };
+    std::vector<node_base const *,
+                arena_allocator<node_base const *>> more_children;
+
+    // Number of evaluations that found the node clean or dirty, number of
+    // evaluations that found it dirty and time spent computing its result.
+    mutable std::atomic<std::size_t> visits { 0 };
+    mutable std::atomic<std::size_t> evaluations { 0 };
+    mutable std::atomic<std::chrono::nanoseconds::rep> eval_time { 0 };
+};
+
+}
+
 //! Expression nodes can form a tree to evaluate arbitrary expressions.
 //!
 //! Expressions are formed from n-ary, user-supplied operators and operands.
@@ -29,9 +171,16 @@ struct is_expression_node;
 //! value<ValueType, EqualityComparator> contained in the tree will be propagated
 //! upward, to the root node.
 //!
+//! Nodes only notify their subscribers when they go from clean to dirty, so a
+//! change reaches each node at most once before it is evaluated, even if the
+//! node can be reached through multiple paths.
+//!
 //! When evaluating the root node, only nodes that have been changed will be
 //! evaluated.
 //!
+//! Nodes that are created while an \ref expression_arena is in scope store
+//! their data inside that arena.
+//!
 //! \warning None of the methods in this class can be safely called concurrently.
 //! \ingroup observable_detail
 template <typename ResultType>
@@ -53,8 +202,9 @@ public:
         static_assert(std::is_convertible<ValueType, ResultType>::value,
                       "ValueType must be convertible to ResultType.");
 
+        data_->name = "constant";
         data_->result = std::forward<ValueType>(constant);
-        data_->dirty = false;
+        data_->dirty.store(false);
         data_->eval = []() { };
     }
 
@@ -76,21 +226,17 @@ public:
         static_assert(std::is_convertible<ValueType, ResultType>::value,
                       "ValueType must be convertible to ResultType.");
 
-        auto mark_dirty = [d = data_.get()]() {
-                              d->dirty = true;
-                              d->notify();
-                          };
+        auto mark_dirty = [d = data_.get()]() { d->mark_dirty(); };
 
         auto update_eval = [d = data_.get()](auto & val) {
                                 d->eval = [=, v = &val]() {
-                                    if(!d->dirty)
-                                        return;
-
-                                    d->result = v->get();
-                                    d->dirty = false;
+                                    d->eval_dirty([&]() { return v->get(); });
                                 };
                             };
 
+        data_->name = "value";
+        data_->rank = value.rank();
+        data_->subs.reserve(3);
         data_->subs.emplace_back(value.subscribe(mark_dirty));
         update_eval(value);
 
@@ -118,28 +264,84 @@ public:
     //!
     //! \param[in] nodes ... Expression nodes who's valuewWW will be the operand to the
     //!                      operation.
+    //!
+    //! \note The node is evaluated by this constructor, unless it is built for
+    //!       a lazy expression; see observe_lazy().
     template <typename OpType, typename ... ValueType>
     explicit expression_node(OpType && op, expression_node<ValueType> && ... nodes)
     {
         static_assert(std::is_convertible<decltype(op(ValueType { } ...)), ResultType>::value,
                       "Operation must return a type that is convertible to ResultType.");
 
+        data_->rank = 1 + std::max({ std::size_t { 0 }, nodes.rank() ... });
+        data_->subs.reserve(sizeof...(nodes));
         subscribe_to_nodes(nodes ...);
 
         data_->eval = [t = std::make_tuple(std::move(nodes) ...),
                        o = std::forward<OpType>(op),
                        d = data_.get()]() mutable {
-                          if(!d->dirty)
-                              return;
+                          constexpr auto const size = std::tuple_size<decltype(t)>::value;
+                          constexpr auto const indices = std::make_index_sequence<size> { };
+
+                          d->eval_dirty([&]() { return call_with_tuple(o, t, indices); });
+                      };
 
+        if(!expr_detail::defer_eval_flag())
+            data_->eval();
+    }
+
+    //! Create a new node from a number of nodes and an operation that only
+    //! evaluates the operands it needs.
+    //!
+    //! Nodes created with this constructor are called lazy n-ary nodes. The
+    //! operation is called with a \ref expr_detail::lazy_operand "callable"
+    //! for each node, instead of the node's value:
+    //!
+    //!     [](auto && cond, auto && a, auto && b) { return cond() ? a() : b(); }
+    //!
+    //! Operands that are not called are not evaluated, and their changes do
+    //! not make this node dirty until an evaluation calls them again. They are
+    //! marked dirty as usual, so they are brought up to date when they are
+    //! next needed.
+    //!
+    //! \param[in] op An n-ary operation with the signature below:
+    //!
+    //!                   ResultType (lazy_operand<expression_node<ValueType>> ...)
+    //!
+    //! \param[in] nodes ... Expression nodes that will be the operation's
+    //!                      operands. At most 32 nodes can be provided.
+    //!
+    //! \note The node is evaluated by this constructor, unless it is built for
+    //!       a lazy expression; see observe_lazy().
+    template <typename OpType, typename ... ValueType>
+    explicit expression_node(expr_detail::lazy_operands_tag,
+                             OpType && op,
+                             expression_node<ValueType> && ... nodes)
+    {
+        static_assert(sizeof...(nodes) <= 32, "Too many operands.");
+        static_assert(std::is_convertible<
+                            decltype(op(std::declval<expr_detail::lazy_operand<
+                                            expression_node<ValueType>>>() ...)),
+                            ResultType>::value,
+                      "Operation must return a type that is convertible to ResultType.");
+
+        data_->rank = 1 + std::max({ std::size_t { 0 }, nodes.rank() ... });
+        data_->subs.reserve(sizeof...(nodes));
+        subscribe_to_nodes_lazily(0, nodes ...);
+
+        data_->eval = [t = std::make_tuple(std::move(nodes) ...),
+                       o = std::forward<OpType>(op),
+                       d = data_.get()]() mutable {
                           constexpr auto const size = std::tuple_size<decltype(t)>::value;
                           constexpr auto const indices = std::make_index_sequence<size> { };
 
-                          d->result = call_with_tuple(o, t, indices);
-                          d->dirty = false;
+                          d->eval_dirty([&]() {
+                              return call_lazily(o, t, d->tracked, indices);
+                          });
                       };
 
-        data_->eval();
+        if(!expr_detail::defer_eval_flag())
+            data_->eval();
     }
 
     //! Execute the stored operation and update the node's result value.
@@ -150,12 +352,55 @@ public:
     //! This call will not evaluate the node, so this value might be stale. You
     //! can call eval() to make sure that the expression has an updated result
     //! value.
-    auto get() const { return data_->result; }
+    //!
+    //! The result is returned by reference, so parent nodes can read large
+    //! results without copying them. The reference stays valid for as long as
+    //! the node exists, but the referenced value changes when the node is
+    //! evaluated.
+    auto get() const noexcept -> ResultType const & { return data_->result; }
+
+    //! Retrieve the node's version.
+    //!
+    //! The version starts at zero and is incremented each time the node is
+    //! evaluated while dirty, after its result has been updated. The result is
+    //! not compared, so the version can change while the result stays equal.
+    //!
+    //! The version is atomic, so it can be read from any thread.
+    auto version() const noexcept -> std::uint64_t
+    {
+        return data_->version.load(std::memory_order_acquire);
+    }
 
     //! Subscribe to change notifications from this node.
+    //!
+    //! The observer is called when the node becomes dirty.
     template <typename Observer>
     auto subscribe(Observer && callable) { return data_->subscribe(callable); }
 
+    //! Height of the node inside its tree.
+    //!
+    //! Constant nodes and nodes of regular values have a rank of zero. Nodes
+    //! of values updated by an expression are ranked above that expression's
+    //! tree, and n-ary nodes are ranked above all of their children.
+    auto rank() const noexcept { return data_->rank; }
+
+    //! Name of the node's operation, used by introspection and tracing.
+    //!
+    //! Operators and filters are named after themselves. Other nodes are
+    //! named ``"constant"``, ``"value"`` or ``"node"``.
+    auto name() const noexcept { return data_->name; }
+
+    //! Change the name of the node's operation.
+    //!
+    //! \param new_name Name of the operation. The string must live as long as
+    //!                 the node.
+    void name(char const * new_name) noexcept { data_->name = new_name; }
+
+    //! Retrieve the part of the node that does not depend on its result type.
+    //!
+    //! \see describe_graph()
+    auto base() const noexcept -> expr_detail::node_base const & { return *data_; }
+
 public:
     //! Expression nodes are not default-constructible.
     expression_node() =default;
@@ -180,11 +425,9 @@ private:
     template <typename Head, typename ... Nodes>
     void subscribe_to_nodes(Head & head, Nodes & ... nodes)
     {
+        data_->add_child(head.base());
         data_->subs.emplace_back(
-                    head.subscribe([d = data_.get()]() {
-                                        d->dirty = true;
-                                        d->notify();
-                                    }));
+                    head.subscribe([d = data_.get()]() { d->mark_dirty(); }));
 
         subscribe_to_nodes(nodes ...);
     }
@@ -195,6 +438,25 @@ private:
         // Do nothing.
     }
 
+    template <typename Head, typename ... Nodes>
+    void subscribe_to_nodes_lazily(unsigned index, Head & head, Nodes & ... nodes)
+    {
+        data_->add_child(head.base());
+        data_->subs.emplace_back(
+                    head.subscribe([d = data_.get(), bit = 1u << index]() {
+                        if(d->tracked.load(std::memory_order_relaxed) & bit)
+                            d->mark_dirty();
+                    }));
+
+        subscribe_to_nodes_lazily(index + 1, nodes ...);
+    }
+
+    template <typename ... Nodes>
+    void subscribe_to_nodes_lazily(unsigned)
+    {
+        // Do nothing.
+    }
+
     template <typename Tuple, std::size_t I=0>
     static auto eval_tuple(Tuple & nodes) ->
         std::enable_if_t<I < std::tuple_size<Tuple>::value>
@@ -217,16 +479,118 @@ private:
         return fun(std::get<I>(nodes).get() ...);
     }
 
+    template <typename Fun, typename Tuple, std::size_t ... I>
+    static auto call_lazily(Fun & fun,
+                            Tuple & nodes,
+                            std::atomic<unsigned> & tracked,
+                            std::index_sequence<I ...>)
+    {
+        // The operands called by this evaluation will be tracked again.
+        tracked.store(0, std::memory_order_relaxed);
+
+        using std::get;
+        return fun(expr_detail::lazy_operand<std::tuple_element_t<I, Tuple>> {
+                        get<I>(nodes), tracked, static_cast<unsigned>(I) } ...);
+    }
+
 private:
-    struct data : subject<void()>
+    struct data : expr_detail::node_base
     {
+        explicit data(expr_detail::arena_allocator<data> const & a) :
+            node_base { a },
+            subs { a }
+        { }
+
+        //! Mark the node as dirty and notify subscribers, if it was clean.
+        //!
+        //! Parents are always marked together with their children and
+        //! evaluating a node also evaluates its dirty children, so the parents
+        //! of a dirty node are already dirty.
+        void mark_dirty()
+        {
+            if(dirty.load(std::memory_order_relaxed))
+                return;
+
+            dirty.store(true, std::memory_order_relaxed);
+            notify();
+        }
+
+        //! Update the result with the provided functor, if the node is dirty.
+        //!
+        //! A node can be shared by expressions that are evaluated in parallel.
+        //! Only one thread evaluates the node; the others wait for it to
+        //! finish and use its result.
+        template <typename Compute>
+        void eval_dirty(Compute && compute)
+        {
+            auto const profiling = expr_detail::profiling_flag().load(std::memory_order_relaxed);
+            if(profiling)
+                visits.fetch_add(1, std::memory_order_relaxed);
+
+            if(!dirty.load(std::memory_order_acquire))
+                return;
+
+            while(busy.exchange(true, std::memory_order_acquire))
+                std::this_thread::yield();
+
+            struct unlock
+            {
+                ~unlock() { b.store(false, std::memory_order_release); }
+                std::atomic<bool> & b;
+            } const u { busy };
+
+            if(!dirty.load(std::memory_order_relaxed))
+                return;
+
+            OBSERVABLE_TRACE_SCOPE(name, rank);
+
+            if(profiling)
+            {
+                using clock = std::chrono::steady_clock;
+                auto const start = clock::now();
+                result = compute();
+                auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                            clock::now() - start);
+
+                evaluations.fetch_add(1, std::memory_order_relaxed);
+                eval_time.fetch_add(elapsed.count(), std::memory_order_relaxed);
+            }
+            else
+            {
+                result = compute();
+            }
+
+            // Only the thread that holds busy writes the version.
+            version.store(version.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_release);
+
+            dirty.store(false, std::memory_order_release);
+        }
+
         ResultType result;
-        bool dirty = true;
-        std::function<void()> eval;
-        std::vector<unique_subscription> subs;
+        std::atomic<bool> dirty { true };
+        std::atomic<bool> busy { false };
+        std::atomic<std::uint64_t> version { 0 };
+        // Operands of a lazy n-ary node whose changes make it dirty; one bit
+        // per operand.
+        std::atomic<unsigned> tracked { ~0u };
+        // Large enough to hold the closure of a binary node without
+        // allocating.
+        detail::inline_function<void(), 6 * sizeof(void *)> eval;
+        std::vector<unique_subscription,
+                    expr_detail::arena_allocator<unique_subscription>> subs;
     };
 
-    std::shared_ptr<data> data_ { std::make_shared<data>() };
+    static auto make_data(expr_detail::arena_allocator<data> const & a)
+    {
+        return std::allocate_shared<data>(a, a);
+    }
+
+    std::shared_ptr<data> data_ {
+        make_data(expr_detail::arena_allocator<data> {
+            expression_arena::current()
+        })
+    };
 };
 
 //! \cond
@@ -2,6 +2,8 @@
 #include <type_traits>
 #include <utility>
 #include <observable/value.hpp>
+#include <observable/expressions/context.hpp>
+#include <observable/expressions/fused.hpp>
 #include <observable/expressions/tree.hpp>
 
 #include <observable/detail/compiler_config.hpp>
@@ -9,18 +11,19 @@ OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
 
 namespace observable { inline namespace expr { namespace expr_detail {
 
-//! Check if a type is either an expression_node or an observable
-//! value<ValueType, EqualityComparator>.
+//! Check if a type is either an expression_node, a fused expression or an
+//! observable value<ValueType, EqualityComparator>.
 //!
 //! The static member ``value`` will be true if the provided type is either an
-//! observable value<ValueType, EqualityComparator> or an
-//! expression_node.
+//! observable value<ValueType, EqualityComparator>, an expression_node or a
+//! fused expression.
 //!
 //! \ingroup observable_detail
 template <typename T>
 struct is_observable :
     std::integral_constant<bool, is_value<T>::value ||
-                                 is_expression_node<T>::value>
+                                 is_expression_node<T>::value ||
+                                 is_fused_expression<T>::value>
 { };
 
 //! Check if any of the provided types are observable.
@@ -103,7 +106,9 @@ using result_node_t = typename result_node<Op, Args ...>::type;
 template <typename T>
 inline auto make_node(T && val)
 {
-    return expression_node<val_type_t<T>> { std::forward<T>(val) };
+    return make_shared_constant<val_type_t<T>>(
+                        std::forward<T>(val),
+                        is_shareable_constant<val_type_t<T>> { });
 }
 
 //! Create a node from an observable value reference.
@@ -112,7 +117,7 @@ inline auto make_node(T && val)
 template <typename T, typename ... R>
 inline auto make_node(value<T, R ...> & val)
 {
-    return expression_node<T> { val };
+    return make_shared_value<T>(val);
 }
 
 //! Create a node from a temporary expression_node.
@@ -130,10 +135,66 @@ inline auto make_node(expression_node<T> && node)
 template <typename Op, typename ... Args>
 inline auto make_node(Op && op, Args && ... args)
 {
-    return result_node_t<Op, Args ...> {
+    return make_shared_nary<result_node_t<Op, Args ...>>(
         std::forward<Op>(op),
         make_node(std::forward<Args>(args)) ...
-    };
+    );
+}
+
+//! Create a named node from an operator and an arbitrary number of arguments.
+//!
+//! \param name Name of the operation. The string must live as long as the
+//!             created node, usually it's a string literal.
+//! \see expression_node::name()
+//! \ingroup observable_detail
+template <typename Op, typename ... Args>
+inline auto make_named_node(char const * name, Op && op, Args && ... args)
+{
+    auto node = make_node(std::forward<Op>(op), std::forward<Args>(args) ...);
+    node.name(name);
+    return node;
+}
+
+//! Computes the type of the expression_node created for a lazily-evaluated
+//! expression with callable ``Op`` and corresponding arguments.
+//!
+//! \ingroup observable_detail
+template <typename Op, typename ... Args>
+struct lazy_result_node
+{
+    using type = expression_node<
+                    std::decay_t<
+                        decltype(std::declval<std::decay_t<Op> &>()(
+                                    std::declval<lazy_operand<
+                                        expression_node<val_type_t<Args>>>>() ...))>>;
+};
+
+//! Type of the expression_node created for a lazily-evaluated expression.
+//!
+//! \ingroup observable_detail
+template <typename Op, typename ... Args>
+using lazy_result_node_t = typename lazy_result_node<Op, Args ...>::type;
+
+//! Create a named, lazily-evaluated node from an operator and an arbitrary
+//! number of arguments.
+//!
+//! The operator is called with a \ref lazy_operand for each argument.
+//!
+//! Lazy nodes are not shared with the current \ref expression_context, but
+//! their operands are.
+//!
+//! \param name Name of the operation. The string must live as long as the
+//!             created node, usually it's a string literal.
+//! \ingroup observable_detail
+template <typename Op, typename ... Args>
+inline auto make_named_lazy_node(char const * name, Op && op, Args && ... args)
+{
+    auto node = lazy_result_node_t<Op, Args ...> {
+                    lazy_operands_tag { },
+                    std::forward<Op>(op),
+                    make_node(std::forward<Args>(args)) ... };
+    node.name(name);
+    return node;
 }
 
 } } }
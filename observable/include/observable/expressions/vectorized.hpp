@@ -0,0 +1,289 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <observable/subject.hpp>
+#include <observable/expressions/expression.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable { inline namespace expr {
+
+//! \cond
+template <typename Signature, typename EvaluatorType=expression_evaluator>
+class vectorized_expression;
+//! \endcond
+
+//! Evaluates the same expression over many independent sets of inputs.
+//!
+//! Each set of inputs is a lane. Inputs are stored as columns, one contiguous
+//! array per input, and results are stored in a contiguous array too.
+//! Evaluating the expression runs a single loop over runs of lanes that have
+//! changed, that applies the expression's shape to each lane. Shapes made of
+//! arithmetic operators and inlinable functions let the compiler vectorize
+//! that loop, which is much faster than evaluating one expression tree per
+//! lane.
+//!
+//! Lanes are tracked in blocks of 64; a changed lane makes its whole block be
+//! evaluated again, which gives the vectorized loop long runs to work with.
+//! Only lanes whose result actually changed are reported to subscribers.
+//!
+//! Example:
+//!
+//!     auto ud = updater { };
+//!     vectorized_expression<float(float, float), updater> e {
+//!         ud, 10000,
+//!         [](auto a, auto b) { return std::min(a * 2.0f + b, 1.0f); } };
+//!
+//!     e.set<0>(42, 0.25f);
+//!     ud.update_all();
+//!     e.get(42); // 0.5f
+//!
+//! \note Math functions only vectorize if the compiler has vector versions
+//!       of them; for GCC, this usually requires ``-fno-math-errno``.
+//!
+//! \tparam ResultType Type of the expression's result.
+//! \tparam InputTypes Types of the expression's inputs.
+//! \tparam EvaluatorType An instance of expression_evaluator, or a type derived
+//!                       from it, that will evaluate the expression.
+//!
+//! \warning None of the methods in this class can be safely called
+//!          concurrently, or while the evaluator is running.
+//!
+//! \ingroup observable_expressions
+template <typename ResultType, typename ... InputTypes, typename EvaluatorType>
+class vectorized_expression<ResultType(InputTypes ...), EvaluatorType> final
+{
+    static_assert(std::is_base_of<expression_evaluator, EvaluatorType>::value,
+                  "EvaluatorType needs to be derived from expression_evaluator.");
+
+    static constexpr auto has_bool() noexcept
+    {
+        bool const is_bool[] = { std::is_same<ResultType, bool>::value,
+                                 std::is_same<InputTypes, bool>::value ... };
+        for(auto b : is_bool)
+            if(b)
+                return true;
+
+        return false;
+    }
+
+    // Columns are std::vectors, which are not contiguous for bool.
+    static_assert(!has_bool(),
+                  "Use unsigned char instead of bool for inputs and results.");
+
+    static constexpr std::size_t block_size = 64;
+
+public:
+    //! Create an expression whose inputs are all value-initialized.
+    //!
+    //! \param[in] evaluator Evaluator that will evaluate the expression.
+    //! \param[in] lanes Number of lanes.
+    //! \param[in] shape Functor with the signature below, that will be called
+    //!                  for each lane:
+    //!
+    //!                      ResultType (InputTypes ...)
+    template <typename Shape>
+    vectorized_expression(EvaluatorType const & evaluator,
+                          std::size_t lanes,
+                          Shape shape) :
+        inputs_ { std::vector<InputTypes>(lanes) ... },
+        results_(lanes),
+        scratch_(lanes),
+        dirty_((lanes + block_size - 1) / block_size),
+        changed_(dirty_.size()),
+        evaluator_ { evaluator }
+    {
+        static_assert(std::is_convertible<decltype(shape(InputTypes { } ...)),
+                                          ResultType>::value,
+                      "Shape must return a type that is convertible to ResultType.");
+
+        kernel_ = [this, s = std::move(shape)](std::size_t first, std::size_t last) {
+            eval_range(s, first, last, std::index_sequence_for<InputTypes ...> { });
+        };
+
+        if(lanes > 0)
+        {
+            kernel_(0, lanes);
+            results_ = scratch_;
+        }
+
+        id_ = evaluator_.insert(this);
+        evaluator_.ready(id_);
+    }
+
+    //! Number of lanes.
+    auto size() const noexcept { return results_.size(); }
+
+    //! Change an input of a lane.
+    //!
+    //! \tparam I Index of the input.
+    //! \param[in] lane Lane to change.
+    //! \param[in] v New value of the input.
+    template <std::size_t I, typename T>
+    void set(std::size_t lane, T && v)
+    {
+        assert(lane < size());
+        std::get<I>(inputs_)[lane] = std::forward<T>(v);
+        mark_dirty(lane);
+    }
+
+    //! Retrieve an input of a lane.
+    template <std::size_t I>
+    auto input(std::size_t lane) const noexcept -> auto const &
+    {
+        assert(lane < size());
+        return std::get<I>(inputs_)[lane];
+    }
+
+    //! Retrieve the result of a lane.
+    //!
+    //! \warning Results are only updated by the evaluator, so they might be
+    //!          stale.
+    auto get(std::size_t lane) const noexcept -> ResultType const &
+    {
+        assert(lane < size());
+        return results_[lane];
+    }
+
+    //! Retrieve the results of all lanes, as a contiguous array.
+    auto results() const noexcept -> ResultType const * { return results_.data(); }
+
+    //! Subscribe to result changes.
+    //!
+    //! \param[in] observer Functor compatible with
+    //!                     ``void(std::size_t lane, ResultType const &)``. It is
+    //!                     called, by the evaluator, for each lane whose result
+    //!                     has changed.
+    template <typename Observer>
+    auto subscribe(Observer && observer)
+    {
+        return changes_.subscribe(std::forward<Observer>(observer));
+    }
+
+    //! Evaluate the lanes that have changed, without notifying subscribers.
+    void prepare()
+    {
+        if(!any_dirty_)
+            return;
+
+        any_dirty_ = false;
+
+        auto const blocks = dirty_.size();
+        for(auto b = std::size_t { 0 }; b < blocks;)
+        {
+            if(!dirty_[b])
+            {
+                ++b;
+                continue;
+            }
+
+            // Evaluate the whole run of dirty blocks at once.
+            auto end = b + 1;
+            while(end < blocks && dirty_[end])
+                ++end;
+
+            auto const first = b * block_size;
+            auto const last = std::min(end * block_size, size());
+            kernel_(first, last);
+
+            for(auto i = first; i < last; ++i)
+            {
+                if(scratch_[i] == results_[i])
+                    continue;
+
+                results_[i] = scratch_[i];
+                changed_[i / block_size] |= std::uint64_t { 1 } << (i % block_size);
+            }
+
+            for(; b < end; ++b)
+                dirty_[b] = 0;
+        }
+    }
+
+    //! Notify subscribers of the lanes prepare() has changed.
+    void deliver()
+    {
+        for(auto b = std::size_t { 0 }; b < changed_.size(); ++b)
+        {
+            for(auto bits = changed_[b]; bits; bits &= bits - 1)
+            {
+                auto bit = std::size_t { 0 };
+                while(!(bits & (std::uint64_t { 1 } << bit)))
+                    ++bit;
+
+                auto const lane = b * block_size + bit;
+                changes_.notify(lane, results_[lane]);
+            }
+
+            changed_[b] = 0;
+        }
+    }
+
+    //! The expression is ranked above its inputs, which are plain data.
+    auto rank() const noexcept -> std::size_t { return 1; }
+
+    //! Destructor.
+    ~vectorized_expression() { evaluator_.remove(id_); }
+
+public:
+    //! Vectorized expressions are not copy-constructible.
+    vectorized_expression(vectorized_expression const &) =delete;
+
+    //! Vectorized expressions are not copy-assignable.
+    auto operator=(vectorized_expression const &) -> vectorized_expression & =delete;
+
+    //! Vectorized expressions are not move-constructible.
+    vectorized_expression(vectorized_expression &&) =delete;
+
+    //! Vectorized expressions are not move-assignable.
+    auto operator=(vectorized_expression &&) -> vectorized_expression & =delete;
+
+private:
+    void mark_dirty(std::size_t lane)
+    {
+        dirty_[lane / block_size] = 1;
+
+        if(any_dirty_)
+            return;
+
+        any_dirty_ = true;
+        if(EvaluatorType::tracks_changes)
+            evaluator_.changed(id_);
+    }
+
+    template <typename Shape, std::size_t ... I>
+    void eval_range(Shape const & shape, std::size_t first, std::size_t last,
+                    std::index_sequence<I ...>)
+    {
+        // Plain pointers, so the loop below is simple enough to vectorize.
+        auto const out = scratch_.data();
+        auto const in = std::make_tuple(std::get<I>(inputs_).data() ...);
+
+        for(auto i = first; i < last; ++i)
+            out[i] = shape(std::get<I>(in)[i] ...);
+    }
+
+private:
+    std::tuple<std::vector<InputTypes> ...> inputs_;
+    std::vector<ResultType> results_;
+    std::vector<ResultType> scratch_;
+    std::vector<unsigned char> dirty_;
+    std::vector<std::uint64_t> changed_;
+    bool any_dirty_ { false };
+    std::function<void(std::size_t, std::size_t)> kernel_;
+    subject<void(std::size_t, ResultType const &)> changes_;
+    EvaluatorType evaluator_;
+    typename EvaluatorType::id id_;
+};
+
+} }
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
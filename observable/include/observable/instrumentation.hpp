@@ -0,0 +1,312 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable {
+
+//! Snapshot of the statistics collected by a \ref counting_instrumentation.
+//!
+//! For subjects, each notify() call is a notification and each observer called
+//! by it is an observer call. For updaters, each update_all() call is a
+//! notification, each registered expression is an observer call and the
+//! observer times measure the whole update_all() call.
+//!
+//! \ingroup observable
+struct notification_stats
+{
+    //! Number of notifications.
+    std::size_t notifications = 0;
+
+    //! Number of observers that have been called.
+    std::size_t observer_calls = 0;
+
+    //! Total time spent inside observers.
+    std::chrono::nanoseconds observer_time { 0 };
+
+    //! Longest time spent inside a single observer.
+    std::chrono::nanoseconds max_observer_time { 0 };
+
+    //! Number of allocations made during notifications. This is always zero,
+    //! unless an allocation counter has been installed with
+    //! set_allocation_counter().
+    std::size_t allocations = 0;
+};
+
+//! Function that returns the number of allocations made so far by the
+//! process. The function must not throw.
+using allocation_counter = std::size_t (*)();
+
+//! \cond
+namespace detail {
+
+    inline auto allocation_counter_storage() noexcept
+        -> std::atomic<allocation_counter> &
+    {
+        static std::atomic<allocation_counter> counter { nullptr };
+        return counter;
+    }
+
+    inline auto allocation_count() noexcept -> std::size_t
+    {
+        auto const counter = allocation_counter_storage().load(std::memory_order_relaxed);
+        return counter ? counter() : 0;
+    }
+
+    //! Counters shared by an instrumented object and the registry.
+    struct instrumentation_record
+    {
+        std::atomic<std::size_t> notifications { 0 };
+        std::atomic<std::size_t> observer_calls { 0 };
+        std::atomic<std::chrono::nanoseconds::rep> observer_time { 0 };
+        std::atomic<std::chrono::nanoseconds::rep> max_observer_time { 0 };
+        std::atomic<std::size_t> allocations { 0 };
+
+        std::mutex name_mutex;
+        std::string name;
+        bool registered = false;
+    };
+
+    inline auto snapshot(instrumentation_record const & r) noexcept
+    {
+        auto s = notification_stats { };
+        s.notifications = r.notifications.load(std::memory_order_relaxed);
+        s.observer_calls = r.observer_calls.load(std::memory_order_relaxed);
+        s.observer_time = std::chrono::nanoseconds {
+                            r.observer_time.load(std::memory_order_relaxed) };
+        s.max_observer_time = std::chrono::nanoseconds {
+                            r.max_observer_time.load(std::memory_order_relaxed) };
+        s.allocations = r.allocations.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    //! Combine the statistics of two subjects that are notified together.
+    inline auto merge_observers(notification_stats a, notification_stats const & b) noexcept
+    {
+        a.notifications = std::max(a.notifications, b.notifications);
+        a.observer_calls += b.observer_calls;
+        a.observer_time += b.observer_time;
+        a.max_observer_time = std::max(a.max_observer_time, b.max_observer_time);
+        a.allocations += b.allocations;
+        return a;
+    }
+
+    class instrumentation_registry final
+    {
+    public:
+        static auto instance() -> instrumentation_registry &
+        {
+            static instrumentation_registry registry;
+            return registry;
+        }
+
+        void add(std::weak_ptr<instrumentation_record> record)
+        {
+            std::lock_guard<std::mutex> const lock { mutex_ };
+
+            records_.erase(std::remove_if(records_.begin(), records_.end(),
+                                          [](auto && r) { return r.expired(); }),
+                           records_.end());
+            records_.push_back(std::move(record));
+        }
+
+        auto records() -> std::vector<std::shared_ptr<instrumentation_record>>
+        {
+            std::lock_guard<std::mutex> const lock { mutex_ };
+
+            auto live = std::vector<std::shared_ptr<instrumentation_record>> { };
+            for(auto && r : records_)
+                if(auto p = r.lock())
+                    live.push_back(std::move(p));
+
+            return live;
+        }
+
+    private:
+        std::mutex mutex_;
+        std::vector<std::weak_ptr<instrumentation_record>> records_;
+    };
+}
+//! \endcond
+
+//! Instrumentation that does nothing.
+//!
+//! This is the instrumentation of all the library's subject policies. All of
+//! its hooks are empty and it has no state, so instrumented code compiles to
+//! the same code as if there were no hooks.
+//!
+//! An instrumentation type provides the four hooks below. Each begin hook
+//! returns a token that is passed to the matching end hook. Hooks can be
+//! called in parallel, from multiple threads.
+//!
+//! \ingroup observable
+struct no_instrumentation
+{
+    //! Token passed between hooks.
+    struct token { };
+
+    //! Called when a notification starts.
+    auto begin_notify() const noexcept { return token { }; }
+
+    //! Called when a notification ends.
+    void end_notify(token) const noexcept { }
+
+    //! Called before an observer is called.
+    auto begin_call() const noexcept { return token { }; }
+
+    //! Called after an observer has returned.
+    void end_call(token) const noexcept { }
+};
+
+//! Instrumentation that counts notifications and measures observer times.
+//!
+//! Counters are updated atomically, so they stay correct when notifications
+//! run in parallel. Observer calls that throw are not counted.
+//!
+//! Instrumented objects can be given a name; named objects are added to a
+//! process-wide registry, that for_each_instrumented() visits.
+//!
+//! \see instrumented_subject_policy
+//! \ingroup observable
+class counting_instrumentation
+{
+    using clock = std::chrono::steady_clock;
+
+public:
+    //! Create an instrumentation with all counters at zero.
+    counting_instrumentation() =default;
+
+    //! Copies share their counters. Moving a subject copies its
+    //! instrumentation, so the moved-from subject stays usable.
+    counting_instrumentation(counting_instrumentation const &) =default;
+
+    //! \see counting_instrumentation(counting_instrumentation const &)
+    auto operator=(counting_instrumentation const &)
+        -> counting_instrumentation & =default;
+
+    //! Retrieve a snapshot of the collected statistics.
+    auto stats() const noexcept -> notification_stats
+    {
+        return detail::snapshot(*record_);
+    }
+
+    //! Reset all counters to zero.
+    void reset() const noexcept
+    {
+        record_->notifications.store(0, std::memory_order_relaxed);
+        record_->observer_calls.store(0, std::memory_order_relaxed);
+        record_->observer_time.store(0, std::memory_order_relaxed);
+        record_->max_observer_time.store(0, std::memory_order_relaxed);
+        record_->allocations.store(0, std::memory_order_relaxed);
+    }
+
+    //! Name the instrumented object and add it to the registry.
+    //!
+    //! Naming an object again only changes its name.
+    void name(std::string new_name) const
+    {
+        auto first = false;
+        {
+            std::lock_guard<std::mutex> const lock { record_->name_mutex };
+            first = !std::exchange(record_->registered, true);
+            record_->name = std::move(new_name);
+        }
+
+        if(first)
+            detail::instrumentation_registry::instance().add(record_);
+    }
+
+    //! Retrieve the object's name, or an empty string if it has none.
+    auto name() const -> std::string
+    {
+        std::lock_guard<std::mutex> const lock { record_->name_mutex };
+        return record_->name;
+    }
+
+    //! \see no_instrumentation::begin_notify()
+    auto begin_notify() const noexcept { return detail::allocation_count(); }
+
+    //! \see no_instrumentation::end_notify()
+    void end_notify(std::size_t allocations_at_begin) const noexcept
+    {
+        record_->notifications.fetch_add(1, std::memory_order_relaxed);
+        record_->allocations.fetch_add(detail::allocation_count() - allocations_at_begin,
+                                       std::memory_order_relaxed);
+    }
+
+    //! \see no_instrumentation::begin_call()
+    auto begin_call() const noexcept { return clock::now(); }
+
+    //! \see no_instrumentation::end_call()
+    void end_call(clock::time_point start) const noexcept { end_call(start, 1); }
+
+    //! Record a number of observer calls that all ran since ``start``. The
+    //! whole time counts as a single call for the maximum observer time.
+    void end_call(clock::time_point start, std::size_t calls) const noexcept
+    {
+        auto const d = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                        clock::now() - start).count();
+
+        record_->observer_calls.fetch_add(calls, std::memory_order_relaxed);
+        record_->observer_time.fetch_add(d, std::memory_order_relaxed);
+
+        auto max = record_->max_observer_time.load(std::memory_order_relaxed);
+        while(d > max &&
+              !record_->max_observer_time.compare_exchange_weak(max, d,
+                                                                std::memory_order_relaxed))
+            ;
+    }
+
+private:
+    std::shared_ptr<detail::instrumentation_record> record_ {
+        std::make_shared<detail::instrumentation_record>()
+    };
+};
+
+//! Install a function that returns the number of allocations made by the
+//! process, usually from a replaced ``operator new`` or from a custom
+//! allocator.
+//!
+//! While it is installed, \ref counting_instrumentation records how many
+//! allocations are made during notifications. Pass nullptr to uninstall it.
+//!
+//! \ingroup observable
+inline void set_allocation_counter(allocation_counter counter) noexcept
+{
+    detail::allocation_counter_storage().store(counter, std::memory_order_relaxed);
+}
+
+//! Call a functor with the name and statistics of every named, instrumented
+//! object that still exists.
+//!
+//! \param fun Functor compatible with
+//!            ``void(std::string const &, notification_stats const &)``.
+//!
+//! \ingroup observable
+template <typename Fun>
+inline void for_each_instrumented(Fun && fun)
+{
+    for(auto && r : detail::instrumentation_registry::instance().records())
+    {
+        auto name = std::string { };
+        {
+            std::lock_guard<std::mutex> const lock { r->name_mutex };
+            name = r->name;
+        }
+
+        fun(name, detail::snapshot(*r));
+    }
+}
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
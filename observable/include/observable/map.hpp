@@ -0,0 +1,231 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <utility>
+#include <observable/subject.hpp>
+#include <observable/subscription.hpp>
+#include <observable/value.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable {
+
+//! Description of a change made to an observable \ref map.
+//!
+//! \ingroup observable
+template <typename Key, typename Value, typename Compare=std::less<Key>>
+struct map_change
+{
+    //! Kind of change.
+    enum class kind
+    {
+        //! A new key has been inserted.
+        insert,
+        //! A key has been erased.
+        erase,
+        //! The value of an existing key has changed.
+        update,
+        //! The whole content has been replaced.
+        reset
+    };
+
+    //! Kind of change.
+    kind type;
+
+    //! The key that has changed, or null for a reset.
+    Key const * key;
+
+    //! Previous value of the key, for erase and update; null otherwise.
+    Value const * old_value;
+
+    //! Previous content of the map, for a reset; null otherwise.
+    std::map<Key, Value, Compare> const * old_content;
+};
+
+//! Associative container that notifies its observers of each change.
+//!
+//! Observers receive a \ref map_change that describes the key that has been
+//! inserted, erased or updated, together with its previous value, so they
+//! can apply the change instead of looking at the whole content. All pointers
+//! inside the change are only valid while observers are being notified.
+//!
+//! The map can be read like a ``std::map``, but can only be modified through
+//! its own methods, which notify the observers.
+//!
+//! \warning None of the methods in this class can be safely called
+//!          concurrently.
+//!
+//! \tparam Key Type of the keys.
+//! \tparam Value Type of the mapped values.
+//! \tparam Compare Key comparator, like for ``std::map``.
+//!
+//! \ingroup observable
+template <typename Key, typename Value, typename Compare=std::less<Key>>
+class map final
+{
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using container_type = std::map<Key, Value, Compare>;
+    using size_type = typename container_type::size_type;
+    using const_iterator = typename container_type::const_iterator;
+    using change_type = map_change<Key, Value, Compare>;
+    using observer_type = void(change_type const &);
+
+    //! Create an empty map.
+    map() =default;
+
+    //! Create a map with the provided entries.
+    map(std::initializer_list<typename container_type::value_type> entries) :
+        items_(entries)
+    { }
+
+    //! Create a map that takes ownership of the provided entries.
+    explicit map(container_type entries) : items_(std::move(entries)) { }
+
+    //! Subscribe to changes.
+    //!
+    //! \param[in] observer Callable compatible with ``void(change_type const &)``.
+    //! \return An infinite subscription that can be used to unsubscribe the
+    //!         observer.
+    //! \see subject<void(Args ...)>::subscribe()
+    template <typename Callable>
+    auto subscribe(Callable && observer) const
+    {
+        return changes_.subscribe(std::forward<Callable>(observer));
+    }
+
+    //! Retrieve the stored entries.
+    auto get() const noexcept -> container_type const & { return items_; }
+
+    //! \see get()
+    explicit operator container_type const &() const noexcept { return items_; }
+
+    //! Number of stored entries.
+    auto size() const noexcept { return items_.size(); }
+
+    //! Return true if there are no stored entries.
+    auto empty() const noexcept { return items_.empty(); }
+
+    //! Return 1 if the key is stored, 0 otherwise.
+    auto count(Key const & key) const { return items_.count(key); }
+
+    //! Find the entry of a key, or return end().
+    auto find(Key const & key) const -> const_iterator { return items_.find(key); }
+
+    //! Retrieve the value of a key.
+    //!
+    //! \throw std::out_of_range if the key is not stored.
+    auto at(Key const & key) const -> Value const & { return items_.at(key); }
+
+    //! Iterator to the first entry.
+    auto begin() const noexcept -> const_iterator { return items_.begin(); }
+
+    //! Iterator past the last entry.
+    auto end() const noexcept -> const_iterator { return items_.end(); }
+
+    //! Insert a key or change the value of an existing one.
+    //!
+    //! Observers are not notified if the key already has an equal value.
+    //!
+    //! \return True if the map has changed.
+    auto set(Key key, Value v) -> bool
+    {
+        auto const it = items_.lower_bound(key);
+        if(it != items_.end() && !items_.key_comp()(key, it->first))
+        {
+            if(detail::equal_to { }(it->second, v))
+                return false;
+
+            auto old = std::exchange(it->second, std::move(v));
+            notify(change_type::kind::update, &it->first, &old, nullptr);
+            return true;
+        }
+
+        auto const inserted = items_.emplace_hint(it, std::move(key), std::move(v));
+        notify(change_type::kind::insert, &inserted->first, nullptr, nullptr);
+        return true;
+    }
+
+    //! Modify the value of an existing key in place.
+    //!
+    //! The functor is called with a reference to the value and must return true
+    //! if it has changed the value. Observers are only notified if it did;
+    //! ``old_value`` will point to a copy taken before the functor was called.
+    //!
+    //! \return The value returned by the functor, or false if the key is not
+    //!         stored.
+    template <typename Fun>
+    auto update(Key const & key, Fun && fun) -> bool
+    {
+        auto const it = items_.find(key);
+        if(it == items_.end())
+            return false;
+
+        auto old = it->second;
+        if(!fun(it->second))
+            return false;
+
+        notify(change_type::kind::update, &it->first, &old, nullptr);
+        return true;
+    }
+
+    //! Erase a key.
+    //!
+    //! \return True if the key was stored.
+    auto erase(Key const & key) -> bool
+    {
+        auto const it = items_.find(key);
+        if(it == items_.end())
+            return false;
+
+        auto old = std::move(*it);
+        items_.erase(it);
+
+        notify(change_type::kind::erase, &old.first, &old.second, nullptr);
+        return true;
+    }
+
+    //! Replace the whole content.
+    void assign(container_type entries)
+    {
+        auto old = std::exchange(items_, std::move(entries));
+        notify(change_type::kind::reset, nullptr, nullptr, &old);
+    }
+
+    //! Erase all entries.
+    void clear() { assign(container_type { }); }
+
+public:
+    //! Maps are **not** copy-constructible.
+    map(map const &) =delete;
+
+    //! Maps are **not** copy-assignable.
+    auto operator=(map const &) -> map & =delete;
+
+    //! Maps are move-constructible.
+    map(map &&) =default;
+
+    //! Maps are move-assignable.
+    auto operator=(map &&) -> map & =default;
+
+private:
+    void notify(typename change_type::kind type,
+                Key const * key,
+                Value const * old_value,
+                container_type const * old_content) const
+    {
+        changes_.notify(change_type { type, key, old_value, old_content });
+    }
+
+private:
+    container_type items_;
+    mutable subject<observer_type> changes_;
+};
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
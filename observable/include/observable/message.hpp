@@ -0,0 +1,144 @@
+#pragma once
+#include <cassert>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable {
+
+//! Immutable, reference-counted payload that can be passed to many observers
+//! without being copied.
+//!
+//! A message wraps its payload once, inside a shared buffer. Copying the
+//! message only copies a reference to the buffer, so observers, including
+//! queued or asynchronous ones, can keep the payload for as long as they need.
+//!
+//! Use it as the argument of a subject to notify large payloads:
+//!
+//!     auto s = subject<void(message<std::string> const &)> { };
+//!
+//!     // Observers can take the payload by reference ...
+//!     s.subscribe([](std::string const & text) { ... });
+//!
+//!     // ... or keep the message itself.
+//!     s.subscribe([&](message<std::string> const & m) { history.push_back(m); });
+//!
+//!     s.notify(std::move(text)); // Wrapped once; never copied.
+//!
+//! With a ``message<T> const &`` argument, notifying does not even copy the
+//! reference, unless an observer keeps the message. With a by-value
+//! ``message<T>`` argument, each observer call copies the reference.
+//!
+//! \tparam ValueType Type of the payload.
+//!
+//! \ingroup observable
+template <typename ValueType>
+class message final
+{
+    static_assert(!std::is_reference<ValueType>::value,
+                  "Message payloads cannot be references.");
+
+public:
+    //! Alias for the payload's type.
+    using value_type = ValueType;
+
+    //! Wrap a payload inside a new buffer.
+    //!
+    //! This constructor is implicit, so payloads can be passed directly to the
+    //! notify() method of subjects that take messages.
+    message(ValueType payload) :
+        data_ { std::make_shared<ValueType const>(std::move(payload)) }
+    { }
+
+    //! Share an existing buffer.
+    //!
+    //! \param[in] data The payload's buffer. It must not be null.
+    explicit message(std::shared_ptr<ValueType const> data) noexcept :
+        data_ { std::move(data) }
+    {
+        assert(data_);
+    }
+
+    //! Retrieve the payload.
+    auto get() const noexcept -> ValueType const & { return *data_; }
+
+    //! \see get()
+    auto operator*() const noexcept -> ValueType const & { return *data_; }
+
+    //! Access the payload's members.
+    auto operator->() const noexcept -> ValueType const * { return data_.get(); }
+
+    //! Convert to a reference to the payload, so observers can take the
+    //! payload itself as their argument.
+    operator ValueType const &() const noexcept { return *data_; }
+
+    //! Retrieve the payload's buffer.
+    auto buffer() const noexcept -> std::shared_ptr<ValueType const> const &
+    {
+        return data_;
+    }
+
+    //! Number of messages, including this one, that share the buffer.
+    auto use_count() const noexcept { return data_.use_count(); }
+
+public:
+    //! Messages are copy-constructible; copies share the payload.
+    message(message const &) =default;
+
+    //! Messages are copy-assignable; copies share the payload.
+    auto operator=(message const &) -> message & =default;
+
+    //! Messages are move-constructible.
+    //!
+    //! \warning Moved-from messages can only be assigned to or destroyed.
+    message(message &&) noexcept =default;
+
+    //! Messages are move-assignable.
+    auto operator=(message &&) noexcept -> message & =default;
+
+private:
+    std::shared_ptr<ValueType const> data_;
+};
+
+//! Create a message, constructing its payload in place.
+//!
+//! \param[in] arguments Arguments forwarded to the payload's constructor.
+//!
+//! \ingroup observable
+template <typename ValueType, typename ... Args>
+inline auto make_message(Args && ... arguments)
+{
+    return message<ValueType> {
+                std::make_shared<ValueType const>(std::forward<Args>(arguments) ...) };
+}
+
+//! Messages are equal if they share a buffer, or if their payloads are equal.
+//!
+//! \ingroup observable
+template <typename A, typename B>
+inline auto operator==(message<A> const & a, message<B> const & b)
+    -> decltype(a.get() == b.get())
+{
+    if(static_cast<void const *>(a.buffer().get()) ==
+       static_cast<void const *>(b.buffer().get()))
+        return true;
+
+    return a.get() == b.get();
+}
+
+//! \see operator==(message<A> const &, message<B> const &)
+//!
+//! \ingroup observable
+template <typename A, typename B>
+inline auto operator!=(message<A> const & a, message<B> const & b)
+    -> decltype(!(a == b))
+{
+    return !(a == b);
+}
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
@@ -1,11 +1,34 @@
 #pragma once
 
 // All the useful headers.
+#include <observable/async_subject.hpp>
+#include <observable/batch.hpp>
+#include <observable/buffered_subject.hpp>
+#include <observable/compact_value.hpp>
+#include <observable/concurrent_value.hpp>
+#include <observable/conflated_value.hpp>
+#include <observable/event_loop.hpp>
+#include <observable/instrumentation.hpp>
+#include <observable/map.hpp>
+#include <observable/message.hpp>
+#include <observable/prioritized_subject.hpp>
+#include <observable/property_column.hpp>
 #include <observable/subject.hpp>
+#include <observable/static_subject.hpp>
+#include <observable/tracing.hpp>
 #include <observable/value.hpp>
+#include <observable/vector.hpp>
 #include <observable/observe.hpp>
+#include <observable/queued_value.hpp>
+#include <observable/replication.hpp>
+#include <observable/serializer.hpp>
+#include <observable/expressions/aggregates.hpp>
 #include <observable/expressions/filters.hpp>
+#include <observable/expressions/introspection.hpp>
 #include <observable/expressions/math.hpp>
+#include <observable/expressions/rolling.hpp>
+#include <observable/expressions/timing.hpp>
+#include <observable/expressions/vectorized.hpp>
 
 // Some Doxygen boilerplate.
 
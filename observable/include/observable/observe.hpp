@@ -1,8 +1,21 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <type_traits>
+#include <utility>
+#include <vector>
 #include <observable/value.hpp>
+#include <observable/detail/thread_pool.hpp>
+#include <observable/expressions/arena.hpp>
+#include <observable/expressions/context.hpp>
 #include <observable/expressions/expression.hpp>
+#include <observable/expressions/fused.hpp>
 #include <observable/expressions/operators.hpp>
 #include <observable/expressions/tree.hpp>
 
@@ -22,6 +35,17 @@ namespace observable {
 class updater : public expr::expression_evaluator
 {
 public:
+    //! Create an updater that keeps its state on the heap.
+    updater() =default;
+
+    //! Create an updater that keeps its state inside an arena.
+    //!
+    //! \param[in] arena Arena that the updater's state is allocated from. The
+    //!                  arena must outlive the updater.
+    explicit updater(expr::expression_arena & arena) :
+        expression_evaluator { arena }
+    { }
+
     //! Update all observable values that have been associated with this instance.
     void update_all() { eval_all(); }
 
@@ -29,6 +53,627 @@ private:
     using expr::expression_evaluator::eval_all;
 };
 
+//! Updater that evaluates independent expressions in parallel.
+//!
+//! Expressions are grouped by their rank, so an expression is only evaluated
+//! after all the expressions that it depends on have updated their values.
+//! The expressions of a group are evaluated concurrently, on a pool of worker
+//! threads. Expression nodes that are shared between expressions are
+//! evaluated only once.
+//!
+//! After a group has been evaluated, its values are updated on the thread
+//! that called update_all(), in the order the expressions were registered,
+//! so observers are always called in the same order and never from worker
+//! threads.
+//!
+//! \warning Observable values that are read by the expressions must not be
+//!          changed from other threads while update_all() is running.
+//!
+//! \note update_all() is not virtual; calling it through a reference to
+//!       \ref updater updates the expressions sequentially.
+//!
+//! \ingroup observable
+class parallel_updater : public updater
+{
+public:
+    //! Create an updater.
+    //!
+    //! \param[in] threads Number of threads that will evaluate expressions,
+    //!                    including the thread calling update_all().
+    explicit parallel_updater(std::size_t threads=std::thread::hardware_concurrency()) :
+        pool_ { std::make_shared<detail::thread_pool>(threads > 1 ? threads - 1 : 0) }
+    { }
+
+    //! Update all observable values that have been associated with this
+    //! instance.
+    void update_all()
+    {
+        with_entries([&](auto && entries) {
+            auto sorted = std::vector<entry>(begin(entries), end(entries));
+            std::stable_sort(begin(sorted), end(sorted),
+                             [](auto && a, auto && b) { return a.rank < b.rank; });
+
+            for(auto first = begin(sorted); first != end(sorted);)
+            {
+                auto const last = std::find_if(first, end(sorted),
+                                               [&](auto && e) {
+                                                   return e.rank != first->rank;
+                                               });
+
+                pool_->parallel_for(static_cast<std::size_t>(last - first),
+                                    [&](std::size_t i) {
+                                        first[i].prepare(first[i].expression);
+                                    });
+
+                for(; first != last; ++first)
+                    first->deliver(first->expression);
+            }
+        });
+    }
+
+private:
+    std::shared_ptr<detail::thread_pool> pool_;
+};
+
+//! Updater that only evaluates the expressions that have changed.
+//!
+//! When an expression's tree becomes dirty, the expression pushes itself onto
+//! a lock-free list. update_all() only evaluates the expressions on that list,
+//! so its cost depends on the number of changed expressions instead of the
+//! number of registered ones.
+//!
+//! Changed expressions are evaluated in rank order, then in the order they
+//! were registered. Expressions that change while update_all() is running,
+//! because they depend on a value updated by it, are evaluated by the same
+//! update_all() call.
+//!
+//! \note update_all() is not virtual; calling it through a reference to
+//!       \ref updater evaluates all expressions.
+//!
+//! \ingroup observable
+class incremental_updater : public updater
+{
+    struct ready_node;
+
+public:
+    //! Update the observable values of all expressions that have changed since
+    //! the last call.
+    //!
+    //! \note This method can be safely called in parallel, from multiple
+    //!       threads. Expressions can be changed from any thread, including
+    //!       while this method is running.
+    void update_all()
+    {
+        std::lock_guard<std::mutex> const lock { state_->mutex };
+        auto & ready = state_->ready;
+
+        while(auto n = state_->head.exchange(nullptr))
+        {
+            for(; n; n = n->next.load())
+            {
+                if(n->removed)
+                    state_->retired.push_back(n);
+                else
+                    ready.push_back(n);
+            }
+
+            for(auto r : state_->retired)
+                delete r;
+            state_->retired.clear();
+
+            std::sort(begin(ready), end(ready), [](auto a, auto b) {
+                return a->e.rank != b->e.rank ? a->e.rank < b->e.rank
+                                              : a->sequence < b->sequence;
+            });
+
+            struct clear_ready
+            {
+                ~clear_ready() { r.clear(); }
+                std::vector<ready_node *> & r;
+            } const clear { ready };
+
+            for(auto r : ready)
+            {
+                // Changes made from now on queue the expression again.
+                r->queued.store(false);
+                r->e.prepare(r->e.expression);
+                r->e.deliver(r->e.expression);
+            }
+        }
+    }
+
+    //! Expressions registered with this updater report their changes.
+    static constexpr bool tracks_changes = true;
+
+private:
+    using id = ready_node *;
+
+    //! Register a new expression.
+    template <typename ExpressionType>
+    auto insert(ExpressionType * expr) -> id
+    {
+        auto n = std::make_unique<ready_node>(make_entry(expr));
+
+        std::lock_guard<std::mutex> const lock { state_->mutex };
+        n->sequence = state_->sequence++;
+        n->base_id = updater::insert(expr);
+        return n.release();
+    }
+
+    //! Unregister a previously registered expression.
+    void remove(id n)
+    {
+        std::lock_guard<std::mutex> const lock { state_->mutex };
+        updater::remove(n->base_id);
+
+        // Claiming the node prevents it from being queued again; if it is
+        // already queued, update_all() frees it.
+        if(n->queued.exchange(true))
+            n->removed = true;
+        else
+            delete n;
+    }
+
+    //! Queue a changed expression, if it is not already queued.
+    void changed(id n) const noexcept
+    {
+        if(n->queued.exchange(true))
+            return;
+
+        auto next = state_->head.load();
+        do
+            n->next.store(next);
+        while(!state_->head.compare_exchange_weak(next, n));
+    }
+
+private:
+    struct ready_node
+    {
+        explicit ready_node(entry en) noexcept : e { en } { }
+
+        entry e;
+        std::atomic<ready_node *> next { nullptr };
+        std::atomic<bool> queued { false };
+        bool removed { false };
+        std::size_t sequence { 0 };
+        expr::expression_evaluator::id base_id { nullptr };
+    };
+
+    struct state
+    {
+        ~state()
+        {
+            for(auto n = head.load(); n;)
+                delete std::exchange(n, n->next.load());
+        }
+
+        std::atomic<ready_node *> head { nullptr };
+        std::mutex mutex;
+        std::size_t sequence { 0 };
+        std::vector<ready_node *> ready;
+        std::vector<ready_node *> retired;
+    };
+
+    std::shared_ptr<state> state_ { std::make_shared<state>() };
+
+    template <typename ValueType, typename EvaluatorType>
+    friend class expr::expression;
+
+    template <typename Root, typename EvaluatorType>
+    friend class expr::fused_expression;
+
+    template <typename ValueType, typename EvaluatorType>
+    friend class expr::expr_detail::conflating_updater;
+
+    template <typename Signature, typename EvaluatorType>
+    friend class expr::vectorized_expression;
+};
+
+//! Updater that spreads its expressions over independent shards.
+//!
+//! The base \ref updater keeps all of its expressions in one list, behind one
+//! mutex that is held while they are evaluated. Registering an expression
+//! waits for any running update_all() and unregistering one searches the whole
+//! list.
+//!
+//! This updater hashes each expression into one of several shards. Each shard
+//! keeps its expressions in intrusive lists, one for each rank, so registering
+//! and unregistering an expression take constant time. A shard's mutex is only
+//! held while linking, unlinking or listing expressions, never while they are
+//! evaluated, so expressions can be created and destroyed freely while their
+//! shard is being updated; destroying an expression only waits if that very
+//! expression is being evaluated by another thread.
+//!
+//! update_all() updates every shard, in rank order across all shards, so an
+//! expression is always evaluated after the expressions it depends on. A
+//! single shard can also be updated on its own, with update_shard(); distinct
+//! shards can be updated in parallel, from different threads:
+//!
+//!     auto ud = sharded_updater { 8 };
+//!     ...
+//!     pool.parallel_for(ud.shard_count(), [&](auto i) { ud.update_shard(i); });
+//!
+//! \warning update_shard() only orders the expressions of one shard. An
+//!          expression that depends on an expression of another shard may be
+//!          evaluated before that expression has been updated.
+//!
+//! \warning An expression must not be destroyed by its own observers.
+//!
+//! \note update_all() is not virtual; calling it through a reference to
+//!       \ref updater does not evaluate any expression.
+//!
+//! \ingroup observable
+class sharded_updater : public updater
+{
+    struct node;
+
+public:
+    //! Create an updater.
+    //!
+    //! \param[in] shards Number of shards. This must be at least one.
+    explicit sharded_updater(std::size_t shards=16) :
+        state_ { std::make_shared<state>(shards) }
+    { }
+
+    //! Update the observable values of all registered expressions.
+    //!
+    //! Expressions that are registered while this method is running are
+    //! evaluated by the next call.
+    //!
+    //! \note This method can be safely called in parallel with update_shard()
+    //!       and with itself, but the expressions that are evaluated by more
+    //!       than one call at a time will be evaluated once by each.
+    void update_all()
+    {
+        auto & shards = state_->shards;
+
+        auto snapshots = std::vector<snapshot> { };
+        snapshots.reserve(shards.size());
+        for(auto && sh : shards)
+            snapshots.push_back(sh.take_snapshot());
+
+        auto cursors = std::vector<std::size_t>(shards.size(), 0);
+        for(auto rank = std::size_t { 0 }; ; ++rank)
+        {
+            auto remaining = false;
+            for(auto i = std::size_t { 0 }; i < shards.size(); ++i)
+            {
+                auto const & nodes = snapshots[i].nodes;
+                auto & c = cursors[i];
+                for(; c < nodes.size() && nodes[c]->e.rank == rank; ++c)
+                    evaluate(*nodes[c]);
+
+                remaining = remaining || c < nodes.size();
+            }
+
+            if(!remaining)
+                break;
+        }
+    }
+
+    //! Update the observable values of the expressions of a single shard, in
+    //! rank order.
+    //!
+    //! \param[in] index Index of the shard, smaller than shard_count().
+    //!
+    //! \note Different shards can be safely updated in parallel, from multiple
+    //!       threads.
+    void update_shard(std::size_t index)
+    {
+        assert(index < state_->shards.size());
+        auto const s = state_->shards[index].take_snapshot();
+        for(auto n : s.nodes)
+            evaluate(*n);
+    }
+
+    //! Number of shards.
+    auto shard_count() const noexcept { return state_->shards.size(); }
+
+    //! Number of expressions registered in a shard.
+    auto shard_size(std::size_t index) const
+    {
+        assert(index < state_->shards.size());
+        auto & s = state_->shards[index];
+
+        std::lock_guard<std::mutex> const lock { s.mutex };
+        return s.size;
+    }
+
+protected:
+    //! Call a functor with all registered entries, shard by shard.
+    //!
+    //! \see expression_evaluator::with_entries()
+    template <typename Fun>
+    void with_entries(Fun && fun) const
+    {
+        auto entries = std::vector<entry> { };
+        for(auto && sh : state_->shards)
+        {
+            auto const s = sh.take_snapshot();
+            for(auto n : s.nodes)
+                entries.push_back(n->e);
+        }
+
+        fun(static_cast<std::vector<entry> const &>(entries));
+    }
+
+private:
+    using id = node *;
+
+    //! Register a new expression in the shard its address hashes to.
+    template <typename ExpressionType>
+    auto insert(ExpressionType * expr) -> id
+    {
+        auto & shards = state_->shards;
+        auto h = reinterpret_cast<std::uintptr_t>(static_cast<void const *>(expr));
+        h ^= h >> 17;
+        h *= static_cast<std::uintptr_t>(0x9E3779B97F4A7C15ull);
+        h ^= h >> 29;
+
+        auto & s = shards[static_cast<std::size_t>(h) % shards.size()];
+        auto n = std::make_unique<node>(make_entry(expr));
+
+        std::lock_guard<std::mutex> const lock { s.mutex };
+        s.link(n.get());
+        return n.release();
+    }
+
+    //! Allow a registered expression to be evaluated.
+    void ready(id n) const noexcept
+    {
+        auto expected = node::constructing;
+        if(n)
+            n->status.compare_exchange_strong(expected, node::idle);
+    }
+
+    //! Unregister a previously registered expression.
+    void remove(id n)
+    {
+        // Wait for any running evaluation of this expression to finish, and
+        // keep it from being evaluated again.
+        for(auto expected = n->status.load();
+            !n->status.compare_exchange_weak(expected, node::removed);)
+        {
+            if(expected == node::running)
+            {
+                std::this_thread::yield();
+                expected = node::idle;
+            }
+        }
+
+        auto & s = *n->owner;
+        std::lock_guard<std::mutex> const lock { s.mutex };
+        s.unlink(n);
+
+        if(s.updating > 0)
+            s.retired.push_back(n);
+        else
+            delete n;
+    }
+
+    //! Sharded updaters evaluate all their expressions.
+    void changed(id) const noexcept { }
+
+    //! Evaluate a node taken from a snapshot, unless it has been removed.
+    static void evaluate(node & n)
+    {
+        auto expected = node::idle;
+        if(!n.status.compare_exchange_strong(expected, node::running))
+            return;
+
+        struct finish
+        {
+            ~finish() { n.status.store(node::idle); }
+            node & n;
+        } const f { n };
+
+        n.e.prepare(n.e.expression);
+        n.e.deliver(n.e.expression);
+    }
+
+private:
+    struct shard;
+
+    //! Nodes of a shard, in rank and registration order. The shard does not
+    //! free any of them while the snapshot exists.
+    struct snapshot
+    {
+        explicit snapshot(shard & s) noexcept : owner { &s } { }
+
+        snapshot(snapshot && other) noexcept :
+            owner { std::exchange(other.owner, nullptr) },
+            nodes(std::move(other.nodes))
+        { }
+
+        ~snapshot()
+        {
+            if(owner)
+                owner->release();
+        }
+
+        auto operator=(snapshot &&) -> snapshot & =delete;
+
+        shard * owner;
+        std::vector<node *> nodes;
+    };
+
+    struct node
+    {
+        enum status_type { constructing, idle, running, removed };
+
+        explicit node(entry en) noexcept : e { en } { }
+
+        entry e;
+        std::atomic<status_type> status { constructing };
+        node * prev { nullptr };
+        node * next { nullptr };
+        shard * owner { nullptr };
+    };
+
+    //! An independent group of expressions, kept in one list per rank.
+    //!
+    //! Nodes unlinked while a snapshot is being evaluated are only freed once
+    //! no evaluation of the shard is running.
+    struct shard
+    {
+        struct rank_list
+        {
+            node * head { nullptr };
+            node * tail { nullptr };
+        };
+
+        //! Return the shard's nodes and keep them alive until the returned
+        //! snapshot is destroyed.
+        auto take_snapshot() -> snapshot
+        {
+            std::lock_guard<std::mutex> const lock { mutex };
+            auto nodes = std::vector<node *> { };
+            nodes.reserve(size);
+            for(auto && l : ranks)
+                for(auto n = l.head; n; n = n->next)
+                    nodes.push_back(n);
+
+            ++updating;
+            auto s = snapshot { *this };
+            s.nodes = std::move(nodes);
+            return s;
+        }
+
+        //! Called when a snapshot is destroyed.
+        void release() noexcept
+        {
+            auto freed = std::vector<node *> { };
+            {
+                std::lock_guard<std::mutex> const lock { mutex };
+                if(--updating == 0)
+                    freed.swap(retired);
+            }
+
+            for(auto n : freed)
+                delete n;
+        }
+
+        void link(node * n)
+        {
+            n->owner = this;
+            if(ranks.size() <= n->e.rank)
+                ranks.resize(n->e.rank + 1);
+
+            auto & l = ranks[n->e.rank];
+            n->prev = l.tail;
+            if(l.tail)
+                l.tail->next = n;
+            else
+                l.head = n;
+
+            l.tail = n;
+            ++size;
+        }
+
+        void unlink(node * n) noexcept
+        {
+            auto & l = ranks[n->e.rank];
+            (n->prev ? n->prev->next : l.head) = n->next;
+            (n->next ? n->next->prev : l.tail) = n->prev;
+            --size;
+        }
+
+        ~shard()
+        {
+            for(auto && l : ranks)
+                while(l.head)
+                    delete std::exchange(l.head, l.head->next);
+
+            for(auto n : retired)
+                delete n;
+        }
+
+        std::mutex mutex;
+        std::vector<rank_list> ranks;
+        std::size_t size { 0 };
+        std::size_t updating { 0 };
+        std::vector<node *> retired;
+    };
+
+    struct state
+    {
+        explicit state(std::size_t count) : shards(count) { assert(count > 0); }
+
+        std::vector<shard> shards;
+    };
+
+    std::shared_ptr<state> state_;
+
+    template <typename ValueType, typename EvaluatorType>
+    friend class expr::expression;
+
+    template <typename Root, typename EvaluatorType>
+    friend class expr::fused_expression;
+
+    template <typename ValueType, typename EvaluatorType>
+    friend class expr::expr_detail::conflating_updater;
+
+    template <typename Signature, typename EvaluatorType>
+    friend class expr::vectorized_expression;
+
+    template <typename ValueType, typename EvaluatorType>
+    friend class expr::expr_detail::shared_memory_updater;
+
+    template <typename ValueType, typename EvaluatorType>
+    friend class expr::expr_detail::replica_updater;
+};
+
+//! Updater that collects statistics about its update_all() calls.
+//!
+//! This works exactly like the provided updater type, but each update_all()
+//! call is also measured by a \ref counting_instrumentation: the number of
+//! calls, the number of registered expressions at each call, the time spent
+//! inside each call and the allocations it made.
+//!
+//!     auto ud = instrumented_updater<> { };
+//!     ud.instrumentation().name("frame");
+//!     ...
+//!     auto const stats = ud.instrumentation().stats();
+//!
+//! Copies of the updater share their statistics.
+//!
+//! \tparam UpdaterType The updater that evaluates the expressions.
+//!
+//! \ingroup observable
+template <typename UpdaterType=updater>
+class instrumented_updater : public UpdaterType
+{
+    static_assert(std::is_base_of<updater, UpdaterType>::value,
+                  "UpdaterType must derive from updater.");
+
+public:
+    using UpdaterType::UpdaterType;
+
+    //! \see updater::update_all()
+    void update_all()
+    {
+        auto expressions = std::size_t { 0 };
+        this->with_entries([&](auto && entries) { expressions = entries.size(); });
+
+        auto const n = instrumentation_.begin_notify();
+        auto const c = instrumentation_.begin_call();
+
+        UpdaterType::update_all();
+
+        instrumentation_.end_call(c, expressions);
+        instrumentation_.end_notify(n);
+    }
+
+    //! Retrieve the updater's instrumentation.
+    auto instrumentation() const noexcept -> counting_instrumentation const &
+    {
+        return instrumentation_;
+    }
+
+private:
+    counting_instrumentation instrumentation_;
+};
+
 //! Observe changes to a single value with automatic synchronization.
 //!
 //! Returns an observable value that is kept in-sync with the provided value.
@@ -113,6 +758,225 @@ inline auto observe(UpdaterType & ud, expr::expression_node<ValueType> && root)
     return value<ValueType> { std::move(e) };
 }
 
+//! Observe changes to a fused expression with automatic evaluation.
+//!
+//! The returned value subscribes directly to the values used by the expression
+//! and evaluates the whole expression at once, whenever any of them change.
+//!
+//! \param[in] root Fused expression to observe. Fused expressions are started
+//!                 with fuse().
+//! \return An observable value that is automatically updated when the
+//!         expression changes.
+//!
+//! \ingroup observable
+template <typename Root, typename = std::enable_if_t<
+                                        expr::is_fused_expression<Root>::value>>
+inline auto observe(Root && root)
+{
+    using expression_type = expr::fused_expression<std::decay_t<Root>,
+                                                   expr::immediate_evaluator>;
+    using value_type = typename expression_type::value_type;
+    auto e = std::make_unique<expression_type>(std::forward<Root>(root));
+    return value<value_type> { std::move(e) };
+}
+
+//! Observe changes to a fused expression with manual synchronization.
+//!
+//! \param[in] ud An \ref updater instance to be used for manually updating the
+//!               returned value with the expression.
+//! \param[in] root Fused expression to observe.
+//! \return An observable value that is updated from the provided expression.
+//!
+//! \see observe(Root &&)
+//! \ingroup observable
+template <typename UpdaterType, typename Root,
+          typename = std::enable_if_t<expr::is_fused_expression<Root>::value>>
+inline auto observe(UpdaterType & ud, Root && root)
+{
+    static_assert(std::is_base_of<updater, UpdaterType>::value,
+                  "UpdaterType must derive from updater.");
+
+    using expression_type = expr::fused_expression<std::decay_t<Root>,
+                                                   UpdaterType>;
+    using value_type = typename expression_type::value_type;
+    auto e = std::make_unique<expression_type>(std::forward<Root>(root), ud);
+    return value<value_type> { std::move(e) };
+}
+
+//! Observe changes to an expression tree that is built inside an arena, with
+//! automatic evaluation.
+//!
+//! The builder is called with the arena in scope, so all nodes of the tree it
+//! returns store their data inside the arena.
+//!
+//! Example:
+//!
+//!     expression_arena arena;
+//!     auto result = observe(arena, [&]() { return a + b * c; });
+//!
+//! \param[in] arena Arena that the expression tree will be built into. The
+//!                  arena must outlive the returned value.
+//! \param[in] build Functor that returns the expression tree, or a value, to
+//!                  observe.
+//! \return An observable value that is automatically updated when the built
+//!         expression tree changes.
+//!
+//! \see observe(expr::expression_node<ValueType> &&)
+//! \ingroup observable
+template <typename Builder>
+inline auto observe(expr::expression_arena & arena, Builder && build)
+{
+    expr::expression_arena::scope const s { arena };
+    return observe(build());
+}
+
+//! Observe changes to an expression tree that is built inside an arena, with
+//! manual synchronization.
+//!
+//! \param[in] ud An \ref updater instance to be used for manually updating the
+//!               returned value with the expression tree.
+//! \param[in] arena Arena that the expression tree will be built into. The
+//!                  arena must outlive the returned value.
+//! \param[in] build Functor that returns the expression tree, or a value, to
+//!                  observe.
+//! \return An observable value that is updated from the built expression.
+//!
+//! \see observe(expr::expression_arena &, Builder &&)
+//! \ingroup observable
+template <typename UpdaterType, typename Builder>
+inline auto observe(UpdaterType & ud, expr::expression_arena & arena,
+                    Builder && build)
+{
+    expr::expression_arena::scope const s { arena };
+    return observe(ud, build());
+}
+
+//! Observe changes to an expression tree that shares its subtrees with other
+//! trees built inside the same context, with automatic evaluation.
+//!
+//! The builder is called with the context in scope, so subtrees that have
+//! already been built in the context are reused.
+//!
+//! Example:
+//!
+//!     expression_context ctx;
+//!     auto r1 = observe(ctx, [&]() { return a * b + 1; });
+//!     auto r2 = observe(ctx, [&]() { return a * b - 1; });
+//!
+//! Here, ``a * b`` is only evaluated once for both results.
+//!
+//! \param[in] context Context that the expression tree will be built in.
+//! \param[in] build Functor that returns the expression tree, or a value, to
+//!                  observe.
+//! \return An observable value that is automatically updated when the built
+//!         expression tree changes.
+//!
+//! \see expr::expression_context
+//! \ingroup observable
+template <typename Builder>
+inline auto observe(expr::expression_context & context, Builder && build)
+{
+    expr::expression_context::scope const s { context };
+    return observe(build());
+}
+
+//! Observe changes to an expression tree that shares its subtrees with other
+//! trees built inside the same context, with manual synchronization.
+//!
+//! \param[in] ud An \ref updater instance to be used for manually updating the
+//!               returned value with the expression tree.
+//! \param[in] context Context that the expression tree will be built in.
+//! \param[in] build Functor that returns the expression tree, or a value, to
+//!                  observe.
+//! \return An observable value that is updated from the built expression.
+//!
+//! \see observe(expr::expression_context &, Builder &&)
+//! \ingroup observable
+template <typename UpdaterType, typename Builder>
+inline auto observe(UpdaterType & ud, expr::expression_context & context,
+                    Builder && build)
+{
+    expr::expression_context::scope const s { context };
+    return observe(ud, build());
+}
+
+//! Observe changes to an expression tree with lazy evaluation.
+//!
+//! Returns a value that is only computed when it is needed. Changes to the
+//! tree mark the value as stale, and reading the stale value evaluates the
+//! changed part of the tree. As long as the value has observers, it is
+//! updated immediately, like a value returned by observe().
+//!
+//! Example:
+//!
+//!     auto result = observe_lazy((a + b) * c);
+//!     a = 5;             // Nothing is computed.
+//!     b = 6;             // Nothing is computed.
+//!     result.get();      // (a + b) * c is computed once.
+//!
+//! \param[in] root Expression tree to observe.
+//! \return An observable value that is evaluated when it is read, or when
+//!         it has observers.
+//!
+//! \warning Reading the value evaluates the expression tree, so it must not
+//!          be done concurrently with changes to the tree's values. If the
+//!          evaluation throws, std::terminate() is called.
+//!
+//! \see observe(expr::expression_node<ValueType> &&)
+//! \ingroup observable
+template <typename ValueType>
+inline auto observe_lazy(expr::expression_node<ValueType> && root)
+{
+    using expression_type = expr::expression<ValueType, expr::lazy_evaluator>;
+    auto e = std::make_unique<expression_type>(std::move(root));
+    return value<ValueType> { std::move(e) };
+}
+
+//! Observe changes to a single value with lazy evaluation.
+//!
+//! \param[in] val Value to observe.
+//! \return An observable value that mirrors the provided value when it is
+//!         read, or when it has observers.
+//!
+//! \see observe_lazy(expr::expression_node<ValueType> &&)
+//! \ingroup observable
+template <typename ... T>
+inline auto observe_lazy(value<T ...> & val)
+{
+    using value_type = std::decay_t<decltype(val.get())>;
+    return observe_lazy(expr::expression_node<value_type> { val });
+}
+
+//! Observe changes to an expression tree that is built lazily.
+//!
+//! The expression trees passed to observe_lazy() have already been evaluated
+//! once, when their nodes were constructed. Nodes built by this builder are
+//! not evaluated until the returned value is first needed.
+//!
+//! Example:
+//!
+//!     auto result = observe_lazy([&]() { return expensive(a) + b; });
+//!
+//! \param[in] build Functor that returns the expression tree, or a value, to
+//!                  observe.
+//! \return An observable value that is evaluated when it is read, or when
+//!         it has observers.
+//!
+//! \see observe_lazy(expr::expression_node<ValueType> &&)
+//! \ingroup observable
+template <typename Builder, typename = std::enable_if_t<
+                                !is_value<Builder>::value &&
+                                !expr::is_expression_node<Builder>::value>>
+inline auto observe_lazy(Builder && build)
+{
+    auto root = [&]() {
+        expr::expr_detail::defer_eval_scope const s;
+        return build();
+    }();
+
+    return observe_lazy(std::move(root));
+}
+
 }
 
 OBSERVABLE_END_CONFIGURE_WARNINGS
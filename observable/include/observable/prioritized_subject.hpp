@@ -0,0 +1,244 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <utility>
+#include <observable/async_subject.hpp>
+#include <observable/detail/type_traits.hpp>
+#include <observable/subject.hpp>
+#include <observable/subscription.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable {
+
+//! Priority class of an observer subscribed to a \ref prioritized_subject.
+//!
+//! \ingroup observable
+enum class observer_priority
+{
+    high,   //!< Called first.
+    normal, //!< Called after all high priority observers.
+    low     //!< Called last; can be deferred if the subject has a time budget.
+};
+
+//! \cond
+template <typename ObserverType, typename Policy=subject_policy>
+class prioritized_subject;
+
+namespace detail {
+
+    //! Deferral state of the prioritized notification running on the calling
+    //! thread.
+    struct dispatch_budget
+    {
+        using clock = std::chrono::steady_clock;
+
+        clock::time_point deadline;
+        std::function<void(async_task)> const * executor;
+
+        //! Innermost notification running on this thread, or null.
+        static auto current() noexcept -> dispatch_budget * &
+        {
+            static thread_local dispatch_budget * b = nullptr;
+            return b;
+        }
+    };
+
+    //! Executor of low priority observers: runs tasks inline until the
+    //! current notification's deadline has passed, then defers them.
+    struct budget_executor
+    {
+        void operator()(async_task task) const
+        {
+            auto const b = dispatch_budget::current();
+            if(!b || dispatch_budget::clock::now() < b->deadline)
+                task();
+            else
+                (*b->executor)(std::move(task));
+        }
+    };
+
+}
+//! \endcond
+
+//! Subject that calls its observers in priority order.
+//!
+//! Each observer is subscribed with an \ref observer_priority. Calling notify()
+//! calls all high priority observers first, then normal priority observers,
+//! then low priority observers. The order of observers with the same priority
+//! is unspecified, like for a regular subject.
+//!
+//! Notifications can be given a time budget with set_budget(). Once the budget
+//! is exceeded, the low priority observers that have not run yet are not
+//! called by notify(), but are submitted to an executor instead:
+//!
+//!     auto s = prioritized_subject<void(int)> { };
+//!     s.subscribe(update_order_book, observer_priority::high);
+//!     s.subscribe(log_price, observer_priority::low);
+//!
+//!     s.set_budget(std::chrono::microseconds { 20 }, background_executor);
+//!
+//! High and normal priority observers always run inside notify(). The budget
+//! is only checked between low priority observers, so a slow observer is never
+//! interrupted.
+//!
+//! All methods, except set_budget(), can be safely called in parallel, from
+//! multiple threads.
+//!
+//! \tparam Args Observer arguments.
+//! \tparam Policy The policy used to store high and normal priority observers.
+//!
+//! \warning Deferred observers are called with copies of the notification's
+//!          arguments. If the subject's arguments are references, the
+//!          referred objects must stay valid until the deferred observers
+//!          have run; use \ref message to share large payloads safely.
+//!
+//! \ingroup observable
+template <typename ... Args, typename Policy>
+class prioritized_subject<void(Args ...), Policy>
+{
+public:
+    using observer_type = void(Args ...);
+
+    //! Type-erased executor, used by deferred observers.
+    using executor_type = std::function<void(async_task)>;
+
+    //! Create a subject without a time budget.
+    prioritized_subject() =default;
+
+    //! Subscribe an observer with a priority.
+    //!
+    //! \param[in] observer An observer callable that will be subscribed to
+    //!                     notifications from this subject.
+    //! \param[in] priority The observer's priority class.
+    //!
+    //! \return An infinite subscription that can be used to unsubscribe the
+    //!         provided observer from receiving notifications from this subject.
+    //!
+    //! \warning Low priority observers can be called from the budget executor,
+    //!          after notify() has returned.
+    //!
+    //! \see subject<void(Args ...)>::subscribe()
+    template <typename Callable>
+    auto subscribe(Callable && observer,
+                   observer_priority priority=observer_priority::normal)
+        -> infinite_subscription
+    {
+        static_assert(detail::is_compatible_with_observer<Callable, observer_type>::value,
+                      "The provided observer object is not callable or not compatible"
+                      " with the subject");
+
+        switch(priority)
+        {
+        case observer_priority::high:
+            return high_.subscribe(std::forward<Callable>(observer));
+        case observer_priority::normal:
+            return normal_.subscribe(std::forward<Callable>(observer));
+        case observer_priority::low:
+        default:
+            return low_.subscribe(detail::budget_executor { },
+                                  std::forward<Callable>(observer));
+        }
+    }
+
+    //! Give each notification a time budget.
+    //!
+    //! \param[in] budget Time, measured from the start of notify(), after
+    //!                   which low priority observers are deferred. A zero
+    //!                   budget defers all low priority observers.
+    //! \param[in] executor Callable that accepts an \ref async_task; receives
+    //!                     one task for each deferred observer.
+    //!
+    //! \warning This method must not be called while notify() is running.
+    template <typename Executor>
+    void set_budget(std::chrono::nanoseconds budget, Executor && executor)
+    {
+        budget_ = budget;
+        executor_ = std::forward<Executor>(executor);
+    }
+
+    //! Remove the time budget; all observers will be called by notify().
+    void clear_budget() noexcept { executor_ = nullptr; }
+
+    //! Notify all currently subscribed observers, in priority order.
+    //!
+    //! \param[in] arguments Arguments that will be forwarded to the subscribed
+    //!                      observers.
+    //!
+    //! \see subject<void(Args ...)>::notify()
+    void notify(Args ... arguments) const
+    {
+        using clock = detail::dispatch_budget::clock;
+        auto const start = executor_ ? clock::now() : clock::time_point { };
+
+        high_.notify(arguments ...);
+        normal_.notify(arguments ...);
+
+        if(low_.empty())
+            return;
+
+        if(!executor_)
+        {
+            budget_scope const scope { nullptr };
+            low_.notify(std::forward<Args>(arguments) ...);
+            return;
+        }
+
+        auto b = detail::dispatch_budget { start + budget_, &executor_ };
+        budget_scope const scope { &b };
+        low_.notify(std::forward<Args>(arguments) ...);
+    }
+
+    //! Return true if there are no subscribers.
+    auto empty() const noexcept
+    {
+        return high_.empty() && normal_.empty() && low_.empty();
+    }
+
+public:
+    //! Subjects are **not** copy-constructible.
+    prioritized_subject(prioritized_subject const &) =delete;
+
+    //! Subjects are **not** copy-assignable.
+    auto operator=(prioritized_subject const &) -> prioritized_subject & =delete;
+
+    //! Subjects are move-constructible.
+    prioritized_subject(prioritized_subject &&) =default;
+
+    //! Subjects are move-assignable.
+    auto operator=(prioritized_subject &&) -> prioritized_subject & =default;
+
+private:
+    //! Makes a budget current for the calling thread, and restores the
+    //! previous one when destroyed, so nested notifications keep their own
+    //! budgets.
+    class budget_scope final
+    {
+    public:
+        explicit budget_scope(detail::dispatch_budget * b) noexcept :
+            previous_ { detail::dispatch_budget::current() }
+        {
+            detail::dispatch_budget::current() = b;
+        }
+
+        ~budget_scope() noexcept { detail::dispatch_budget::current() = previous_; }
+
+        budget_scope(budget_scope const &) =delete;
+        auto operator=(budget_scope const &) -> budget_scope & =delete;
+
+    private:
+        detail::dispatch_budget * previous_;
+    };
+
+private:
+    subject<observer_type, Policy> high_;
+    subject<observer_type, Policy> normal_;
+    async_subject<observer_type> low_ { detail::budget_executor { } };
+    std::chrono::nanoseconds budget_ { 0 };
+    executor_type executor_;
+};
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
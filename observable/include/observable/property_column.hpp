@@ -0,0 +1,440 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <observable/batch.hpp>
+#include <observable/subject.hpp>
+#include <observable/subscription.hpp>
+#include <observable/value.hpp>
+#include <observable/detail/type_traits.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable {
+
+//! Description of a change made to a \ref property_column.
+//!
+//! All changed rows are inside ``[first, first + count)``. If ``rows`` is
+//! null, every row of that range may have changed; otherwise, only the
+//! ``row_count`` rows it points to, sorted in increasing order, have changed.
+//!
+//! \ingroup observable
+template <typename ValueType>
+struct column_change
+{
+    //! Index of the first row that may have changed.
+    std::size_t first;
+
+    //! Number of rows, starting at ``first``, that may have changed.
+    std::size_t count;
+
+    //! Sorted indices of the changed rows, or null if the whole range changed.
+    std::size_t const * rows;
+
+    //! Number of indices pointed to by ``rows``.
+    std::size_t row_count;
+
+    //! The column's values, indexed by row.
+    ValueType const * values;
+
+    //! Return true if the provided row has changed.
+    auto contains(std::size_t row) const noexcept
+    {
+        if(row < first || row - first >= count)
+            return false;
+
+        return !rows || std::binary_search(rows, rows + row_count, row);
+    }
+};
+
+//! Contiguous storage for the same property of many objects.
+//!
+//! An object model that uses \ref observable_property stores a full value,
+//! with its own subjects, inside every object. A column stores the property
+//! of all objects in one contiguous array, indexed by row, and notifies all
+//! of its observers through a single subject:
+//!
+//!     auto prices = property_column<double> { };
+//!     auto const row = prices.push_back(100.0);
+//!
+//!     auto sub = prices.subscribe(row, [](double p) { ... });
+//!
+//!     // One vectorizable loop and one notification.
+//!     prices.transform([](double p) { return p * 1.01; });
+//!
+//! Observers of the whole column receive a \ref column_change that describes
+//! the changed rows. Observers of a single row are filters over the column
+//! subject; they are only called when their row has changed.
+//!
+//! If a \ref batch is open on the calling thread, changes are accumulated and
+//! all column observers are notified once, when the batch is committed, with a
+//! change that covers all of the modified rows.
+//!
+//! Rows can only be added, not removed, so row indices stay valid for as long
+//! as the column exists.
+//!
+//! \warning None of the methods in this class can be safely called
+//!          concurrently.
+//!
+//! \tparam ValueType Type of the stored property.
+//! \tparam Policy Subject policy used by the column's subject.
+//!
+//! \ingroup observable
+template <typename ValueType, typename Policy=subject_policy>
+class property_column final
+{
+    static_assert(!std::is_same<ValueType, bool>::value,
+                  "property_column<bool> is not supported.");
+
+public:
+    using value_type = ValueType;
+    using size_type = std::size_t;
+    using change_type = column_change<ValueType>;
+    using observer_type = void(change_type const &);
+
+    //! Create an empty column.
+    property_column() =default;
+
+    //! Create a column with the provided rows.
+    explicit property_column(std::vector<ValueType> values) :
+        values_(std::move(values))
+    { }
+
+    //! Subscribe to changes to any row.
+    //!
+    //! \param[in] observer Callable compatible with ``void(change_type const &)``.
+    //! \return An infinite subscription that can be used to unsubscribe the
+    //!         observer.
+    template <typename Callable>
+    auto subscribe(Callable && observer) const
+    {
+        return changes_.subscribe(std::forward<Callable>(observer));
+    }
+
+    //! Subscribe to changes to a single row.
+    //!
+    //! \param[in] row Row to observe. The row does not need to exist yet.
+    //! \param[in] observer A callable taking no parameters, or taking the
+    //!                     row's new value, like a \ref value "value" observer.
+    //! \return An infinite subscription that can be used to unsubscribe the
+    //!         observer.
+    template <typename Callable>
+    auto subscribe(size_type row, Callable && observer) const
+    {
+        static_assert(detail::is_compatible_with_observer<Callable, void()>::value ||
+                      detail::is_compatible_with_observer<Callable,
+                                                          void(ValueType const &)>::value,
+                      "Observer is not valid. Please provide a void observer or an "
+                      "observer that takes a ValueType as its only argument.");
+
+        return changes_.subscribe(
+                    [row, o = std::forward<Callable>(observer)](change_type const & c) {
+                        if(c.contains(row))
+                            call(o, c.values[row]);
+                    });
+    }
+
+    //! Number of rows.
+    auto size() const noexcept { return values_.size(); }
+
+    //! Return true if there are no rows.
+    auto empty() const noexcept { return values_.empty(); }
+
+    //! Retrieve the value of a row. The row must be valid.
+    auto operator[](size_type row) const noexcept -> ValueType const &
+    {
+        assert(row < values_.size());
+        return values_[row];
+    }
+
+    //! \see operator[]()
+    auto get(size_type row) const noexcept -> ValueType const & { return (*this)[row]; }
+
+    //! Retrieve all rows, in a contiguous array.
+    auto data() const noexcept -> ValueType const * { return values_.data(); }
+
+    //! Add a row. Observers are not notified.
+    //!
+    //! \return The index of the new row.
+    auto push_back(ValueType v) -> size_type
+    {
+        values_.push_back(std::move(v));
+        return values_.size() - 1;
+    }
+
+    //! Set the value of a row.
+    //!
+    //! Observers are not notified if the new value is equal to the old one.
+    void set(size_type row, ValueType v)
+    {
+        assert(row < values_.size());
+        if(detail::equal_to { }(values_[row], v))
+            return;
+
+        values_[row] = std::move(v);
+        changed(row);
+    }
+
+    //! Modify the value of a row in place.
+    //!
+    //! \param[in] row Row to modify.
+    //! \param[in] fun Functor called with a ``ValueType &``; must return true
+    //!                if it has changed the value.
+    //! \return The value returned by the functor.
+    template <typename Fun>
+    auto update(size_type row, Fun && fun) -> bool
+    {
+        assert(row < values_.size());
+        if(!fun(values_[row]))
+            return false;
+
+        changed(row);
+        return true;
+    }
+
+    //! Replace the value of every row with the result of a functor.
+    //!
+    //! The functor is called with each value and returns its replacement, in a
+    //! simple loop over the contiguous column, which the compiler can
+    //! vectorize. All observers are then notified once, with a change that
+    //! covers every row.
+    //!
+    //! \param[in] fun Functor with a signature compatible with
+    //!                ``ValueType(ValueType const &)``.
+    template <typename Fun>
+    void transform(Fun && fun)
+    {
+        transform(0, values_.size(), std::forward<Fun>(fun));
+    }
+
+    //! Replace the values of ``count`` rows, starting at ``first``, with the
+    //! result of a functor.
+    //!
+    //! \see transform(Fun &&)
+    template <typename Fun>
+    void transform(size_type first, size_type count, Fun && fun)
+    {
+        assert(first + count <= values_.size());
+        if(count == 0)
+            return;
+
+        auto const p = values_.data() + first;
+        for(auto i = size_type { 0 }; i < count; ++i)
+            p[i] = fun(p[i]);
+
+        changed_range(first, count);
+    }
+
+    //! Overwrite rows with the provided values, starting at ``first``.
+    //!
+    //! \param[in] first Index of the first row to overwrite.
+    //! \param[in] begin Iterator to the first new value.
+    //! \param[in] end Iterator past the last new value. The values must fit
+    //!                inside the column; values that do not fit are never
+    //!                written.
+    template <typename InputIt>
+    void assign(size_type first, InputIt begin, InputIt end)
+    {
+        assert(first <= values_.size());
+        if(first > values_.size())
+            return;
+
+        using category = typename std::iterator_traits<InputIt>::iterator_category;
+        auto const count = copy_rows(first, begin, end, category { });
+        if(count > 0)
+            changed_range(first, count);
+    }
+
+public:
+    //! Columns are **not** copy-constructible.
+    property_column(property_column const &) =delete;
+
+    //! Columns are **not** copy-assignable.
+    auto operator=(property_column const &) -> property_column & =delete;
+
+    //! Columns are move-constructible.
+    //!
+    //! Observers, and changes waiting for a batch, follow the moved column.
+    property_column(property_column && other) :
+        values_(std::move(other.values_)),
+        changes_ { std::move(other.changes_) }
+    {
+        take_pending(other);
+    }
+
+    //! Columns are move-assignable.
+    //!
+    //! The observers of the moved-into column are replaced.
+    auto operator=(property_column && other) -> property_column &
+    {
+        if(pending_)
+            batch::cancel(this);
+
+        pending_ = false;
+        values_ = std::move(other.values_);
+        changes_ = std::move(other.changes_);
+        take_pending(other);
+        return *this;
+    }
+
+    //! Destructor.
+    ~property_column()
+    {
+        if(pending_)
+            batch::cancel(this);
+    }
+
+private:
+    template <typename Callable>
+    static auto call(Callable const & observer, ValueType const &) ->
+        std::enable_if_t<!detail::is_compatible_with_observer<
+                                Callable, void(ValueType const &)>::value>
+    {
+        observer();
+    }
+
+    template <typename Callable>
+    static auto call(Callable const & observer, ValueType const & v) ->
+        std::enable_if_t<detail::is_compatible_with_observer<
+                                Callable, void(ValueType const &)>::value>
+    {
+        observer(v);
+    }
+
+    //! Copy a range whose size is known, after checking that it fits.
+    template <typename ForwardIt>
+    auto copy_rows(size_type first, ForwardIt begin, ForwardIt end,
+                   std::forward_iterator_tag) -> size_type
+    {
+        auto const size = static_cast<size_type>(std::distance(begin, end));
+        assert(size <= values_.size() - first);
+
+        auto const count = std::min(size, values_.size() - first);
+        std::copy_n(begin, count, values_.begin() + first);
+        return count;
+    }
+
+    //! Copy a single-pass range, stopping at the end of the column.
+    template <typename InputIt>
+    auto copy_rows(size_type first, InputIt begin, InputIt end,
+                   std::input_iterator_tag) -> size_type
+    {
+        auto count = size_type { 0 };
+        for(; begin != end && first + count < values_.size(); ++begin, ++count)
+            values_[first + count] = *begin;
+
+        assert(begin == end);
+        return count;
+    }
+
+    void take_pending(property_column & other) noexcept
+    {
+        if(!other.pending_)
+            return;
+
+        batch::retarget(&other, this);
+        pending_ = true;
+        all_ = other.all_;
+        pending_rows_ = std::move(other.pending_rows_);
+        range_first_ = other.range_first_;
+        range_last_ = other.range_last_;
+        other.pending_ = false;
+    }
+
+    //! Notify a single row change, or record it if a batch is open.
+    void changed(size_type row)
+    {
+        if(defer())
+        {
+            range_first_ = std::min(range_first_, row);
+            range_last_ = std::max(range_last_, row + 1);
+            if(!all_)
+                pending_rows_.push_back(row);
+
+            return;
+        }
+
+        notify(change_type { row, 1, nullptr, 0, values_.data() });
+    }
+
+    //! Notify a change to a range of rows, or record it if a batch is open.
+    void changed_range(size_type first, size_type count)
+    {
+        if(defer())
+        {
+            // Ranges are usually large; the batch reports one range of rows
+            // instead of listing each row.
+            all_ = true;
+            pending_rows_.clear();
+            range_first_ = std::min(range_first_, first);
+            range_last_ = std::max(range_last_, first + count);
+            return;
+        }
+
+        notify(change_type { first, count, nullptr, 0, values_.data() });
+    }
+
+    //! Return true if a batch will deliver the change.
+    auto defer() -> bool
+    {
+        if(!pending_)
+        {
+            pending_ = batch::defer(this, &flush);
+            if(!pending_)
+                return false;
+
+            range_first_ = values_.size();
+            range_last_ = 0;
+        }
+
+        return true;
+    }
+
+    void notify(change_type const & change) const { changes_.notify(change); }
+
+    //! Deliver the changes accumulated by a batch.
+    static void flush(void * target, bool notify)
+    {
+        auto & c = *static_cast<property_column *>(target);
+        c.pending_ = false;
+
+        auto rows = std::move(c.pending_rows_);
+        c.pending_rows_.clear();
+        auto const all = std::exchange(c.all_, false);
+
+        if(!notify || c.range_last_ <= c.range_first_)
+            return;
+
+        auto change = change_type { c.range_first_, c.range_last_ - c.range_first_,
+                                    nullptr, 0, c.values_.data() };
+        if(!all)
+        {
+            std::sort(rows.begin(), rows.end());
+            rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+            change.rows = rows.data();
+            change.row_count = rows.size();
+        }
+
+        c.notify(change);
+    }
+
+private:
+    std::vector<ValueType> values_;
+    mutable subject<observer_type, Policy> changes_;
+
+    // Changes recorded while a batch is open.
+    bool pending_ { false };
+    bool all_ { false };
+    std::vector<size_type> pending_rows_;
+    size_type range_first_ { 0 };
+    size_type range_last_ { 0 };
+};
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
@@ -0,0 +1,44 @@
+#pragma once
+
+// Qt event loop integration. This header is not included by observable.hpp,
+// since it needs Qt 5.10 or later.
+
+#include <memory>
+#include <QMetaObject>
+#include <QObject>
+#include <observable/event_loop.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable {
+
+//! Post function that queues tasks on the event loop of a QObject's thread.
+//!
+//! Use it to create a \ref loop_dispatcher that runs its passes on the Qt
+//! event loop:
+//!
+//!     auto loop = loop_dispatcher { qt_post(&window) };
+//!
+//! Tasks are queued with ``Qt::QueuedConnection``, so they run on the
+//! context's thread, from the event loop, even if they are posted from that
+//! same thread.
+//!
+//! \param[in] context Object whose thread runs the tasks. It must outlive the
+//!                    dispatcher; tasks that are still queued when it is
+//!                    destroyed are dropped by Qt.
+//! \return A callable that accepts an \ref async_task.
+//!
+//! \ingroup observable
+inline auto qt_post(QObject * context)
+{
+    return [context](async_task task) {
+        // Qt copies functors, and tasks are move-only.
+        auto const t = std::make_shared<async_task>(std::move(task));
+        QMetaObject::invokeMethod(context, [t]() { (*t)(); }, Qt::QueuedConnection);
+    };
+}
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
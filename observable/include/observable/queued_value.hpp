@@ -0,0 +1,121 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <observable/value.hpp>
+#include <observable/detail/spsc_queue.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable {
+
+//! Value that is set from one thread and observed from another.
+//!
+//! A producer thread calls push() to enqueue new values into a bounded,
+//! lock-free ring buffer. The consumer thread calls drain(), usually from its
+//! own loop, to apply the enqueued values to an observable value, in order.
+//!
+//! The observable value behaves exactly like a regular value, on the consumer
+//! thread: observers are notified from drain(), values that are equal to the
+//! current one do not trigger notifications, and it can be used inside
+//! expressions.
+//!
+//! Example:
+//!
+//!     auto price = queued_value<double> { 1024 };
+//!
+//!     // Network thread.
+//!     price.push(42.0);
+//!
+//!     // UI thread.
+//!     auto const sub = price.output().subscribe([](double p) { ... });
+//!     price.drain();
+//!
+//! \note For more than one producer, use one queued value per producer.
+//!
+//! \warning push() must only be called from one thread at a time. All other
+//!          methods must only be called from the consumer thread.
+//!
+//! \tparam ValueType The value-type that will be stored inside the observable.
+//!                   This type will need to be at least movable.
+//!
+//! \ingroup observable
+template <typename ValueType>
+class queued_value final
+{
+public:
+    //! Type of the observable value that drained values are applied to.
+    using output_type = value<ValueType, queued_value>;
+
+    //! Create a queued value.
+    //!
+    //! \param[in] capacity Minimum number of values that can be waiting to be
+    //!                     drained.
+    //! \param[in] initial_value Initial value of the output.
+    explicit queued_value(std::size_t capacity,
+                          ValueType initial_value=ValueType { }) :
+        queue_ { std::make_unique<queue>(capacity) },
+        output_ { std::move(initial_value) }
+    { }
+
+    //! Enqueue a new value. This is wait-free.
+    //!
+    //! \param[in] new_value Value that will be applied by the next drain().
+    //! \return False if the queue is full; the value is dropped.
+    auto push(ValueType new_value) -> bool
+    {
+        return queue_->try_push(std::move(new_value));
+    }
+
+    //! Apply all the enqueued values to the output, in the order in which they
+    //! were pushed.
+    //!
+    //! \return Number of values that have been applied.
+    auto drain() -> std::size_t
+    {
+        auto count = std::size_t { 0 };
+        while(queue_->try_pop([&](ValueType && v) { output_.set(std::move(v)); }))
+            ++count;
+
+        return count;
+    }
+
+    //! Maximum number of values that can be waiting to be drained.
+    auto capacity() const noexcept { return queue_->capacity(); }
+
+    //! Retrieve the output's current value.
+    auto get() const noexcept -> ValueType const & { return output_.get(); }
+
+    //! Observable value that drained values are applied to.
+    //!
+    //! The output can be subscribed to and used in expressions, but it can only
+    //! be set through push() and drain().
+    auto output() noexcept -> output_type & { return output_; }
+
+    //! \see output()
+    auto output() const noexcept -> output_type const & { return output_; }
+
+public:
+    //! Queued values are not copy-constructible.
+    queued_value(queued_value const &) =delete;
+
+    //! Queued values are not copy-assignable.
+    auto operator=(queued_value const &) -> queued_value & =delete;
+
+    //! Queued values are move-constructible.
+    queued_value(queued_value &&) =default;
+
+    //! Queued values are move-assignable.
+    auto operator=(queued_value &&) -> queued_value & =default;
+
+private:
+    using queue = detail::spsc_queue<ValueType>;
+
+    std::unique_ptr<queue> queue_;
+    output_type output_;
+};
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
@@ -0,0 +1,582 @@
+#pragma once
+
+// Binary recording and replay of value and subject traffic. This header is
+// not included by observable.hpp, since it is only available on POSIX systems.
+
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <observable/serializer.hpp>
+#include <observable/subject.hpp>
+#include <observable/subscription.hpp>
+#include <observable/value.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable {
+
+//! \cond
+namespace detail {
+
+    //! Layout of a recording file.
+    //!
+    //! The file starts with a header, followed by records. Each record is
+    //! aligned to 8 bytes, and holds the arguments of one notification, each
+    //! preceded by its size. Numbers are stored in the native byte order.
+    struct recording_layout
+    {
+        static constexpr std::uint32_t expected_magic = 0x6f627263; // "obrc"
+        static constexpr std::uint32_t version = 1;
+        static constexpr std::uint32_t padding_channel =
+                                    std::numeric_limits<std::uint32_t>::max();
+
+        struct file_header
+        {
+            std::uint32_t magic;
+            std::uint32_t version;
+        };
+
+        struct record_header
+        {
+            //! Size of the record, header included. Zero until the record has
+            //! been completely written.
+            std::atomic<std::uint32_t> length;
+            std::uint32_t channel;
+            //! Nanoseconds since the recording started.
+            std::uint64_t time;
+        };
+
+        using arg_size = std::uint32_t;
+
+        static constexpr auto align(std::size_t size) noexcept
+        {
+            return (size + 7) & ~std::size_t { 7 };
+        }
+    };
+
+    static_assert(sizeof(recording_layout::file_header) == 8 &&
+                  sizeof(recording_layout::record_header) == 16,
+                  "Unexpected recording layout.");
+
+    //! A file mapped in memory.
+    class mapped_file final
+    {
+    public:
+        //! Create or truncate a file of ``size`` bytes, mapped for writing.
+        mapped_file(std::string const & path, std::size_t size) :
+            fd_ { ::open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644) },
+            size_ { size }
+        {
+            if(fd_ < 0)
+                throw std::system_error { errno, std::generic_category(),
+                                          "Could not create " + path };
+
+            if(::ftruncate(fd_, static_cast<off_t>(size)) != 0)
+                fail("Could not resize " + path);
+
+            map(path, PROT_READ | PROT_WRITE, MAP_SHARED);
+        }
+
+        //! Open an existing file, mapped for reading.
+        explicit mapped_file(std::string const & path) :
+            fd_ { ::open(path.c_str(), O_RDONLY) }
+        {
+            if(fd_ < 0)
+                throw std::system_error { errno, std::generic_category(),
+                                          "Could not open " + path };
+
+            struct stat st;
+            if(::fstat(fd_, &st) != 0)
+                fail("Could not inspect " + path);
+
+            size_ = static_cast<std::size_t>(st.st_size);
+            if(size_ > 0)
+                map(path, PROT_READ, MAP_PRIVATE);
+        }
+
+        auto address() const noexcept { return static_cast<char *>(address_); }
+        auto size() const noexcept { return size_; }
+
+        //! Unmap the file, and truncate it to ``size`` bytes.
+        void close(std::size_t size) noexcept
+        {
+            unmap();
+            if(size < size_)
+                static_cast<void>(::ftruncate(fd_, static_cast<off_t>(size)));
+        }
+
+        ~mapped_file()
+        {
+            unmap();
+            ::close(fd_);
+        }
+
+        mapped_file(mapped_file const &) =delete;
+        auto operator=(mapped_file const &) -> mapped_file & =delete;
+
+    private:
+        void map(std::string const & path, int protection, int flags)
+        {
+            address_ = ::mmap(nullptr, size_, protection, flags, fd_, 0);
+            if(address_ == MAP_FAILED)
+            {
+                address_ = nullptr;
+                fail("Could not map " + path);
+            }
+        }
+
+        [[noreturn]] void fail(std::string const & message)
+        {
+            auto const error = errno;
+            ::close(fd_);
+            throw std::system_error { error, std::generic_category(), message };
+        }
+
+        void unmap() noexcept
+        {
+            if(address_)
+                ::munmap(address_, size_);
+            address_ = nullptr;
+        }
+
+        int fd_;
+        std::size_t size_ { 0 };
+        void * address_ { nullptr };
+    };
+
+    //! Recording file that records are appended to, from any thread.
+    //!
+    //! Space for each record is reserved by incrementing an atomic offset, so
+    //! writers never wait for each other, and never make system calls: the
+    //! operating system writes the mapped pages back to the file.
+    class record_log final
+    {
+        using layout = recording_layout;
+
+    public:
+        record_log(std::string const & path, std::size_t capacity) :
+            file_ { path, layout::align(capacity < sizeof(layout::file_header) ?
+                                            sizeof(layout::file_header) :
+                                            capacity) }
+        {
+            auto const header = reinterpret_cast<layout::file_header *>(file_.address());
+            header->magic = layout::expected_magic;
+            header->version = layout::version;
+        }
+
+        //! Append a record holding ``args``.
+        template <typename ... Args>
+        void append(std::uint32_t channel, Args const & ... args)
+        {
+            auto const time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    clock::now() - start_).count();
+
+            auto payload = std::size_t { 0 };
+            for(auto s : { arg_size(args) ... , std::size_t { 0 } })
+                payload += s;
+
+            auto const length = layout::align(sizeof(layout::record_header) + payload);
+            if(length > std::numeric_limits<std::uint32_t>::max())
+            {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            auto const offset = next_.fetch_add(length, std::memory_order_relaxed);
+            if(offset + length > file_.size())
+            {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            auto const p = file_.address() + offset;
+            auto const header = reinterpret_cast<layout::record_header *>(p);
+            header->channel = channel;
+            header->time = static_cast<std::uint64_t>(time);
+
+            try {
+                auto out = p + sizeof(layout::record_header);
+                for(auto o : { write_arg(args, out) ... , out })
+                    static_cast<void>(o);
+            } catch(...) {
+                // Readers stop at the first incomplete record; this one is
+                // skipped instead.
+                header->channel = layout::padding_channel;
+                header->length.store(static_cast<std::uint32_t>(length),
+                                     std::memory_order_release);
+                throw;
+            }
+
+            header->length.store(static_cast<std::uint32_t>(length),
+                                 std::memory_order_release);
+        }
+
+        auto size() const noexcept
+        {
+            auto const used = next_.load(std::memory_order_relaxed);
+            return used < file_.size() ? used : file_.size();
+        }
+
+        auto dropped() const noexcept
+        {
+            return dropped_.load(std::memory_order_relaxed);
+        }
+
+        //! Truncates the file to the records that have been appended.
+        ~record_log() { file_.close(size()); }
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        template <typename T>
+        static auto arg_size(T const & v) noexcept
+        {
+            return sizeof(layout::arg_size) + serializer<T>::size(v);
+        }
+
+        template <typename T>
+        static auto write_arg(T const & v, char * & out) -> char *
+        {
+            auto const size = serializer<T>::size(v);
+            if(size > std::numeric_limits<layout::arg_size>::max())
+                throw std::length_error { "Recorded object is too large." };
+
+            auto const s = static_cast<layout::arg_size>(size);
+            std::memcpy(out, &s, sizeof(s));
+            serializer<T>::write(v, out + sizeof(s));
+
+            out += sizeof(s) + size;
+            return out;
+        }
+
+        mapped_file file_;
+        clock::time_point const start_ { clock::now() };
+        std::atomic<std::size_t> next_ { sizeof(layout::file_header) };
+        std::atomic<std::size_t> dropped_ { 0 };
+    };
+
+    //! Reads the arguments of a record, in order.
+    class record_reader final
+    {
+        using layout = recording_layout;
+
+    public:
+        record_reader(char const * data, std::size_t size) noexcept :
+            data_ { data },
+            end_ { data + size }
+        { }
+
+        template <typename T>
+        auto next() -> T
+        {
+            auto s = layout::arg_size { 0 };
+            if(static_cast<std::size_t>(end_ - data_) < sizeof(s))
+                throw std::runtime_error { "Recorded notification is truncated." };
+
+            std::memcpy(&s, data_, sizeof(s));
+            data_ += sizeof(s);
+
+            if(static_cast<std::size_t>(end_ - data_) < s)
+                throw std::runtime_error { "Recorded notification is truncated." };
+
+            auto const in = data_;
+            data_ += s;
+            return serializer<T>::read(in, s);
+        }
+
+    private:
+        char const * data_;
+        char const * end_;
+    };
+
+}
+//! \endcond
+
+//! Records the notifications of values and subjects to a binary file.
+//!
+//! Each notification is appended as a timestamped record, tagged with the
+//! channel number of its source. A \ref replayer reads the file back, and
+//! notifies the same, or other, values and subjects:
+//!
+//!     auto rec = recorder { "/tmp/prices.rec", 64 << 20 };
+//!     rec.record(price, 1);
+//!     rec.record(trades, 2);
+//!
+//! The file is mapped in memory, and has a fixed capacity. Recording a
+//! notification never locks and never makes a system call; notifications
+//! that do not fit are dropped, and counted.
+//!
+//! Arguments are converted to bytes by \ref serializer specializations.
+//!
+//! \warning Recordings use the native byte order and the serializers' format;
+//!          they are meant to be replayed on the same kind of machine.
+//!
+//! \ingroup observable
+class recorder final
+{
+public:
+    //! Create, or truncate, a recording file.
+    //!
+    //! \param[in] path Path of the file.
+    //! \param[in] capacity Maximum size of the file, in bytes. The file is
+    //!                     truncated to the recorded size when the recorder is
+    //!                     destroyed.
+    //! \throw std::system_error if the file cannot be created.
+    recorder(std::string const & path, std::size_t capacity) :
+        log_ { std::make_shared<detail::record_log>(path, capacity) }
+    { }
+
+    //! Record the changes of a value.
+    //!
+    //! The current value is recorded immediately, so a replay starts from the
+    //! same state.
+    //!
+    //! \param[in] v Recorded value. It can be destroyed before the recorder.
+    //! \param[in] channel Number identifying the value in the recording. It
+    //!                    must be less than ``0xffffffff``.
+    template <typename ValueType, typename ... Rest>
+    void record(value<ValueType, Rest ...> & v, std::uint32_t channel)
+    {
+        assert(channel != detail::recording_layout::padding_channel);
+
+        log_->append(channel, v.get());
+        subscriptions_.emplace_back(
+            v.subscribe([log = log_, channel](ValueType const & n) {
+                log->append(channel, n);
+            }));
+    }
+
+    //! Record the notifications of a subject.
+    //!
+    //! \param[in] s Recorded subject. It can be destroyed before the recorder.
+    //! \param[in] channel Number identifying the subject in the recording. It
+    //!                    must be less than ``0xffffffff``.
+    template <typename ... Args, typename Policy>
+    void record(detail::subject_base<void(Args ...), Policy> & s,
+                std::uint32_t channel)
+    {
+        assert(channel != detail::recording_layout::padding_channel);
+
+        subscriptions_.emplace_back(
+            s.subscribe([log = log_, channel](Args ... args) {
+                log->append(channel, static_cast<std::decay_t<Args> const &>(args) ...);
+            }));
+    }
+
+    //! Number of bytes that have been recorded, file header included.
+    auto size() const noexcept { return log_->size(); }
+
+    //! Number of notifications that have been dropped because the file was
+    //! full.
+    auto dropped() const noexcept { return log_->dropped(); }
+
+    //! Destructor. Stops recording.
+    //!
+    //! The file is closed once notifications that are being recorded on other
+    //! threads have completed.
+    ~recorder() =default;
+
+public:
+    //! Recorders are not copy-constructible.
+    recorder(recorder const &) =delete;
+
+    //! Recorders are not copy-assignable.
+    auto operator=(recorder const &) -> recorder & =delete;
+
+    //! Recorders are move-constructible.
+    recorder(recorder &&) =default;
+
+    //! Recorders are move-assignable.
+    auto operator=(recorder &&) -> recorder & =default;
+
+private:
+    std::shared_ptr<detail::record_log> log_;
+    std::vector<unique_subscription> subscriptions_;
+};
+
+//! Speed at which a \ref replayer delivers recorded notifications.
+//!
+//! \ingroup observable
+enum class replay_rate
+{
+    //! Keep the delays between notifications that were recorded.
+    original,
+    //! Deliver notifications as fast as possible.
+    maximum,
+};
+
+//! Replays a file written by a \ref recorder.
+//!
+//! Each channel of the recording can be bound to a value or a subject, which
+//! is set or notified with the recorded arguments. Records of channels that
+//! are not bound are skipped:
+//!
+//!     auto rep = replayer { "/tmp/prices.rec" };
+//!     rep.bind(1, price);
+//!     rep.bind(2, trades);
+//!     rep.replay(replay_rate::maximum);
+//!
+//! Notifications are delivered on the thread that calls replay(), in the
+//! order in which they were recorded.
+//!
+//! \ingroup observable
+class replayer final
+{
+    using layout = detail::recording_layout;
+
+public:
+    //! Open a recording file.
+    //!
+    //! \param[in] path Path of a file written by a recorder that has been
+    //!                 destroyed.
+    //! \throw std::system_error if the file cannot be opened.
+    //! \throw std::runtime_error if the file is not a recording.
+    explicit replayer(std::string const & path) :
+        file_ { std::make_shared<detail::mapped_file>(path) }
+    {
+        auto header = layout::file_header { };
+        if(file_->size() >= sizeof(header))
+            std::memcpy(&header, file_->address(), sizeof(header));
+
+        if(header.magic != layout::expected_magic || header.version != layout::version)
+            throw std::runtime_error { path + " is not a recording." };
+    }
+
+    //! Set a value with each recorded argument of a channel.
+    //!
+    //! \param[in] channel A channel number passed to recorder::record().
+    //! \param[in] v Value that will be set. It must outlive the replayer, or
+    //!              be bound to another channel.
+    template <typename ValueType, typename ... Rest>
+    void bind(std::uint32_t channel, value<ValueType, Rest ...> & v)
+    {
+        handlers_[channel] = [&v](detail::record_reader & r) {
+            v.set(r.next<ValueType>());
+        };
+    }
+
+    //! Notify a subject with each recorded notification of a channel.
+    //!
+    //! \param[in] channel A channel number passed to recorder::record().
+    //! \param[in] s Subject that will be notified. It must outlive the
+    //!              replayer, or be bound to another channel.
+    template <typename ... Args, typename Policy>
+    void bind(std::uint32_t channel, detail::subject_base<void(Args ...), Policy> & s)
+    {
+        handlers_[channel] = [&s](detail::record_reader & r) {
+            // Braced initializers are evaluated in order.
+            auto args = std::tuple<std::decay_t<Args> ...> { r.next<std::decay_t<Args>>() ... };
+            notify(s, args, std::index_sequence_for<Args ...> { });
+        };
+    }
+
+    //! Stop delivering the notifications of a channel.
+    void unbind(std::uint32_t channel) { handlers_.erase(channel); }
+
+    //! Deliver all recorded notifications.
+    //!
+    //! Exceptions thrown by values, subjects or serializers are propagated;
+    //! the remaining notifications are not delivered.
+    //!
+    //! \param[in] rate Speed of the replay.
+    //! \return Number of notifications that have been delivered.
+    //! \throw std::runtime_error if the file is corrupted.
+    auto replay(replay_rate rate=replay_rate::original) const -> std::size_t
+    {
+        using clock = std::chrono::steady_clock;
+
+        auto const data = file_->address();
+        auto const size = file_->size();
+
+        auto delivered = std::size_t { 0 };
+        auto start = clock::time_point { };
+        auto first_time = std::uint64_t { 0 };
+
+        auto offset = sizeof(layout::file_header);
+        while(size - offset >= sizeof(layout::record_header))
+        {
+            // The file is mapped privately, for reading only, so the atomic
+            // length is only read through a copy.
+            auto length = std::uint32_t { 0 };
+            auto channel = std::uint32_t { 0 };
+            auto time = std::uint64_t { 0 };
+            std::memcpy(&length, data + offset, sizeof(length));
+            std::memcpy(&channel, data + offset + 4, sizeof(channel));
+            std::memcpy(&time, data + offset + 8, sizeof(time));
+
+            // Recording stopped while this record was being written.
+            if(length == 0)
+                break;
+
+            if(length < sizeof(layout::record_header) || length > size - offset ||
+               length != layout::align(length))
+                throw std::runtime_error { "Recording is corrupted." };
+
+            auto const handler = handlers_.find(channel);
+            if(channel != layout::padding_channel && handler != handlers_.end())
+            {
+                if(rate == replay_rate::original)
+                {
+                    if(delivered == 0)
+                    {
+                        start = clock::now();
+                        first_time = time;
+                    }
+                    else if(time > first_time)
+                    {
+                        std::this_thread::sleep_until(
+                            start + std::chrono::nanoseconds { time - first_time });
+                    }
+                }
+
+                auto reader = detail::record_reader {
+                    data + offset + sizeof(layout::record_header),
+                    length - sizeof(layout::record_header)
+                };
+                handler->second(reader);
+                ++delivered;
+            }
+
+            offset += length;
+        }
+
+        return delivered;
+    }
+
+private:
+    template <typename Subject, typename Tuple, std::size_t ... I>
+    static void notify(Subject & s, Tuple & args, std::index_sequence<I ...>)
+    {
+        s.notify(std::get<I>(args) ...);
+    }
+
+private:
+    std::shared_ptr<detail::mapped_file> file_;
+    std::unordered_map<std::uint32_t,
+                       std::function<void(detail::record_reader &)>> handlers_;
+};
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
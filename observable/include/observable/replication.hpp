@@ -0,0 +1,638 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <observable/observe.hpp>
+#include <observable/serializer.hpp>
+#include <observable/subscription.hpp>
+#include <observable/value.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable {
+
+//! \cond
+namespace detail {
+
+    //! Layout of a replication packet.
+    //!
+    //! A packet starts with a header, followed by entries that each hold the
+    //! serialized state of one value. Numbers are stored in the native byte
+    //! order.
+    struct replication_layout
+    {
+        static constexpr std::uint32_t expected_magic = 0x6f627270; // "obrp"
+
+        enum kind : std::uint32_t
+        {
+            delta = 0,
+            snapshot = 1,
+        };
+
+        struct packet_header
+        {
+            std::uint32_t magic;
+            std::uint32_t kind;
+            //! Delta packets are numbered from 1. Snapshot packets hold the
+            //! number of the last delta packet that was sent before them.
+            std::uint64_t sequence;
+        };
+
+        struct entry_header
+        {
+            std::uint32_t id;
+            std::uint32_t size;
+        };
+    };
+
+    static_assert(sizeof(replication_layout::packet_header) == 16 &&
+                  sizeof(replication_layout::entry_header) == 8,
+                  "Unexpected replication layout.");
+
+}
+//! \endcond
+
+//! Sends the state of local values to replication_subscriber instances, as
+//! packets of bytes.
+//!
+//! Changes are coalesced: values are only serialized when they change, and
+//! tick() sends the latest state of the values that changed since the
+//! previous tick. Values that did not change are not sent. Late joiners call
+//! snapshot() to get the state of all values:
+//!
+//!     auto pub = replication_publisher { [&](char const * data, std::size_t size) {
+//!         socket.send_to(data, size, group);
+//!     } };
+//!     pub.publish(price, 1);
+//!     pub.publish(volume, 2);
+//!
+//!     for(;;)
+//!     {
+//!         wait_for_next_tick();
+//!         pub.tick();
+//!     }
+//!
+//! The publisher does not depend on a transport. Each packet is
+//! self-contained, and numbered, so packets can be sent as datagrams;
+//! subscribers detect lost packets.
+//!
+//! Values can change on any thread. tick() and snapshot() can be called from
+//! any thread, but publish() must not be called in parallel with itself.
+//!
+//! \ingroup observable
+class replication_publisher final
+{
+    using layout = detail::replication_layout;
+
+    struct entry
+    {
+        std::uint32_t id;
+        std::vector<char> bytes;
+        bool dirty;
+    };
+
+    struct state
+    {
+        //! Serialize a new value, and queue it for the next tick.
+        template <typename ValueType>
+        void set(std::size_t index, ValueType const & v)
+        {
+            std::lock_guard<std::mutex> const lock { mutex };
+            write(index, v);
+        }
+
+        //! Same as set(), with the mutex already locked.
+        template <typename ValueType>
+        void write(std::size_t index, ValueType const & v)
+        {
+            auto const size = serializer<ValueType>::size(v);
+            if(size > std::numeric_limits<std::uint32_t>::max())
+                throw std::length_error { "Replicated value is too large." };
+
+            auto & e = entries[index];
+            e.bytes.resize(size);
+            serializer<ValueType>::write(v, e.bytes.data());
+
+            if(!e.dirty)
+            {
+                e.dirty = true;
+                dirty.push_back(index);
+            }
+        }
+
+        std::mutex mutex;
+        std::vector<entry> entries;
+        std::vector<std::size_t> dirty;
+    };
+
+public:
+    //! Type of the functions that send packets.
+    using sink_type = std::function<void(char const *, std::size_t)>;
+
+    //! Create a publisher.
+    //!
+    //! \param[in] sink Function that is called with each packet to send. It is
+    //!                 called by tick() and snapshot(), without any lock held
+    //!                 on the replicated values.
+    //! \param[in] max_packet_size Packets are split to stay under this size,
+    //!                            for example to fit in a datagram. A value
+    //!                            that is larger is sent in a packet of its
+    //!                            own.
+    explicit replication_publisher(sink_type sink, std::size_t max_packet_size=1400) :
+        sink_ { std::move(sink) },
+        max_packet_size_ { max_packet_size }
+    { }
+
+    //! Replicate a value.
+    //!
+    //! The current value is sent by the next tick.
+    //!
+    //! \param[in] v Replicated value. It can be destroyed before the
+    //!              publisher.
+    //! \param[in] id Number identifying the value. It must be unique for the
+    //!               publisher.
+    template <typename ValueType, typename ... Rest>
+    void publish(value<ValueType, Rest ...> & v, std::uint32_t id)
+    {
+        auto index = std::size_t { 0 };
+        {
+            std::lock_guard<std::mutex> const lock { state_->mutex };
+            assert(std::none_of(state_->entries.begin(), state_->entries.end(),
+                                [&](auto && e) { return e.id == id; }));
+
+            index = state_->entries.size();
+            state_->entries.push_back(entry { id, { }, false });
+
+            try {
+                state_->write(index, v.get());
+            } catch(...) {
+                state_->entries.pop_back();
+                throw;
+            }
+        }
+
+        subscriptions_.emplace_back(
+            v.subscribe([s = state_, index](ValueType const & n) {
+                s->set(index, n);
+            }));
+    }
+
+    //! Send the values that changed since the previous tick.
+    //!
+    //! Each delta packet gets the next sequence number. Nothing is sent if
+    //! no value has changed.
+    //!
+    //! \return Number of packets that have been sent.
+    auto tick() -> std::size_t
+    {
+        std::lock_guard<std::mutex> const lock { tick_mutex_ };
+        {
+            std::lock_guard<std::mutex> const state_lock { state_->mutex };
+
+            selected_.clear();
+            for(auto index : state_->dirty)
+            {
+                auto & e = state_->entries[index];
+                e.dirty = false;
+                selected_.push_back(&e);
+            }
+            state_->dirty.clear();
+
+            build(layout::delta, [&]() { return ++sequence_; });
+        }
+
+        return send(sink_);
+    }
+
+    //! Send the current state of all values.
+    //!
+    //! Snapshot packets do not consume sequence numbers, so they can be sent to
+    //! a single subscriber, for example over a separate connection.
+    //!
+    //! \param[in] sink Callable compatible with ``sink_type``.
+    //! \return Number of packets that have been sent.
+    template <typename Sink>
+    auto snapshot(Sink && sink) -> std::size_t
+    {
+        std::lock_guard<std::mutex> const lock { tick_mutex_ };
+        {
+            std::lock_guard<std::mutex> const state_lock { state_->mutex };
+
+            selected_.clear();
+            for(auto && e : state_->entries)
+                selected_.push_back(&e);
+
+            build(layout::snapshot, [&]() { return sequence_; });
+        }
+
+        return send(sink);
+    }
+
+    //! Send the current state of all values, to the publisher's sink.
+    auto snapshot() -> std::size_t { return snapshot(sink_); }
+
+    //! Sequence number of the last delta packet that has been sent.
+    auto sequence() const
+    {
+        std::lock_guard<std::mutex> const lock { tick_mutex_ };
+        return sequence_;
+    }
+
+    //! Destructor. Stops replicating.
+    ~replication_publisher() =default;
+
+public:
+    //! Publishers are not copy-constructible.
+    replication_publisher(replication_publisher const &) =delete;
+
+    //! Publishers are not copy-assignable.
+    auto operator=(replication_publisher const &) -> replication_publisher & =delete;
+
+private:
+    //! Serialize the selected entries into packets. Called with both locks
+    //! held; packet buffers are reused from one call to the next.
+    template <typename Sequence>
+    void build(std::uint32_t kind, Sequence && sequence)
+    {
+        packet_count_ = 0;
+        std::vector<char> * p = nullptr;
+
+        for(auto e : selected_)
+        {
+            auto const size = sizeof(layout::entry_header) + e->bytes.size();
+            if(!p || (p->size() + size > max_packet_size_ &&
+                      p->size() > sizeof(layout::packet_header)))
+            {
+                if(packet_count_ == packets_.size())
+                    packets_.emplace_back();
+
+                p = &packets_[packet_count_++];
+                p->clear();
+
+                auto const header = layout::packet_header {
+                    layout::expected_magic, kind, sequence()
+                };
+                append(*p, &header, sizeof(header));
+            }
+
+            auto const header = layout::entry_header {
+                e->id, static_cast<std::uint32_t>(e->bytes.size())
+            };
+            append(*p, &header, sizeof(header));
+            append(*p, e->bytes.data(), e->bytes.size());
+        }
+    }
+
+    template <typename Sink>
+    auto send(Sink & sink) const -> std::size_t
+    {
+        for(auto i = std::size_t { 0 }; i < packet_count_; ++i)
+            sink(static_cast<char const *>(packets_[i].data()), packets_[i].size());
+
+        return packet_count_;
+    }
+
+    static void append(std::vector<char> & p, void const * data, std::size_t size)
+    {
+        auto const at = p.size();
+        p.resize(at + size);
+        if(size > 0)
+            std::memcpy(p.data() + at, data, size);
+    }
+
+private:
+    std::shared_ptr<state> state_ { std::make_shared<state>() };
+    std::vector<unique_subscription> subscriptions_;
+
+    sink_type sink_;
+    std::size_t max_packet_size_;
+
+    mutable std::mutex tick_mutex_;
+    std::uint64_t sequence_ { 0 };
+    std::vector<entry *> selected_;
+    std::vector<std::vector<char>> packets_;
+    std::size_t packet_count_ { 0 };
+};
+
+//! \cond
+namespace detail {
+
+    //! Latest replicated state of one value.
+    struct replica_slot
+    {
+        //! Incremented each time new bytes are received.
+        std::atomic<std::uint64_t> version { 0 };
+        //! Sequence number of the packet the bytes came from.
+        std::uint64_t sequence { 0 };
+        std::vector<char> bytes;
+    };
+
+    struct replication_state
+    {
+        std::mutex mutex;
+        std::unordered_map<std::uint32_t, std::unique_ptr<replica_slot>> slots;
+
+        auto slot(std::uint32_t id) -> replica_slot &
+        {
+            auto & s = slots[id];
+            if(!s)
+                s = std::make_unique<replica_slot>();
+            return *s;
+        }
+    };
+
+}
+//! \endcond
+
+//! Value replicated by a \ref replication_subscriber.
+//!
+//! Pass a replica to observe() to get a value<ValueType> that an updater
+//! refreshes. Replicas are cheap to copy; copies read the same state.
+//!
+//! \ingroup observable
+template <typename ValueType>
+class replica final
+{
+public:
+    //! Version of the replicated state. It changes each time a new state is
+    //! received, and is 0 until the first state is received.
+    auto version() const noexcept
+    {
+        return slot_->version.load(std::memory_order_acquire);
+    }
+
+    //! Read the replicated state.
+    //!
+    //! \param[out] v Receives the value. It is not changed if no state has
+    //!               been received yet.
+    //! \return Version of the state that has been read.
+    auto read(ValueType & v) const -> std::uint64_t
+    {
+        std::lock_guard<std::mutex> const lock { state_->mutex };
+        auto const version = slot_->version.load(std::memory_order_relaxed);
+        if(version > 0)
+            v = serializer<ValueType>::read(slot_->bytes.data(), slot_->bytes.size());
+
+        return version;
+    }
+
+private:
+    replica(std::shared_ptr<detail::replication_state> state,
+            detail::replica_slot & slot) noexcept :
+        state_ { std::move(state) },
+        slot_ { &slot }
+    { }
+
+    friend class replication_subscriber;
+
+    std::shared_ptr<detail::replication_state> state_;
+    detail::replica_slot * slot_;
+};
+
+//! Receives packets sent by a \ref replication_publisher, and keeps the
+//! latest state of each value.
+//!
+//! Packets can be received in any order, or more than once: a value is only
+//! changed by a packet that is newer than the one it was last changed by.
+//! Deltas that were lost are detected; needs_snapshot() then returns true
+//! until a recent enough snapshot has been applied:
+//!
+//!     auto sub = replication_subscriber { };
+//!     auto ud = updater { };
+//!     auto price = observe(ud, sub.get<double>(1));
+//!
+//!     // On the network thread:
+//!     sub.apply(data, size);
+//!     if(sub.needs_snapshot())
+//!         request_snapshot();
+//!
+//!     // On the updater thread:
+//!     ud.update_all();
+//!
+//! All methods can be safely called in parallel, from multiple threads.
+//!
+//! \ingroup observable
+class replication_subscriber final
+{
+    using layout = detail::replication_layout;
+
+public:
+    //! Apply a packet.
+    //!
+    //! \param[in] data Bytes of the packet.
+    //! \param[in] size Number of bytes.
+    //! \throw std::runtime_error if the bytes are not a valid packet. Entries
+    //!        that come before the invalid part are applied.
+    void apply(char const * data, std::size_t size)
+    {
+        auto header = layout::packet_header { };
+        if(size < sizeof(header))
+            throw std::runtime_error { "Replication packet is truncated." };
+
+        std::memcpy(&header, data, sizeof(header));
+        if(header.magic != layout::expected_magic ||
+           (header.kind != layout::delta && header.kind != layout::snapshot))
+            throw std::runtime_error { "Not a replication packet." };
+
+        auto const snapshot = header.kind == layout::snapshot;
+        auto const sequence = header.sequence;
+
+        std::lock_guard<std::mutex> const lock { state_->mutex };
+        track(snapshot, sequence);
+
+        auto offset = sizeof(header);
+        while(offset < size)
+        {
+            auto entry = layout::entry_header { };
+            if(size - offset < sizeof(entry))
+                throw std::runtime_error { "Replication packet is truncated." };
+
+            std::memcpy(&entry, data + offset, sizeof(entry));
+            offset += sizeof(entry);
+
+            if(size - offset < entry.size)
+                throw std::runtime_error { "Replication packet is truncated." };
+
+            auto & slot = state_->slot(entry.id);
+            auto const version = slot.version.load(std::memory_order_relaxed);
+
+            // Snapshots can hold changes that are newer than their sequence
+            // number, so they win ties against deltas.
+            if(version == 0 || sequence > slot.sequence ||
+               (snapshot && sequence == slot.sequence))
+            {
+                slot.bytes.assign(data + offset, data + offset + entry.size);
+                slot.sequence = sequence;
+                slot.version.store(version + 1, std::memory_order_release);
+            }
+
+            offset += entry.size;
+        }
+    }
+
+    //! Returns true if the values might be missing changes: enough to be
+    //! fixed by applying a snapshot.
+    //!
+    //! This is true until the first packet has been applied, and after delta
+    //! packets have been lost.
+    auto needs_snapshot() const -> bool
+    {
+        std::lock_guard<std::mutex> const lock { state_->mutex };
+        return !received_ || missing_ > covered_;
+    }
+
+    //! Get a replica of the value with the provided id.
+    //!
+    //! The replica can be retrieved before any state for the value has been
+    //! received.
+    //!
+    //! \tparam ValueType Type of the value. It must be the type the value was
+    //!                   published with, or use the same serialized format.
+    template <typename ValueType>
+    auto get(std::uint32_t id) -> replica<ValueType>
+    {
+        std::lock_guard<std::mutex> const lock { state_->mutex };
+        return replica<ValueType> { state_, state_->slot(id) };
+    }
+
+private:
+    //! Keep track of the deltas that have been lost.
+    void track(bool snapshot, std::uint64_t sequence) noexcept
+    {
+        received_ = true;
+
+        if(snapshot)
+        {
+            covered_ = std::max(covered_, sequence);
+            return;
+        }
+
+        if(sequence > last_ + 1)
+            missing_ = std::max(missing_, sequence - 1);
+
+        last_ = std::max(last_, sequence);
+    }
+
+private:
+    std::shared_ptr<detail::replication_state> state_ {
+        std::make_shared<detail::replication_state>()
+    };
+
+    bool received_ { false };
+    //! Highest delta sequence number received.
+    std::uint64_t last_ { 0 };
+    //! Highest delta sequence number that might have been lost.
+    std::uint64_t missing_ { 0 };
+    //! Highest sequence number of an applied snapshot.
+    std::uint64_t covered_ { 0 };
+};
+
+//! \cond
+inline namespace expr { namespace expr_detail {
+
+    //! Value updater that polls a replica each time its evaluator runs.
+    template <typename ValueType, typename EvaluatorType>
+    class replica_updater final : public value_updater<ValueType>
+    {
+        static_assert(!EvaluatorType::tracks_changes,
+                      "Replicated values are polled; use an updater that "
+                      "evaluates all of its expressions.");
+
+    public:
+        replica_updater(replica<ValueType> r, EvaluatorType const & evaluator) :
+            replica_ { std::move(r) },
+            evaluator_ { evaluator }
+        {
+            seen_ = replica_.read(result_);
+            id_ = evaluator_.insert(this);
+        }
+
+        virtual auto get() const -> ValueType override { return result_; }
+
+        virtual void set_value_notifier(std::function<void(ValueType &&)> const & notifier) override
+        {
+            value_notifier_ = notifier;
+            evaluator_.ready(id_);
+        }
+
+        //! Read the value, if a new state has been received.
+        void prepare()
+        {
+            if(replica_.version() == seen_)
+                return;
+
+            seen_ = replica_.read(result_);
+            ready_ = true;
+        }
+
+        //! Notify the value of a new value read by prepare().
+        void deliver()
+        {
+            if(!ready_)
+                return;
+
+            ready_ = false;
+            value_notifier_(ValueType { result_ });
+        }
+
+        //! Replicated values do not depend on anything.
+        virtual auto rank() const -> std::size_t override { return 0; }
+
+        virtual ~replica_updater() override { evaluator_.remove(id_); }
+
+        replica_updater(replica_updater const &) =delete;
+        auto operator=(replica_updater const &) -> replica_updater & =delete;
+
+    private:
+        replica<ValueType> replica_;
+        ValueType result_ { };
+        std::uint64_t seen_ { 0 };
+        bool ready_ { false };
+        EvaluatorType evaluator_;
+        typename EvaluatorType::id id_;
+        std::function<void(ValueType &&)> value_notifier_ { [](auto &&) { } };
+    };
+
+} }
+//! \endcond
+
+//! Observe a replicated value.
+//!
+//! The returned value is read-only, and refreshed by the updater: each
+//! update_all() call checks the replica's version, with a single atomic load,
+//! and reads the value if a new state has been received. Observers are only
+//! notified when the value is different from the previous one.
+//!
+//! \param[in] ud An updater that evaluates all of its expressions on each
+//!               update, like \ref updater or \ref parallel_updater.
+//! \param[in] r Replica of the value.
+//! \return A value that is updated from the replica.
+//!
+//! \ingroup observable
+template <typename UpdaterType, typename ValueType>
+inline auto observe(UpdaterType & ud, replica<ValueType> r)
+{
+    static_assert(std::is_base_of<updater, UpdaterType>::value,
+                  "UpdaterType must derive from updater.");
+
+    using updater_type = expr::expr_detail::replica_updater<ValueType, UpdaterType>;
+    auto u = std::make_unique<updater_type>(std::move(r), ud);
+    return value<ValueType> { std::move(u) };
+}
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable {
+
+//! Converts objects to and from the bytes stored in a recording, or
+//! sent to another process.
+//!
+//! The default serializer copies the object's bytes, so it only accepts
+//! trivially copyable types. Specialize this template for other types:
+//!
+//!     template <>
+//!     struct observable::serializer<order>
+//!     {
+//!         static auto size(order const & o) noexcept -> std::size_t;
+//!         static void write(order const & o, char * out) noexcept;
+//!         static auto read(char const * in, std::size_t size) -> order;
+//!     };
+//!
+//! write() receives a buffer of size() bytes. read() receives the same bytes,
+//! and can throw if they are not valid.
+//!
+//! \tparam ValueType Type of the serialized objects.
+//! \tparam Enable Can be used to specialize for a family of types, with
+//!                ``std::enable_if_t``.
+//!
+//! \ingroup observable
+template <typename ValueType, typename Enable=void>
+struct serializer
+{
+    static_assert(std::is_trivially_copyable<ValueType>::value,
+                  "Recorded types must be trivially copyable, or have a "
+                  "specialization of observable::serializer.");
+
+    static auto size(ValueType const &) noexcept -> std::size_t
+    {
+        return sizeof(ValueType);
+    }
+
+    static void write(ValueType const & v, char * out) noexcept
+    {
+        std::memcpy(out, &v, sizeof(ValueType));
+    }
+
+    static auto read(char const * in, std::size_t size) -> ValueType
+    {
+        if(size != sizeof(ValueType))
+            throw std::runtime_error { "Recorded object has the wrong size." };
+
+        std::aligned_storage_t<sizeof(ValueType), alignof(ValueType)> storage;
+        std::memcpy(&storage, in, sizeof(ValueType));
+        return *reinterpret_cast<ValueType *>(&storage);
+    }
+};
+
+//! Serializer for strings; the characters are stored without a terminator.
+//!
+//! \ingroup observable
+template <>
+struct serializer<std::string>
+{
+    static auto size(std::string const & s) noexcept -> std::size_t
+    {
+        return s.size();
+    }
+
+    static void write(std::string const & s, char * out) noexcept
+    {
+        s.copy(out, s.size());
+    }
+
+    static auto read(char const * in, std::size_t size) -> std::string
+    {
+        return std::string(in, size);
+    }
+};
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
@@ -0,0 +1,467 @@
+#pragma once
+
+// Values shared between processes through POSIX shared memory. This header is
+// not included by observable.hpp, since it is only available on POSIX systems.
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+#include <observable/observe.hpp>
+#include <observable/value.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable {
+
+//! \cond
+namespace detail {
+
+    static_assert(ATOMIC_INT_LOCK_FREE == 2 &&
+                  ATOMIC_LONG_LOCK_FREE == 2 &&
+                  ATOMIC_LLONG_LOCK_FREE == 2,
+                  "Shared memory values need lock-free atomics.");
+
+    //! Layout of a shared memory region that holds one value.
+    //!
+    //! The value is protected by a sequence lock: the sequence is odd while
+    //! the value is being written. The data is copied in words through
+    //! atomics, so torn reads are detected instead of being data races. On
+    //! common platforms, these atomics compile to plain loads and stores.
+    template <typename ValueType>
+    struct shared_layout
+    {
+        static constexpr std::uint32_t expected_magic = 0x6f627376; // "obsv"
+        static constexpr std::size_t word_count =
+                            (sizeof(ValueType) + sizeof(std::uint64_t) - 1) /
+                            sizeof(std::uint64_t);
+
+        std::atomic<std::uint32_t> magic;
+        std::uint32_t value_size;
+        std::atomic<std::uint32_t> sequence;
+        std::atomic<std::uint32_t> waiters;
+        std::atomic<std::uint64_t> words[word_count];
+    };
+
+    //! A mapped shared memory object. The mapping is removed when the last
+    //! copy of the owning shared pointer is destroyed.
+    class shared_mapping final
+    {
+    public:
+        shared_mapping(std::string const & name, std::size_t size, bool create) :
+            size_ { size }
+        {
+            auto const flags = create ? O_CREAT | O_RDWR : O_RDWR;
+            auto const fd = ::shm_open(name.c_str(), flags, 0600);
+            if(fd < 0)
+                throw std::system_error { errno, std::generic_category(),
+                                          "Could not open shared memory " + name };
+
+            struct close_fd
+            {
+                ~close_fd() { ::close(fd); }
+                int fd;
+            } const closer { fd };
+
+            if(create && ::ftruncate(fd, static_cast<off_t>(size)) != 0)
+                throw std::system_error { errno, std::generic_category(),
+                                          "Could not resize shared memory " + name };
+
+            struct stat st;
+            if(::fstat(fd, &st) != 0)
+                throw std::system_error { errno, std::generic_category(),
+                                          "Could not inspect shared memory " + name };
+
+            if(static_cast<std::size_t>(st.st_size) < size)
+                throw std::runtime_error { "Shared memory " + name +
+                                           " does not hold the expected type." };
+
+            address_ = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if(address_ == MAP_FAILED)
+                throw std::system_error { errno, std::generic_category(),
+                                          "Could not map shared memory " + name };
+        }
+
+        auto address() const noexcept { return address_; }
+
+        ~shared_mapping() { ::munmap(address_, size_); }
+
+        shared_mapping(shared_mapping const &) =delete;
+        auto operator=(shared_mapping const &) -> shared_mapping & =delete;
+
+    private:
+        std::size_t size_;
+        void * address_ { nullptr };
+    };
+
+    inline void futex_wake_all(std::atomic<std::uint32_t> & word) noexcept
+    {
+#if defined(__linux__)
+        ::syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word),
+                  FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+        static_cast<void>(word);
+#endif
+    }
+
+    //! Block while ``word`` is equal to ``expected``, for at most ``timeout``.
+    //! Can return early.
+    inline void futex_wait(std::atomic<std::uint32_t> & word,
+                           std::uint32_t expected,
+                           std::chrono::nanoseconds timeout) noexcept
+    {
+#if defined(__linux__)
+        auto const s = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+        auto ts = timespec { };
+        ts.tv_sec = static_cast<time_t>(s.count());
+        ts.tv_nsec = static_cast<long>((timeout - s).count());
+
+        ::syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word),
+                  FUTEX_WAIT, expected, &ts, nullptr, 0);
+#else
+        static_cast<void>(expected);
+        if(word.load() == expected)
+            std::this_thread::sleep_for(std::min(timeout,
+                                                 std::chrono::nanoseconds { 100000 }));
+#endif
+    }
+}
+//! \endcond
+
+//! Publishes a value into a named shared memory object.
+//!
+//! Other processes can read the value with a \ref shared_memory_reader.
+//! Publishing never makes a system call, unless a reader is waiting for a
+//! change with shared_memory_reader::wait().
+//!
+//! The publisher owns the shared memory object: the name is removed when the
+//! publisher is destroyed. Readers that have already opened it keep working,
+//! but do not see any more changes.
+//!
+//! Example:
+//!
+//!     shared_memory_publisher<double> prices { "/prices" };
+//!     prices.publish(101.5);
+//!
+//! \tparam ValueType Type of the published value. It must be trivially
+//!                   copyable, and must not contain pointers into the
+//!                   publishing process.
+//!
+//! \warning Only one publisher can exist for a name, and it must not
+//!          publish from multiple threads at the same time.
+//!
+//! \ingroup observable
+template <typename ValueType>
+class shared_memory_publisher final
+{
+    static_assert(std::is_trivially_copyable<ValueType>::value,
+                  "Shared memory values must be trivially copyable.");
+
+    using layout = detail::shared_layout<ValueType>;
+
+public:
+    //! Create or reset a shared memory object that holds the initial value.
+    //!
+    //! \param[in] name Name of the shared memory object. It must start with
+    //!                 a slash and contain no other slashes.
+    //! \param[in] initial Initial value.
+    //! \throw std::system_error if the shared memory object cannot be created.
+    explicit shared_memory_publisher(std::string name,
+                                     ValueType const & initial=ValueType { }) :
+        name_ { std::move(name) },
+        mapping_ { std::make_shared<detail::shared_mapping>(name_, sizeof(layout), true) },
+        layout_ { static_cast<layout *>(mapping_->address()) }
+    {
+        layout_->value_size = sizeof(ValueType);
+        layout_->sequence.store(0, std::memory_order_relaxed);
+        store(initial);
+        layout_->magic.store(layout::expected_magic, std::memory_order_release);
+    }
+
+    //! Publish a new value.
+    void publish(ValueType const & v) noexcept
+    {
+        auto const s = layout_->sequence.load(std::memory_order_relaxed);
+        layout_->sequence.store(s + 1, std::memory_order_relaxed);
+
+        store(v);
+
+        // Sequentially consistent, so either this sees a waiter, or the
+        // waiter sees the new sequence.
+        layout_->sequence.store(s + 2);
+        if(layout_->waiters.load() > 0)
+            detail::futex_wake_all(layout_->sequence);
+    }
+
+    //! Name of the shared memory object.
+    auto name() const -> std::string const & { return name_; }
+
+    //! Destructor. Removes the shared memory object's name.
+    ~shared_memory_publisher() { ::shm_unlink(name_.c_str()); }
+
+public:
+    //! Publishers are not copy-constructible.
+    shared_memory_publisher(shared_memory_publisher const &) =delete;
+
+    //! Publishers are not copy-assignable.
+    auto operator=(shared_memory_publisher const &) -> shared_memory_publisher & =delete;
+
+private:
+    void store(ValueType const & v) noexcept
+    {
+        std::uint64_t words[layout::word_count] { };
+        std::memcpy(words, &v, sizeof(ValueType));
+
+        for(auto i = std::size_t { 0 }; i < layout::word_count; ++i)
+            // Release, so a reader that sees a word also sees the odd sequence.
+            layout_->words[i].store(words[i], std::memory_order_release);
+    }
+
+private:
+    std::string name_;
+    std::shared_ptr<detail::shared_mapping> mapping_;
+    layout * layout_;
+};
+
+//! Reads a value published by a \ref shared_memory_publisher, possibly from
+//! another process.
+//!
+//! Reading never makes a system call. Pass the reader to observe() to get a
+//! value<ValueType> that an updater refreshes.
+//!
+//! Readers are cheap to copy; copies share the same mapping.
+//!
+//! \ingroup observable
+template <typename ValueType>
+class shared_memory_reader final
+{
+    static_assert(std::is_trivially_copyable<ValueType>::value,
+                  "Shared memory values must be trivially copyable.");
+
+    using layout = detail::shared_layout<ValueType>;
+
+public:
+    //! Open a shared memory object created by a publisher.
+    //!
+    //! \param[in] name Name of the shared memory object.
+    //! \throw std::system_error if the shared memory object cannot be opened.
+    //! \throw std::runtime_error if the object does not hold a ValueType.
+    explicit shared_memory_reader(std::string const & name) :
+        mapping_ { std::make_shared<detail::shared_mapping>(name, sizeof(layout), false) },
+        layout_ { static_cast<layout *>(mapping_->address()) }
+    {
+        if(layout_->magic.load(std::memory_order_acquire) != layout::expected_magic ||
+           layout_->value_size != sizeof(ValueType))
+            throw std::runtime_error { "Shared memory " + name +
+                                       " does not hold the expected type." };
+    }
+
+    //! Current sequence number. It changes each time a value is published.
+    auto sequence() const noexcept
+    {
+        return layout_->sequence.load(std::memory_order_acquire);
+    }
+
+    //! Read a consistent copy of the published value.
+    //!
+    //! \param[out] v Receives the value.
+    //! \return Sequence number of the value. It can be passed to wait().
+    //!
+    //! \warning If the publisher dies while it is publishing, this call never
+    //!          returns.
+    auto read(ValueType & v) const noexcept -> std::uint32_t
+    {
+        std::uint64_t words[layout::word_count];
+
+        for(;;)
+        {
+            auto const before = layout_->sequence.load(std::memory_order_acquire);
+            if(before & 1)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            for(auto i = std::size_t { 0 }; i < layout::word_count; ++i)
+                words[i] = layout_->words[i].load(std::memory_order_acquire);
+
+            if(layout_->sequence.load(std::memory_order_relaxed) == before)
+            {
+                std::memcpy(&v, words, sizeof(ValueType));
+                return before;
+            }
+        }
+    }
+
+    //! Read a consistent copy of the published value.
+    auto read() const noexcept
+    {
+        auto v = ValueType { };
+        read(v);
+        return v;
+    }
+
+    //! Block until a value newer than ``since`` is published.
+    //!
+    //! On Linux, this uses a futex. Elsewhere, it sleeps in short steps.
+    //!
+    //! \param[in] since A sequence number returned by sequence() or read().
+    //! \param[in] timeout Maximum time to wait.
+    //! \return True if a newer value has been published.
+    template <typename Rep, typename Period>
+    auto wait(std::uint32_t since, std::chrono::duration<Rep, Period> timeout) const noexcept
+    {
+        using clock = std::chrono::steady_clock;
+        auto const deadline = clock::now() + timeout;
+
+        layout_->waiters.fetch_add(1);
+
+        auto changed = false;
+        for(;;)
+        {
+            changed = layout_->sequence.load() != since;
+            auto const left = deadline - clock::now();
+
+            if(changed || left <= clock::duration::zero())
+                break;
+
+            detail::futex_wait(layout_->sequence, since,
+                               std::chrono::duration_cast<std::chrono::nanoseconds>(left));
+        }
+
+        layout_->waiters.fetch_sub(1);
+        return changed;
+    }
+
+private:
+    std::shared_ptr<detail::shared_mapping> mapping_;
+    layout * layout_;
+};
+
+//! \cond
+inline namespace expr { namespace expr_detail {
+
+    //! Value updater that polls a shared memory reader each time its
+    //! evaluator runs.
+    template <typename ValueType, typename EvaluatorType>
+    class shared_memory_updater final : public value_updater<ValueType>
+    {
+        static_assert(!EvaluatorType::tracks_changes,
+                      "Shared memory values are polled; use an updater that "
+                      "evaluates all of its expressions.");
+
+    public:
+        shared_memory_updater(shared_memory_reader<ValueType> reader,
+                              EvaluatorType const & evaluator) :
+            reader_ { std::move(reader) },
+            evaluator_ { evaluator }
+        {
+            seen_ = reader_.read(result_);
+            id_ = evaluator_.insert(this);
+        }
+
+        virtual auto get() const -> ValueType override { return result_; }
+
+        virtual void set_value_notifier(std::function<void(ValueType &&)> const & notifier) override
+        {
+            value_notifier_ = notifier;
+            evaluator_.ready(id_);
+        }
+
+        //! Read the value, if a new one has been published.
+        void prepare()
+        {
+            if(reader_.sequence() == seen_)
+                return;
+
+            seen_ = reader_.read(result_);
+            ready_ = true;
+        }
+
+        //! Notify the value of a new value read by prepare().
+        void deliver()
+        {
+            if(!ready_)
+                return;
+
+            ready_ = false;
+            value_notifier_(ValueType { result_ });
+        }
+
+        //! Shared values do not depend on anything.
+        virtual auto rank() const -> std::size_t override { return 0; }
+
+        virtual ~shared_memory_updater() override { evaluator_.remove(id_); }
+
+        shared_memory_updater(shared_memory_updater const &) =delete;
+        auto operator=(shared_memory_updater const &) -> shared_memory_updater & =delete;
+
+    private:
+        shared_memory_reader<ValueType> reader_;
+        ValueType result_ { };
+        std::uint32_t seen_ { 0 };
+        bool ready_ { false };
+        EvaluatorType evaluator_;
+        typename EvaluatorType::id id_;
+        std::function<void(ValueType &&)> value_notifier_ { [](auto &&) { } };
+    };
+
+} }
+//! \endcond
+
+//! Observe a value published in shared memory.
+//!
+//! The returned value is refreshed by the updater: each update_all() call
+//! checks the shared sequence number, with a single atomic load, and reads
+//! the value if it has changed. Observers are only notified when the value
+//! is different from the previous one.
+//!
+//! Example:
+//!
+//!     auto ud = updater { };
+//!     auto price = observe(ud, shared_memory_reader<double> { "/prices" });
+//!
+//!     for(;;)
+//!         ud.update_all();
+//!
+//! \param[in] ud An updater that evaluates all of its expressions on each
+//!               update, like \ref updater or \ref parallel_updater.
+//! \param[in] reader Reader of the shared value.
+//! \return A value that is updated from the shared value.
+//!
+//! \ingroup observable
+template <typename UpdaterType, typename ValueType>
+inline auto observe(UpdaterType & ud, shared_memory_reader<ValueType> reader)
+{
+    static_assert(std::is_base_of<updater, UpdaterType>::value,
+                  "UpdaterType must derive from updater.");
+
+    using updater_type = expr::expr_detail::shared_memory_updater<ValueType, UpdaterType>;
+    auto u = std::make_unique<updater_type>(std::move(reader), ud);
+    return value<ValueType> { std::move(u) };
+}
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
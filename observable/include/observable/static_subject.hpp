@@ -0,0 +1,123 @@
+#pragma once
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable {
+
+//! \cond
+template <typename ObserverType, typename ... Observers>
+class static_subject;
+//! \endcond
+
+//! Subject with a fixed list of observers, known at compile time.
+//!
+//! The observers are stored by value, inside the subject, and notify() calls
+//! each one of them directly. There is no type erasure, no allocation and no
+//! synchronization, so the compiler is free to inline the whole notification.
+//!
+//! Use this instead of a regular subject when the wiring is known at build
+//! time. Since a static subject is itself callable with the notification
+//! arguments, it can be subscribed as a single observer to a regular subject
+//! or value, to fan out a dynamic notification to a static list.
+//!
+//! Observers are called in the order they are provided.
+//!
+//! \tparam Args Observer arguments.
+//! \tparam Observers Types of the observers. Each one must be callable with
+//!                   ``Args ...``.
+//!
+//! \warning A static subject is as safe to call from multiple threads as its
+//!          observers are.
+//!
+//! \see make_static_subject()
+//! \ingroup observable
+template <typename ... Args, typename ... Observers>
+class static_subject<void(Args ...), Observers ...>
+{
+public:
+    using observer_type = void(Args ...);
+
+    //! Create a subject with default-constructed observers.
+    static_subject() =default;
+
+    //! Create a subject with the provided observers.
+    //!
+    //! \param[in] first The first observer that will be stored inside the
+    //!                  subject.
+    //! \param[in] rest The rest of the observers, in order.
+    template <typename First, typename ... Rest,
+              typename = std::enable_if_t<
+                            sizeof...(Rest) + 1 == sizeof...(Observers) &&
+                            !std::is_same<std::decay_t<First>,
+                                          static_subject>::value>>
+    explicit static_subject(First && first, Rest && ... rest) :
+        observers_ { std::forward<First>(first), std::forward<Rest>(rest) ... }
+    { }
+
+    //! Call all observers with the provided arguments.
+    //!
+    //! \param[in] arguments Arguments that will be passed to every observer.
+    void notify(Args ... arguments) const
+    {
+        notify_impl(std::index_sequence_for<Observers ...> { }, arguments ...);
+    }
+
+    //! Equivalent to calling notify().
+    void operator()(Args ... arguments) const { notify(arguments ...); }
+
+    //! Return true if there are no observers.
+    static constexpr auto empty() noexcept { return sizeof...(Observers) == 0; }
+
+    //! Number of observers.
+    static constexpr auto size() noexcept { return sizeof...(Observers); }
+
+    //! Retrieve the observer at the provided index.
+    template <std::size_t Index>
+    auto get() noexcept -> auto & { return std::get<Index>(observers_); }
+
+    //! \see get()
+    template <std::size_t Index>
+    auto get() const noexcept -> auto const & { return std::get<Index>(observers_); }
+
+private:
+    template <std::size_t ... Indexes>
+    void notify_impl(std::index_sequence<Indexes ...>, Args & ... arguments) const
+    {
+        using expand = int[];
+        (void) expand {
+            0, ((void) std::get<Indexes>(observers_)(arguments ...), 0) ...
+        };
+    }
+
+private:
+    // Observers are allowed to be stateful.
+    mutable std::tuple<Observers ...> observers_;
+};
+
+//! Create a static subject from a list of observers.
+//!
+//! Example:
+//!
+//!     auto s = make_static_subject<void(int)>([](int) { }, [](int) { });
+//!     s.notify(5);
+//!
+//! \tparam ObserverType Function type of the observers.
+//! \param[in] observers Observers that will be stored inside the subject.
+//!
+//! \ingroup observable
+template <typename ObserverType, typename ... Observers>
+inline auto make_static_subject(Observers && ... observers)
+{
+    return static_subject<ObserverType, std::decay_t<Observers> ...> {
+        std::forward<Observers>(observers) ...
+    };
+}
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
@@ -3,9 +3,16 @@
 #include <functional>
 #include <memory>
 #include <type_traits>
+#include <observable/detail/chunked_collection.hpp>
 #include <observable/detail/collection.hpp>
+#include <observable/detail/inline_function.hpp>
+#include <observable/detail/parallel_apply.hpp>
+#include <observable/detail/pool_allocator.hpp>
+#include <observable/detail/single_threaded_collection.hpp>
 #include <observable/detail/type_traits.hpp>
+#include <observable/instrumentation.hpp>
 #include <observable/subscription.hpp>
+#include <observable/tracing.hpp>
 
 #include <observable/detail/compiler_config.hpp>
 OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
@@ -17,29 +24,196 @@ template <typename ...>
 class subject;
 //! \endcond
 
-//! Store observers and provide a way to notify them when events occur.
+//! Default subject policy.
 //!
-//! Observers are objects that satisfy the Callable concept and can be stored
-//! inside a ``std::function<void(Args ...)>``.
+//! Policies customize how a subject stores its observers. You can create your
+//! own policy by deriving from this class, hiding any of its members and
+//! specializing \ref is_subject_policy for it.
 //!
-//! Once you call subscribe(), the observer is said to be subscribed to
-//! notifications from the subject.
+//! \ingroup observable
+struct subject_policy
+{
+    //! Collection used to store the subscribed observers.
+    //!
+    //! The default collection stores each observer in a separately allocated
+    //! node.
+    template <typename ValueType>
+    using collection = detail::collection<ValueType>;
+
+    //! Type-erased callable used to store each subscribed observer.
+    template <typename ObserverType>
+    using observer = std::function<ObserverType>;
+
+    //! Allocator used for the subject's collection object.
+    //!
+    //! Policies that change this usually also pass the allocator to their
+    //! collection, for its nodes.
+    template <typename T>
+    using allocator = std::allocator<T>;
+
+    //! Hooks called by notify(), stored inside each subject.
+    //!
+    //! The default instrumentation does nothing and takes no space.
+    using instrumentation = no_instrumentation;
+};
+
+//! Subject policy that keeps subscribed observers in contiguous memory.
 //!
-//! Calling notify(), will call all the currently subscribed observers with the
-//! arguments provided to notify().
+//! Notifying a subject that uses this policy walks its observers linearly,
+//! instead of following a pointer for each observer. This is the better choice
+//! for subjects with many observers that are notified often.
 //!
-//! All methods can be safely called in parallel, from multiple threads.
+//! \ingroup observable
+struct contiguous_subject_policy : subject_policy
+{
+    //! \see subject_policy::collection
+    template <typename ValueType>
+    using collection = detail::chunked_collection<ValueType>;
+};
+
+//! Subject policy that reuses the memory of unsubscribed observers.
 //!
-//! \tparam Args Observer arguments. All observer types must be storable
-//!              inside a ``std::function<void(Args ...)>``.
+//! Observers are stored like with the default policy, but the collection's
+//! nodes are allocated from a thread-local pool. Subscribing right after
+//! unsubscribing, on the same thread, reuses the freed node instead of going
+//! through the global allocator. This helps subjects with a lot of
+//! subscription churn.
 //!
-//! \warning Even though subjects themselves are safe to use in parallel,
-//!          observers need to handle being called from multiple threads too.
+//! \ingroup observable
+struct pooled_subject_policy : subject_policy
+{
+    //! \see subject_policy::collection
+    template <typename ValueType>
+    using collection = detail::collection<ValueType,
+                                          detail::pool_allocator<ValueType>>;
+};
+
+//! Subject policy that stores observers in place, without allocating.
+//!
+//! Observers that capture up to four pointers worth of state (like a lambda
+//! capturing an object and a member function pointer) are stored inside the
+//! collection, instead of inside a separately allocated ``std::function``.
+//! Larger observers are still supported, but will allocate.
 //!
 //! \ingroup observable
-template <typename ... Args>
-class subject<void(Args ...)>
+struct inline_subject_policy : subject_policy
+{
+    //! \see subject_policy::observer
+    template <typename ObserverType>
+    using observer = detail::inline_function<ObserverType>;
+};
+
+//! Subject policy that stores observers in place, inside contiguous memory.
+//!
+//! This combines \ref contiguous_subject_policy and \ref inline_subject_policy
+//! and is the fastest policy to notify.
+//!
+//! \ingroup observable
+struct inline_contiguous_subject_policy : contiguous_subject_policy
+{
+    //! \see subject_policy::observer
+    template <typename ObserverType>
+    using observer = inline_subject_policy::observer<ObserverType>;
+};
+
+//! Subject policy for subjects that are only used by a single thread.
+//!
+//! Observers are stored in place, like with \ref inline_subject_policy, inside
+//! a collection that uses no atomic operations and no epochs. Subscribing,
+//! unsubscribing and notifying are all cheaper than with the thread-safe
+//! policies.
+//!
+//! Values use the policy for all their subjects:
+//!
+//!     auto price = value<double, single_threaded_subject_policy> { };
+//!
+//! \warning Subjects that use this policy, and values that use it, must not be
+//!          used by more than one thread, not even to subscribe.
+//!
+//! \ingroup observable
+struct single_threaded_subject_policy : inline_subject_policy
 {
+    //! \see subject_policy::collection
+    template <typename ValueType>
+    using collection = detail::single_threaded_collection<ValueType>;
+};
+
+//! Subject policy that collects notification statistics.
+//!
+//! This works like the provided policy, but each subject also counts its
+//! notifications and measures the time spent inside its observers, through a
+//! \ref counting_instrumentation:
+//!
+//!     auto s = subject<void(int), instrumented_subject_policy<>> { };
+//!     s.instrumentation().name("prices");
+//!     ...
+//!     auto const stats = s.instrumentation().stats();
+//!
+//! \tparam Policy The policy that decides how observers are stored.
+//!
+//! \ingroup observable
+template <typename Policy=subject_policy>
+struct instrumented_subject_policy : Policy
+{
+    //! \see subject_policy::instrumentation
+    using instrumentation = counting_instrumentation;
+};
+
+//! Check if a type is a subject policy.
+//!
+//! The static member ``value`` will be true if the provided type is a subject
+//! policy. If you write your own policy, you must specialize this trait for it.
+//!
+//! \note The trait does not inspect its parameter, so it can be used with
+//!       incomplete types (like the EnclosingType of a subject).
+//!
+//! \ingroup observable
+template <typename T>
+struct is_subject_policy : std::false_type { };
+
+//! \cond
+template <>
+struct is_subject_policy<subject_policy> : std::true_type { };
+
+template <>
+struct is_subject_policy<contiguous_subject_policy> : std::true_type { };
+
+template <>
+struct is_subject_policy<pooled_subject_policy> : std::true_type { };
+
+template <>
+struct is_subject_policy<inline_subject_policy> : std::true_type { };
+
+template <>
+struct is_subject_policy<inline_contiguous_subject_policy> : std::true_type { };
+
+template <>
+struct is_subject_policy<single_threaded_subject_policy> : std::true_type { };
+
+template <typename Policy>
+struct is_subject_policy<instrumented_subject_policy<Policy>> :
+    is_subject_policy<Policy>
+{ };
+//! \endcond
+
+namespace detail {
+
+//! \cond
+template <typename ObserverType, typename Policy>
+class subject_base;
+//! \endcond
+
+//! Implementation of the public subject interface.
+//!
+//! \see subject<void(Args ...)>
+//! \ingroup observable_detail
+template <typename ... Args, typename Policy>
+class subject_base<void(Args ...), Policy> :
+    private Policy::instrumentation
+{
+    static_assert(is_subject_policy<Policy>::value,
+                  "Policy must be a subject policy.");
+
 public:
     using observer_type = void(Args ...);
 
@@ -73,17 +247,48 @@ public:
                       " with the subject");
 
         assert(observers_);
-        auto const id = observers_->insert(observer);
+        auto handle = observers_->insert_handle(std::forward<Callable>(observer));
 
-        return infinite_subscription {
-            [id, weak_observers = std::weak_ptr<collection> { observers_ }]() {
-                auto const observers = weak_observers.lock();
-                if(!observers)
-                    return;
+        auto unsubscribe = [handle,
+                            weak_observers = std::weak_ptr<collection> { observers_ }]() {
+            auto const observers = weak_observers.lock();
+            if(!observers)
+                return;
 
-                observers->remove(id);
-            }
+            observers->remove(handle);
         };
+
+        static_assert(infinite_subscription::unsubscribe_token::
+                          is_stored_inline<decltype(unsubscribe)>(),
+                      "Subscriptions should not allocate");
+
+        return infinite_subscription { std::move(unsubscribe) };
+    }
+
+    //! Subscribe a member function of an object to notifications.
+    //!
+    //! This is equivalent to subscribing a lambda that calls the method on the
+    //! object, but the resulting observer is small enough to never allocate
+    //! with \ref inline_subject_policy.
+    //!
+    //! \param[in] object The object on which the method will be called.
+    //! \param[in] method Pointer to a member function of Object that can be
+    //!                   called with the subject's arguments.
+    //!
+    //! \return An unique subscription that can be used to unsubscribe the
+    //!         method from receiving notifications from this subject.
+    //!
+    //! \warning The object must outlive the subscription.
+    //!
+    //! \see subscribe()
+    template <typename Object, typename Method,
+              typename = std::enable_if_t<std::is_member_function_pointer<
+                                                        Method>::value>>
+    auto subscribe(Object & object, Method method) -> infinite_subscription
+    {
+        return subscribe([&object, method](Args ... arguments) {
+            (object.*method)(std::forward<Args>(arguments) ...);
+        });
     }
 
     //! Subscribe an observer to notifications and immediately call it with
@@ -144,6 +349,10 @@ public:
     //! \param[in] arguments Arguments that will be forwarded to the subscribed
     //!                      observers.
     //!
+    //! \note Arguments are passed to each observer as they are declared in the
+    //!       subject's signature. To notify large payloads without copying
+    //!       them, declare the argument as a ``message<T> const &``.
+    //!
     //! \warning All observers that will be called by notify() must remain valid
     //!          to be called for the duration of the notify() call.
     //!
@@ -152,7 +361,79 @@ public:
     void notify(Args ... arguments) const
     {
         assert(observers_);
-        observers_->apply([&](auto && observer) { observer(arguments ...); });
+
+        auto const & hooks = instrumentation();
+        auto const n = hooks.begin_notify();
+
+        observers_->apply([&](auto && observer) {
+            OBSERVABLE_TRACE_SCOPE("observer", 0);
+            auto const c = hooks.begin_call();
+            observer(arguments ...);
+            hooks.end_call(c);
+        });
+
+        hooks.end_notify(n);
+    }
+
+    //! Notify all currently subscribed observers, calling groups of observers
+    //! in parallel.
+    //!
+    //! The observers are split into groups of about ``parallel_group_size``
+    //! observers. One group is called on the calling thread, and a task is
+    //! submitted to the executor for each other group. Tasks that start late
+    //! find their groups already taken by the calling thread, which never
+    //! waits for the executor to start a task.
+    //!
+    //! This method blocks until all observers have been called and has the same
+    //! guarantees as notify(): observers removed before they have been called
+    //! are not called, and observers subscribed during the call are not called
+    //! by it.
+    //!
+    //! If observers throw, the other groups are still called and the first
+    //! exception is rethrown.
+    //!
+    //! \param[in] executor Callable that accepts an ``async_task`` and runs it,
+    //!                     on any thread. See \ref async_subject.
+    //! \param[in] arguments Arguments that will be forwarded to the subscribed
+    //!                      observers.
+    //!
+    //! \note Only subjects whose policy is safe to use from multiple threads
+    //!       provide this method.
+    //!
+    //! \warning Observers must be safe to be called in parallel, with the same
+    //!          arguments.
+    template <typename Executor>
+    void notify_parallel(Executor && executor, Args ... arguments) const
+    {
+        assert(observers_);
+
+        auto const & hooks = instrumentation();
+        auto const n = hooks.begin_notify();
+
+        observers_->apply_chunks(parallel_group_size,
+            [&](std::size_t count, auto & group) {
+                detail::parallel_apply(executor, count, group);
+            },
+            [&](auto && observer) {
+                OBSERVABLE_TRACE_SCOPE("observer", 0);
+                auto const c = hooks.begin_call();
+                observer(arguments ...);
+                hooks.end_call(c);
+            });
+
+        hooks.end_notify(n);
+    }
+
+    //! Number of observers called by each task of notify_parallel().
+    static constexpr std::size_t parallel_group_size = 1024;
+
+    //! Retrieve the subject's instrumentation.
+    //!
+    //! \see subject_policy::instrumentation
+    auto instrumentation() const noexcept
+        -> typename Policy::instrumentation const &
+    {
+        return *this;
     }
 
     //! Return true if there are no subscribers.
@@ -162,32 +443,100 @@ public:
         return observers_->empty();
     }
 
+    //! Return the number of subscribers.
+    auto size() const noexcept
+    {
+        assert(observers_);
+        return observers_->size();
+    }
+
 public:
     //! Constructor. Will create an empty subject.
-    subject() =default;
+    subject_base() =default;
 
     //! Subjects are **not** copy-constructible.
-    subject(subject const &) =delete;
+    subject_base(subject_base const &) =delete;
 
     //! Subjects are **not** copy-assignable.
-    auto operator=(subject const &) -> subject & =delete;
+    auto operator=(subject_base const &) -> subject_base & =delete;
 
     //! Subjects are move-constructible.
-    subject(subject &&) noexcept =default;
+    subject_base(subject_base &&) noexcept =default;
 
     //! Subjects are move-assignable.
-    auto operator=(subject &&) noexcept -> subject & =default;
+    auto operator=(subject_base &&) noexcept -> subject_base & =default;
 
 private:
-    using collection = detail::collection<std::function<observer_type>>;
+    using observer_storage = typename Policy::template observer<observer_type>;
+    using collection = typename Policy::template collection<observer_storage>;
+
+    using allocator = typename Policy::template allocator<collection>;
 
-    std::shared_ptr<collection> observers_ { std::make_shared<collection>() };
+    std::shared_ptr<collection> observers_ {
+        std::allocate_shared<collection>(allocator { })
+    };
+};
+
+//! \cond
+template <typename ... Args, typename Policy>
+constexpr std::size_t subject_base<void(Args ...), Policy>::parallel_group_size;
+//! \endcond
+
+}
+
+//! Store observers and provide a way to notify them when events occur.
+//!
+//! Observers are objects that satisfy the Callable concept and can be stored
+//! inside a ``std::function<void(Args ...)>``.
+//!
+//! Once you call subscribe(), the observer is said to be subscribed to
+//! notifications from the subject.
+//!
+//! Calling notify(), will call all the currently subscribed observers with the
+//! arguments provided to notify().
+//!
+//! All methods can be safely called in parallel, from multiple threads.
+//!
+//! \tparam Args Observer arguments. All observer types must be storable
+//!              inside a ``std::function<void(Args ...)>``.
+//!
+//! \warning Even though subjects themselves are safe to use in parallel,
+//!          observers need to handle being called from multiple threads too.
+//!
+//! \see detail::subject_base for the full interface.
+//! \ingroup observable
+template <typename ... Args>
+class subject<void(Args ...)> :
+    public detail::subject_base<void(Args ...), subject_policy>
+{
+};
+
+//! Subject specialization that uses a custom policy.
+//!
+//! \note Except for how observers are stored, this specialization is exactly
+//!       the same as a regular subject.
+//!
+//! \tparam ObserverType The function type of the observers that will subscribe
+//!                      to notifications.
+//! \tparam Policy A type for which \ref is_subject_policy is true.
+//!
+//! \see subject<void(Args ...)>
+//! \ingroup observable
+template <typename ObserverType, typename Policy>
+class subject<ObserverType, Policy> :
+    public std::conditional_t<is_subject_policy<Policy>::value,
+                              detail::subject_base<ObserverType, Policy>,
+                              subject<ObserverType, Policy, subject_policy>>
+{
 };
 
 //! Subject specialization that can be used inside a class, as a member, to
 //! prevent external code from calling notify(), but still allow anyone to
 //! subscribe.
 //!
+//! You can use this specialization by providing a second template parameter
+//! that is not a subject policy, for example: ``subject<void(), MyClass>``.
+//!
 //! \note Except for the notify() method being private, this specialization is
 //!       exactly the same as a regular subject.
 //!
@@ -197,17 +546,23 @@ private:
 //! \tparam EnclosingType This type will be declared a friend of the subject and
 //!                       will have access to the notify() method.
 //!
+//! \tparam Policy The policy used by the subject.
+//!
 //! \see subject<void(Args ...)>
 //! \ingroup observable
-template <typename ObserverType, typename EnclosingType>
-class subject<ObserverType, EnclosingType> : public subject<ObserverType>
+template <typename ObserverType, typename EnclosingType, typename Policy>
+class subject<ObserverType, EnclosingType, Policy> :
+    public subject<ObserverType, Policy>
 {
-public:
-    using subject<ObserverType>::subject;
+    static_assert(is_subject_policy<Policy>::value,
+                  "Policy must be a subject policy.");
 
 private:
     //! \see subject<void(Args...)>::notify
-    using subject<ObserverType>::notify;
+    using subject<ObserverType, Policy>::notify;
+
+    //! \see subject<void(Args...)>::notify_parallel
+    using subject<ObserverType, Policy>::notify_parallel;
 
     friend EnclosingType;
 };
@@ -1,9 +1,11 @@
 #pragma once
 #include <atomic>
 #include <cassert>
-#include <functional>
 #include <memory>
 #include <mutex>
+#include <type_traits>
+#include <utility>
+#include <observable/detail/inline_function.hpp>
 
 #include <observable/detail/compiler_config.hpp>
 OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
@@ -13,17 +15,27 @@ namespace observable {
 //! Infinite subscription that will not unsubscribe the associated observer
 //! when destroyed.
 //!
+//! The unsubscribe functor is stored inside the subscription object, so
+//! subscriptions created by subjects do not allocate.
+//!
 //! \ingroup observable
 class infinite_subscription
 {
 public:
+    //! Type of the functor that performs the unsubscribe.
+    using unsubscribe_token = detail::inline_function<void()>;
+
     //! Create a subscription with the specified unsubscribe functor.
     //!
     //! \param[in] unsubscribe Calling this functor will unsubscribe the
     //!                        associated observer.
     //! \note This is for internal use by subject instances.
-    explicit infinite_subscription(std::function<void()> const & unsubscribe) :
-        unsubscribe_ { unsubscribe }
+    template <typename Unsubscribe,
+              typename = std::enable_if_t<
+                            !std::is_base_of<infinite_subscription,
+                                             std::decay_t<Unsubscribe>>::value>>
+    explicit infinite_subscription(Unsubscribe && unsubscribe) :
+        unsubscribe_ { std::forward<Unsubscribe>(unsubscribe) }
     { }
 
     //! Unsubscribe the associated observer from receiving notifications.
@@ -33,13 +45,13 @@ public:
     //! \note If release() has been called, this method will have no effect.
     void unsubscribe()
     {
-        if(!called_ || !unsubscribe_ || called_->test_and_set())
+        if(!unsubscribe_ || called_.exchange(true))
             return;
 
         try {
-            if(unsubscribe_) unsubscribe_();
+            unsubscribe_();
         } catch(...) {
-            called_->clear();
+            called_.store(false);
             throw;
         }
     }
@@ -53,18 +65,17 @@ public:
     //!         when called.
     //!         For example: ``subscription.release()()`` is equivalent to
     //!         ``subscription.unsubscribe()``.
-    auto release()
+    auto release() noexcept -> unsubscribe_token
     {
-        using std::swap;
-        decltype(unsubscribe_) unsub = []() { };
-        swap(unsub, unsubscribe_);
+        if(called_.load())
+            unsubscribe_ = unsubscribe_token { [] { } };
 
-        return unsub;
+        return std::move(unsubscribe_);
     }
 
 public:
     //! This class is default-constructible.
-    infinite_subscription() =default;
+    infinite_subscription() noexcept =default;
 
     //! This class is not copy-constructible.
     infinite_subscription(infinite_subscription const & ) =delete;
@@ -73,18 +84,23 @@ public:
     auto operator=(infinite_subscription const &) -> infinite_subscription & =delete;
 
     //! This class is move-constructible.
-    infinite_subscription(infinite_subscription &&) = default;
+    infinite_subscription(infinite_subscription && other) noexcept :
+        unsubscribe_ { std::move(other.unsubscribe_) },
+        called_ { other.called_.load() }
+    { }
 
     //! This class is move-assignable.
-    auto operator=(infinite_subscription &&) -> infinite_subscription & =default;
+    auto operator=(infinite_subscription && other) noexcept
+        -> infinite_subscription &
+    {
+        unsubscribe_ = std::move(other.unsubscribe_);
+        called_.store(other.called_.load());
+        return *this;
+    }
 
 private:
-    std::function<void()> unsubscribe_ { []() { } };
-
-    // std::call_once with a std::once_flag would have worked, but it requires
-    // pthreads on Linux. We're using this in order not to bring in that
-    // dependency.
-    std::unique_ptr<std::atomic_flag> called_ { std::make_unique<std::atomic_flag>() };
+    unsubscribe_token unsubscribe_;
+    std::atomic<bool> called_ { false };
 };
 
 //! Unsubscribe the associated observer when destroyed.
@@ -0,0 +1,268 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <ios>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+#include <observable/detail/spsc_queue.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+//! Record a trace event for the rest of the enclosing scope.
+//!
+//! The library uses this macro around value changes, expression node
+//! evaluations and observer calls. It expands to nothing unless
+//! ``OBSERVABLE_TRACING`` is defined, so tracing costs nothing in regular
+//! builds.
+//!
+//! \warning ``OBSERVABLE_TRACING`` must be defined, or not, for the whole
+//!          program. Mixing translation units that disagree breaks the one
+//!          definition rule.
+//!
+//! \param NAME Event name. This must be a string literal, or a string that
+//!             lives until the trace has been written.
+//! \param DEPTH Depth of the traced object inside the dependency graph.
+//!
+//! \ingroup observable
+#if defined(OBSERVABLE_TRACING)
+#define OBSERVABLE_TRACE_SCOPE(NAME, DEPTH) \
+    ::observable::trace_scope const observable_trace_scope_ { (NAME), (DEPTH) }
+#else
+#define OBSERVABLE_TRACE_SCOPE(NAME, DEPTH) \
+    static_cast<void>(0)
+#endif
+
+namespace observable {
+
+namespace detail {
+
+//! A single complete event.
+//!
+//! \ingroup observable_detail
+struct trace_event
+{
+    char const * name;
+    std::int64_t start;
+    std::int64_t duration;
+    std::size_t depth;
+};
+
+//! Collects trace events from all threads.
+//!
+//! Each thread records into its own bounded, lock-free buffer; recording an
+//! event never blocks and never allocates, once the thread's buffer exists.
+//! Events that do not fit into a full buffer are dropped and counted.
+//!
+//! Writing the trace drains all buffers. Buffers of threads that have exited
+//! are dropped once they have been drained.
+//!
+//! \ingroup observable_detail
+class trace_recorder final
+{
+    using clock = std::chrono::steady_clock;
+
+public:
+    //! Number of events each thread can buffer between two writes.
+    static constexpr std::size_t buffer_capacity = 1 << 16;
+
+    //! Retrieve the process-wide recorder.
+    static auto instance() -> trace_recorder &
+    {
+        static trace_recorder recorder;
+        return recorder;
+    }
+
+    //! Return true if events are being recorded.
+    auto enabled() const noexcept { return enabled_.load(std::memory_order_relaxed); }
+
+    //! Start or stop recording events.
+    void enable(bool on) noexcept { enabled_.store(on, std::memory_order_relaxed); }
+
+    //! Current time, relative to the creation of the recorder.
+    auto now() const noexcept -> std::int64_t
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                clock::now() - epoch_).count();
+    }
+
+    //! Record an event into the calling thread's buffer.
+    void record(trace_event const & e) noexcept
+    {
+        auto & b = local_buffer();
+        if(!(b && b->events.try_push(e)))
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //! Number of events that have been dropped because a buffer was full.
+    auto dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+    //! Drain all buffered events, oldest first for each thread.
+    //!
+    //! \param fun Functor called with a thread index and a trace_event.
+    template <typename Fun>
+    void drain(Fun && fun)
+    {
+        std::lock_guard<std::mutex> const lock { mutex_ };
+
+        for(auto && b : buffers_)
+            while(b->events.try_pop([&](trace_event && e) { fun(b->thread, e); }))
+                ;
+
+        buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(),
+                                      [](auto && b) { return b.use_count() == 1; }),
+                       buffers_.end());
+    }
+
+private:
+    struct buffer
+    {
+        explicit buffer(std::size_t t) : thread { t } { }
+
+        std::size_t thread;
+        spsc_queue<trace_event> events { buffer_capacity };
+    };
+
+    trace_recorder() =default;
+
+    auto local_buffer() noexcept -> std::shared_ptr<buffer> &
+    {
+        thread_local std::shared_ptr<buffer> local = make_buffer();
+        return local;
+    }
+
+    auto make_buffer() noexcept -> std::shared_ptr<buffer>
+    {
+        try {
+            std::lock_guard<std::mutex> const lock { mutex_ };
+            buffers_.push_back(std::make_shared<buffer>(++last_thread_));
+            return buffers_.back();
+        } catch(...) {
+            return nullptr;
+        }
+    }
+
+private:
+    std::atomic<bool> enabled_ { false };
+    std::atomic<std::size_t> dropped_ { 0 };
+    clock::time_point const epoch_ { clock::now() };
+
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<buffer>> buffers_;
+    std::size_t last_thread_ { 0 };
+};
+
+}
+
+//! Records a trace event that lasts for the lifetime of this object.
+//!
+//! If tracing is not running when the scope is created, the scope does
+//! nothing.
+//!
+//! \see OBSERVABLE_TRACE_SCOPE
+//! \ingroup observable
+class trace_scope final
+{
+public:
+    //! Start an event.
+    //!
+    //! \param name Event name. The string must live until the trace has been
+    //!             written.
+    //! \param depth Depth of the traced object inside the dependency graph.
+    explicit trace_scope(char const * name, std::size_t depth=0) noexcept
+    {
+        auto & r = detail::trace_recorder::instance();
+        if(!r.enabled())
+            return;
+
+        event_ = { name, r.now(), 0, depth };
+    }
+
+    //! Record the event.
+    ~trace_scope()
+    {
+        if(!event_.name)
+            return;
+
+        auto & r = detail::trace_recorder::instance();
+        event_.duration = r.now() - event_.start;
+        r.record(event_);
+    }
+
+    //! Trace scopes are not copy-constructible.
+    trace_scope(trace_scope const &) =delete;
+
+    //! Trace scopes are not copy-assignable.
+    auto operator=(trace_scope const &) -> trace_scope & =delete;
+
+private:
+    detail::trace_event event_ { nullptr, 0, 0, 0 };
+};
+
+//! Start recording trace events.
+//!
+//! \ingroup observable
+inline void start_tracing() noexcept { detail::trace_recorder::instance().enable(true); }
+
+//! Stop recording trace events. Events that have already been recorded are
+//! kept until they are written.
+//!
+//! \ingroup observable
+inline void stop_tracing() noexcept { detail::trace_recorder::instance().enable(false); }
+
+//! Write all recorded events in the Chrome trace event format, and discard
+//! them.
+//!
+//! The output can be opened by ``chrome://tracing`` and by the Perfetto UI.
+//! Each event is a complete (``"X"``) event that has its depth as an argument.
+//!
+//! \param out Stream the trace will be written to.
+//! \return Number of events that have been written.
+//!
+//! \ingroup observable
+inline auto write_chrome_trace(std::ostream & out) -> std::size_t
+{
+    auto count = std::size_t { 0 };
+    auto & r = detail::trace_recorder::instance();
+
+    auto const write_string = [&](char const * s) {
+        out << '"';
+        for(; *s; ++s)
+        {
+            if(*s == '"' || *s == '\\')
+                out << '\\';
+            out << *s;
+        }
+        out << '"';
+    };
+
+    auto const flags = out.flags();
+    auto const precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+
+    out << "{\"traceEvents\":[";
+    r.drain([&](std::size_t thread, detail::trace_event const & e) {
+        out << (count++ ? ",\n" : "\n") << "{\"name\":";
+        write_string(e.name);
+        out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+            << ",\"ts\":" << static_cast<double>(e.start) / 1000.0
+            << ",\"dur\":" << static_cast<double>(e.duration) / 1000.0
+            << ",\"args\":{\"depth\":" << e.depth << "}}";
+    });
+    out << "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_events\":"
+        << r.dropped() << "}}\n";
+
+    out.flags(flags);
+    out.precision(precision);
+    return count;
+}
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
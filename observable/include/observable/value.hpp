@@ -1,12 +1,18 @@
 #pragma once
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <stdexcept>
+#include <string>
 #include <type_traits>
 #include <utility>
+#include <observable/batch.hpp>
 #include <observable/subject.hpp>
 #include <observable/subscription.hpp>
+#include <observable/detail/propagation.hpp>
 #include <observable/detail/type_traits.hpp>
 
 #include <observable/detail/compiler_config.hpp>
@@ -15,12 +21,23 @@ OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
 namespace observable {
 
 //! \cond
-template <typename ValueType, typename ...>
+template <typename ValueType,
+          typename EnclosingOrPolicy=void,
+          typename Policy=void,
+          typename=void>
 class value;
 
 template <typename ValueType>
 class value_updater;
 
+inline namespace expr {
+template <typename ResultType>
+class expression_node;
+
+template <typename ValueType>
+class fused_leaf;
+}
+
 namespace detail {
 
 struct equal_to
@@ -40,35 +57,218 @@ struct equal_to
     }
 };
 
+//! Call the ``invalidate()`` method of comparators that have one.
+template <typename Comparator>
+auto invalidate_comparator(Comparator const & equal, int)
+    noexcept(noexcept(equal.invalidate())) -> decltype(equal.invalidate())
+{
+    equal.invalidate();
+}
+
+template <typename Comparator>
+void invalidate_comparator(Comparator const &, long) noexcept { }
+
+//! Stores the comparator of a value. Empty comparators do not take any space.
+template <typename Comparator, typename=void>
+class comparator_holder
+{
+protected:
+    comparator_holder() =default;
+
+    explicit comparator_holder(Comparator equal)
+        noexcept(std::is_nothrow_move_constructible<Comparator>::value) :
+        equal_ { std::move(equal) }
+    { }
+
+    auto comparator() const noexcept -> Comparator const & { return equal_; }
+
+    void assign_comparator(comparator_holder && other)
+    {
+        equal_ = std::move(other.equal_);
+    }
+
+private:
+    Comparator equal_;
+};
+
+template <typename Comparator>
+class comparator_holder<Comparator,
+                        std::enable_if_t<std::is_empty<Comparator>::value &&
+                                         !std::is_final<Comparator>::value>> :
+    private Comparator
+{
+protected:
+    comparator_holder() =default;
+
+    explicit comparator_holder(Comparator equal)
+        noexcept(std::is_nothrow_move_constructible<Comparator>::value) :
+        Comparator(std::move(equal))
+    { }
+
+    auto comparator() const noexcept -> Comparator const & { return *this; }
+
+    void assign_comparator(comparator_holder &&) noexcept { }
+};
+
 }
 //! \endcond
 
-//! Exception thrown if you try to set a value that has an associated updater.
-struct readonly_value : std::runtime_error
+//! Select the equality comparator of a value.
+//!
+//! Use it as the second template argument of a value:
+//!
+//!     auto v = value<double, compare_with<almost_equal>> { 0.0 };
+//!
+//! The comparator is called with the current and the new value, and must
+//! return true if they are equal, in which case the value is not changed and
+//! observers are not notified. It is stored inside the value, so empty
+//! comparators do not take any space, and calls to it can be inlined.
+//!
+//! Comparators can also be provided at runtime, by using a type-erased
+//! comparator:
+//!
+//!     using runtime_equal = std::function<bool(int const &, int const &)>;
+//!     auto v = value<int, compare_with<runtime_equal>> { 1, some_functor };
+//!
+//! Comparators that keep state about the current value can have a
+//! ``void invalidate() const`` method. It is called whenever the value is
+//! changed without going through the comparator, like by modify() and update().
+//!
+//! \tparam Comparator Callable with a signature compatible with the one below.
+//!
+//!                        bool(ValueType const &, ValueType const &)
+//!
+//! \ingroup observable
+template <typename Comparator>
+struct compare_with
 {
-    readonly_value() = delete;
-    using std::runtime_error::runtime_error;
+    using type = Comparator;
 };
 
-//! Get notified when a value-type changes.
+//! \cond
+template <typename T>
+struct is_compare_with_ : std::false_type { };
+
+template <typename Comparator>
+struct is_compare_with_<compare_with<Comparator>> : std::true_type { };
+//! \endcond
+
+//! Check if a type is a \ref compare_with comparator selector.
 //!
-//! When setting a new value, if the new value is different than the existing one,
-//! any subscribed observers will be notified.
+//! \ingroup observable
+template <typename T>
+struct is_compare_with : is_compare_with_<std::decay_t<T>> { };
+
+//! Comparator that detects changes by hashing values, for types that are
+//! expensive to compare.
 //!
-//! Equality will be checked using ``std::equal_to<ValueType>`` if the ValueType
-//! is EqualityComparable, else all values will be assumed to be unequal.
+//! The hash of the current value is remembered, so each change only hashes the
+//! new value once, instead of comparing it to the current value.
 //!
-//! \warning None of the methods in this class can be safely called concurrently.
+//!     auto doc = value<std::string, compare_with<hash_equal_to<>>> { };
 //!
-//! \tparam ValueType The value-type that will be stored inside the observable.
-//!                   This type will need to be at least movable.
+//! \warning Values with colliding hashes are considered equal, so a change
+//!          can go unnoticed.
+//!
+//! \warning Each comparator instance must only be used by one value.
+//!
+//! \tparam Hash Hash function object. Defaults to ``std::hash<>`` of the
+//!              compared type.
 //!
 //! \ingroup observable
-template <typename ValueType>
-class value<ValueType>
+template <typename Hash=void>
+class hash_equal_to
 {
-    using void_subject = subject<void()>;
-    using value_subject = subject<void(ValueType const &)>;
+public:
+    //! Return true if both values have the same hash.
+    template <typename T>
+    auto operator()(T const & current, T const & new_value) const
+    {
+        auto const h = hash_of(new_value);
+        if(!known_)
+            last_ = hash_of(current);
+
+        // Unequal values replace the current value, so the new hash is the
+        // hash of the current value in both cases.
+        auto const equal = last_ == h;
+        last_ = h;
+        known_ = true;
+
+        return equal;
+    }
+
+    //! Forget the remembered hash.
+    //!
+    //! Values call this when they are changed in place, without going through
+    //! the comparator.
+    void invalidate() const noexcept { known_ = false; }
+
+private:
+    template <typename T, typename H=Hash>
+    static auto hash_of(T const & v)
+        -> std::enable_if_t<std::is_void<H>::value, std::size_t>
+    {
+        return std::hash<T> { }(v);
+    }
+
+    template <typename T, typename H=Hash>
+    static auto hash_of(T const & v)
+        -> std::enable_if_t<!std::is_void<H>::value, std::size_t>
+    {
+        return H { }(v);
+    }
+
+    mutable std::size_t last_ { 0 };
+    mutable bool known_ { false };
+};
+
+//! Comparator that detects changes by comparing version numbers.
+//!
+//! The compared type must have a ``version()`` method, returning a value that
+//! changes whenever the object changes. Nothing else is compared, so this is
+//! cheap even for very large types.
+//!
+//!     auto mesh = value<versioned_mesh, compare_with<version_equal_to>> { };
+//!
+//! \ingroup observable
+struct version_equal_to
+{
+    //! Return true if both values have the same version.
+    template <typename T>
+    auto operator()(T const & current, T const & new_value) const
+        noexcept(noexcept(current.version() == new_value.version()))
+    {
+        return current.version() == new_value.version();
+    }
+};
+
+//! Exception thrown if you try to set a value that has an associated updater.
+struct readonly_value : std::runtime_error
+{
+    readonly_value() = delete;
+    using std::runtime_error::runtime_error;
+};
+
+namespace detail {
+
+//! Implementation of the public value interface.
+//!
+//! \tparam Policy Subject policy used by all the value's subjects.
+//! \tparam Derived The public value type that derives from this class.
+//! \tparam Comparator Equality comparator used to suppress notifications for
+//!                    unchanged values.
+//!
+//! \see value<ValueType>
+//! \ingroup observable_detail
+template <typename ValueType,
+          typename Policy,
+          typename Derived,
+          typename Comparator=equal_to>
+class value_base : private comparator_holder<Comparator>
+{
+    using holder = comparator_holder<Comparator>;
+    using void_subject = subject<void(), Policy>;
+    using value_subject = subject<void(ValueType const &), Policy>;
 
 public:
     //! The observable value's stored value type.
@@ -78,12 +278,12 @@ public:
     //!
     //! Depending on the value type, the stored value will be either uninitialized
     //! or it will be default constructed.
-    value() =default;
+    value_base() =default;
 
     //! Create an initialized observable value.
     //!
     //! \param initial_value The observable's initial value.
-    explicit value(ValueType initial_value)
+    explicit value_base(ValueType initial_value)
         noexcept(std::is_nothrow_move_constructible<ValueType>::value) :
         value_ { std::move(initial_value) }
     { }
@@ -91,19 +291,14 @@ public:
     //! Create an initialized observable value.
     //!
     //! \param initial_value The observable's initial value.
-    //! \param equal A functor to be used for comparing values. The functor must
-    //!              have a signature compatible with the one below:
-    //!
-    //!                 bool(ValueType const &, ValueType const &)
+    //! \param equal The comparator instance to use for comparing values.
     //!
-    //!              The comparator must return true if both of its parameters
-    //!              are equal.
-    template <typename EqualityComparator>
-    value(ValueType initial_value, EqualityComparator equal)
+    //! \see compare_with
+    value_base(ValueType initial_value, Comparator equal)
         noexcept(std::is_nothrow_move_constructible<ValueType>::value &&
-                 std::is_nothrow_move_constructible<EqualityComparator>::value) :
-        value_ { std::move(initial_value) },
-        eq_ { std::move(equal) }
+                 std::is_nothrow_move_constructible<Comparator>::value) :
+        holder(std::move(equal)),
+        value_ { std::move(initial_value) }
     { }
 
     //! Create an initialized value that will be updated by the provided
@@ -111,22 +306,53 @@ public:
     //!
     //! \param ud A value_updater that will be stored by the value.
     template <typename UpdaterType>
-    explicit value(std::unique_ptr<UpdaterType> && ud) :
+    explicit value_base(std::unique_ptr<UpdaterType> && ud) :
         updater_ { std::move(ud) }
     {
-        using namespace std::placeholders;
+        bind_updater();
 
-        updater_->set_value_notifier(std::bind(&value<ValueType>::set_impl,
-                                               this,
-                                                std::placeholders::_1));
-        set_impl(updater_->get());
+        if(!stale_)
+            set_impl(updater_->get());
     }
 
     //! Convert the observable value to its stored value type.
-    explicit operator ValueType const &() const noexcept { return value_; }
+    explicit operator ValueType const &() const noexcept { return get(); }
 
     //! Retrieve the stored value.
-    auto get() const noexcept -> ValueType const & { return value_; }
+    //!
+    //! If the value's updater is lazy and the value is stale, this brings it
+    //! up to date first.
+    //!
+    //! \warning If a lazy updater throws while computing the value, the program
+    //!          is terminated.
+    auto get() const noexcept -> ValueType const &
+    {
+        refresh();
+        return value_;
+    }
+
+    //! Retrieve the value's version.
+    //!
+    //! The version starts at zero and is incremented each time the stored
+    //! value changes, before observers are notified, so polling readers can
+    //! detect changes with a single integer comparison:
+    //!
+    //!     if(mesh.version() != drawn)
+    //!     {
+    //!         drawn = mesh.version();
+    //!         draw(mesh.get());
+    //!     }
+    //!
+    //! The version is atomic, so it can be read from any thread. Reading the
+    //! stored value from another thread still needs to be synchronized.
+    //!
+    //! \note If the value's updater is lazy, the version is also incremented
+    //!       when the value becomes stale, even if its next computed value
+    //!       turns out to be unchanged.
+    auto version() const noexcept -> std::uint64_t
+    {
+        return version_.load(std::memory_order_acquire);
+    }
 
     //! Subscribe to changes to the observable value.
     //!
@@ -155,6 +381,9 @@ public:
                       "Observer is not valid. Please provide a void observer or an "
                       "observer that takes a ValueType as its only argument.");
 
+        // Stale values are not notified of changes anymore, they need to be
+        // computed again first.
+        refresh();
         return subscribe_impl(std::forward<Callable>(observer));
     }
 
@@ -184,6 +413,7 @@ public:
     template <typename Callable>
     auto subscribe_and_call(Callable && observer) const
     {
+        refresh();
         call_impl(observer);
         return subscribe(std::forward<Callable>(observer));
     }
@@ -193,27 +423,113 @@ public:
     //! If the new value compares equal to the existing value, this method has no
     //! effect. The comparison is performed using the EqualityComparator.
     //!
+    //! If a \ref batch is open on the calling thread, the observers will be
+    //! notified when the batch is committed.
+    //!
     //! \param new_value The new value to set.
     //! \throw readonly_value if the value has an associated updater.
     //! \see subject<void(Args ...)>::notify()
     void set(ValueType new_value)
     {
-        if(updater_)
-            throw readonly_value {
-                "Can't set a value that has an associated updater. These values "
-                "are readonly."
-            };
-
+        check_writable();
         set_impl(std::move(new_value));
     }
 
+    //! Modify the stored value in place.
+    //!
+    //! The functor is called with a non-const reference to the stored value,
+    //! so large values can be changed without being copied. Observers are
+    //! always notified afterwards, like after a set() with a different value;
+    //! no equality check is done.
+    //!
+    //! If a \ref batch is open on the calling thread, the observers will be
+    //! notified when the batch is committed.
+    //!
+    //! \param fun Functor that will be called with a ``ValueType &``. If it
+    //!            throws, observers are not notified.
+    //! \throw readonly_value if the value has an associated updater.
+    template <typename Fun>
+    void modify(Fun && fun)
+    {
+        check_writable();
+        OBSERVABLE_TRACE_SCOPE("value::modify", rank());
+        // The comparator does not see in-place changes.
+        detail::invalidate_comparator(holder::comparator(), 0);
+        fun(value_);
+        changed();
+    }
+
+    //! Modify the stored value in place and notify observers only if the
+    //! functor reports a change.
+    //!
+    //! This works like modify(), but the functor decides if the value has
+    //! changed, so updating part of a large value costs neither a copy nor a
+    //! full equality check.
+    //!
+    //! Example:
+    //!
+    //!     rows.update([&](auto & v) {
+    //!         if(v[i] == x)
+    //!             return false;
+    //!
+    //!         v[i] = x;
+    //!         return true;
+    //!     });
+    //!
+    //! \param fun Functor that will be called with a ``ValueType &`` and must
+    //!            return true if it changed the value. If it throws, observers
+    //!            are not notified.
+    //! \return The value returned by the functor.
+    //! \throw readonly_value if the value has an associated updater.
+    template <typename Fun>
+    auto update(Fun && fun) -> bool
+    {
+        check_writable();
+        OBSERVABLE_TRACE_SCOPE("value::update", rank());
+        detail::invalidate_comparator(holder::comparator(), 0);
+        if(!fun(value_))
+            return false;
+
+        changed();
+        return true;
+    }
+
     //! Set a new value. Will just call set(ValueType &&).
     //!
     //! \see set(ValueType &&)
-    auto operator=(ValueType new_value) -> value &
+    auto operator=(ValueType new_value) -> Derived &
     {
         set(std::move(new_value));
-        return *this;
+        return static_cast<Derived &>(*this);
+    }
+
+    //! Retrieve the notification statistics of the value's observers.
+    //!
+    //! This is only available if the value's subject policy uses a
+    //! \ref counting_instrumentation, like \ref instrumented_subject_policy.
+    //! Observers that take the new value and observers that take no arguments
+    //! are counted together; each change counts as one notification.
+    template <typename Subject=value_subject>
+    auto stats() const
+        -> decltype(std::declval<Subject const &>().instrumentation().stats())
+    {
+        return detail::merge_observers(value_observers_.instrumentation().stats(),
+                                       void_observers_.instrumentation().stats());
+    }
+
+    //! Name the value, so its statistics are visited by
+    //! for_each_instrumented().
+    //!
+    //! The value is visited twice, under the same name: once for observers
+    //! that take the new value and once for observers that take no arguments.
+    //!
+    //! \see stats()
+    template <typename Subject=value_subject>
+    auto name(std::string new_name) const
+        -> decltype(std::declval<Subject const &>().instrumentation().name(new_name))
+    {
+        void_observers_.instrumentation().name(new_name);
+        value_observers_.instrumentation().name(std::move(new_name));
     }
 
     //! Subject notified after the value has been moved.
@@ -223,51 +539,61 @@ public:
     //!
     //! \warning The subject of the moved-into value will be notified, not the
     //!          moved-from value's subject.
-    subject<void(value<ValueType> &), value<ValueType>> moved;
+    subject<void(Derived &), value_base, Policy> moved;
 
     //! Subject notified before the value is destroyed.
-    subject<void(), value<ValueType>> destroyed;
+    subject<void(), value_base, Policy> destroyed;
 
     //! Destructor.
-    ~value() { destroyed.notify(); }
+    ~value_base()
+    {
+        if(pending_)
+            batch::cancel(this);
+
+        destroyed.notify();
+    }
 
 public:
     //! Observable values are **not** copy-constructible.
-    value(value<ValueType> const &) =delete;
+    value_base(value_base const &) =delete;
 
     //! Observable values are **not** copy-assignable.
-    auto operator=(value<ValueType> const &) -> value<ValueType> & =delete;
+    auto operator=(value_base const &) -> value_base & =delete;
 
     //! Observable values are move-constructible.
     template <typename = std::enable_if_t<std::is_move_constructible<ValueType>::value>>
-    value(value<ValueType> && other)
+    value_base(value_base && other)
         noexcept(std::is_nothrow_move_constructible<ValueType>::value) :
+        holder(std::move(other)),
         moved { std::move(other.moved) },
         destroyed { std::move(other.destroyed) },
         value_(std::move(other.value_)),
-        eq_ { std::move(other.eq_) },
         void_observers_ { std::move(other.void_observers_) },
         value_observers_ { std::move(other.value_observers_) },
-        updater_ { std::move(other.updater_) }
+        updater_ { std::move(other.updater_) },
+        stale_ { other.stale_ },
+        version_ { other.version_.load(std::memory_order_relaxed) }
     {
-        using namespace std::placeholders;
         if(updater_)
-            updater_->set_value_notifier(std::bind(&value<ValueType>::set_impl,
-                                                   this,
-                                                   std::placeholders::_1));
+            bind_updater();
+
+        if(other.pending_)
+        {
+            batch::retarget(&other, this);
+            pending_ = true;
+            other.pending_ = false;
+        }
 
-        moved.notify(*this);
+        moved.notify(static_cast<Derived &>(*this));
         other.destroyed = decltype(destroyed) { };
     }
 
     //! Observable values are move-assignable.
     template <typename =  std::enable_if_t<std::is_move_assignable<ValueType>::value>>
-    auto operator=(value<ValueType> && other)
+    auto operator=(value_base && other)
         noexcept(std::is_nothrow_move_assignable<ValueType>::value)
-        -> value<ValueType> &
+        -> value_base &
     {
-        using namespace std::placeholders;
-
         moved = std::move(other.moved);
         destroyed = std::move(other.destroyed);
 
@@ -275,14 +601,29 @@ public:
         void_observers_ = std::move(other.void_observers_);
         value_observers_ = std::move(other.value_observers_);
         updater_ = std::move(other.updater_);
-        eq_ = std::move(other.eq_);
+        holder::assign_comparator(std::move(other));
+        stale_ = other.stale_;
+
+        // Differs from any version that was read from either value.
+        auto const v = std::max(version_.load(std::memory_order_relaxed),
+                                other.version_.load(std::memory_order_relaxed));
+        version_.store(v + 1, std::memory_order_release);
 
         if(updater_)
-            updater_->set_value_notifier(std::bind(&value<ValueType>::set_impl,
-                                                   this,
-                                                   std::placeholders::_1));
+            bind_updater();
+
+        if(other.pending_)
+        {
+            if(pending_)
+                batch::cancel(&other);
+            else
+                batch::retarget(&other, this);
 
-        moved.notify(*this);
+            pending_ = true;
+            other.pending_ = false;
+        }
+
+        moved.notify(static_cast<Derived &>(*this));
         other.destroyed = decltype(destroyed) { };
         return *this;
     }
@@ -322,29 +663,236 @@ private:
         observer(value_);
     }
 
+    //! Connect the updater to this value.
+    void bind_updater()
+    {
+        updater_->set_value_notifier(std::bind(&value_base::set_impl,
+                                               this,
+                                               std::placeholders::_1));
+
+        updater_->set_stale_notifier([this]() {
+            if(!void_observers_.empty() || !value_observers_.empty())
+                return true;
+
+            stale_ = true;
+            bump_version();
+            return false;
+        });
+    }
+
+    //! Read the value from its updater, if it is stale.
+    //!
+    //! Stale values have no observers, so there is nobody to notify.
+    void refresh() const noexcept
+    {
+        if(!stale_)
+            return;
+
+        stale_ = false;
+
+        // Goes through the comparator, so stateful comparators see the change.
+        auto new_value = updater_->get();
+        if(!holder::comparator()(value_, new_value))
+            value_ = std::move(new_value);
+    }
+
+    void check_writable() const
+    {
+        if(updater_)
+            throw readonly_value {
+                "Can't set a value that has an associated updater. These values "
+                "are readonly."
+            };
+    }
+
     void set_impl(ValueType new_value)
     {
-        if(eq_(value_, new_value))
+        OBSERVABLE_TRACE_SCOPE("value::set", rank());
+        if(holder::comparator()(value_, new_value))
             return;
 
         value_ = std::move(new_value);
-        void_observers_.notify();
-        value_observers_.notify(value_);
+        changed();
     }
 
-private:
-    ValueType value_;
+    //! Notify observers of a change to the stored value, or defer the
+    //! notification if a batch is open.
+    void changed()
+    {
+        bump_version();
 
-    std::function<bool(ValueType const &, ValueType const &)> eq_ {
-        [](auto && a, auto && b) { return detail::equal_to { }(a, b); }
-    };
+        if(!pending_)
+            pending_ = batch::defer(this, &flush);
+
+        if(pending_)
+            return;
+
+        notify_observers();
+    }
+
+    //! Only the thread that changes the value writes the version, so this
+    //! does not need a read-modify-write.
+    void bump_version() noexcept
+    {
+        version_.store(version_.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_release);
+    }
+
+    void notify_observers() const
+    {
+        detail::propagation::run([&]() {
+            void_observers_.notify();
+            value_observers_.notify(value_);
+        });
+    }
+
+    //! Propagation rank of the value; values updated by an updater are ranked
+    //! after everything the updater depends on.
+    auto rank() const noexcept -> std::size_t
+    {
+        return updater_ ? updater_->rank() : 0;
+    }
+
+    //! Deliver a change deferred by a batch.
+    static void flush(void * target, bool notify)
+    {
+        auto & v = *static_cast<value_base *>(target);
+        v.pending_ = false;
+
+        if(notify)
+            v.notify_observers();
+    }
+
+private:
+    // Mutable, so lazily updated values can be refreshed when they are read.
+    mutable ValueType value_;
 
     mutable void_subject void_observers_;
     mutable value_subject value_observers_;
     std::unique_ptr<value_updater<ValueType>> updater_;
 
-    template <typename, typename ...>
-    friend class value;
+    // True while the change notification is deferred by a batch.
+    bool pending_ { false };
+
+    // True if a lazy updater has a newer value that has not been read yet.
+    mutable bool stale_ { false };
+
+    // Incremented each time value_ changes.
+    std::atomic<std::uint64_t> version_ { 0 };
+
+    template <typename>
+    friend class expr::expression_node;
+
+    template <typename>
+    friend class expr::fused_leaf;
+};
+
+
+}
+
+//! Get notified when a value-type changes.
+//!
+//! When setting a new value, if the new value is different than the existing one,
+//! any subscribed observers will be notified.
+//!
+//! Equality will be checked using ``std::equal_to<ValueType>`` if the ValueType
+//! is EqualityComparable, else all values will be assumed to be unequal. Use
+//! \ref compare_with to select another comparator.
+//!
+//! \warning None of the methods in this class can be safely called concurrently.
+//!
+//! \tparam ValueType The value-type that will be stored inside the observable.
+//!                   This type will need to be at least movable.
+//!
+//! \see detail::value_base for the full interface.
+//! \ingroup observable
+template <typename ValueType>
+class value<ValueType> :
+    public detail::value_base<ValueType, subject_policy, value<ValueType>>
+{
+    using base = detail::value_base<ValueType, subject_policy, value<ValueType>>;
+
+public:
+    using base::base;
+    using base::operator=;
+
+    //! \see detail::value_base::value_base()
+    value() =default;
+};
+
+//! Value specialization that uses a custom subject policy.
+//!
+//! The policy is used by all the subjects owned by the value. For example,
+//! ``value<int, contiguous_subject_policy>`` keeps its observers in
+//! contiguous memory.
+//!
+//! \note Except for how observers are stored, this specialization is exactly
+//!       the same as a regular value.
+//!
+//! \tparam ValueType The value-type that will be stored inside the observable.
+//! \tparam Policy A type for which \ref is_subject_policy is true.
+//!
+//! \see value<ValueType>
+//! \ingroup observable
+template <typename ValueType, typename Policy>
+class value<ValueType, Policy, void,
+            std::enable_if_t<is_subject_policy<Policy>::value>> :
+    public detail::value_base<ValueType, Policy, value<ValueType, Policy>>
+{
+    using base = detail::value_base<ValueType, Policy, value<ValueType, Policy>>;
+
+public:
+    using base::base;
+    using base::operator=;
+
+    //! \see detail::value_base::value_base()
+    value() =default;
+};
+
+//! Value specialization that uses a custom equality comparator.
+//!
+//! Example:
+//!
+//!     struct same_sign
+//!     {
+//!         auto operator()(int a, int b) const { return (a < 0) == (b < 0); }
+//!     };
+//!
+//!     auto v = value<int, compare_with<same_sign>> { 1 };
+//!     v = 5; // Observers are not notified.
+//!
+//! \tparam ValueType The value-type that will be stored inside the observable.
+//! \tparam Comparator A \ref compare_with instantiation.
+//! \tparam Policy Optional subject policy, used like in
+//!                ``value<ValueType, Policy>``.
+//!
+//! \see value<ValueType>
+//! \ingroup observable
+template <typename ValueType, typename Comparator, typename Policy>
+class value<ValueType, Comparator, Policy,
+            std::enable_if_t<is_compare_with<Comparator>::value &&
+                             (std::is_void<Policy>::value ||
+                              is_subject_policy<Policy>::value)>> :
+    public detail::value_base<ValueType,
+                              std::conditional_t<std::is_void<Policy>::value,
+                                                 subject_policy,
+                                                 Policy>,
+                              value<ValueType, Comparator, Policy>,
+                              typename Comparator::type>
+{
+    using base = detail::value_base<ValueType,
+                                    std::conditional_t<std::is_void<Policy>::value,
+                                                       subject_policy,
+                                                       Policy>,
+                                    value<ValueType, Comparator, Policy>,
+                                    typename Comparator::type>;
+
+public:
+    using base::base;
+    using base::operator=;
+
+    //! \see detail::value_base::value_base()
+    value() =default;
 };
 
 //! Value specialization that can be used inside a class, as a member, to
@@ -358,33 +906,44 @@ private:
 //!
 //! \tparam ValueType The value-type that will be stored inside the observable.
 //! \tparam EnclosingType A type that will have access to the value's setters.
+//! \tparam Policy Optional subject policy, used like in
+//!                ``value<ValueType, Policy>``.
 //!
 //! \ingroup observable
-template <typename ValueType, typename EnclosingType>
-class value<ValueType, EnclosingType> :
-    public value<ValueType>
+template <typename ValueType, typename EnclosingType, typename Policy>
+class value<ValueType, EnclosingType, Policy,
+            std::enable_if_t<!std::is_void<EnclosingType>::value &&
+                             !is_subject_policy<EnclosingType>::value &&
+                             !is_compare_with<EnclosingType>::value &&
+                             (std::is_void<Policy>::value ||
+                              is_subject_policy<Policy>::value)>> :
+    public std::conditional_t<std::is_void<Policy>::value,
+                              value<ValueType>,
+                              value<ValueType, Policy>>
 {
+    using base = std::conditional_t<std::is_void<Policy>::value,
+                                    value<ValueType>,
+                                    value<ValueType, Policy>>;
+
 public:
-    using value<ValueType>::value;
+    using base::base;
 
     value() =default;
 
 private:
-    using value<ValueType>::set;
-    using value<ValueType>::operator=;
+    using base::set;
+    using base::operator=;
 
-    value(value<ValueType, EnclosingType> &&) =default;
+    value(value &&) =default;
 
-    auto operator=(value<ValueType, EnclosingType> &&)
-         -> value<ValueType, EnclosingType> & =default;
+    auto operator=(value &&) -> value & =default;
 
-    value(value<ValueType> && other) :
-        value<ValueType> { std::move(other) }
+    value(base && other) : base { std::move(other) }
     { }
 
-    auto operator=(value<ValueType> && other) -> value<ValueType, EnclosingType> &
+    auto operator=(base && other) -> value &
     {
-        *static_cast<value<ValueType> *>(this) = std::move(other);
+        *static_cast<base *>(this) = std::move(other);
         return *this;
     }
 
@@ -456,9 +1015,31 @@ public:
     //! \param[in] notifier Functor that will notify the value of a change.
     virtual void set_value_notifier(std::function<void(ValueType &&)> const & notifier) =0;
 
+    //! Set a functor that a lazy updater can call, instead of computing a new
+    //! value, when the value might have changed.
+    //!
+    //! The functor returns true if the value has observers; the updater must
+    //! then compute the new value and notify it, as usual. Otherwise, the value
+    //! is marked as stale and will call get() the next time it is read.
+    //!
+    //! Updaters that are not lazy can ignore this.
+    //!
+    //! \param[in] notifier Functor that will mark the value as stale.
+    virtual void set_stale_notifier(std::function<bool()> const & notifier)
+    {
+        static_cast<void>(notifier);
+    }
+
     //! Retrieve the current value.
     virtual auto get() const -> ValueType =0;
 
+    //! Propagation rank of the updated value.
+    //!
+    //! Values are updated in increasing rank order after a change, so an
+    //! updater that depends on other values must return a rank that is higher
+    //! than theirs.
+    virtual auto rank() const -> std::size_t { return 0; }
+
     //! Destructor.
     virtual ~value_updater() { }
 
@@ -0,0 +1,267 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <observable/subject.hpp>
+#include <observable/subscription.hpp>
+#include <observable/value.hpp>
+
+#include <observable/detail/compiler_config.hpp>
+OBSERVABLE_BEGIN_CONFIGURE_WARNINGS
+
+namespace observable {
+
+//! Description of a change made to an observable \ref vector.
+//!
+//! Every change replaces ``removed_count`` elements, starting at index
+//! ``first``, with ``count`` new elements. The new elements are available
+//! through ``values`` and the old ones through ``removed``, for the duration
+//! of the notification.
+//!
+//! \ingroup observable
+template <typename ValueType>
+struct vector_change
+{
+    //! Kind of change.
+    enum class kind
+    {
+        //! Elements have been inserted; ``removed_count`` is zero.
+        insert,
+        //! Elements have been erased; ``count`` is zero.
+        erase,
+        //! Elements have been overwritten; ``count`` equals ``removed_count``.
+        update,
+        //! The whole content has been replaced; ``first`` is zero.
+        reset
+    };
+
+    //! Kind of change.
+    kind type;
+
+    //! Index of the first changed element.
+    std::size_t first;
+
+    //! Number of elements that are now at ``[first, first + count)``.
+    std::size_t count;
+
+    //! The ``count`` new elements, inside the vector.
+    ValueType const * values;
+
+    //! Elements that have been erased or overwritten, in their original order.
+    //! This is only valid while observers are being notified.
+    ValueType const * removed;
+
+    //! Number of elements pointed to by ``removed``.
+    std::size_t removed_count;
+};
+
+//! Sequence container that notifies its observers of each change.
+//!
+//! Observers are not just told that the vector has changed; they receive a
+//! \ref vector_change that describes which elements have been inserted,
+//! erased or updated. Observers that keep derived state (like a UI model or an
+//! aggregate) can apply the change, instead of looking at the whole content.
+//!
+//! The vector can be read like a ``std::vector``, but can only be modified
+//! through its own methods, which notify the observers.
+//!
+//! \warning None of the methods in this class can be safely called
+//!          concurrently.
+//!
+//! \tparam ValueType Type of the stored elements.
+//!
+//! \ingroup observable
+template <typename ValueType>
+class vector final
+{
+    static_assert(!std::is_same<ValueType, bool>::value,
+                  "vector<bool> is not supported.");
+
+public:
+    using value_type = ValueType;
+    using container_type = std::vector<ValueType>;
+    using size_type = typename container_type::size_type;
+    using const_iterator = typename container_type::const_iterator;
+    using change_type = vector_change<ValueType>;
+    using observer_type = void(change_type const &);
+
+    //! Create an empty vector.
+    vector() =default;
+
+    //! Create a vector with the provided elements.
+    vector(std::initializer_list<ValueType> values) : items_ { values } { }
+
+    //! Create a vector that takes ownership of the provided elements.
+    explicit vector(container_type values) : items_(std::move(values)) { }
+
+    //! Subscribe to changes.
+    //!
+    //! \param[in] observer Callable compatible with ``void(change_type const &)``.
+    //! \return An infinite subscription that can be used to unsubscribe the
+    //!         observer.
+    //! \see subject<void(Args ...)>::subscribe()
+    template <typename Callable>
+    auto subscribe(Callable && observer) const
+    {
+        return changes_.subscribe(std::forward<Callable>(observer));
+    }
+
+    //! Retrieve the stored elements.
+    auto get() const noexcept -> container_type const & { return items_; }
+
+    //! \see get()
+    explicit operator container_type const &() const noexcept { return items_; }
+
+    //! Number of stored elements.
+    auto size() const noexcept { return items_.size(); }
+
+    //! Return true if there are no stored elements.
+    auto empty() const noexcept { return items_.empty(); }
+
+    //! Retrieve an element. The index must be valid.
+    auto operator[](size_type index) const noexcept -> ValueType const &
+    {
+        assert(index < items_.size());
+        return items_[index];
+    }
+
+    //! Retrieve an element.
+    //!
+    //! \throw std::out_of_range if the index is not valid.
+    auto at(size_type index) const -> ValueType const & { return items_.at(index); }
+
+    //! Iterator to the first element.
+    auto begin() const noexcept -> const_iterator { return items_.begin(); }
+
+    //! Iterator past the last element.
+    auto end() const noexcept -> const_iterator { return items_.end(); }
+
+    //! Add an element at the end.
+    void push_back(ValueType v) { insert(items_.size(), std::move(v)); }
+
+    //! Insert an element before the provided index.
+    void insert(size_type index, ValueType v)
+    {
+        assert(index <= items_.size());
+        items_.insert(items_.begin() + index, std::move(v));
+        notify(change_type::kind::insert, index, 1, nullptr, 0);
+    }
+
+    //! Insert a range of elements before the provided index.
+    template <typename InputIt>
+    void insert(size_type index, InputIt first, InputIt last)
+    {
+        assert(index <= items_.size());
+        auto const old_size = items_.size();
+        items_.insert(items_.begin() + index, first, last);
+
+        auto const count = items_.size() - old_size;
+        if(count > 0)
+            notify(change_type::kind::insert, index, count, nullptr, 0);
+    }
+
+    //! Erase the element at the provided index.
+    void erase(size_type index) { erase(index, 1); }
+
+    //! Erase ``count`` consecutive elements, starting at the provided index.
+    void erase(size_type index, size_type count)
+    {
+        assert(index + count <= items_.size());
+        if(count == 0)
+            return;
+
+        auto const first = items_.begin() + index;
+        auto const last = first + count;
+        auto removed = container_type(std::make_move_iterator(first),
+                                      std::make_move_iterator(last));
+        items_.erase(first, last);
+
+        notify(change_type::kind::erase, index, 0, removed.data(), count);
+    }
+
+    //! Erase the last element. The vector must not be empty.
+    void pop_back()
+    {
+        assert(!items_.empty());
+        erase(items_.size() - 1);
+    }
+
+    //! Overwrite the element at the provided index.
+    //!
+    //! Observers are not notified if the new element is equal to the old one.
+    void set(size_type index, ValueType v)
+    {
+        assert(index < items_.size());
+        if(detail::equal_to { }(items_[index], v))
+            return;
+
+        auto old = std::exchange(items_[index], std::move(v));
+        notify(change_type::kind::update, index, 1, &old, 1);
+    }
+
+    //! Modify the element at the provided index in place.
+    //!
+    //! The functor is called with a reference to the element and must return
+    //! true if it has changed the element. Observers are only notified if it
+    //! did; ``removed`` will point to a copy of the element, taken before the
+    //! functor was called.
+    //!
+    //! \return The value returned by the functor.
+    template <typename Fun>
+    auto update(size_type index, Fun && fun) -> bool
+    {
+        assert(index < items_.size());
+        auto old = items_[index];
+        if(!fun(items_[index]))
+            return false;
+
+        notify(change_type::kind::update, index, 1, &old, 1);
+        return true;
+    }
+
+    //! Replace the whole content.
+    void assign(container_type values)
+    {
+        auto old = std::exchange(items_, std::move(values));
+        notify(change_type::kind::reset, 0, items_.size(), old.data(), old.size());
+    }
+
+    //! Erase all elements.
+    void clear() { assign(container_type { }); }
+
+public:
+    //! Vectors are **not** copy-constructible.
+    vector(vector const &) =delete;
+
+    //! Vectors are **not** copy-assignable.
+    auto operator=(vector const &) -> vector & =delete;
+
+    //! Vectors are move-constructible.
+    vector(vector &&) =default;
+
+    //! Vectors are move-assignable.
+    auto operator=(vector &&) -> vector & =default;
+
+private:
+    void notify(typename change_type::kind type,
+                size_type first,
+                size_type count,
+                ValueType const * removed,
+                size_type removed_count) const
+    {
+        changes_.notify(change_type { type, first, count, items_.data() + first,
+                                      removed, removed_count });
+    }
+
+private:
+    container_type items_;
+    mutable subject<observer_type> changes_;
+};
+
+}
+
+OBSERVABLE_END_CONFIGURE_WARNINGS
@@ -0,0 +1,269 @@
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/async_subject.hpp>
+
+namespace observable { namespace test {
+
+namespace {
+
+//! Executor that queues tasks until they are explicitly run.
+struct manual_executor
+{
+    void operator()(async_task task) { tasks->push_back(std::move(task)); }
+
+    void run_all()
+    {
+        while(!tasks->empty())
+        {
+            auto task = std::move(tasks->front());
+            tasks->pop_front();
+            task();
+        }
+    }
+
+    std::shared_ptr<std::deque<async_task>> tasks {
+        std::make_shared<std::deque<async_task>>()
+    };
+};
+
+}
+
+TEST_CASE("async_subject/subscribing", "[async_subject]")
+{
+    SECTION("new subject is empty")
+    {
+        async_subject<void()> s;
+
+        REQUIRE(s.empty());
+    }
+
+    SECTION("subject with observers is not empty")
+    {
+        async_subject<void()> s;
+        auto const sub = s.subscribe([]() { });
+
+        REQUIRE_FALSE(s.empty());
+    }
+
+    SECTION("observers use the inline executor by default")
+    {
+        async_subject<void(int)> s;
+        auto v = 0;
+        auto const sub = s.subscribe([&](int x) { v = x; });
+
+        s.notify(5);
+
+        REQUIRE(v == 5);
+    }
+
+    SECTION("observers use the default executor of the subject")
+    {
+        auto ex = manual_executor { };
+        async_subject<void(int)> s { ex };
+        auto v = 0;
+        auto const sub = s.subscribe([&](int x) { v = x; });
+
+        s.notify(5);
+        REQUIRE(v == 0);
+
+        ex.run_all();
+        REQUIRE(v == 5);
+    }
+}
+
+TEST_CASE("async_subject/notifying", "[async_subject]")
+{
+    SECTION("notify() submits one task per observer")
+    {
+        auto ex = manual_executor { };
+        async_subject<void()> s;
+        auto const s1 = s.subscribe(ex, []() { });
+        auto const s2 = s.subscribe(ex, []() { });
+
+        s.notify();
+        REQUIRE(ex.tasks->size() == 2);
+
+        ex.run_all();
+    }
+
+    SECTION("observers are called through their own executor")
+    {
+        auto ex1 = manual_executor { };
+        auto ex2 = manual_executor { };
+        async_subject<void(int)> s;
+        auto a = 0;
+        auto b = 0;
+        auto const s1 = s.subscribe(ex1, [&](int x) { a = x; });
+        auto const s2 = s.subscribe(ex2, [&](int x) { b = x; });
+
+        s.notify(3);
+        ex1.run_all();
+
+        REQUIRE(a == 3);
+        REQUIRE(b == 0);
+
+        ex2.run_all();
+        REQUIRE(b == 3);
+    }
+
+    SECTION("payload is shared between observers")
+    {
+        auto ex = manual_executor { };
+        async_subject<void(std::string const &)> s;
+        std::vector<std::string const *> seen;
+        auto const s1 = s.subscribe(ex, [&](auto && v) { seen.push_back(&v); });
+        auto const s2 = s.subscribe(ex, [&](auto && v) { seen.push_back(&v); });
+
+        s.notify("hello");
+        REQUIRE(ex.tasks->size() == 2);
+
+        ex.run_all();
+
+        REQUIRE(seen.size() == 2);
+        REQUIRE(seen[0] == seen[1]);
+    }
+
+    SECTION("payload outlives the notify() call")
+    {
+        auto ex = manual_executor { };
+        async_subject<void(std::string)> s;
+        auto v = std::string { };
+        auto const sub = s.subscribe(ex, [&](std::string x) { v = x; });
+
+        {
+            auto temp = std::string { "a fairly long string, not stored inline" };
+            s.notify(std::move(temp));
+        }
+        ex.run_all();
+
+        REQUIRE(v == "a fairly long string, not stored inline");
+    }
+
+    SECTION("arguments are moved into the payload")
+    {
+        auto ex = manual_executor { };
+        async_subject<void(std::vector<int>)> s;
+        auto arg = std::vector<int> { 1, 2, 3 };
+        auto const data = arg.data();
+        auto seen = static_cast<int const *>(nullptr);
+        auto const sub = s.subscribe(ex, [&](std::vector<int> const & x) {
+            seen = x.data();
+        });
+
+        s.notify(std::move(arg));
+        ex.run_all();
+
+        REQUIRE(seen == data);
+    }
+
+    SECTION("notify() without observers does not submit tasks")
+    {
+        auto ex = manual_executor { };
+        async_subject<void(int)> s { ex };
+
+        s.notify(1);
+
+        REQUIRE(ex.tasks->empty());
+    }
+}
+
+TEST_CASE("async_subject/unsubscribing", "[async_subject]")
+{
+    SECTION("unsubscribed observer is not notified")
+    {
+        auto ex = manual_executor { };
+        async_subject<void()> s;
+        auto calls = 0;
+        auto sub = s.subscribe(ex, [&]() { ++calls; });
+
+        sub.unsubscribe();
+        s.notify();
+        ex.run_all();
+
+        REQUIRE(calls == 0);
+        REQUIRE(s.empty());
+    }
+
+    SECTION("queued tasks of an unsubscribed observer do nothing")
+    {
+        auto ex = manual_executor { };
+        async_subject<void()> s;
+        auto calls = 0;
+        auto sub = s.subscribe(ex, [&]() { ++calls; });
+
+        s.notify();
+        sub.unsubscribe();
+        ex.run_all();
+
+        REQUIRE(calls == 0);
+    }
+
+    SECTION("queued tasks can run after the subject is destroyed")
+    {
+        auto ex = manual_executor { };
+        auto v = 0;
+
+        {
+            async_subject<void(int)> s;
+            auto const sub = s.subscribe(ex, [&](int x) { v = x; });
+            s.notify(4);
+        }
+
+        ex.run_all();
+        REQUIRE(v == 4);
+    }
+}
+
+TEST_CASE("async_subject/threads", "[async_subject]")
+{
+    SECTION("notifications can be delivered on another thread")
+    {
+        std::mutex mutex;
+        std::deque<async_task> queue;
+        std::atomic<bool> done { false };
+        std::atomic<int> sum { 0 };
+
+        auto consumer = std::thread { [&]() {
+            for(;;)
+            {
+                auto task = async_task { };
+                {
+                    std::lock_guard<std::mutex> const lock { mutex };
+                    if(queue.empty())
+                    {
+                        if(done)
+                            return;
+                        continue;
+                    }
+
+                    task = std::move(queue.front());
+                    queue.pop_front();
+                }
+                task();
+            }
+        } };
+
+        async_subject<void(int)> s { [&](async_task task) {
+            std::lock_guard<std::mutex> const lock { mutex };
+            queue.push_back(std::move(task));
+        } };
+        auto const sub = s.subscribe([&](int x) { sum += x; });
+
+        for(auto i = 1; i <= 100; ++i)
+            s.notify(i);
+
+        done = true;
+        consumer.join();
+
+        REQUIRE(sum == 5050);
+    }
+}
+
+} }
@@ -0,0 +1,262 @@
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/batch.hpp>
+#include <observable/value.hpp>
+
+namespace observable { namespace test {
+
+TEST_CASE("batch/deferring", "[batch]")
+{
+    SECTION("observers are not called before commit")
+    {
+        auto val = value<int> { 1 };
+        auto call_count = 0;
+        val.subscribe([&]() { ++call_count; }).release();
+
+        batch b;
+        val = 2;
+
+        REQUIRE(call_count == 0);
+        REQUIRE(val.get() == 2);
+    }
+
+    SECTION("observers are called once on commit with the latest value")
+    {
+        auto val = value<int> { 1 };
+        auto call_count = 0;
+        auto last = 0;
+        val.subscribe([&](int v) { ++call_count; last = v; }).release();
+
+        batch b;
+        val = 2;
+        val = 3;
+        val = 4;
+        b.commit();
+
+        REQUIRE(call_count == 1);
+        REQUIRE(last == 4);
+    }
+
+    SECTION("observers of all changed values are called")
+    {
+        auto a = value<int> { 1 };
+        auto c = value<int> { 1 };
+        auto call_count = 0;
+        a.subscribe([&]() { ++call_count; }).release();
+        c.subscribe([&]() { ++call_count; }).release();
+
+        batch b;
+        a = 2;
+        c = 2;
+        b.commit();
+
+        REQUIRE(call_count == 2);
+    }
+
+    SECTION("unchanged values are not notified")
+    {
+        auto val = value<int> { 1 };
+        auto call_count = 0;
+        val.subscribe([&]() { ++call_count; }).release();
+
+        batch b;
+        val = 1;
+        b.commit();
+
+        REQUIRE(call_count == 0);
+    }
+
+    SECTION("destructor commits")
+    {
+        auto val = value<int> { 1 };
+        auto call_count = 0;
+        val.subscribe([&]() { ++call_count; }).release();
+
+        {
+            batch b;
+            val = 2;
+        }
+
+        REQUIRE(call_count == 1);
+    }
+
+    SECTION("values are notified immediately after commit")
+    {
+        auto val = value<int> { 1 };
+        auto call_count = 0;
+        val.subscribe([&]() { ++call_count; }).release();
+
+        batch b;
+        b.commit();
+        val = 2;
+
+        REQUIRE(call_count == 1);
+        REQUIRE_FALSE(b.is_open());
+    }
+}
+
+TEST_CASE("batch/nesting", "[batch]")
+{
+    SECTION("inner commit does not deliver")
+    {
+        auto val = value<int> { 1 };
+        auto call_count = 0;
+        val.subscribe([&]() { ++call_count; }).release();
+
+        batch outer;
+        {
+            batch inner;
+            val = 2;
+            inner.commit();
+        }
+
+        REQUIRE(call_count == 0);
+
+        outer.commit();
+
+        REQUIRE(call_count == 1);
+    }
+}
+
+TEST_CASE("batch/lifetime", "[batch]")
+{
+    SECTION("destroyed pending value is not notified")
+    {
+        auto call_count = 0;
+
+        batch b;
+        {
+            auto val = value<int> { 1 };
+            val.subscribe([&]() { ++call_count; }).release();
+            val = 2;
+        }
+        b.commit();
+
+        REQUIRE(call_count == 0);
+    }
+
+    SECTION("moved pending value is notified at its new location")
+    {
+        auto val = value<int> { 1 };
+        auto seen = 0;
+        val.subscribe([&](int v) { seen = v; }).release();
+
+        batch b;
+        val = 2;
+        auto moved = std::move(val);
+        b.commit();
+
+        REQUIRE(seen == 2);
+    }
+
+    SECTION("move-assigning pending values notifies once")
+    {
+        auto a = value<int> { 1 };
+        auto c = value<int> { 1 };
+        auto call_count = 0;
+        a.subscribe([&]() { ++call_count; }).release();
+
+        batch b;
+        a = 2;
+        c = 3;
+        c = std::move(a);
+        b.commit();
+
+        REQUIRE(call_count == 1);
+    }
+
+    SECTION("observers can destroy pending values")
+    {
+        auto a = value<int> { 1 };
+        auto c = std::make_unique<value<int>>(1);
+        auto call_count = 0;
+        a.subscribe([&]() { c.reset(); }).release();
+        c->subscribe([&]() { ++call_count; }).release();
+
+        batch b;
+        a = 2;
+        *c = 2;
+        b.commit();
+
+        REQUIRE_FALSE(c);
+        REQUIRE(call_count == 0);
+    }
+
+    SECTION("values can be notified again after an observer throws")
+    {
+        auto a = value<int> { 1 };
+        auto c = value<int> { 1 };
+        auto call_count = 0;
+        a.subscribe([&]() { throw std::runtime_error { "test" }; }).release();
+        c.subscribe([&]() { ++call_count; }).release();
+
+        {
+            batch b;
+            a = 2;
+            c = 2;
+            REQUIRE_THROWS_AS(b.commit(), std::runtime_error);
+        }
+
+        c = 3;
+
+        REQUIRE(call_count == 1);
+    }
+
+    SECTION("large batches track destroyed and moved values")
+    {
+        auto values = std::vector<std::unique_ptr<value<int>>> { };
+        auto notified = std::vector<int> { };
+        for(auto i = 0; i < 100; ++i)
+        {
+            values.push_back(std::make_unique<value<int>>(0));
+            values.back()->subscribe([&, i]() { notified.push_back(i); }).release();
+        }
+
+        auto moved = std::vector<value<int>> { };
+        moved.reserve(values.size());
+
+        {
+            batch b;
+            for(auto && v : values)
+                *v = 1;
+
+            // Destroy the even values, and move the last ten odd ones.
+            for(auto i = 0u; i < values.size(); i += 2)
+                values[i].reset();
+
+            for(auto i = 81u; i < values.size(); i += 2)
+                moved.push_back(std::move(*values[i]));
+
+            // Values changed after the lookups are still tracked.
+            auto late = std::make_unique<value<int>>(0);
+            *late = 1;
+            late.reset();
+
+            b.commit();
+        }
+
+        REQUIRE(notified.size() == 50);
+        for(auto i = 0u; i < notified.size(); ++i)
+            REQUIRE(notified[i] == static_cast<int>(2 * i + 1));
+    }
+}
+
+TEST_CASE("batch/threads", "[batch]")
+{
+    SECTION("batch does not affect other threads")
+    {
+        auto val = value<int> { 1 };
+        auto call_count = 0;
+        val.subscribe([&]() { ++call_count; }).release();
+
+        batch b;
+        std::thread { [&]() { val = 2; } }.join();
+
+        REQUIRE(call_count == 1);
+    }
+}
+
+} }
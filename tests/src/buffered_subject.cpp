@@ -0,0 +1,243 @@
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/buffered_subject.hpp>
+#include <observable/subject.hpp>
+#include <observable/value.hpp>
+
+namespace observable { namespace test {
+
+namespace {
+
+//! Clock that only advances when told to.
+struct test_clock
+{
+    using duration = std::chrono::milliseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<test_clock>;
+    static constexpr bool is_steady = true;
+
+    static auto now() noexcept { return time_point { current() }; }
+
+    static auto current() noexcept -> duration &
+    {
+        static auto d = duration { 0 };
+        return d;
+    }
+
+    static void advance(duration d) noexcept { current() += d; }
+};
+
+using namespace std::chrono_literals;
+
+}
+
+TEST_CASE("buffered_subject/span", "[buffered_subject]")
+{
+    SECTION("span views a vector")
+    {
+        auto v = std::vector<int> { 1, 2, 3 };
+        auto const s = span<int const> { v };
+
+        REQUIRE(s.size() == 3);
+        REQUIRE(s.data() == v.data());
+        REQUIRE(s[1] == 2);
+        REQUIRE(s.front() == 1);
+        REQUIRE(s.back() == 3);
+        REQUIRE(std::accumulate(s.begin(), s.end(), 0) == 6);
+    }
+
+    SECTION("default-constructed span is empty")
+    {
+        auto const s = span<int> { };
+
+        REQUIRE(s.empty());
+        REQUIRE(s.begin() == s.end());
+    }
+}
+
+TEST_CASE("buffered_subject/count", "[buffered_subject]")
+{
+    SECTION("observers are called once per batch")
+    {
+        auto s = subject<void(int)> { };
+        auto b = buffered(s, 3);
+        auto batches = std::vector<std::vector<int>> { };
+        auto const sub = b.subscribe([&](span<int const> batch) {
+            batches.emplace_back(batch.begin(), batch.end());
+        });
+
+        for(auto i = 1; i <= 7; ++i)
+            s.notify(i);
+
+        REQUIRE(batches == (std::vector<std::vector<int>> { { 1, 2, 3 }, { 4, 5, 6 } }));
+        REQUIRE(b.size() == 1);
+    }
+
+    SECTION("flush delivers a partial batch")
+    {
+        auto s = subject<void(int)> { };
+        auto b = buffered(s, 3);
+        auto seen = std::vector<int> { };
+        auto const sub = b.subscribe([&](span<int const> batch) {
+            seen.assign(batch.begin(), batch.end());
+        });
+
+        s.notify(1);
+        s.notify(2);
+        b.flush();
+
+        REQUIRE(seen == (std::vector<int> { 1, 2 }));
+        REQUIRE(b.size() == 0);
+    }
+
+    SECTION("flushing an empty buffer does not notify")
+    {
+        auto s = subject<void(int)> { };
+        auto b = buffered(s, 3);
+        auto call_count = 0;
+        auto const sub = b.subscribe([&](span<int const>) { ++call_count; });
+
+        b.flush();
+
+        REQUIRE(call_count == 0);
+    }
+
+    SECTION("buffers are reused between batches")
+    {
+        auto s = subject<void(int)> { };
+        auto b = buffered(s, 4);
+        auto buffers = std::vector<int const *> { };
+        auto const sub = b.subscribe([&](span<int const> batch) {
+            buffers.push_back(batch.data());
+        });
+
+        for(auto i = 0; i < 4 * 4; ++i)
+            s.notify(i);
+
+        REQUIRE(buffers.size() == 4);
+        REQUIRE(buffers[0] == buffers[2]);
+        REQUIRE(buffers[1] == buffers[3]);
+    }
+
+    SECTION("values are buffered")
+    {
+        auto v = value<std::string> { "a" };
+        auto b = buffered(v, 2);
+        auto seen = std::vector<std::string> { };
+        auto const sub = b.subscribe([&](span<std::string const> batch) {
+            seen.assign(batch.begin(), batch.end());
+        });
+
+        v = "b";
+        v = "c";
+
+        REQUIRE(seen == (std::vector<std::string> { "b", "c" }));
+    }
+
+    SECTION("destroyed buffer unsubscribes from its source")
+    {
+        auto s = subject<void(int)> { };
+        {
+            auto const b = buffered(s, 2);
+            REQUIRE(s.size() == 1);
+        }
+
+        REQUIRE(s.empty());
+        s.notify(1);
+    }
+
+    SECTION("observers can flush")
+    {
+        auto s = subject<void(int)> { };
+        auto b = buffered(s, 2);
+        auto call_count = 0;
+        auto const sub = b.subscribe([&](span<int const>) {
+            ++call_count;
+            b.flush();
+        });
+
+        s.notify(1);
+        s.notify(2);
+
+        REQUIRE(call_count == 1);
+    }
+}
+
+TEST_CASE("buffered_subject/period", "[buffered_subject]")
+{
+    SECTION("batch is delivered once its oldest argument is too old")
+    {
+        auto s = subject<void(int)> { };
+        auto b = buffered_subject<int, test_clock> { s, 10ms };
+        auto seen = std::vector<int> { };
+        auto const sub = b.subscribe([&](span<int const> batch) {
+            seen.assign(batch.begin(), batch.end());
+        });
+
+        s.notify(1);
+        test_clock::advance(5ms);
+        s.notify(2);
+        REQUIRE(seen.empty());
+
+        test_clock::advance(5ms);
+        s.notify(3);
+        REQUIRE(seen == (std::vector<int> { 1, 2, 3 }));
+
+        s.notify(4);
+        REQUIRE(b.size() == 1);
+    }
+
+    SECTION("count limits timed batches")
+    {
+        auto s = subject<void(int)> { };
+        auto b = buffered_subject<int, test_clock> { s, 10ms, 2 };
+        auto call_count = 0;
+        auto const sub = b.subscribe([&](span<int const>) { ++call_count; });
+
+        s.notify(1);
+        s.notify(2);
+
+        REQUIRE(call_count == 1);
+    }
+}
+
+TEST_CASE("buffered_subject/threads", "[buffered_subject]")
+{
+    auto s = subject<void(int)> { };
+    auto b = buffered(s, 16);
+    std::atomic<long> total { 0 };
+    std::atomic<int> received { 0 };
+    std::atomic<int> wrong_size { 0 };
+    auto const sub = b.subscribe([&](span<int const> batch) {
+        total += std::accumulate(batch.begin(), batch.end(), 0L);
+        received += static_cast<int>(batch.size());
+
+        // Every argument count is a multiple of 16, so no batch is partial.
+        if(batch.size() != 16)
+            ++wrong_size;
+    });
+
+    auto threads = std::vector<std::thread> { };
+    for(auto t = 0; t < 4; ++t)
+        threads.emplace_back([&]() {
+            for(auto i = 1; i <= 1000; ++i)
+                s.notify(i);
+        });
+
+    for(auto && t : threads)
+        t.join();
+
+    b.flush();
+
+    REQUIRE(received == 4000);
+    REQUIRE(wrong_size == 0);
+    REQUIRE(total == 4 * 500500L);
+}
+
+} }
@@ -0,0 +1,277 @@
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/batch.hpp>
+#include <observable/compact_value.hpp>
+
+namespace observable { namespace test {
+
+TEST_CASE("compact_value/layout", "[compact_value]")
+{
+    SECTION("unobserved value only stores its value and a pointer")
+    {
+        REQUIRE(sizeof(compact_value<int>) <= sizeof(int) + 2 * sizeof(void *));
+        REQUIRE(sizeof(compact_value<int>) < sizeof(value<int>));
+    }
+
+    SECTION("observer storage is allocated on first subscribe")
+    {
+        auto v = compact_value<int> { 1 };
+        REQUIRE_FALSE(v.has_observer_storage());
+
+        v = 2;
+        REQUIRE_FALSE(v.has_observer_storage());
+
+        auto const sub = v.subscribe([]() { });
+        REQUIRE(v.has_observer_storage());
+    }
+
+    SECTION("compact values are nothrow move-constructible")
+    {
+        REQUIRE(std::is_nothrow_move_constructible<compact_value<int>>::value);
+    }
+
+    SECTION("compact values are not copyable")
+    {
+        REQUIRE_FALSE(std::is_copy_constructible<compact_value<int>>::value);
+        REQUIRE_FALSE(std::is_copy_assignable<compact_value<int>>::value);
+    }
+}
+
+TEST_CASE("compact_value/value operations", "[compact_value]")
+{
+    SECTION("default-constructed value is value-initialized")
+    {
+        auto const v = compact_value<int> { };
+
+        REQUIRE(v.get() == 0);
+    }
+
+    SECTION("can set and get the value")
+    {
+        auto v = compact_value<std::string> { "a" };
+
+        v = "b";
+        REQUIRE(v.get() == "b");
+
+        v.set("c");
+        REQUIRE(static_cast<std::string const &>(v) == "c");
+    }
+
+    SECTION("void observers are notified of changes")
+    {
+        auto v = compact_value<int> { 1 };
+        auto call_count = 0;
+        auto const sub = v.subscribe([&]() { ++call_count; });
+
+        v = 2;
+
+        REQUIRE(call_count == 1);
+    }
+
+    SECTION("value observers receive the new value")
+    {
+        auto v = compact_value<int> { 1 };
+        auto seen = 0;
+        auto const sub = v.subscribe([&](int x) { seen = x; });
+
+        v = 5;
+
+        REQUIRE(seen == 5);
+    }
+
+    SECTION("setting an equal value does not notify")
+    {
+        auto v = compact_value<int> { 1 };
+        auto call_count = 0;
+        auto const sub = v.subscribe([&]() { ++call_count; });
+
+        v = 1;
+
+        REQUIRE(call_count == 0);
+    }
+
+    SECTION("subscribe_and_call calls the observer immediately")
+    {
+        auto v = compact_value<int> { 3 };
+        auto seen = 0;
+        auto const sub = v.subscribe_and_call([&](int x) { seen = x; });
+
+        REQUIRE(seen == 3);
+    }
+
+    SECTION("unsubscribed observers are not called")
+    {
+        auto v = compact_value<int> { 1 };
+        auto call_count = 0;
+        auto sub = v.subscribe([&]() { ++call_count; });
+        sub.unsubscribe();
+
+        v = 2;
+
+        REQUIRE(call_count == 0);
+    }
+
+    SECTION("modify and update change the value in place")
+    {
+        auto v = compact_value<std::vector<int>> { std::vector<int> { 1 } };
+        auto call_count = 0;
+        auto const sub = v.subscribe([&]() { ++call_count; });
+
+        v.modify([](auto & x) { x.push_back(2); });
+        REQUIRE(call_count == 1);
+
+        REQUIRE_FALSE(v.update([](auto &) { return false; }));
+        REQUIRE(call_count == 1);
+
+        REQUIRE(v.update([](auto & x) { x.push_back(3); return true; }));
+        REQUIRE(call_count == 2);
+        REQUIRE(v.get() == (std::vector<int> { 1, 2, 3 }));
+    }
+
+    SECTION("batches defer notifications")
+    {
+        auto v = compact_value<int> { 1 };
+        auto call_count = 0;
+        auto const sub = v.subscribe([&]() { ++call_count; });
+
+        {
+            batch b;
+            v = 2;
+            v = 3;
+            REQUIRE(call_count == 0);
+        }
+
+        REQUIRE(call_count == 1);
+    }
+
+    SECTION("value with a custom subject policy works")
+    {
+        auto v = compact_value<int, single_threaded_subject_policy> { 1 };
+        auto seen = 0;
+        auto const sub = v.subscribe([&](int x) { seen = x; });
+
+        v = 4;
+
+        REQUIRE(seen == 4);
+    }
+}
+
+TEST_CASE("compact_value/move and destruction", "[compact_value]")
+{
+    SECTION("observers follow the moved value")
+    {
+        auto v = compact_value<int> { 1 };
+        auto seen = 0;
+        auto const sub = v.subscribe([&](int x) { seen = x; });
+
+        auto moved = std::move(v);
+        moved = 7;
+
+        REQUIRE(seen == 7);
+    }
+
+    SECTION("moved subject is notified with the moved-into value")
+    {
+        auto v = compact_value<int> { 1 };
+        compact_value<int> const * notified = nullptr;
+        auto const sub = v.moved().subscribe([&](auto & x) { notified = &x; });
+
+        auto moved = std::move(v);
+
+        REQUIRE(notified == &moved);
+    }
+
+    SECTION("moved subject is notified by move assignment")
+    {
+        auto v = compact_value<int> { 1 };
+        auto other = compact_value<int> { 2 };
+        auto call_count = 0;
+        auto const sub = v.moved().subscribe([&](auto &) { ++call_count; });
+
+        other = std::move(v);
+
+        REQUIRE(call_count == 1);
+        REQUIRE(other.get() == 1);
+    }
+
+    SECTION("destroyed subject is notified")
+    {
+        auto call_count = 0;
+        {
+            auto v = compact_value<int> { 1 };
+            v.destroyed().subscribe([&]() { ++call_count; }).release();
+        }
+
+        REQUIRE(call_count == 1);
+    }
+
+    SECTION("moved-from value does not notify destroyed subject")
+    {
+        auto call_count = 0;
+        auto v = std::make_unique<compact_value<int>>(1);
+        v->destroyed().subscribe([&]() { ++call_count; }).release();
+
+        auto moved = std::move(*v);
+        v.reset();
+
+        REQUIRE(call_count == 0);
+    }
+
+    SECTION("deferred notification follows the moved value")
+    {
+        auto v = compact_value<int> { 1 };
+        auto seen = 0;
+        auto const sub = v.subscribe([&](int x) { seen = x; });
+
+        auto moved = std::unique_ptr<compact_value<int>> { };
+        {
+            batch b;
+            v = 5;
+            moved = std::make_unique<compact_value<int>>(std::move(v));
+        }
+
+        REQUIRE(seen == 5);
+    }
+}
+
+namespace {
+
+struct instrument
+{
+    OBSERVABLE_PROPERTIES(instrument)
+
+public:
+    observable_compact_property<double> price;
+
+    void set_price(double p) { price = p; }
+};
+
+}
+
+TEST_CASE("compact_value/properties", "[compact_value]")
+{
+    SECTION("compact properties can be set by the enclosing class")
+    {
+        auto i = instrument { };
+        auto seen = 0.0;
+        auto const sub = i.price.subscribe([&](double p) { seen = p; });
+
+        i.set_price(2.5);
+
+        REQUIRE(seen == 2.5);
+        REQUIRE(i.price.get() == 2.5);
+    }
+
+    SECTION("compact properties are setters-private")
+    {
+        using property_type = compact_value<int, instrument>;
+
+        REQUIRE_FALSE(std::is_assignable<property_type &, int>::value);
+    }
+}
+
+} }
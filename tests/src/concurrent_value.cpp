@@ -0,0 +1,210 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/batch.hpp>
+#include <observable/concurrent_value.hpp>
+
+namespace observable { namespace test {
+
+namespace {
+
+struct point
+{
+    int x;
+    int y;
+
+    auto operator==(point const & other) const noexcept
+    {
+        return x == other.x && y == other.y;
+    }
+};
+
+}
+
+TEST_CASE("concurrent_value/storage", "[concurrent_value]")
+{
+    SECTION("small trivially-copyable values use a sequence lock")
+    {
+        REQUIRE(std::is_same<detail::snapshot_storage<int>,
+                             detail::seqlock_snapshot<int>>::value);
+        REQUIRE(std::is_same<detail::snapshot_storage<point>,
+                             detail::seqlock_snapshot<point>>::value);
+    }
+
+    SECTION("other values are published as copies")
+    {
+        REQUIRE(std::is_same<detail::snapshot_storage<std::string>,
+                             detail::rcu_snapshot<std::string>>::value);
+    }
+
+    SECTION("concurrent values are not copyable")
+    {
+        REQUIRE_FALSE(std::is_copy_constructible<concurrent_value<int>>::value);
+        REQUIRE_FALSE(std::is_copy_assignable<concurrent_value<int>>::value);
+    }
+}
+
+TEST_CASE("concurrent_value/value operations", "[concurrent_value]")
+{
+    SECTION("default-constructed value is value-initialized")
+    {
+        concurrent_value<int> const v;
+
+        REQUIRE(v.get() == 0);
+        REQUIRE(v.load() == 0);
+    }
+
+    SECTION("set value can be loaded")
+    {
+        concurrent_value<point> v { point { 1, 2 } };
+
+        v = point { 3, 4 };
+
+        REQUIRE(v.load() == (point { 3, 4 }));
+        REQUIRE(v.get() == (point { 3, 4 }));
+    }
+
+    SECTION("large values can be read without copying")
+    {
+        concurrent_value<std::string> v { "abc" };
+
+        v.set("abcd");
+
+        REQUIRE(v.read([](std::string const & s) { return s.size(); }) == 4);
+        REQUIRE(v.load() == "abcd");
+    }
+
+    SECTION("observers are notified of changes")
+    {
+        concurrent_value<std::string> v { "a" };
+        auto call_count = 0;
+        auto seen = std::string { };
+        auto const s1 = v.subscribe([&]() { ++call_count; });
+        auto const s2 = v.subscribe([&](std::string const & s) { seen = s; });
+
+        v = "b";
+
+        REQUIRE(call_count == 1);
+        REQUIRE(seen == "b");
+    }
+
+    SECTION("observers can load the new value")
+    {
+        concurrent_value<int> v { 1 };
+        auto seen = 0;
+        auto const sub = v.subscribe([&]() { seen = v.load(); });
+
+        v = 2;
+
+        REQUIRE(seen == 2);
+    }
+
+    SECTION("setting an equal value does not notify")
+    {
+        concurrent_value<int> v { 1 };
+        auto call_count = 0;
+        auto const sub = v.subscribe([&]() { ++call_count; });
+
+        v = 1;
+
+        REQUIRE(call_count == 0);
+    }
+
+    SECTION("update stores the modified value")
+    {
+        concurrent_value<std::vector<int>> v { std::vector<int> { 1 } };
+        auto call_count = 0;
+        auto const sub = v.subscribe([&]() { ++call_count; });
+
+        REQUIRE_FALSE(v.update([](auto &) { return false; }));
+        REQUIRE(call_count == 0);
+
+        REQUIRE(v.update([](auto & x) { x.push_back(2); return true; }));
+        REQUIRE(call_count == 1);
+        REQUIRE(v.load() == (std::vector<int> { 1, 2 }));
+    }
+
+    SECTION("batches defer notifications")
+    {
+        concurrent_value<int> v { 1 };
+        auto call_count = 0;
+        auto const sub = v.subscribe([&]() { ++call_count; });
+
+        {
+            batch b;
+            v = 2;
+            v = 3;
+            REQUIRE(call_count == 0);
+            REQUIRE(v.load() == 3);
+        }
+
+        REQUIRE(call_count == 1);
+    }
+}
+
+TEST_CASE("concurrent_value/concurrent reads", "[concurrent_value]")
+{
+    SECTION("readers never see a torn trivially-copyable value")
+    {
+        concurrent_value<point> v { point { 0, 0 } };
+        std::atomic<bool> done { false };
+        std::atomic<int> torn { 0 };
+
+        auto readers = std::vector<std::thread> { };
+        for(auto i = 0; i < 2; ++i)
+            readers.emplace_back([&]() {
+                while(!done.load())
+                {
+                    auto const p = v.load();
+                    if(p.x != -p.y)
+                        ++torn;
+                }
+            });
+
+        for(auto i = 1; i <= 20000; ++i)
+            v = point { i, -i };
+
+        done = true;
+        for(auto && t : readers)
+            t.join();
+
+        REQUIRE(torn == 0);
+    }
+
+    SECTION("readers never see a partially written large value")
+    {
+        concurrent_value<std::string> v { "a" };
+        std::atomic<bool> done { false };
+        std::atomic<int> torn { 0 };
+
+        auto readers = std::vector<std::thread> { };
+        for(auto i = 0; i < 2; ++i)
+            readers.emplace_back([&]() {
+                while(!done.load())
+                {
+                    auto const ok = v.read([](std::string const & s) {
+                        return !s.empty() &&
+                               s.find_first_not_of(s.front()) == std::string::npos;
+                    });
+
+                    if(!ok)
+                        ++torn;
+                }
+            });
+
+        for(auto i = 1; i <= 5000; ++i)
+            v = std::string(static_cast<std::size_t>(i % 64 + 1),
+                            static_cast<char>('a' + i % 26));
+
+        done = true;
+        for(auto && t : readers)
+            t.join();
+
+        REQUIRE(torn == 0);
+    }
+}
+
+} }
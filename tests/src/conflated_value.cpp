@@ -0,0 +1,161 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/conflated_value.hpp>
+#include <observable/observe.hpp>
+
+namespace observable { namespace test {
+
+TEST_CASE("conflated_value/delivery", "[conflated_value]")
+{
+    SECTION("conflated value has the initial value")
+    {
+        auto ud = updater { };
+        auto v = conflated_value<int> { ud, 5 };
+
+        REQUIRE(v.get() == 5);
+    }
+
+    SECTION("set() does not change the output")
+    {
+        auto ud = updater { };
+        auto v = conflated_value<int> { ud, 5 };
+
+        v.set(6);
+
+        REQUIRE(v.get() == 5);
+    }
+
+    SECTION("updater delivers the latest value")
+    {
+        auto ud = updater { };
+        auto v = conflated_value<int> { ud };
+
+        v.set(1);
+        v.set(2);
+        v.set(3);
+        ud.update_all();
+
+        REQUIRE(v.get() == 3);
+    }
+
+    SECTION("observers are notified once per update")
+    {
+        auto ud = updater { };
+        auto v = conflated_value<int> { ud };
+        std::vector<int> seen;
+        auto const sub = v.output().subscribe([&](int x) { seen.push_back(x); });
+
+        for(auto i = 1; i <= 1000; ++i)
+            v.set(i);
+        ud.update_all();
+        ud.update_all();
+
+        REQUIRE(seen == (std::vector<int> { 1000 }));
+    }
+
+    SECTION("flush() delivers the latest value")
+    {
+        auto ud = updater { };
+        auto v = conflated_value<int> { ud };
+
+        v.set(4);
+
+        REQUIRE(v.flush());
+        REQUIRE(v.get() == 4);
+        REQUIRE_FALSE(v.flush());
+    }
+
+    SECTION("equal values do not notify observers")
+    {
+        auto ud = updater { };
+        auto v = conflated_value<int> { ud, 1 };
+        auto calls = 0;
+        auto const sub = v.output().subscribe([&]() { ++calls; });
+
+        v.set(1);
+        ud.update_all();
+
+        REQUIRE(calls == 0);
+    }
+
+    SECTION("output is readonly")
+    {
+        auto ud = updater { };
+        auto v = conflated_value<int> { ud };
+
+        REQUIRE_THROWS_AS(v.output().set(1), readonly_value);
+    }
+
+    SECTION("expressions on the output are updated in the same update")
+    {
+        auto ud = updater { };
+        auto v = conflated_value<int> { ud };
+        auto doubled = observe(ud, v.output() * 2);
+
+        v.set(5);
+        ud.update_all();
+
+        REQUIRE(doubled.get() == 10);
+    }
+
+    SECTION("incremental updater delivers changed values")
+    {
+        auto ud = incremental_updater { };
+        auto v = conflated_value<int, incremental_updater> { ud };
+        auto doubled = observe(ud, v.output() * 2);
+
+        v.set(5);
+        ud.update_all();
+
+        REQUIRE(v.get() == 5);
+        REQUIRE(doubled.get() == 10);
+    }
+
+    SECTION("conflated value can be moved")
+    {
+        auto ud = updater { };
+        auto v = conflated_value<int> { ud };
+        auto moved = std::move(v);
+
+        moved.set(3);
+        ud.update_all();
+
+        REQUIRE(moved.get() == 3);
+    }
+}
+
+TEST_CASE("conflated_value/threads", "[conflated_value]")
+{
+    SECTION("values can be set from other threads")
+    {
+        auto ud = updater { };
+        auto v = conflated_value<int> { ud };
+        std::atomic<bool> done { false };
+
+        auto producer = std::thread { [&]() {
+            for(auto i = 1; i <= 10000; ++i)
+                v.set(i);
+            done = true;
+        } };
+
+        auto last = 0;
+        auto increasing = true;
+        auto const sub = v.output().subscribe([&](int x) {
+            increasing = increasing && x > last;
+            last = x;
+        });
+
+        while(!done)
+            ud.update_all();
+
+        producer.join();
+        ud.update_all();
+
+        REQUIRE(increasing);
+        REQUIRE(v.get() == 10000);
+    }
+}
+
+} }
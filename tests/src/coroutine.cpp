@@ -0,0 +1,378 @@
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/coroutine.hpp>
+#include <observable/subject.hpp>
+#include <observable/value.hpp>
+
+namespace observable { namespace test {
+
+namespace {
+
+//! Coroutine that starts immediately and cannot be awaited.
+struct task
+{
+    struct promise_type
+    {
+        auto get_return_object() noexcept { return task { }; }
+        auto initial_suspend() noexcept { return std::suspend_never { }; }
+        auto final_suspend() noexcept { return std::suspend_never { }; }
+        void return_void() noexcept { }
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+//! Coroutine that can be destroyed while it is suspended.
+struct owned_task
+{
+    struct promise_type
+    {
+        auto get_return_object() noexcept
+        {
+            using handle_type = std::coroutine_handle<promise_type>;
+            return owned_task { handle_type::from_promise(*this) };
+        }
+
+        auto initial_suspend() noexcept { return std::suspend_never { }; }
+        auto final_suspend() noexcept { return std::suspend_always { }; }
+        void return_void() noexcept { }
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    ~owned_task() { handle.destroy(); }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+//! Executor that queues tasks until they are run by the test.
+struct queue_executor
+{
+    void operator()(async_task t) const { tasks->push_back(std::move(t)); }
+
+    std::vector<async_task> * tasks;
+};
+
+}
+
+TEST_CASE("coroutine/next", "[coroutine]")
+{
+    SECTION("coroutine is resumed with the notification argument")
+    {
+        auto s = subject<void(int)> { };
+        auto result = 0;
+
+        auto const body = [&]() -> task { result = co_await next(s); };
+        body();
+
+        REQUIRE(result == 0);
+        REQUIRE(s.size() == 1);
+
+        s.notify(5);
+
+        REQUIRE(result == 5);
+        REQUIRE(s.empty());
+    }
+
+    SECTION("void subjects resume without a result")
+    {
+        auto s = subject<void()> { };
+        auto resumed = false;
+
+        auto const body = [&]() -> task { co_await next(s); resumed = true; };
+        body();
+        s.notify();
+
+        REQUIRE(resumed);
+    }
+
+    SECTION("multiple arguments are returned as a tuple")
+    {
+        auto s = subject<void(int, std::string)> { };
+        auto result = std::tuple<int, std::string> { };
+
+        auto const body = [&]() -> task { result = co_await next(s); };
+        body();
+        s.notify(1, "a");
+
+        REQUIRE(result == std::make_tuple(1, std::string { "a" }));
+    }
+
+    SECTION("only the first notification is returned")
+    {
+        auto s = subject<void(int)> { };
+        auto results = std::vector<int> { };
+
+        auto const body = [&]() -> task {
+            results.push_back(co_await next(s));
+            results.push_back(co_await next(s));
+        };
+        body();
+
+        s.notify(1);
+        s.notify(2);
+        s.notify(3);
+
+        REQUIRE(results == (std::vector<int> { 1, 2 }));
+        REQUIRE(s.empty());
+    }
+
+    SECTION("coroutine is resumed on the provided executor")
+    {
+        auto s = subject<void(int)> { };
+        auto tasks = std::vector<async_task> { };
+        auto result = 0;
+
+        auto const body = [&]() -> task {
+            result = co_await next(s, queue_executor { &tasks });
+        };
+        body();
+        s.notify(3);
+
+        REQUIRE(result == 0);
+        REQUIRE(tasks.size() == 1);
+
+        tasks.front()();
+        REQUIRE(result == 3);
+    }
+
+    SECTION("destroying a suspended coroutine unsubscribes it")
+    {
+        auto s = subject<void(int)> { };
+        {
+            auto const body = [&]() -> owned_task { co_await next(s); };
+            auto const t = body();
+            REQUIRE(s.size() == 1);
+        }
+
+        REQUIRE(s.empty());
+        s.notify(1);
+    }
+
+    SECTION("coroutine can be resumed on another thread")
+    {
+        auto s = subject<void(int)> { };
+        auto result = 0;
+        auto resumed_on = std::thread::id { };
+        std::thread worker;
+
+        auto const on_worker = [&](async_task t) {
+            worker = std::thread { [t = std::move(t)]() mutable { t(); } };
+        };
+
+        auto const body = [&]() -> task {
+            result = co_await next(s, on_worker);
+            resumed_on = std::this_thread::get_id();
+        };
+        body();
+
+        s.notify(9);
+        worker.join();
+
+        REQUIRE(result == 9);
+        REQUIRE(resumed_on != std::this_thread::get_id());
+    }
+
+    SECTION("coroutines can suspend while another thread notifies")
+    {
+        auto s = subject<void(int)> { };
+        std::atomic<bool> stop { false };
+        std::atomic<int> resumed { 0 };
+
+        std::thread notifier { [&]() {
+            while(!stop)
+                s.notify(1);
+        } };
+
+        auto const body = [&]() -> task {
+            co_await next(s);
+            ++resumed;
+        };
+
+        for(auto i = 1; i <= 200; ++i)
+        {
+            body();
+            while(resumed < i)
+                std::this_thread::yield();
+        }
+
+        stop = true;
+        notifier.join();
+
+        REQUIRE(resumed == 200);
+    }
+
+    SECTION("coroutines destroyed while another thread notifies are not resumed")
+    {
+        auto s = subject<void(int)> { };
+        std::atomic<bool> stop { false };
+        auto resumed = 0;
+
+        std::mutex mutex;
+        auto tasks = std::vector<async_task> { };
+        auto const queue = [&](async_task t) {
+            std::lock_guard<std::mutex> const lock { mutex };
+            tasks.push_back(std::move(t));
+        };
+
+        std::thread notifier { [&]() {
+            while(!stop)
+                s.notify(1);
+        } };
+
+        auto const body = [&]() -> owned_task {
+            co_await next(s, queue);
+            ++resumed;
+        };
+
+        for(auto i = 0; i < 2000; ++i)
+        {
+            body();
+
+            auto queued = std::vector<async_task> { };
+            {
+                std::lock_guard<std::mutex> const lock { mutex };
+                queued.swap(tasks);
+            }
+
+            for(auto && t : queued)
+                t();
+        }
+
+        stop = true;
+        notifier.join();
+
+        for(auto && t : tasks)
+            t();
+
+        REQUIRE(resumed == 0);
+        REQUIRE(s.empty());
+    }
+}
+
+TEST_CASE("coroutine/changed", "[coroutine]")
+{
+    SECTION("coroutine is resumed with the new value")
+    {
+        auto v = value<int> { 1 };
+        auto result = 0;
+
+        auto const body = [&]() -> task { result = co_await changed(v); };
+        body();
+        v = 1;
+        REQUIRE(result == 0);
+
+        v = 4;
+        REQUIRE(result == 4);
+    }
+
+    SECTION("values with a policy can be awaited")
+    {
+        auto v = value<std::string, single_threaded_subject_policy> { "a" };
+        auto result = std::string { };
+
+        auto const body = [&]() -> task { result = co_await changed(v); };
+        body();
+        v = "b";
+
+        REQUIRE(result == "b");
+    }
+}
+
+TEST_CASE("coroutine/notification stream", "[coroutine]")
+{
+    SECTION("stream delivers all notifications in order")
+    {
+        auto s = subject<void(int)> { };
+        auto results = std::vector<int> { };
+
+        auto stream = notifications(s);
+        auto const body = [&]() -> task {
+            for(auto i = 0; i < 3; ++i)
+                results.push_back(co_await stream.next());
+        };
+        body();
+
+        s.notify(1);
+        s.notify(2);
+        s.notify(3);
+
+        REQUIRE(results == (std::vector<int> { 1, 2, 3 }));
+    }
+
+    SECTION("notifications are queued until consumed")
+    {
+        auto s = subject<void(int)> { };
+        auto stream = notifications(s);
+
+        s.notify(1);
+        s.notify(2);
+        REQUIRE(stream.size() == 2);
+
+        auto results = std::vector<int> { };
+        auto const body = [&]() -> task {
+            results.push_back(co_await stream.next());
+            results.push_back(co_await stream.next());
+        };
+        body();
+
+        REQUIRE(results == (std::vector<int> { 1, 2 }));
+        REQUIRE(stream.size() == 0);
+    }
+
+    SECTION("value streams receive each new value")
+    {
+        auto v = value<int> { 0 };
+        auto stream = notifications(v);
+        auto results = std::vector<int> { };
+
+        auto const body = [&]() -> task {
+            for(auto i = 0; i < 2; ++i)
+                results.push_back(co_await stream.next());
+        };
+        body();
+
+        v = 1;
+        v = 2;
+
+        REQUIRE(results == (std::vector<int> { 1, 2 }));
+    }
+
+    SECTION("destroyed stream unsubscribes from its source")
+    {
+        auto s = subject<void()> { };
+        {
+            auto const stream = notifications(s);
+            REQUIRE(s.size() == 1);
+        }
+
+        REQUIRE(s.empty());
+    }
+
+    SECTION("consumer is resumed on the provided executor")
+    {
+        auto s = subject<void(int)> { };
+        auto tasks = std::vector<async_task> { };
+        auto stream = notifications(s, queue_executor { &tasks });
+        auto result = 0;
+
+        auto const body = [&]() -> task { result = co_await stream.next(); };
+        body();
+        s.notify(2);
+        s.notify(3);
+
+        REQUIRE(result == 0);
+        REQUIRE(tasks.size() == 1);
+
+        tasks.front()();
+        REQUIRE(result == 2);
+        REQUIRE(stream.size() == 1);
+    }
+}
+
+} }
@@ -0,0 +1,281 @@
+#include <array>
+#include <atomic>
+#include <type_traits>
+#include <thread>
+#include <vector>
+#include <unordered_set>
+#include <catch/catch.hpp>
+#include <observable/detail/chunked_collection.hpp>
+
+namespace observable { namespace detail { namespace test {
+
+using small_collection = chunked_collection<unsigned int, 4>;
+
+TEST_CASE("chunked_collection/default constructor", "[chunked_collection]")
+{
+    SECTION("collections are default-constructible")
+    {
+        REQUIRE(std::is_nothrow_default_constructible<chunked_collection<int>>::value);
+    }
+
+    SECTION("default-constructed collection is empty")
+    {
+        REQUIRE(chunked_collection<int> { }.empty());
+    }
+}
+
+TEST_CASE("chunked_collection/copy and move operations", "[chunked_collection]")
+{
+    REQUIRE_FALSE(std::is_copy_constructible<chunked_collection<int>>::value);
+    REQUIRE_FALSE(std::is_copy_assignable<chunked_collection<int>>::value);
+    REQUIRE_FALSE(std::is_move_constructible<chunked_collection<int>>::value);
+    REQUIRE_FALSE(std::is_move_assignable<chunked_collection<int>>::value);
+}
+
+TEST_CASE("chunked_collection/insert and apply", "[chunked_collection]")
+{
+    small_collection col;
+
+    SECTION("collection is not empty after insert")
+    {
+        col.insert(5u);
+        REQUIRE_FALSE(col.empty());
+    }
+
+    SECTION("apply visits elements spanning multiple chunks")
+    {
+        auto ref_els = std::unordered_set<unsigned int> { };
+        for(auto i = 0u; i < 10u; ++i)
+        {
+            col.insert(i);
+            ref_els.insert(i);
+        }
+
+        auto els = std::unordered_set<unsigned int> { };
+        col.apply([&](auto i) { els.insert(i); });
+
+        REQUIRE(els == ref_els);
+    }
+
+    SECTION("apply does nothing for empty collection")
+    {
+        auto call_count = 0;
+        col.apply([&](auto) { ++call_count; });
+
+        REQUIRE(call_count == 0);
+    }
+
+    SECTION("apply is nothrow for nothrow functor")
+    {
+        auto fun = [](auto) noexcept(true) { };
+
+        REQUIRE(noexcept(col.apply(fun)));
+    }
+}
+
+TEST_CASE("chunked_collection/remove", "[chunked_collection]")
+{
+    small_collection col;
+
+    SECTION("can remove elements")
+    {
+        auto call_count = 0;
+        auto id = col.insert(5u);
+
+        REQUIRE(col.remove(id));
+        REQUIRE(col.empty());
+
+        col.apply([&](auto) { ++call_count; });
+        REQUIRE(call_count == 0);
+    }
+
+    SECTION("removing an unknown id does nothing")
+    {
+        col.insert(5u);
+
+        REQUIRE_FALSE(col.remove(small_collection::id { 1234 }));
+        REQUIRE_FALSE(col.empty());
+    }
+
+    SECTION("removed slots are reused")
+    {
+        for(auto r = 0; r < 10; ++r)
+        {
+            auto ids = std::array<small_collection::id, 4> { };
+            for(auto i = 0u; i < ids.size(); ++i)
+                ids[i] = col.insert(i);
+
+            for(auto && id : ids)
+                col.remove(id);
+        }
+
+        auto sum = 0u;
+        col.insert(3u);
+        col.apply([&](auto v) { sum += v; });
+
+        REQUIRE(sum == 3u);
+    }
+
+    SECTION("remove is nothrow")
+    {
+        REQUIRE(noexcept(col.remove(small_collection::id { })));
+    }
+}
+
+TEST_CASE("chunked_collection/handles", "[chunked_collection]")
+{
+    SECTION("can remove element through its handle")
+    {
+        chunked_collection<int> col;
+        auto call_count = 0;
+        auto const h = col.insert_handle(5);
+
+        REQUIRE(h);
+        REQUIRE(col.remove(h));
+        REQUIRE(col.empty());
+
+        col.apply([&](auto) { ++call_count; });
+        REQUIRE(call_count == 0);
+    }
+
+    SECTION("removing through a handle twice has no effect")
+    {
+        chunked_collection<int> col;
+        auto const h = col.insert_handle(5);
+        col.insert(7);
+
+        REQUIRE(col.remove(h));
+        REQUIRE_FALSE(col.remove(h));
+        REQUIRE_FALSE(col.empty());
+    }
+
+    SECTION("handle of an element removed by id has no effect")
+    {
+        chunked_collection<int> col;
+        auto const h = col.insert_handle(5);
+        auto const id = col.insert(7);
+
+        for(auto i = 0; i < 64; ++i)
+            col.remove(col.insert(i));
+
+        auto sum = 0;
+        col.apply([&](auto v) { sum += v; });
+        REQUIRE(sum == 5 + 7);
+
+        col.remove(id);
+        REQUIRE(col.remove(h));
+        REQUIRE_FALSE(col.remove(h));
+        REQUIRE(col.empty());
+    }
+
+    SECTION("empty handle does not remove anything")
+    {
+        chunked_collection<int> col;
+        col.insert(5);
+
+        REQUIRE_FALSE(col.remove(chunked_collection<int>::handle { }));
+        REQUIRE_FALSE(col.empty());
+    }
+}
+
+TEST_CASE("chunked_collection/mutations during apply", "[chunked_collection]")
+{
+    SECTION("will not call apply for a removed element that has not been applied")
+    {
+        small_collection col;
+
+        auto ids = std::array<small_collection::id, 6> { };
+        for(auto i = 0u; i < ids.size(); ++i)
+            ids[i] = col.insert(i);
+
+        auto call_count = 0;
+        col.apply([&](auto j) {
+            for(auto i = 0u; i < ids.size(); ++i)
+                if(i != j)
+                    col.remove(ids[i]);
+            ++call_count;
+        });
+
+        REQUIRE(call_count == 1);
+    }
+
+    SECTION("element inserted during apply is not applied")
+    {
+        small_collection col;
+        col.insert(3u);
+
+        auto call_count = 0;
+        col.apply([&](auto) {
+            for(auto i = 0u; i < 8u; ++i)
+                col.insert(7u);
+            ++call_count;
+        });
+
+        REQUIRE(call_count == 1);
+
+        auto sum = 0u;
+        col.apply([&](auto v) { sum += v; });
+
+        REQUIRE(sum == 3u + 8u * 7u);
+    }
+}
+
+TEST_CASE("chunked_collection/concurrent mutations", "[chunked_collection]")
+{
+    SECTION("can insert elements in parallel")
+    {
+        small_collection col;
+
+        auto ts = std::vector<std::thread> { };
+        std::atomic<bool> wait { true };
+
+        for(auto i = 1u; i <= 8u; ++i)
+        {
+            ts.emplace_back([&, i]() {
+                while(wait)
+                    ;
+                col.insert(i);
+            });
+        }
+
+        wait = false;
+        for(auto && t : ts)
+            t.join();
+
+        auto ref_els = std::unordered_set<unsigned int> { 1, 2, 3, 4, 5, 6, 7, 8 };
+        auto els = std::unordered_set<unsigned int> { };
+        col.apply([&](auto i) { els.insert(i); });
+
+        REQUIRE(ref_els == els);
+    }
+
+    SECTION("can insert and remove in parallel")
+    {
+        small_collection col;
+
+        auto ts = std::vector<std::thread> { };
+        std::atomic<bool> wait { true };
+
+        for(auto j = 0u; j < 4u; ++j)
+        {
+            ts.emplace_back([&]() {
+                while(wait)
+                    ;
+                auto ids = std::array<small_collection::id, 8> { };
+                for(auto i = 0u; i < ids.size(); ++i)
+                    ids[i] = col.insert(i);
+
+                for(auto && id : ids)
+                    col.remove(id);
+            });
+        }
+
+        wait = false;
+        for(auto && t : ts)
+            t.join();
+
+        REQUIRE(col.empty());
+    }
+}
+
+} } }
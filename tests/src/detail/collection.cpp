@@ -1,5 +1,6 @@
 #include <array>
 #include <atomic>
+#include <memory>
 #include <type_traits>
 #include <thread>
 #include <vector>
@@ -137,6 +138,73 @@ TEST_CASE("collection/remove", "[collection]")
     }
 }
 
+TEST_CASE("collection/handles", "[collection]")
+{
+    SECTION("can remove element through its handle")
+    {
+        collection<int> col;
+        auto call_count = 0;
+        auto const h = col.insert_handle(5);
+
+        REQUIRE(h);
+        REQUIRE(col.remove(h));
+        REQUIRE(col.empty());
+
+        col.apply([&](auto) { ++call_count; });
+        REQUIRE(call_count == 0);
+    }
+
+    SECTION("removing through a handle twice has no effect")
+    {
+        collection<int> col;
+        auto const h = col.insert_handle(5);
+        col.insert(7);
+
+        REQUIRE(col.remove(h));
+        REQUIRE_FALSE(col.remove(h));
+        REQUIRE_FALSE(col.empty());
+    }
+
+    SECTION("handle of an element removed by id has no effect")
+    {
+        collection<int> col;
+        auto const h = col.insert_handle(5);
+        auto const id = col.insert(7);
+
+        for(auto i = 0; i < 64; ++i)
+            col.remove(col.insert(i));
+
+        auto sum = 0;
+        col.apply([&](auto v) { sum += v; });
+        REQUIRE(sum == 5 + 7);
+
+        col.remove(id);
+        REQUIRE(col.remove(h));
+        REQUIRE_FALSE(col.remove(h));
+        REQUIRE(col.empty());
+    }
+
+    SECTION("handle can outlive the collection")
+    {
+        auto h = collection<int>::handle { };
+        {
+            collection<int> col;
+            h = col.insert_handle(5);
+        }
+
+        REQUIRE(h);
+    }
+
+    SECTION("empty handle does not remove anything")
+    {
+        collection<int> col;
+        col.insert(5);
+
+        REQUIRE_FALSE(col.remove(collection<int>::handle { }));
+        REQUIRE_FALSE(col.empty());
+    }
+}
+
 TEST_CASE("collection/mutations during apply", "[collection]")
 {
     SECTION("will not call apply for a removed element that has not been applied")
@@ -190,6 +258,81 @@ TEST_CASE("collection/mutations during apply", "[collection]")
     }
 }
 
+TEST_CASE("collection/reclamation", "[collection]")
+{
+    SECTION("removed element is freed when there are no readers")
+    {
+        collection<std::shared_ptr<int>> col;
+        auto const p = std::make_shared<int>(5);
+
+        auto const id = col.insert(p);
+        col.remove(id);
+
+        REQUIRE(p.use_count() == 1);
+    }
+
+    SECTION("removed element is freed when other elements remain")
+    {
+        collection<std::shared_ptr<int>> col;
+        for(auto i = 0; i < 10; ++i)
+            col.insert(std::make_shared<int>(i));
+
+        auto const p = std::make_shared<int>(5);
+        auto const h = col.insert_handle(p);
+        auto const id = col.insert(p);
+        col.remove(h);
+
+        REQUIRE(p.use_count() == 2);
+
+        col.remove(id);
+
+        REQUIRE(p.use_count() == 1);
+        REQUIRE(col.size() == 10);
+    }
+
+    SECTION("removed element is not freed while it is being applied")
+    {
+        collection<std::shared_ptr<int>> col;
+        auto const p = std::make_shared<int>(5);
+        auto const id = col.insert(p);
+
+        col.apply([&](auto && e) {
+            col.remove(id);
+            REQUIRE(*e == 5);
+            REQUIRE(p.use_count() == 2);
+        });
+    }
+
+    SECTION("removed elements are freed under constant apply traffic")
+    {
+        collection<std::shared_ptr<int>> col;
+        auto const p = std::make_shared<int>(5);
+
+        std::atomic<bool> done { false };
+        auto readers = std::vector<std::thread> { };
+        for(auto i = 0; i < 4; ++i)
+            readers.emplace_back([&]() {
+                while(!done)
+                    col.apply([](auto &&) { });
+            });
+
+        for(auto i = 0; i < 100; ++i)
+            col.remove(col.insert(p));
+
+        for(auto i = 0; i < 1000 && p.use_count() > 1; ++i)
+        {
+            col.remove(col.insert(std::make_shared<int>(0)));
+            std::this_thread::yield();
+        }
+
+        done = true;
+        for(auto && t : readers)
+            t.join();
+
+        REQUIRE(p.use_count() == 1);
+    }
+}
+
 TEST_CASE("collection/concurrent mutations", "[collection]")
 {
     SECTION("can insert elements in parallel")
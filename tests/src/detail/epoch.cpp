@@ -0,0 +1,80 @@
+#include <atomic>
+#include <thread>
+#include <catch/catch.hpp>
+#include <observable/detail/epoch.hpp>
+
+namespace observable { namespace detail { namespace test {
+
+TEST_CASE("epoch/advancing", "[epoch]")
+{
+    auto & domain = epoch_domain::instance();
+
+    SECTION("epoch advances when no thread is inside a critical section")
+    {
+        auto const e = domain.current();
+
+        REQUIRE(domain.try_advance() == e + 1);
+        REQUIRE(domain.try_advance() == e + 2);
+        REQUIRE(domain.is_safe(e));
+    }
+
+    SECTION("objects retired in the current epoch are not safe")
+    {
+        REQUIRE_FALSE(domain.is_safe(domain.current()));
+    }
+
+    SECTION("epoch does not advance past a thread inside a critical section")
+    {
+        std::atomic<bool> entered { false };
+        std::atomic<bool> done { false };
+
+        auto t = std::thread { [&]() {
+            epoch_guard const guard { };
+            entered = true;
+            while(!done)
+                std::this_thread::yield();
+        } };
+
+        while(!entered)
+            std::this_thread::yield();
+
+        auto const e = domain.current();
+        domain.try_advance();
+        domain.try_advance();
+        domain.try_advance();
+
+        REQUIRE_FALSE(domain.is_safe(e));
+
+        done = true;
+        t.join();
+
+        domain.try_advance();
+        domain.try_advance();
+
+        REQUIRE(domain.is_safe(e));
+    }
+
+    SECTION("nested critical sections keep the outer section open")
+    {
+        auto e = epoch_domain::epoch_type { };
+        {
+            epoch_guard const outer { };
+            e = domain.current();
+            {
+                epoch_guard const inner { };
+            }
+
+            domain.try_advance();
+            domain.try_advance();
+
+            REQUIRE_FALSE(domain.is_safe(e));
+        }
+
+        domain.try_advance();
+        domain.try_advance();
+
+        REQUIRE(domain.is_safe(e));
+    }
+}
+
+} } }
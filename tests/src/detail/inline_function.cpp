@@ -0,0 +1,206 @@
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <catch/catch.hpp>
+#include <observable/detail/inline_function.hpp>
+
+namespace observable { namespace detail { namespace test {
+
+namespace {
+
+struct counted
+{
+    explicit counted(int & destroyed) noexcept : destroyed_ { &destroyed } { }
+
+    counted(counted && other) noexcept : destroyed_ { other.destroyed_ }
+    {
+        other.destroyed_ = nullptr;
+    }
+
+    ~counted()
+    {
+        if(destroyed_)
+            ++*destroyed_;
+    }
+
+    void operator()() const { }
+
+    int * destroyed_;
+};
+
+struct big
+{
+    void operator()() const { }
+
+    char data[128];
+};
+
+}
+
+TEST_CASE("inline_function/creation", "[inline_function]")
+{
+    SECTION("is default-constructible")
+    {
+        REQUIRE(std::is_default_constructible<inline_function<void()>>::value);
+    }
+
+    SECTION("default-constructed function is empty")
+    {
+        REQUIRE_FALSE(inline_function<void()> { });
+    }
+
+    SECTION("function created from callable is not empty")
+    {
+        REQUIRE(inline_function<void()> { []() { } });
+    }
+}
+
+TEST_CASE("inline_function/calling", "[inline_function]")
+{
+    SECTION("stored callable is called")
+    {
+        auto call_count = 0;
+        inline_function<void()> const fun { [&]() { ++call_count; } };
+
+        fun();
+
+        REQUIRE(call_count == 1);
+    }
+
+    SECTION("arguments are forwarded and the result is returned")
+    {
+        inline_function<int(int, int)> const fun {
+            [](int a, int b) { return a + b; }
+        };
+
+        REQUIRE(fun(2, 3) == 5);
+    }
+
+    SECTION("move-only arguments can be passed")
+    {
+        inline_function<int(std::unique_ptr<int>)> const fun {
+            [](std::unique_ptr<int> p) { return *p; }
+        };
+
+        REQUIRE(fun(std::make_unique<int>(7)) == 7);
+    }
+
+    SECTION("mutable callables can be called")
+    {
+        inline_function<int()> const fun { [i = 0]() mutable { return ++i; } };
+
+        fun();
+
+        REQUIRE(fun() == 2);
+    }
+
+    SECTION("heap-stored callable is called")
+    {
+        auto call_count = 0;
+        inline_function<void()> const fun {
+            [&, b = big { }]() { b(); ++call_count; }
+        };
+
+        fun();
+
+        REQUIRE(call_count == 1);
+    }
+}
+
+TEST_CASE("inline_function/storage", "[inline_function]")
+{
+    using function = inline_function<void()>;
+
+    SECTION("small callables are stored inline")
+    {
+        auto const p = std::make_shared<int>();
+        auto const f = [p]() { };
+
+        REQUIRE(function::is_stored_inline<decltype(f)>());
+    }
+
+    SECTION("large callables are not stored inline")
+    {
+        REQUIRE_FALSE(function::is_stored_inline<big>());
+    }
+
+    SECTION("capacity can be increased")
+    {
+        REQUIRE(inline_function<void(), sizeof(big)>::is_stored_inline<big>());
+    }
+}
+
+TEST_CASE("inline_function/lifetime", "[inline_function]")
+{
+    SECTION("destructor destroys the stored callable")
+    {
+        auto destroyed = 0;
+        {
+            inline_function<void()> fun { counted { destroyed } };
+        }
+
+        REQUIRE(destroyed == 1);
+    }
+
+    SECTION("move-constructed function calls the stored callable")
+    {
+        auto call_count = 0;
+        inline_function<void()> fun { [&]() { ++call_count; } };
+
+        auto other = std::move(fun);
+        other();
+
+        REQUIRE(call_count == 1);
+        REQUIRE_FALSE(fun);
+    }
+
+    SECTION("moving keeps a single live callable")
+    {
+        auto destroyed = 0;
+        {
+            inline_function<void()> fun { counted { destroyed } };
+            auto other = std::move(fun);
+        }
+
+        REQUIRE(destroyed == 1);
+    }
+
+    SECTION("move-assignment destroys the previous callable")
+    {
+        auto destroyed = 0;
+        auto other_destroyed = 0;
+
+        inline_function<void()> fun { counted { destroyed } };
+        fun = inline_function<void()> { counted { other_destroyed } };
+
+        REQUIRE(destroyed == 1);
+        REQUIRE(other_destroyed == 0);
+    }
+
+    SECTION("heap-stored callable can be moved")
+    {
+        auto call_count = 0;
+        inline_function<void()> fun { [&, b = big { }]() { ++call_count; } };
+
+        inline_function<void()> other;
+        other = std::move(fun);
+        other();
+
+        REQUIRE(call_count == 1);
+    }
+}
+
+TEST_CASE("inline_function/copy", "[inline_function]")
+{
+    SECTION("is not copy-constructible")
+    {
+        REQUIRE_FALSE(std::is_copy_constructible<inline_function<void()>>::value);
+    }
+
+    SECTION("is not copy-assignable")
+    {
+        REQUIRE_FALSE(std::is_copy_assignable<inline_function<void()>>::value);
+    }
+}
+
+} } }
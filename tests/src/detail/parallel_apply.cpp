@@ -0,0 +1,106 @@
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/detail/parallel_apply.hpp>
+
+namespace observable { namespace detail { namespace test {
+
+namespace {
+
+//! Executor that runs each task on a new thread.
+struct thread_executor
+{
+    void operator()(inline_function<void()> task) const
+    {
+        threads->emplace_back([t = std::move(task)]() mutable { t(); });
+    }
+
+    std::vector<std::thread> * threads;
+};
+
+//! Executor that keeps tasks until the test runs them.
+struct queue_executor
+{
+    void operator()(inline_function<void()> task) const
+    {
+        tasks->push_back(std::move(task));
+    }
+
+    std::vector<inline_function<void()>> * tasks;
+};
+
+}
+
+TEST_CASE("parallel apply/indices", "[parallel apply]")
+{
+    SECTION("every index is visited exactly once")
+    {
+        auto threads = std::vector<std::thread> { };
+        auto executor = thread_executor { &threads };
+        auto visits = std::vector<std::atomic<int>>(64);
+        auto fun = [&](std::size_t i) { ++visits[i]; };
+
+        parallel_apply(executor, visits.size(), fun);
+
+        for(auto && v : visits)
+            REQUIRE(v.load() == 1);
+
+        for(auto && t : threads)
+            t.join();
+
+        REQUIRE(threads.size() == visits.size() - 1);
+    }
+
+    SECTION("single index runs on the calling thread")
+    {
+        auto tasks = std::vector<inline_function<void()>> { };
+        auto executor = queue_executor { &tasks };
+        auto calls = 0;
+        auto fun = [&](std::size_t) { ++calls; };
+
+        parallel_apply(executor, 1, fun);
+
+        REQUIRE(calls == 1);
+        REQUIRE(tasks.empty());
+    }
+
+    SECTION("calling thread does not wait for tasks to start")
+    {
+        auto tasks = std::vector<inline_function<void()>> { };
+        auto executor = queue_executor { &tasks };
+        auto calls = 0;
+        auto fun = [&](std::size_t) { ++calls; };
+
+        parallel_apply(executor, 8, fun);
+        REQUIRE(calls == 8);
+        REQUIRE(tasks.size() == 7);
+
+        for(auto && t : tasks)
+            t();
+
+        REQUIRE(calls == 8);
+    }
+
+    SECTION("first exception is rethrown after all indices are processed")
+    {
+        auto threads = std::vector<std::thread> { };
+        auto executor = thread_executor { &threads };
+        std::atomic<int> calls { 0 };
+        auto fun = [&](std::size_t i) {
+            ++calls;
+            if(i % 2)
+                throw std::runtime_error { "failed" };
+        };
+
+        REQUIRE_THROWS_AS(parallel_apply(executor, 10, fun), std::runtime_error);
+        REQUIRE(calls == 10);
+
+        for(auto && t : threads)
+            t.join();
+    }
+}
+
+} } }
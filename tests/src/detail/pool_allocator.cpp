@@ -0,0 +1,126 @@
+#include <memory>
+#include <thread>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/detail/collection.hpp>
+#include <observable/detail/pool_allocator.hpp>
+
+namespace observable { namespace detail { namespace test {
+
+namespace {
+
+struct alignas(16) pooled_block
+{
+    char data[208];
+};
+
+}
+
+TEST_CASE("pool_allocator/allocation", "[pool_allocator]")
+{
+    using pool = block_pool<sizeof(pooled_block)>;
+    auto a = pool_allocator<pooled_block> { };
+
+    SECTION("freed blocks are reused by the same thread")
+    {
+        auto const p = a.allocate(1);
+        a.deallocate(p, 1);
+        auto const cached = pool::cached();
+
+        auto const q = a.allocate(1);
+
+        REQUIRE(q == p);
+        REQUIRE(pool::cached() == cached - 1);
+        a.deallocate(q, 1);
+    }
+
+    SECTION("blocks can be freed by another thread")
+    {
+        auto const p = a.allocate(1);
+        auto cached_by_other = std::size_t { 0 };
+
+        std::thread { [&]() {
+            a.deallocate(p, 1);
+            cached_by_other = pool::cached();
+        } }.join();
+
+        REQUIRE(cached_by_other == 1);
+    }
+
+    SECTION("thread caches are bounded")
+    {
+        auto blocks = std::vector<pooled_block *> { };
+        for(auto i = std::size_t { 0 }; i < pool::max_cached * 2; ++i)
+            blocks.push_back(a.allocate(1));
+
+        for(auto && b : blocks)
+            a.deallocate(b, 1);
+
+        REQUIRE(pool::cached() == pool::max_cached);
+    }
+
+    SECTION("arrays are not pooled")
+    {
+        auto const cached = pool::cached();
+        auto const p = a.allocate(3);
+        a.deallocate(p, 3);
+
+        REQUIRE(pool::cached() == cached);
+    }
+
+    SECTION("allocators are interchangeable")
+    {
+        REQUIRE(a == pool_allocator<int> { });
+        REQUIRE_FALSE(a != pool_allocator<int> { });
+    }
+}
+
+TEST_CASE("pool_allocator/collection", "[pool_allocator]")
+{
+    using pooled_collection = collection<int, pool_allocator<int>>;
+
+    SECTION("pooled collection stores elements")
+    {
+        pooled_collection c;
+        auto const id = c.insert(1);
+        c.insert(2);
+
+        auto sum = 0;
+        c.apply([&](int v) { sum += v; });
+        REQUIRE(sum == 3);
+
+        c.remove(id);
+        sum = 0;
+        c.apply([&](int v) { sum += v; });
+        REQUIRE(sum == 2);
+    }
+
+    SECTION("handles can outlive removed elements")
+    {
+        auto c = std::make_unique<pooled_collection>();
+        auto h = c->insert_handle(5);
+
+        REQUIRE(c->remove(h));
+        REQUIRE_FALSE(c->remove(h));
+        REQUIRE(c->empty());
+    }
+
+    SECTION("elements can be inserted and removed from multiple threads")
+    {
+        pooled_collection c;
+        auto threads = std::vector<std::thread> { };
+
+        for(auto t = 0; t < 4; ++t)
+            threads.emplace_back([&]() {
+                for(auto i = 0; i < 1000; ++i)
+                    c.remove(c.insert_handle(i));
+            });
+
+        for(auto && t : threads)
+            t.join();
+
+        REQUIRE(c.empty());
+    }
+}
+
+} } }
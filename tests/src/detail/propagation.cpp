@@ -0,0 +1,141 @@
+#include <functional>
+#include <stdexcept>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/detail/propagation.hpp>
+
+namespace observable { namespace detail { namespace test {
+
+namespace {
+
+struct work
+{
+    static void run(void * target, bool run)
+    {
+        auto const w = static_cast<work *>(target);
+        w->scheduled = false;
+
+        if(run)
+            w->fun();
+    }
+
+    void schedule(std::size_t rank)
+    {
+        scheduled = propagation::schedule(rank, this, &work::run);
+    }
+
+    std::function<void()> fun;
+    bool scheduled = false;
+};
+
+}
+
+TEST_CASE("propagation/scheduling", "[propagation]")
+{
+    SECTION("work is not scheduled outside of a propagation")
+    {
+        work w;
+        w.schedule(0);
+
+        REQUIRE_FALSE(w.scheduled);
+        REQUIRE_FALSE(propagation::is_running());
+    }
+
+    SECTION("work runs after the functor returns")
+    {
+        std::vector<int> calls;
+        work w;
+        w.fun = [&]() { calls.push_back(2); };
+
+        propagation::run([&]() {
+            w.schedule(0);
+            calls.push_back(1);
+        });
+
+        REQUIRE(calls == (std::vector<int> { 1, 2 }));
+        REQUIRE_FALSE(w.scheduled);
+    }
+
+    SECTION("work runs in increasing rank order")
+    {
+        std::vector<int> calls;
+        work high, low;
+        high.fun = [&]() { calls.push_back(2); };
+        low.fun = [&]() { calls.push_back(1); };
+
+        propagation::run([&]() {
+            high.schedule(5);
+            low.schedule(1);
+        });
+
+        REQUIRE(calls == (std::vector<int> { 1, 2 }));
+    }
+
+    SECTION("work with equal ranks runs in scheduling order")
+    {
+        std::vector<int> calls;
+        work first, second;
+        first.fun = [&]() { calls.push_back(1); };
+        second.fun = [&]() { calls.push_back(2); };
+
+        propagation::run([&]() {
+            first.schedule(1);
+            second.schedule(1);
+        });
+
+        REQUIRE(calls == (std::vector<int> { 1, 2 }));
+    }
+
+    SECTION("work scheduled by work joins the propagation")
+    {
+        std::vector<int> calls;
+        work first, second;
+        second.fun = [&]() { calls.push_back(2); };
+        first.fun = [&]() {
+            calls.push_back(1);
+            propagation::run([&]() { second.schedule(0); });
+            calls.push_back(3);
+        };
+
+        propagation::run([&]() { first.schedule(0); });
+
+        REQUIRE(calls == (std::vector<int> { 1, 3, 2 }));
+    }
+
+    SECTION("cancelled work does not run")
+    {
+        auto called = false;
+        work w;
+        w.fun = [&]() { called = true; };
+
+        propagation::run([&]() {
+            w.schedule(0);
+            propagation::cancel(&w);
+        });
+
+        REQUIRE_FALSE(called);
+    }
+}
+
+TEST_CASE("propagation/exceptions", "[propagation]")
+{
+    SECTION("remaining work is dropped if work throws")
+    {
+        work throwing, other;
+        throwing.fun = [&]() { throw std::runtime_error { "test" }; };
+        auto called = false;
+        other.fun = [&]() { called = true; };
+
+        REQUIRE_THROWS_AS(propagation::run([&]() {
+                              throwing.schedule(0);
+                              other.schedule(1);
+                          }),
+                          std::runtime_error);
+
+        REQUIRE_FALSE(called);
+        REQUIRE_FALSE(other.scheduled);
+        REQUIRE_FALSE(propagation::is_running());
+    }
+}
+
+} } }
@@ -0,0 +1,314 @@
+#include <array>
+#include <memory>
+#include <type_traits>
+#include <unordered_set>
+#include <catch/catch.hpp>
+#include <observable/detail/single_threaded_collection.hpp>
+
+namespace observable { namespace detail { namespace test {
+
+using int_collection = single_threaded_collection<int>;
+
+TEST_CASE("single_threaded_collection/default constructor",
+          "[single_threaded_collection]")
+{
+    SECTION("collections are default-constructible")
+    {
+        REQUIRE(std::is_nothrow_default_constructible<int_collection>::value);
+    }
+
+    SECTION("default-constructed collection is empty")
+    {
+        REQUIRE(int_collection { }.empty());
+    }
+}
+
+TEST_CASE("single_threaded_collection/copy and move operations",
+          "[single_threaded_collection]")
+{
+    REQUIRE_FALSE(std::is_copy_constructible<int_collection>::value);
+    REQUIRE_FALSE(std::is_copy_assignable<int_collection>::value);
+    REQUIRE_FALSE(std::is_move_constructible<int_collection>::value);
+    REQUIRE_FALSE(std::is_move_assignable<int_collection>::value);
+}
+
+TEST_CASE("single_threaded_collection/insert and apply",
+          "[single_threaded_collection]")
+{
+    int_collection col;
+
+    SECTION("collection is not empty after insert")
+    {
+        col.insert(5);
+
+        REQUIRE_FALSE(col.empty());
+        REQUIRE(col.size() == 1);
+    }
+
+    SECTION("apply visits elements spanning multiple chunks")
+    {
+        auto ref_els = std::unordered_set<int> { };
+        for(auto i = 0; i < 100; ++i)
+        {
+            col.insert(i);
+            ref_els.insert(i);
+        }
+
+        auto els = std::unordered_set<int> { };
+        col.apply([&](auto i) { els.insert(i); });
+
+        REQUIRE(els == ref_els);
+    }
+
+    SECTION("apply does nothing for empty collection")
+    {
+        auto call_count = 0;
+        col.apply([&](auto) { ++call_count; });
+
+        REQUIRE(call_count == 0);
+    }
+
+    SECTION("apply is nothrow for nothrow functor")
+    {
+        auto fun = [](auto) noexcept(true) { };
+
+        REQUIRE(noexcept(col.apply(fun)));
+    }
+
+    SECTION("apply is not nothrow for throwing functor")
+    {
+        auto fun = [](auto) noexcept(false) { };
+
+        REQUIRE_FALSE(noexcept(col.apply(fun)));
+    }
+
+    SECTION("collection can be used after a throwing functor")
+    {
+        auto const id = col.insert(1);
+
+        REQUIRE_THROWS(col.apply([&](auto) { col.remove(id); throw 1; }));
+        REQUIRE(col.empty());
+
+        col.insert(2);
+        auto sum = 0;
+        col.apply([&](auto v) { sum += v; });
+        REQUIRE(sum == 2);
+    }
+}
+
+TEST_CASE("single_threaded_collection/remove", "[single_threaded_collection]")
+{
+    int_collection col;
+
+    SECTION("can remove elements")
+    {
+        auto call_count = 0;
+        auto const id = col.insert(5);
+
+        REQUIRE(col.remove(id));
+        REQUIRE(col.empty());
+
+        col.apply([&](auto) { ++call_count; });
+        REQUIRE(call_count == 0);
+    }
+
+    SECTION("removing an unknown id does nothing")
+    {
+        col.insert(5);
+
+        REQUIRE_FALSE(col.remove(int_collection::id { 1234 }));
+        REQUIRE_FALSE(col.empty());
+    }
+
+    SECTION("removed element is destroyed")
+    {
+        single_threaded_collection<std::shared_ptr<int>> c;
+        auto const p = std::make_shared<int>(1);
+
+        c.remove(c.insert(p));
+
+        REQUIRE(p.use_count() == 1);
+    }
+
+    SECTION("removed slots are reused")
+    {
+        for(auto r = 0; r < 10; ++r)
+        {
+            auto ids = std::array<int_collection::id, 4> { };
+            for(auto i = 0u; i < ids.size(); ++i)
+                ids[i] = col.insert(static_cast<int>(i));
+
+            for(auto && id : ids)
+                col.remove(id);
+        }
+
+        auto sum = 0;
+        col.insert(3);
+        col.apply([&](auto v) { sum += v; });
+
+        REQUIRE(sum == 3);
+    }
+
+    SECTION("remove is nothrow")
+    {
+        REQUIRE(noexcept(col.remove(int_collection::id { })));
+    }
+}
+
+TEST_CASE("single_threaded_collection/handles", "[single_threaded_collection]")
+{
+    int_collection col;
+
+    SECTION("can remove element through its handle")
+    {
+        auto call_count = 0;
+        auto const h = col.insert_handle(5);
+
+        REQUIRE(h);
+        REQUIRE(col.remove(h));
+        REQUIRE(col.empty());
+
+        col.apply([&](auto) { ++call_count; });
+        REQUIRE(call_count == 0);
+    }
+
+    SECTION("removing through a handle twice has no effect")
+    {
+        auto const h = col.insert_handle(5);
+        col.insert(7);
+
+        REQUIRE(col.remove(h));
+        REQUIRE_FALSE(col.remove(h));
+        REQUIRE_FALSE(col.empty());
+    }
+
+    SECTION("handle of a removed element does not remove the slot's new element")
+    {
+        auto const h = col.insert_handle(5);
+        col.remove(h);
+        col.insert(7);
+
+        REQUIRE_FALSE(col.remove(h));
+        REQUIRE(col.size() == 1);
+    }
+
+    SECTION("handle can outlive the collection")
+    {
+        auto h = int_collection::handle { };
+        {
+            int_collection c;
+            h = c.insert_handle(5);
+        }
+
+        REQUIRE(h);
+    }
+
+    SECTION("empty handle does not remove anything")
+    {
+        col.insert(5);
+
+        REQUIRE_FALSE(col.remove(int_collection::handle { }));
+        REQUIRE_FALSE(col.empty());
+    }
+}
+
+TEST_CASE("single_threaded_collection/mutations during apply",
+          "[single_threaded_collection]")
+{
+    SECTION("will not call apply for a removed element that has not been applied")
+    {
+        single_threaded_collection<unsigned int> col;
+
+        auto ids = std::array<single_threaded_collection<unsigned int>::id, 3> { };
+        for(auto i = 0u; i < ids.size(); ++i)
+            ids[i] = col.insert(i);
+
+        auto call_count = 0;
+        col.apply([&](auto j) {
+            for(auto i = 0u; i < ids.size(); ++i)
+                if(i != j)
+                    col.remove(ids[i]);
+            ++call_count;
+        });
+
+        REQUIRE(call_count == 1);
+    }
+
+    SECTION("can remove already applied element")
+    {
+        single_threaded_collection<unsigned int> col;
+
+        auto ids = std::array<single_threaded_collection<unsigned int>::id, 3> { };
+        for(auto i = 0u; i < ids.size(); ++i)
+            ids[i] = col.insert(i);
+
+        col.apply([&](auto i) { col.remove(ids[i]); });
+
+        REQUIRE(col.empty());
+    }
+
+    SECTION("element removed during apply is destroyed after apply")
+    {
+        single_threaded_collection<std::shared_ptr<int>> col;
+        auto const p = std::make_shared<int>(1);
+        auto const id = col.insert(p);
+
+        col.apply([&](auto const &) {
+            col.remove(id);
+            REQUIRE(p.use_count() == 2);
+        });
+
+        REQUIRE(p.use_count() == 1);
+    }
+
+    SECTION("element inserted during apply is not applied")
+    {
+        int_collection col;
+        col.insert(3);
+
+        auto call_count = 0;
+        col.apply([&](auto) {
+            for(auto i = 0; i < 100; ++i)
+                col.insert(7);
+            ++call_count;
+        });
+
+        REQUIRE(call_count == 1);
+        REQUIRE(col.size() == 101);
+    }
+
+    SECTION("slot freed during apply is not reused by the same apply")
+    {
+        int_collection col;
+        auto const first = col.insert(1);
+        col.insert(2);
+
+        auto sum = 0;
+        col.apply([&](auto v) {
+            sum += v;
+            if(v == 1)
+            {
+                col.remove(first);
+                col.insert(10);
+            }
+        });
+
+        REQUIRE(sum == 3);
+    }
+
+    SECTION("nested apply calls see the same elements")
+    {
+        int_collection col;
+        col.insert(1);
+        col.insert(2);
+
+        auto sum = 0;
+        col.apply([&](auto) {
+            col.apply([&](auto v) { sum += v; });
+        });
+
+        REQUIRE(sum == 6);
+    }
+}
+
+} } }
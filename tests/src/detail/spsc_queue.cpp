@@ -0,0 +1,125 @@
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/detail/spsc_queue.hpp>
+
+namespace observable { namespace detail { namespace test {
+
+TEST_CASE("spsc queue/single thread", "[spsc queue]")
+{
+    SECTION("capacity is rounded up to a power of two")
+    {
+        spsc_queue<int> q { 5 };
+
+        REQUIRE(q.capacity() == 8);
+    }
+
+    SECTION("empty queue cannot be popped")
+    {
+        spsc_queue<int> q { 4 };
+
+        REQUIRE_FALSE(q.try_pop([](int) { }));
+    }
+
+    SECTION("elements are popped in the order they were pushed")
+    {
+        spsc_queue<int> q { 4 };
+        q.try_push(1);
+        q.try_push(2);
+        q.try_push(3);
+
+        std::vector<int> popped;
+        while(q.try_pop([&](int v) { popped.push_back(v); }))
+            ;
+
+        REQUIRE(popped == (std::vector<int> { 1, 2, 3 }));
+    }
+
+    SECTION("full queue rejects elements")
+    {
+        spsc_queue<int> q { 2 };
+
+        REQUIRE(q.try_push(1));
+        REQUIRE(q.try_push(2));
+        REQUIRE_FALSE(q.try_push(3));
+    }
+
+    SECTION("popping makes room for new elements")
+    {
+        spsc_queue<int> q { 2 };
+        q.try_push(1);
+        q.try_push(2);
+        q.try_pop([](int) { });
+
+        REQUIRE(q.try_push(3));
+    }
+
+    SECTION("move-only elements are supported")
+    {
+        spsc_queue<std::unique_ptr<int>> q { 2 };
+        q.try_push(std::make_unique<int>(5));
+
+        auto v = 0;
+        q.try_pop([&](std::unique_ptr<int> && p) { v = *p; });
+
+        REQUIRE(v == 5);
+    }
+
+    SECTION("remaining elements are destroyed with the queue")
+    {
+        auto const p = std::make_shared<int>(1);
+
+        {
+            spsc_queue<std::shared_ptr<int>> q { 4 };
+            q.try_push(p);
+            q.try_push(p);
+            REQUIRE(p.use_count() == 3);
+        }
+
+        REQUIRE(p.use_count() == 1);
+    }
+
+    SECTION("element is destroyed if the functor throws")
+    {
+        auto const p = std::make_shared<int>(1);
+        spsc_queue<std::shared_ptr<int>> q { 4 };
+        q.try_push(p);
+
+        REQUIRE_THROWS(q.try_pop([](auto &&) { throw 1; }));
+        REQUIRE(p.use_count() == 1);
+        REQUIRE_FALSE(q.try_pop([](auto &&) { }));
+    }
+}
+
+TEST_CASE("spsc queue/threads", "[spsc queue]")
+{
+    SECTION("all elements are received in order")
+    {
+        spsc_queue<std::string> q { 16 };
+        auto const count = 10000;
+
+        auto producer = std::thread { [&]() {
+            for(auto i = 0; i < count; ++i)
+                while(!q.try_push(std::to_string(i)))
+                    std::this_thread::yield();
+        } };
+
+        auto expected = 0;
+        auto ordered = true;
+        while(expected < count)
+        {
+            if(!q.try_pop([&](std::string && s) {
+                ordered = ordered && s == std::to_string(expected);
+                ++expected;
+            }))
+                std::this_thread::yield();
+        }
+
+        producer.join();
+        REQUIRE(ordered);
+    }
+}
+
+} } }
@@ -0,0 +1,89 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/detail/thread_pool.hpp>
+
+namespace observable { namespace detail { namespace test {
+
+TEST_CASE("thread pool/parallel loops", "[thread pool]")
+{
+    SECTION("every index is visited exactly once")
+    {
+        thread_pool pool { 3 };
+        auto visits = std::vector<std::atomic<int>>(1000);
+
+        pool.parallel_for(visits.size(), [&](std::size_t i) { ++visits[i]; });
+
+        for(auto && v : visits)
+            REQUIRE(v.load() == 1);
+    }
+
+    SECTION("pool without workers runs on the calling thread")
+    {
+        thread_pool pool { 0 };
+        auto const caller = std::this_thread::get_id();
+        auto same_thread = true;
+
+        pool.parallel_for(10, [&](std::size_t) {
+            same_thread = same_thread && std::this_thread::get_id() == caller;
+        });
+
+        REQUIRE(pool.concurrency() == 1);
+        REQUIRE(same_thread);
+    }
+
+    SECTION("empty loop does not call the functor")
+    {
+        thread_pool pool { 2 };
+        auto called = false;
+
+        pool.parallel_for(0, [&](std::size_t) { called = true; });
+
+        REQUIRE_FALSE(called);
+    }
+
+    SECTION("pool can run multiple loops")
+    {
+        thread_pool pool { 2 };
+        std::atomic<std::size_t> sum { 0 };
+
+        for(auto n = 0; n < 100; ++n)
+            pool.parallel_for(10, [&](std::size_t i) { sum += i; });
+
+        REQUIRE(sum.load() == 100 * 45);
+    }
+
+    SECTION("uneven work is balanced")
+    {
+        thread_pool pool { 3 };
+        std::atomic<int> visits { 0 };
+
+        pool.parallel_for(64, [&](std::size_t i) {
+            if(i == 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds { 20 });
+            ++visits;
+        });
+
+        REQUIRE(visits.load() == 64);
+    }
+
+    SECTION("exceptions are rethrown after the loop finishes")
+    {
+        thread_pool pool { 2 };
+        std::atomic<int> visits { 0 };
+
+        REQUIRE_THROWS_AS(pool.parallel_for(100, [&](std::size_t i) {
+                              ++visits;
+                              if(i == 50)
+                                  throw std::runtime_error { "error" };
+                          }),
+                          std::runtime_error);
+        REQUIRE(visits.load() == 100);
+    }
+}
+
+} } }
@@ -0,0 +1,329 @@
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/async_subject.hpp>
+#include <observable/event_loop.hpp>
+#include <observable/observe.hpp>
+#include <observable/subject.hpp>
+#include <observable/value.hpp>
+#include <observable/expressions/operators.hpp>
+
+namespace observable { namespace test {
+
+namespace {
+
+//! Event loop that runs its queue when told to.
+struct test_loop
+{
+    auto post()
+    {
+        return [this](async_task t) {
+            std::lock_guard<std::mutex> const lock { mutex };
+            queue.push_back(std::move(t));
+        };
+    }
+
+    //! Run the tasks that are queued; returns their number.
+    auto run()
+    {
+        auto count = 0;
+        for(;;)
+        {
+            auto t = async_task { };
+            {
+                std::lock_guard<std::mutex> const lock { mutex };
+                if(queue.empty())
+                    return count;
+
+                t = std::move(queue.front());
+                queue.pop_front();
+            }
+
+            t();
+            ++count;
+        }
+    }
+
+    auto size()
+    {
+        std::lock_guard<std::mutex> const lock { mutex };
+        return queue.size();
+    }
+
+    std::mutex mutex;
+    std::deque<async_task> queue;
+};
+
+}
+
+TEST_CASE("event_loop/posting", "[event_loop]")
+{
+    SECTION("posted tasks run during the next pass")
+    {
+        test_loop l;
+        auto loop = loop_dispatcher { l.post() };
+        auto seen = std::vector<int> { };
+
+        loop.post([&]() { seen.push_back(1); });
+        loop.post([&]() { seen.push_back(2); });
+        REQUIRE(seen.empty());
+
+        REQUIRE(l.run() == 1);
+        REQUIRE(seen == (std::vector<int> { 1, 2 }));
+        REQUIRE(loop.passes() == 1);
+    }
+
+    SECTION("only one pass is posted until it runs")
+    {
+        test_loop l;
+        auto loop = loop_dispatcher { l.post() };
+
+        for(auto i = 0; i < 100; ++i)
+            loop.post([]() { });
+
+        REQUIRE(l.size() == 1);
+    }
+
+    SECTION("tasks posted during a pass run during the next one")
+    {
+        test_loop l;
+        auto loop = loop_dispatcher { l.post() };
+        auto calls = 0;
+
+        loop.post([&]() {
+            ++calls;
+            loop.post([&]() { ++calls; });
+        });
+
+        REQUIRE(l.run() == 2);
+        REQUIRE(calls == 2);
+        REQUIRE(loop.passes() == 2);
+    }
+
+    SECTION("tasks can be posted from other threads")
+    {
+        test_loop l;
+        auto loop = loop_dispatcher { l.post() };
+        std::atomic<int> calls { 0 };
+
+        auto threads = std::vector<std::thread> { };
+        for(auto t = 0; t < 4; ++t)
+            threads.emplace_back([&]() {
+                for(auto i = 0; i < 100; ++i)
+                    loop.post([&]() { ++calls; });
+            });
+
+        for(auto && t : threads)
+            t.join();
+
+        l.run();
+        REQUIRE(calls == 400);
+    }
+
+    SECTION("passes can be run directly")
+    {
+        test_loop l;
+        auto loop = loop_dispatcher { l.post() };
+        auto calls = 0;
+        loop.post([&]() { ++calls; });
+
+        loop.run();
+
+        REQUIRE(calls == 1);
+        REQUIRE(l.run() == 1);
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("posted passes do nothing after the dispatcher is destroyed")
+    {
+        test_loop l;
+        auto calls = 0;
+        {
+            auto loop = loop_dispatcher { l.post() };
+            loop.post([&]() { ++calls; });
+        }
+
+        l.run();
+
+        REQUIRE(calls == 0);
+    }
+
+    SECTION("tasks that did not run are kept if a task throws")
+    {
+        test_loop l;
+        auto loop = loop_dispatcher { l.post() };
+        auto seen = std::vector<int> { };
+
+        loop.post([&]() { seen.push_back(1); });
+        loop.post([]() { throw std::runtime_error { "fail" }; });
+        loop.post([&]() { seen.push_back(3); });
+
+        REQUIRE_THROWS_AS(l.run(), std::runtime_error);
+        REQUIRE(seen == (std::vector<int> { 1 }));
+
+        l.run();
+        REQUIRE(seen == (std::vector<int> { 1, 3 }));
+    }
+}
+
+TEST_CASE("event_loop/coalescing", "[event_loop]")
+{
+    SECTION("coalesced function is called once per pass")
+    {
+        test_loop l;
+        auto loop = loop_dispatcher { l.post() };
+        auto repaints = 0;
+        auto const repaint = loop.coalesce([&]() { ++repaints; });
+
+        for(auto i = 0; i < 100; ++i)
+            repaint();
+
+        REQUIRE(repaints == 0);
+        REQUIRE(l.run() == 1);
+        REQUIRE(repaints == 1);
+
+        repaint();
+        l.run();
+        REQUIRE(repaints == 2);
+    }
+
+    SECTION("coalesced functions can observe values")
+    {
+        test_loop l;
+        auto loop = loop_dispatcher { l.post() };
+        auto x = value<int> { 0 };
+        auto y = value<std::string> { "" };
+        auto repaints = 0;
+
+        auto const repaint = loop.coalesce([&]() { ++repaints; });
+        auto const s1 = x.subscribe(repaint);
+        auto const s2 = y.subscribe(repaint);
+
+        for(auto i = 1; i <= 100; ++i)
+        {
+            x = i;
+            y = std::to_string(i);
+        }
+
+        l.run();
+        REQUIRE(repaints == 1);
+    }
+
+    SECTION("functions that were not triggered are not called")
+    {
+        test_loop l;
+        auto loop = loop_dispatcher { l.post() };
+        auto a = 0;
+        auto b = 0;
+        auto const fa = loop.coalesce([&]() { ++a; });
+        auto const fb = loop.coalesce([&]() { ++b; });
+
+        fa();
+        l.run();
+
+        REQUIRE(a == 1);
+        REQUIRE(b == 0);
+    }
+
+    SECTION("destroyed functions are not called")
+    {
+        test_loop l;
+        auto loop = loop_dispatcher { l.post() };
+        auto calls = 0;
+        {
+            auto const f = loop.coalesce([&]() { ++calls; });
+            f();
+        }
+
+        l.run();
+
+        REQUIRE(calls == 0);
+    }
+
+    SECTION("coalesced functions can be triggered from other threads")
+    {
+        test_loop l;
+        auto loop = loop_dispatcher { l.post() };
+        auto calls = 0;
+        auto const f = loop.coalesce([&]() { ++calls; });
+
+        auto threads = std::vector<std::thread> { };
+        for(auto t = 0; t < 4; ++t)
+            threads.emplace_back([&]() {
+                for(auto i = 0; i < 100; ++i)
+                    f();
+            });
+
+        for(auto && t : threads)
+            t.join();
+
+        l.run();
+        REQUIRE(calls == 1);
+    }
+}
+
+TEST_CASE("event_loop/updaters", "[event_loop]")
+{
+    SECTION("updaters are run after tasks, before coalesced functions")
+    {
+        test_loop l;
+        auto loop = loop_dispatcher { l.post() };
+        auto ud = updater { };
+        loop.add(ud);
+
+        auto a = value<int> { 1 };
+        auto const doubled = observe(ud, a * 2);
+        auto seen = 0;
+        auto const repaint = loop.coalesce([&]() { seen = doubled.get(); });
+
+        loop.post([&]() { a = 5; });
+        repaint();
+        l.run();
+
+        REQUIRE(seen == 10);
+    }
+
+    SECTION("updaters run on each pass")
+    {
+        test_loop l;
+        auto loop = loop_dispatcher { l.post() };
+        auto ud = updater { };
+        loop.add(ud);
+
+        auto a = value<int> { 1 };
+        auto const doubled = observe(ud, a * 2);
+
+        a = 3;
+        loop.schedule();
+        l.run();
+
+        REQUIRE(doubled.get() == 6);
+    }
+}
+
+TEST_CASE("event_loop/executor", "[event_loop]")
+{
+    SECTION("async subjects deliver notifications during passes")
+    {
+        test_loop l;
+        auto loop = loop_dispatcher { l.post() };
+        auto s = async_subject<void(int)> { loop.executor() };
+        auto seen = std::vector<int> { };
+        auto const sub = s.subscribe([&](int v) { seen.push_back(v); });
+
+        s.notify(1);
+        s.notify(2);
+        REQUIRE(seen.empty());
+        REQUIRE(l.size() == 1);
+
+        l.run();
+        REQUIRE(seen == (std::vector<int> { 1, 2 }));
+    }
+}
+
+} }
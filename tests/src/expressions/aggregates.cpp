@@ -0,0 +1,267 @@
+#include <memory>
+#include <catch/catch.hpp>
+#include <observable/observe.hpp>
+#include <observable/value.hpp>
+#include <observable/vector.hpp>
+#include <observable/expressions/aggregates.hpp>
+#include <observable/expressions/operators.hpp>
+
+namespace observable { inline namespace expr { namespace test {
+
+TEST_CASE("aggregates/sum", "[aggregates]")
+{
+    SECTION("sum has the initial value")
+    {
+        auto v = vector<int> { 1, 2, 3 };
+        auto result = observe(sum(v));
+
+        REQUIRE(result.get() == 6);
+    }
+
+    SECTION("sum of an empty vector is zero")
+    {
+        auto v = vector<int> { };
+        auto result = observe(sum(v));
+
+        REQUIRE(result.get() == 0);
+    }
+
+    SECTION("sum follows all kinds of changes")
+    {
+        auto v = vector<int> { 1, 2, 3 };
+        auto result = observe(sum(v));
+
+        v.push_back(4);
+        REQUIRE(result.get() == 10);
+
+        v.set(0, 11);
+        REQUIRE(result.get() == 20);
+
+        v.update(1, [](int & i) { i *= 10; return true; });
+        REQUIRE(result.get() == 38);
+
+        v.erase(0, 2);
+        REQUIRE(result.get() == 7);
+
+        auto const more = std::vector<int> { 5, 6 };
+        v.insert(1, more.begin(), more.end());
+        REQUIRE(result.get() == 18);
+
+        v.assign({ 100 });
+        REQUIRE(result.get() == 100);
+
+        v.clear();
+        REQUIRE(result.get() == 0);
+    }
+
+    SECTION("observers are notified once per change")
+    {
+        auto v = vector<int> { 1 };
+        auto result = observe(sum(v));
+        auto calls = 0;
+        auto const sub = result.subscribe([&]() { ++calls; });
+
+        v.push_back(2);
+        v.push_back(3);
+
+        REQUIRE(calls == 2);
+    }
+
+    SECTION("changes that keep the sum do not notify")
+    {
+        auto v = vector<int> { 1, 2 };
+        auto result = observe(sum(v));
+        auto calls = 0;
+        auto const sub = result.subscribe([&]() { ++calls; });
+
+        v.push_back(0);
+
+        REQUIRE(calls == 0);
+    }
+
+    SECTION("sum can be used inside expressions")
+    {
+        auto v = vector<int> { 1, 2 };
+        auto offset = value<int> { 10 };
+        auto result = observe(sum(v) + offset);
+
+        REQUIRE(result.get() == 13);
+
+        v.push_back(3);
+        REQUIRE(result.get() == 16);
+
+        offset = 20;
+        REQUIRE(result.get() == 26);
+    }
+
+    SECTION("sum can be updated by an updater")
+    {
+        auto ud = updater { };
+        auto v = vector<int> { 1, 2 };
+        auto result = observe(ud, sum(v));
+
+        v.push_back(3);
+        REQUIRE(result.get() == 3);
+
+        ud.update_all();
+        REQUIRE(result.get() == 6);
+    }
+
+    SECTION("sum keeps its value after the vector is destroyed")
+    {
+        auto v = std::make_unique<vector<int>>(std::initializer_list<int> { 1, 2 });
+        auto result = observe(sum(*v));
+
+        v.reset();
+
+        REQUIRE(result.get() == 3);
+    }
+
+    SECTION("sum follows a moved vector")
+    {
+        auto v = vector<int> { 1, 2 };
+        auto result = observe(sum(v));
+
+        auto moved = std::move(v);
+        moved.push_back(3);
+
+        REQUIRE(result.get() == 6);
+    }
+}
+
+TEST_CASE("aggregates/count_if", "[aggregates]")
+{
+    SECTION("count has the initial value")
+    {
+        auto v = vector<int> { 1, 2, 3, 4 };
+        auto result = observe(count_if(v, [](int i) { return i % 2 == 0; }));
+
+        REQUIRE(result.get() == 2);
+    }
+
+    SECTION("count follows changes")
+    {
+        auto v = vector<int> { 1, 2, 3, 4 };
+        auto result = observe(count_if(v, [](int i) { return i % 2 == 0; }));
+
+        v.push_back(6);
+        REQUIRE(result.get() == 3);
+
+        v.set(0, 8);
+        REQUIRE(result.get() == 4);
+
+        v.set(1, 5);
+        REQUIRE(result.get() == 3);
+
+        v.pop_back();
+        REQUIRE(result.get() == 2);
+
+        v.clear();
+        REQUIRE(result.get() == 0);
+    }
+
+    SECTION("predicate is only called for changed elements")
+    {
+        auto v = vector<int> { 1, 2, 3, 4 };
+        auto calls = 0;
+        auto result = observe(count_if(v, [&](int) { ++calls; return true; }));
+        calls = 0;
+
+        v.set(2, 7);
+
+        REQUIRE(calls == 2);
+    }
+}
+
+TEST_CASE("aggregates/mean", "[aggregates]")
+{
+    SECTION("mean has the initial value")
+    {
+        auto v = vector<int> { 1, 2, 3, 4 };
+        auto result = observe(mean(v));
+
+        REQUIRE(result.get() == Approx { 2.5 });
+    }
+
+    SECTION("mean of an empty vector is zero")
+    {
+        auto v = vector<int> { };
+        auto result = observe(mean(v));
+
+        REQUIRE(result.get() == Approx { 0.0 });
+    }
+
+    SECTION("mean follows changes")
+    {
+        auto v = vector<int> { 1, 2, 3, 4 };
+        auto result = observe(mean(v));
+
+        v.push_back(10);
+        REQUIRE(result.get() == Approx { 4.0 });
+
+        v.erase(0, 4);
+        REQUIRE(result.get() == Approx { 10.0 });
+
+        v.clear();
+        REQUIRE(result.get() == Approx { 0.0 });
+    }
+}
+
+TEST_CASE("aggregates/min and max", "[aggregates]")
+{
+    SECTION("min and max have the initial values")
+    {
+        auto v = vector<int> { 3, 1, 2 };
+        auto low = observe(min(v));
+        auto high = observe(max(v));
+
+        REQUIRE(low.get() == 1);
+        REQUIRE(high.get() == 3);
+    }
+
+    SECTION("erasing the minimum selects the next one")
+    {
+        auto v = vector<int> { 3, 1, 2 };
+        auto low = observe(min(v));
+
+        v.erase(1);
+
+        REQUIRE(low.get() == 2);
+    }
+
+    SECTION("duplicate minimums are handled")
+    {
+        auto v = vector<int> { 1, 1, 2 };
+        auto low = observe(min(v));
+
+        v.erase(0);
+        REQUIRE(low.get() == 1);
+
+        v.erase(0);
+        REQUIRE(low.get() == 2);
+    }
+
+    SECTION("updating an element moves the maximum")
+    {
+        auto v = vector<int> { 3, 1, 2 };
+        auto high = observe(max(v));
+
+        v.set(0, 0);
+        REQUIRE(high.get() == 2);
+
+        v.set(1, 9);
+        REQUIRE(high.get() == 9);
+    }
+
+    SECTION("min of an empty vector is value-initialized")
+    {
+        auto v = vector<int> { 4 };
+        auto low = observe(min(v));
+
+        v.clear();
+
+        REQUIRE(low.get() == 0);
+    }
+}
+
+} } }
@@ -0,0 +1,294 @@
+#include <cstdint>
+#include <memory>
+#include <catch/catch.hpp>
+#include <observable/observe.hpp>
+#include <observable/expressions/arena.hpp>
+
+namespace observable { inline namespace expr { namespace test {
+
+TEST_CASE("expression arena/allocation", "[expression arena]")
+{
+    SECTION("new arena is empty")
+    {
+        expression_arena arena;
+
+        REQUIRE(arena.size() == 0);
+    }
+
+    SECTION("allocated memory is aligned")
+    {
+        expression_arena arena;
+        arena.allocate(1, 1);
+        auto const p = arena.allocate(8, 16);
+
+        REQUIRE(reinterpret_cast<std::uintptr_t>(p) % 16 == 0);
+    }
+
+    SECTION("allocations do not overlap")
+    {
+        expression_arena arena { 64 };
+        auto const a = static_cast<char *>(arena.allocate(40, 8));
+        auto const b = static_cast<char *>(arena.allocate(40, 8));
+
+        REQUIRE((b >= a + 40 || a >= b + 40));
+    }
+
+    SECTION("allocations larger than a block are supported")
+    {
+        expression_arena arena { 64 };
+        auto const p = static_cast<char *>(arena.allocate(1000, 8));
+        p[0] = p[999] = 'x';
+
+        REQUIRE(arena.size() == 1000);
+    }
+
+    SECTION("scope makes arena current")
+    {
+        expression_arena arena;
+        REQUIRE(expression_arena::current() == nullptr);
+
+        {
+            expression_arena::scope const s { arena };
+            REQUIRE(expression_arena::current() == &arena);
+        }
+
+        REQUIRE(expression_arena::current() == nullptr);
+    }
+
+    SECTION("nested scopes restore the outer arena")
+    {
+        expression_arena outer;
+        expression_arena inner;
+        expression_arena::scope const s1 { outer };
+
+        {
+            expression_arena::scope const s2 { inner };
+            REQUIRE(expression_arena::current() == &inner);
+        }
+
+        REQUIRE(expression_arena::current() == &outer);
+    }
+}
+
+TEST_CASE("expression arena/expression trees", "[expression arena]")
+{
+    SECTION("nodes created in scope allocate from the arena")
+    {
+        expression_arena arena;
+        auto a = value<int> { 1 };
+
+        {
+            expression_arena::scope const s { arena };
+            auto node = expression_node<int> { a };
+        }
+
+        REQUIRE(arena.size() > 0);
+    }
+
+    SECTION("nodes created outside of a scope do not use the arena")
+    {
+        expression_arena arena;
+        auto a = value<int> { 1 };
+        auto node = expression_node<int> { a };
+
+        REQUIRE(arena.size() == 0);
+    }
+
+    SECTION("observed expression built in an arena is evaluated")
+    {
+        expression_arena arena;
+        auto a = value<int> { 1 };
+        auto b = value<int> { 2 };
+        auto c = value<int> { 3 };
+
+        auto result = observe(arena, [&]() { return (a + b) * c; });
+
+        REQUIRE(result.get() == 9);
+        REQUIRE(arena.size() > 0);
+    }
+
+    SECTION("observed expression built in an arena is updated")
+    {
+        expression_arena arena;
+        auto a = value<int> { 1 };
+        auto b = value<int> { 2 };
+
+        auto result = observe(arena, [&]() { return a * 10 + b; });
+        auto calls = 0;
+        auto const sub = result.subscribe([&](int) { ++calls; });
+
+        a = 3;
+        b = 4;
+
+        REQUIRE(result.get() == 34);
+        REQUIRE(calls == 2);
+    }
+
+    SECTION("single value can be observed in an arena")
+    {
+        expression_arena arena;
+        auto a = value<int> { 1 };
+
+        auto result = observe(arena, [&]() -> auto & { return a; });
+        a = 5;
+
+        REQUIRE(result.get() == 5);
+    }
+
+    SECTION("manually updated expression built in an arena is updated")
+    {
+        expression_arena arena;
+        auto ud = updater { };
+        auto a = value<int> { 1 };
+
+        auto result = observe(ud, arena, [&]() { return a + 1; });
+        a = 5;
+        REQUIRE(result.get() == 2);
+
+        ud.update_all();
+        REQUIRE(result.get() == 6);
+    }
+
+    SECTION("observed value can outlive the source values")
+    {
+        expression_arena arena;
+        auto a = std::make_unique<value<int>>(1);
+
+        auto result = observe(arena, [&]() { return *a + 1; });
+        a.reset();
+
+        REQUIRE(result.get() == 2);
+    }
+
+    SECTION("arena is not current after observe() returns")
+    {
+        expression_arena arena;
+        auto a = value<int> { 1 };
+        auto result = observe(arena, [&]() { return a + 1; });
+
+        REQUIRE(expression_arena::current() == nullptr);
+    }
+}
+
+TEST_CASE("expression arena/subgraphs", "[expression arena]")
+{
+    SECTION("tagged allocator uses the arena that is current when allocating")
+    {
+        expression_arena arena;
+        auto a = expr_detail::tagged_arena_allocator<int> { };
+
+        auto const heap = a.allocate(1);
+        REQUIRE(arena.size() == 0);
+
+        int * in_arena = nullptr;
+        {
+            expression_arena::scope const s { arena };
+            in_arena = a.allocate(1);
+        }
+
+        REQUIRE(arena.size() > 0);
+
+        // Each allocation knows where it comes from.
+        a.deallocate(in_arena, 1);
+        a.deallocate(heap, 1);
+    }
+
+    SECTION("subjects created in scope allocate from the arena")
+    {
+        expression_arena arena;
+        expression_arena::scope const s { arena };
+
+        auto const before = arena.size();
+        auto subject = observable::subject<void(int), arena_subject_policy> { };
+        auto const created = arena.size();
+
+        auto sum = 0;
+        auto const sub = unique_subscription {
+            subject.subscribe([&](int v) { sum += v; })
+        };
+        subject.notify(3);
+
+        REQUIRE(created > before);
+        REQUIRE(arena.size() > created);
+        REQUIRE(sum == 3);
+    }
+
+    SECTION("arena subjects can be used outside of the scope")
+    {
+        expression_arena arena;
+        auto subject = std::unique_ptr<observable::subject<void(), arena_subject_policy>> { };
+        {
+            expression_arena::scope const s { arena };
+            subject = std::make_unique<observable::subject<void(), arena_subject_policy>>();
+        }
+
+        auto call_count = 0;
+        auto sub = subject->subscribe([&]() { ++call_count; });
+        subject->notify();
+        sub.unsubscribe();
+        subject->notify();
+
+        REQUIRE(call_count == 1);
+    }
+
+    SECTION("values created in scope allocate from the arena")
+    {
+        expression_arena arena;
+        expression_arena::scope const s { arena };
+
+        auto v = value<int, arena_subject_policy> { 1 };
+        auto seen = 0;
+        auto const sub = v.subscribe([&](int x) { seen = x; });
+        v = 2;
+
+        REQUIRE(arena.size() > 0);
+        REQUIRE(seen == 2);
+    }
+
+    SECTION("updaters created with an arena allocate from it")
+    {
+        expression_arena arena;
+        auto a = value<int> { 1 };
+        auto ud = updater { arena };
+
+        auto const before = arena.size();
+        auto result = observe(ud, arena, [&]() { return a * 2; });
+        a = 4;
+        ud.update_all();
+
+        REQUIRE(before > 0);
+        REQUIRE(result.get() == 8);
+    }
+
+    SECTION("updaters created in scope do not use the arena")
+    {
+        expression_arena arena;
+        auto ud = std::unique_ptr<updater> { };
+        {
+            expression_arena::scope const s { arena };
+            ud = std::make_unique<updater>();
+        }
+
+        REQUIRE(arena.size() == 0);
+    }
+
+    SECTION("immediate expressions can be observed after an arena is gone")
+    {
+        auto a = value<int> { 1 };
+        {
+            expression_arena arena;
+            expression_arena::scope const s { arena };
+            auto const evaluator = expression_evaluator { };
+            auto const result = observe(arena, [&]() { return a + 1; });
+
+            REQUIRE(arena.size() > 0);
+        }
+
+        auto result = observe(a + 2);
+        a = 5;
+
+        REQUIRE(result.get() == 7);
+    }
+}
+
+} } }
@@ -0,0 +1,201 @@
+#include <memory>
+#include <catch/catch.hpp>
+#include <observable/observe.hpp>
+#include <observable/value.hpp>
+#include <observable/expressions/context.hpp>
+#include <observable/expressions/introspection.hpp>
+#include <observable/expressions/math.hpp>
+#include <observable/expressions/operators.hpp>
+#include <observable/expressions/timing.hpp>
+
+namespace observable { inline namespace expr { namespace test {
+
+namespace {
+
+template <typename T, typename U>
+auto same_node(expression_node<T> const & a, expression_node<U> const & b)
+{
+    return static_cast<void const *>(&a.base()) == static_cast<void const *>(&b.base());
+}
+
+}
+
+TEST_CASE("expression context/sharing", "[expression context]")
+{
+    SECTION("new context is empty")
+    {
+        expression_context ctx;
+
+        REQUIRE(ctx.size() == 0);
+        REQUIRE(expression_context::current() == nullptr);
+    }
+
+    SECTION("scope makes the context current")
+    {
+        expression_context ctx;
+        {
+            expression_context::scope const s { ctx };
+            REQUIRE(expression_context::current() == &ctx);
+        }
+
+        REQUIRE(expression_context::current() == nullptr);
+    }
+
+    SECTION("nodes are not shared without a context")
+    {
+        auto a = value<int> { 1 };
+        auto b = value<int> { 2 };
+
+        REQUIRE_FALSE(same_node(a * b, a * b));
+    }
+
+    SECTION("identical expressions are shared")
+    {
+        auto a = value<int> { 1 };
+        auto b = value<int> { 2 };
+
+        expression_context ctx;
+        expression_context::scope const s { ctx };
+
+        REQUIRE(same_node(a * b, a * b));
+        REQUIRE(same_node(abs(a - b), abs(a - b)));
+        REQUIRE(same_node((a + 1) * 2, (a + 1) * 2));
+        REQUIRE(ctx.size() == 9);
+    }
+
+    SECTION("different expressions are not shared")
+    {
+        auto a = value<int> { 1 };
+        auto b = value<int> { 2 };
+
+        expression_context ctx;
+        expression_context::scope const s { ctx };
+
+        REQUIRE_FALSE(same_node(a * b, b * a));
+        REQUIRE_FALSE(same_node(a * b, a + b));
+        REQUIRE_FALSE(same_node(a + 1, a + 2));
+        REQUIRE_FALSE(same_node(a + 1, a + 1.0));
+    }
+
+    SECTION("stateful operations are not shared")
+    {
+        auto a = value<int> { 1 };
+
+        expression_context ctx;
+        expression_context::scope const s { ctx };
+
+        REQUIRE_FALSE(same_node(throttle(a, std::chrono::seconds { 1 }),
+                                throttle(a, std::chrono::seconds { 1 })));
+    }
+
+    SECTION("shared values only have one node")
+    {
+        auto a = value<int> { 1 };
+
+        expression_context ctx;
+        auto r1 = observe(ctx, [&]() { return a * 2 + 1; });
+        auto r2 = observe(ctx, [&]() { return a * 2 - 1; });
+
+        expression_context::scope const s { ctx };
+        auto const leaf = expression_node<int> { 0 } + a;
+        auto const nodes = describe_graph(leaf);
+        auto const value_node = nodes.front().children[1];
+
+        for(auto && d : nodes)
+            if(d.id == value_node)
+                REQUIRE(d.subscribers == 2);
+        REQUIRE(r1.get() == 3);
+        REQUIRE(r2.get() == 1);
+    }
+
+    SECTION("shared results follow their values")
+    {
+        auto a = value<int> { 1 };
+        auto b = value<int> { 2 };
+
+        expression_context ctx;
+        auto r1 = observe(ctx, [&]() { return a * b + 1; });
+        auto r2 = observe(ctx, [&]() { return a * b - 1; });
+
+        a = 5;
+
+        REQUIRE(r1.get() == 11);
+        REQUIRE(r2.get() == 9);
+    }
+
+    SECTION("shared nodes are evaluated once per change")
+    {
+        auto a = value<int> { 1 };
+        auto b = value<int> { 2 };
+
+        expression_context ctx;
+        auto ud = updater { };
+        auto r1 = observe(ud, ctx, [&]() { return a * b + 1; });
+        auto r2 = observe(ud, ctx, [&]() { return a * b - 1; });
+
+        auto shared = expression_node<int> { 0 };
+        {
+            expression_context::scope const s { ctx };
+            shared = a * b;
+        }
+
+        start_profiling();
+        a = 3;
+        ud.update_all();
+        stop_profiling();
+
+        REQUIRE(r1.get() == 7);
+        REQUIRE(r2.get() == 5);
+        REQUIRE(describe_graph(shared).front().profile.evaluations == 1);
+    }
+
+    SECTION("destroyed values are forgotten")
+    {
+        auto a = std::make_unique<value<int>>(1);
+
+        expression_context ctx;
+        expression_context::scope const s { ctx };
+
+        auto const node = *a + 1;
+        REQUIRE(ctx.size() == 3);
+
+        a.reset();
+        REQUIRE(ctx.size() == 2);
+    }
+
+    SECTION("moved values are forgotten")
+    {
+        auto a = value<int> { 1 };
+
+        expression_context ctx;
+        expression_context::scope const s { ctx };
+
+        auto const before = a + 1;
+        auto b = std::move(a);
+        auto const after = b + 1;
+
+        REQUIRE_FALSE(same_node(before, after));
+
+        b = 5;
+        before.eval();
+        after.eval();
+        REQUIRE(before.get() == 6);
+        REQUIRE(after.get() == 6);
+    }
+
+    SECTION("cleared context does not share nodes anymore")
+    {
+        auto a = value<int> { 1 };
+
+        expression_context ctx;
+        expression_context::scope const s { ctx };
+
+        auto const before = a + 1;
+        ctx.clear();
+
+        REQUIRE(ctx.size() == 0);
+        REQUIRE_FALSE(same_node(before, a + 1));
+    }
+}
+
+} } }
@@ -158,6 +158,40 @@ TEST_CASE("expression/expression updating", "[expression]")
         REQUIRE(e1.get() == 7);
         REQUIRE(e2.get() == 17);
     }
+
+    SECTION("unchanged expression does not notify its value")
+    {
+        auto ev = expression_evaluator { };
+
+        auto val = value<int> { 5 };
+        auto e = expression<int> { expression_node<int> { val }, ev };
+        auto calls = 0;
+        e.set_value_notifier([&](int &&) { ++calls; });
+
+        ev.eval_all();
+        ev.eval_all();
+        REQUIRE(calls == 1);
+
+        val = 7;
+        ev.eval_all();
+        REQUIRE(calls == 2);
+    }
+
+    SECTION("new notifier gets the current result")
+    {
+        auto ev = expression_evaluator { };
+
+        auto val = value<int> { 5 };
+        auto e = expression<int> { expression_node<int> { val }, ev };
+        e.set_value_notifier([](int &&) { });
+        ev.eval_all();
+
+        auto seen = 0;
+        e.set_value_notifier([&](int && v) { seen = v; });
+        ev.eval_all();
+
+        REQUIRE(seen == 5);
+    }
 }
 
 } } }
@@ -144,6 +144,36 @@ TEST_CASE("filter/select", "[filter]")
     REQUIRE(res.get() == 200);
 }
 
+TEST_CASE("filter/select evaluates only the selected value", "[filter]")
+{
+    auto p = value<bool> { true };
+    auto a = value<int> { 1 };
+    auto b = value<int> { 2 };
+    auto b_calls = 0;
+
+    auto expensive_b = observable::expression_node<int> {
+        [&](int v) { ++b_calls; return v * 10; },
+        observable::expression_node<int> { b }
+    };
+
+    auto res = observe(select(p, a, std::move(expensive_b)));
+    auto notifications = 0;
+    auto const sub = res.subscribe([&]() { ++notifications; });
+
+    b = 3;
+    b = 4;
+    REQUIRE(b_calls == 1);
+    REQUIRE(notifications == 0);
+
+    p = false;
+    REQUIRE(res.get() == 40);
+    REQUIRE(b_calls == 2);
+    REQUIRE(notifications == 1);
+
+    a = 5;
+    REQUIRE(notifications == 1);
+}
+
 TEST_CASE("filter/min", "[filter]")
 {
     auto a = value<int> { 1 };
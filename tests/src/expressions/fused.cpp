@@ -0,0 +1,236 @@
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <catch/catch.hpp>
+#include <observable/batch.hpp>
+#include <observable/observe.hpp>
+#include <observable/expressions/fused.hpp>
+
+namespace observable { inline namespace expr { namespace test {
+
+namespace {
+
+//! Counts how many times it is compared.
+struct probe
+{
+    int v;
+    int * comparisons;
+};
+
+auto operator==(probe const & p, int v)
+{
+    ++*p.comparisons;
+    return p.v == v;
+}
+
+}
+
+TEST_CASE("fused expression/building", "[fused expression]")
+{
+    SECTION("fuse() creates a leaf")
+    {
+        auto a = value<int> { 5 };
+        auto leaf = fuse(a);
+
+        REQUIRE(is_fused_expression<decltype(leaf)>::value);
+        REQUIRE(leaf.eval() == 5);
+    }
+
+    SECTION("operators on fused expressions create fused nodes")
+    {
+        auto a = value<int> { 5 };
+        auto b = value<int> { 3 };
+        auto node = fuse(a) * b + 1;
+
+        REQUIRE(is_fused_expression<decltype(node)>::value);
+        REQUIRE_FALSE(is_expression_node<decltype(node)>::value);
+        REQUIRE(node.eval() == 16);
+    }
+
+    SECTION("values and constants are fused on both sides")
+    {
+        auto a = value<int> { 5 };
+        auto b = value<int> { 3 };
+        auto node = 10 - (b - fuse(a));
+
+        REQUIRE(is_fused_expression<decltype(node)>::value);
+        REQUIRE(node.eval() == 12);
+    }
+
+    SECTION("unary operators can be fused")
+    {
+        auto a = value<int> { 5 };
+        auto node = -fuse(a);
+
+        REQUIRE(node.eval() == -5);
+    }
+
+    SECTION("leaves are counted")
+    {
+        auto a = value<int> { 1 };
+        auto b = value<int> { 2 };
+        auto node = fuse(a) + fuse(b) * a + 3;
+
+        REQUIRE(decltype(node)::leaf_count() == 3);
+    }
+
+    SECTION("fused node evaluates current values")
+    {
+        auto a = value<int> { 1 };
+        auto b = value<int> { 2 };
+        auto node = fuse(a) + b;
+
+        a = 10;
+        REQUIRE(node.eval() == 12);
+    }
+
+    SECTION("&& and || short-circuit")
+    {
+        auto comparisons = 0;
+        auto flag = value<bool> { false };
+        auto p = value<probe> { probe { 1, &comparisons } };
+
+        auto const both = fuse(flag) && (fuse(p) == 1);
+        auto const either = fuse(flag) || (fuse(p) == 1);
+
+        REQUIRE_FALSE(both.eval());
+        REQUIRE(comparisons == 0);
+
+        REQUIRE(either.eval());
+        REQUIRE(comparisons == 1);
+
+        flag = true;
+        REQUIRE(both.eval());
+        REQUIRE(comparisons == 2);
+
+        REQUIRE(either.eval());
+        REQUIRE(comparisons == 2);
+    }
+}
+
+TEST_CASE("fused expression/observing", "[fused expression]")
+{
+    SECTION("observed fused expression has the correct initial value")
+    {
+        auto i = value<int> { 1 };
+        auto j = value<int> { 2 };
+        auto k = value<int> { 3 };
+
+        auto result = observe(500 + (fuse(i) * j * k) - (1 + fuse(k) + j));
+
+        REQUIRE(result.get() == 500 + (1 * 2 * 3) - (1 + 3 + 2));
+    }
+
+    SECTION("observed fused expression is updated")
+    {
+        auto i = value<int> { 1 };
+        auto j = value<int> { 2 };
+        auto result = observe(fuse(i) * 10 + j);
+
+        i = 3;
+        REQUIRE(result.get() == 32);
+
+        j = 5;
+        REQUIRE(result.get() == 35);
+    }
+
+    SECTION("observed fused expression notifies observers")
+    {
+        auto i = value<int> { 1 };
+        auto result = observe(fuse(i) * 2);
+        auto v = 0;
+        auto const sub = result.subscribe([&](int x) { v = x; });
+
+        i = 4;
+
+        REQUIRE(v == 8);
+    }
+
+    SECTION("fused expression is evaluated once per batch")
+    {
+        auto i = value<int> { 1 };
+        auto j = value<int> { 2 };
+        auto result = observe(fuse(i) + j);
+        auto calls = 0;
+        auto const sub = result.subscribe([&]() { ++calls; });
+
+        {
+            batch b;
+            i = 10;
+            j = 20;
+        }
+
+        REQUIRE(result.get() == 30);
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("value used more than once is evaluated once")
+    {
+        auto i = value<int> { 1 };
+        auto result = observe(fuse(i) + i + i);
+        auto calls = 0;
+        auto const sub = result.subscribe([&]() { ++calls; });
+
+        i = 2;
+
+        REQUIRE(result.get() == 6);
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("fused and regular expressions are consistent")
+    {
+        auto i = value<int> { 1 };
+        auto fused = observe(fuse(i) * 2);
+        auto regular = observe(i * 2);
+        auto sum = observe(fuse(fused) + regular);
+        auto calls = 0;
+        auto const sub = sum.subscribe([&](int s) {
+            ++calls;
+            REQUIRE(s == fused.get() + regular.get());
+        });
+
+        i = 5;
+
+        REQUIRE(sum.get() == 20);
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("manually updated fused expression is updated")
+    {
+        auto ud = updater { };
+        auto i = value<int> { 1 };
+        auto result = observe(ud, fuse(i) + 1);
+
+        i = 5;
+        REQUIRE(result.get() == 2);
+
+        ud.update_all();
+        REQUIRE(result.get() == 6);
+    }
+
+    SECTION("fused expression tracks moved values")
+    {
+        auto i = std::make_unique<value<int>>(1);
+        auto result = observe(fuse(*i) + 1);
+
+        auto moved = std::move(*i);
+        i.reset();
+        moved = 7;
+
+        REQUIRE(result.get() == 8);
+    }
+
+    SECTION("fused expression keeps its last result if a value is destroyed")
+    {
+        auto i = std::make_unique<value<int>>(1);
+        auto j = value<int> { 2 };
+        auto result = observe(fuse(*i) + j);
+
+        i.reset();
+        j = 10;
+
+        REQUIRE(result.get() == 3);
+    }
+}
+
+} } }
@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/observe.hpp>
+#include <observable/value.hpp>
+#include <observable/expressions/introspection.hpp>
+#include <observable/expressions/math.hpp>
+#include <observable/expressions/operators.hpp>
+
+namespace observable { inline namespace expr { namespace test {
+
+namespace {
+
+auto find(std::vector<node_description> const & nodes, void const * id)
+{
+    return *std::find_if(nodes.begin(), nodes.end(),
+                         [=](auto && d) { return d.id == id; });
+}
+
+template <typename T>
+auto copy(expression_node<T> const & node)
+{
+    return node;
+}
+
+template <typename T>
+auto id_of(expression_node<T> const & node) -> void const *
+{
+    return &node.base();
+}
+
+}
+
+TEST_CASE("introspection/names", "[introspection]")
+{
+    SECTION("operators are named after themselves")
+    {
+        auto a = value<int> { 1 };
+
+        REQUIRE(std::string { (a + 1).name() } == "+");
+        REQUIRE(std::string { (a << 1).name() } == "<<");
+        REQUIRE(std::string { (-a).name() } == "-");
+    }
+
+    SECTION("filters are named after themselves")
+    {
+        auto a = value<int> { 1 };
+
+        REQUIRE(std::string { abs(a).name() } == "abs");
+        REQUIRE(std::string { static_expr_cast<long>(a).name() } == "static_expr_cast");
+    }
+
+    SECTION("leaves have default names")
+    {
+        auto a = value<int> { 1 };
+
+        REQUIRE(std::string { expression_node<int> { 1 }.name() } == "constant");
+        REQUIRE(std::string { expression_node<int> { a }.name() } == "value");
+    }
+
+    SECTION("nodes can be renamed")
+    {
+        auto a = value<int> { 1 };
+        auto node = a + 1;
+        node.name("increment");
+
+        REQUIRE(std::string { node.name() } == "increment");
+    }
+}
+
+TEST_CASE("introspection/describe_graph", "[introspection]")
+{
+    SECTION("all nodes are described")
+    {
+        auto a = value<int> { 1 };
+        auto b = value<int> { 2 };
+        auto root = (a + b) * 2;
+
+        auto const nodes = describe_graph(root);
+
+        REQUIRE(nodes.size() == 5);
+        REQUIRE(nodes.front().id == id_of(root));
+        REQUIRE(std::string { nodes.front().name } == "*");
+        REQUIRE(nodes.front().children.size() == 2);
+        REQUIRE(nodes.front().parents == 0);
+
+        auto const sum = find(nodes, nodes.front().children[0]);
+        REQUIRE(std::string { sum.name } == "+");
+        REQUIRE(sum.rank == 1);
+        REQUIRE(sum.parents == 1);
+        REQUIRE(sum.subscribers == 1);
+        REQUIRE(sum.children.size() == 2);
+    }
+
+    SECTION("parents come before their children")
+    {
+        auto a = value<int> { 1 };
+        auto root = -(-(-a));
+
+        auto const nodes = describe_graph(root);
+
+        REQUIRE(std::is_sorted(nodes.begin(), nodes.end(),
+                               [](auto && x, auto && y) { return x.rank > y.rank; }));
+    }
+
+    SECTION("shared nodes are described once")
+    {
+        auto a = value<int> { 1 };
+        auto shared = a + 1;
+        auto root = copy(shared) * copy(shared);
+        auto other = copy(shared) - 1;
+
+        auto const nodes = describe_graph(root, other);
+
+        REQUIRE(nodes.size() == 6);
+        REQUIRE(find(nodes, id_of(shared)).parents == 3);
+        REQUIRE(find(nodes, id_of(root)).children ==
+                std::vector<void const *>(2, id_of(shared)));
+    }
+
+    SECTION("nodes with many children are described")
+    {
+        auto a = value<int> { 1 };
+        auto root = expr_detail::make_node([](int w, int x, int y, int z) { return w + x + y + z; },
+                                           a, a, a, a);
+
+        REQUIRE(describe_graph(root).front().children.size() == 4);
+    }
+
+    SECTION("observers are counted as subscribers")
+    {
+        auto a = value<int> { 1 };
+        auto root = a + 1;
+        auto result = observe(copy(root));
+
+        REQUIRE(describe_graph(root).front().subscribers == 1);
+    }
+}
+
+TEST_CASE("introspection/profiling", "[introspection]")
+{
+    SECTION("nothing is counted while profiling is stopped")
+    {
+        auto a = value<int> { 1 };
+        auto root = a + 1;
+
+        a = 2;
+        root.eval();
+
+        REQUIRE(describe_graph(root).front().profile.visits == 0);
+    }
+
+    SECTION("visits and evaluations are counted")
+    {
+        auto a = value<int> { 1 };
+        auto root = a + 1;
+
+        start_profiling();
+        a = 2;
+        root.eval();
+        root.eval();
+        stop_profiling();
+
+        auto const profile = describe_graph(root).front().profile;
+        REQUIRE(root.get() == 3);
+        REQUIRE(profile.visits == 2);
+        REQUIRE(profile.evaluations == 1);
+        REQUIRE(profile.dirty_ratio() == Approx(0.5));
+    }
+
+    SECTION("children are only evaluated by dirty parents")
+    {
+        auto a = value<int> { 1 };
+        auto root = a + 1;
+
+        start_profiling();
+        a = 2;
+        root.eval();
+        root.eval();
+        stop_profiling();
+
+        auto const nodes = describe_graph(root);
+        REQUIRE(find(nodes, nodes.front().children[0]).profile.visits == 1);
+    }
+
+    SECTION("counters can be reset")
+    {
+        auto a = value<int> { 1 };
+        auto root = a + 1;
+
+        start_profiling();
+        a = 2;
+        root.eval();
+        stop_profiling();
+
+        reset_profile(root);
+
+        for(auto && d : describe_graph(root))
+        {
+            REQUIRE(d.profile.visits == 0);
+            REQUIRE(d.profile.evaluations == 0);
+            REQUIRE(d.profile.time.count() == 0);
+        }
+    }
+
+    SECTION("unvisited nodes have a zero dirty ratio")
+    {
+        REQUIRE(node_profile { }.dirty_ratio() == 0.0);
+    }
+}
+
+TEST_CASE("introspection/write_graph", "[introspection]")
+{
+    SECTION("graph is written in the dot format")
+    {
+        auto a = value<int> { 1 };
+        auto root = a + 1;
+
+        std::ostringstream out;
+        write_graph(out, root);
+
+        auto const graph = out.str();
+        REQUIRE(graph.find("digraph expression {") == 0);
+        REQUIRE(graph.find("[label=\"+\\nrank 1") != std::string::npos);
+        REQUIRE(graph.find("n0 -> n1;") != std::string::npos);
+        REQUIRE(graph.find("n0 -> n2;") != std::string::npos);
+    }
+
+    SECTION("names are escaped")
+    {
+        auto a = value<int> { 1 };
+        auto root = a + 1;
+        root.name("\"quoted\"");
+
+        std::ostringstream out;
+        write_graph(out, root);
+
+        REQUIRE(out.str().find("\\\"quoted\\\"") != std::string::npos);
+    }
+}
+
+} } }
@@ -79,6 +79,63 @@ MAKE_BINARY_OP_TEST("|", 0x1, |, 0x2)
 MAKE_BINARY_OP_TEST("&&", true, &&, true)
 MAKE_BINARY_OP_TEST("||", true, ||, false)
 
+TEST_CASE("expression operator/logical operators short-circuit", "[expression operator]")
+{
+    auto a = value<bool> { false };
+    auto b = value<bool> { true };
+    auto b_calls = 0;
+
+    auto const counted_b = [&]() {
+        return expression_node<bool> {
+            [&](bool v) { ++b_calls; return v; },
+            expression_node<bool> { b }
+        };
+    };
+
+    SECTION("and does not evaluate its second operand if the first is false")
+    {
+        auto r = a && counted_b();
+        REQUIRE_FALSE(r.get());
+        REQUIRE(b_calls == 1);
+
+        b = false;
+        b = true;
+        r.eval();
+        REQUIRE(b_calls == 1);
+
+        a = true;
+        r.eval();
+        REQUIRE(r.get());
+        REQUIRE(b_calls == 2);
+    }
+
+    SECTION("or does not evaluate its second operand if the first is true")
+    {
+        a = true;
+        auto r = a || counted_b();
+        REQUIRE(r.get());
+
+        b = false;
+        r.eval();
+        REQUIRE(b_calls == 1);
+
+        a = false;
+        r.eval();
+        REQUIRE_FALSE(r.get());
+        REQUIRE(b_calls == 2);
+    }
+
+    SECTION("constant operands short-circuit")
+    {
+        auto r = a && true;
+        REQUIRE_FALSE(r.get());
+
+        a = true;
+        r.eval();
+        REQUIRE(r.get());
+    }
+}
+
 TEST_CASE("expression operator/nodes are updated", "[expression operator]")
 {
     auto a = value<int> { 5 };
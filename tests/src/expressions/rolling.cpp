@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/observe.hpp>
+#include <observable/value.hpp>
+#include <observable/expressions/operators.hpp>
+#include <observable/expressions/rolling.hpp>
+
+namespace observable { inline namespace expr { namespace test {
+
+TEST_CASE("rolling/scan", "[rolling]")
+{
+    SECTION("initial input is accumulated")
+    {
+        auto a = value<int> { 5 };
+        auto const result = observe(scan(a, 1, [](int acc, int v) { return acc + v; }));
+
+        REQUIRE(result.get() == 6);
+    }
+
+    SECTION("each change is accumulated")
+    {
+        auto a = value<int> { 1 };
+        auto const result = observe(scan(a, 0, [](int acc, int v) { return acc + v; }));
+
+        a = 2;
+        a = 3;
+
+        REQUIRE(result.get() == 6);
+    }
+
+    SECTION("accumulator can have a different type")
+    {
+        auto a = value<char> { 'a' };
+        auto const result = observe(scan(a, std::string { },
+                                         [](std::string acc, char c) {
+                                             acc.push_back(c);
+                                             return acc;
+                                         }));
+
+        a = 'b';
+
+        REQUIRE(result.get() == "ab");
+    }
+
+    SECTION("changes between updates count as one input")
+    {
+        auto ud = updater { };
+        auto a = value<int> { 1 };
+        auto const result = observe(ud, scan(a, 0, [](int acc, int v) { return acc + v; }));
+
+        a = 2;
+        a = 3;
+        ud.update_all();
+
+        REQUIRE(result.get() == 4);
+    }
+
+    SECTION("expression nodes can be accumulated")
+    {
+        auto a = value<int> { 1 };
+        auto const result = observe(scan(a * 2, 0, [](int acc, int v) { return acc + v; }));
+
+        a = 2;
+
+        REQUIRE(result.get() == 6);
+    }
+}
+
+TEST_CASE("rolling/ema", "[rolling]")
+{
+    SECTION("first input is taken as is")
+    {
+        auto a = value<int> { 4 };
+        auto const result = observe(ema(a, 0.5));
+
+        REQUIRE(result.get() == Approx { 4.0 });
+    }
+
+    SECTION("each input moves the average")
+    {
+        auto a = value<double> { 0.0 };
+        auto const result = observe(ema(a, 0.25));
+
+        a = 8.0;
+        REQUIRE(result.get() == Approx { 2.0 });
+
+        a = 2.0;
+        REQUIRE(result.get() == Approx { 2.0 });
+
+        a = 6.0;
+        REQUIRE(result.get() == Approx { 3.0 });
+    }
+}
+
+TEST_CASE("rolling/rolling_mean", "[rolling]")
+{
+    SECTION("mean is taken over the inputs seen so far")
+    {
+        auto a = value<int> { 2 };
+        auto const result = observe(rolling_mean(a, 3));
+
+        REQUIRE(result.get() == Approx { 2.0 });
+
+        a = 4;
+        REQUIRE(result.get() == Approx { 3.0 });
+    }
+
+    SECTION("old inputs leave the window")
+    {
+        auto a = value<int> { 1 };
+        auto const result = observe(rolling_mean(a, 3));
+
+        a = 2;
+        a = 3;
+        REQUIRE(result.get() == Approx { 2.0 });
+
+        a = 10;
+        REQUIRE(result.get() == Approx { 5.0 });
+
+        a = 20;
+        a = 30;
+        REQUIRE(result.get() == Approx { 20.0 });
+    }
+
+    SECTION("window of one follows the input")
+    {
+        auto a = value<int> { 1 };
+        auto const result = observe(rolling_mean(a, 1));
+
+        a = 7;
+
+        REQUIRE(result.get() == Approx { 7.0 });
+    }
+}
+
+TEST_CASE("rolling/rolling_min and rolling_max", "[rolling]")
+{
+    SECTION("initial input is the extreme")
+    {
+        auto a = value<int> { 5 };
+        auto const lo = observe(rolling_min(a, 3));
+        auto const hi = observe(rolling_max(a, 3));
+
+        REQUIRE(lo.get() == 5);
+        REQUIRE(hi.get() == 5);
+    }
+
+    SECTION("extremes follow the window")
+    {
+        auto a = value<int> { 5 };
+        auto const lo = observe(rolling_min(a, 3));
+        auto const hi = observe(rolling_max(a, 3));
+
+        auto const inputs = { 1, 4, 3, 9, 2, 8, 7, 6 };
+        auto const mins   = { 1, 1, 1, 3, 2, 2, 2, 6 };
+        auto const maxs   = { 5, 5, 4, 9, 9, 9, 8, 8 };
+
+        auto mi = mins.begin();
+        auto ma = maxs.begin();
+        for(auto v : inputs)
+        {
+            a = v;
+            REQUIRE(lo.get() == *mi++);
+            REQUIRE(hi.get() == *ma++);
+        }
+    }
+
+    SECTION("equal inputs are kept in the window")
+    {
+        auto a = value<int> { 1 };
+        auto const lo = observe(rolling_min(a, 2));
+
+        a = 3;
+        a = 1;
+        a = 3;
+        REQUIRE(lo.get() == 1);
+
+        a = 4;
+        REQUIRE(lo.get() == 3);
+    }
+
+    SECTION("matches a full scan of the window")
+    {
+        auto a = value<int> { 0 };
+        auto const size = std::size_t { 7 };
+        auto const lo = observe(rolling_min(a, size));
+        auto const hi = observe(rolling_max(a, size));
+
+        auto history = std::vector<int> { 0 };
+        auto seed = 12345u;
+        for(auto i = 0; i < 500; ++i)
+        {
+            seed = seed * 1103515245u + 12345u;
+            auto const v = static_cast<int>((seed >> 16) % 100);
+            if(v == a.get())
+                continue;
+
+            a = v;
+            history.push_back(v);
+
+            auto const first = history.size() > size ? history.end() - size
+                                                     : history.begin();
+            REQUIRE(lo.get() == *std::min_element(first, history.end()));
+            REQUIRE(hi.get() == *std::max_element(first, history.end()));
+        }
+    }
+}
+
+} } }
@@ -0,0 +1,216 @@
+#include <chrono>
+#include <catch/catch.hpp>
+#include <observable/observe.hpp>
+#include <observable/value.hpp>
+#include <observable/expressions/operators.hpp>
+#include <observable/expressions/timing.hpp>
+
+namespace observable { inline namespace expr { namespace test {
+
+namespace {
+
+//! Clock that only advances when told to.
+struct test_clock
+{
+    using duration = std::chrono::milliseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<test_clock>;
+    static constexpr bool is_steady = true;
+
+    static auto now() noexcept { return time_point { current() }; }
+
+    static auto current() noexcept -> duration &
+    {
+        static auto d = duration { 0 };
+        return d;
+    }
+
+    static void advance(duration d) noexcept { current() += d; }
+};
+
+using namespace std::chrono_literals;
+
+}
+
+TEST_CASE("timing/throttle", "[timing]")
+{
+    SECTION("throttle has the initial value")
+    {
+        auto a = value<int> { 5 };
+        auto result = observe(throttle<test_clock>(a, 10ms));
+
+        REQUIRE(result.get() == 5);
+    }
+
+    SECTION("changes inside the window are dropped")
+    {
+        auto a = value<int> { 1 };
+        auto result = observe(throttle<test_clock>(a, 10ms));
+        auto calls = 0;
+        auto const sub = result.subscribe([&]() { ++calls; });
+
+        test_clock::advance(5ms);
+        a = 2;
+        a = 3;
+
+        REQUIRE(result.get() == 1);
+        REQUIRE(calls == 0);
+    }
+
+    SECTION("changes after the window are let through")
+    {
+        auto a = value<int> { 1 };
+        auto result = observe(throttle<test_clock>(a, 10ms));
+
+        test_clock::advance(10ms);
+        a = 2;
+        REQUIRE(result.get() == 2);
+
+        test_clock::advance(1ms);
+        a = 3;
+        REQUIRE(result.get() == 2);
+    }
+
+    SECTION("tick delivers the latest value after the window")
+    {
+        auto a = value<int> { 1 };
+        auto tick = value<int> { 0 };
+        auto result = observe(throttle<test_clock>(a, 10ms, tick));
+
+        test_clock::advance(1ms);
+        a = 2;
+        REQUIRE(result.get() == 1);
+
+        test_clock::advance(10ms);
+        tick = 1;
+        REQUIRE(result.get() == 2);
+    }
+
+    SECTION("throttle works with expressions")
+    {
+        auto a = value<int> { 1 };
+        auto result = observe(throttle<test_clock>(a * 2, 10ms) + 1);
+
+        test_clock::advance(20ms);
+        a = 5;
+
+        REQUIRE(result.get() == 11);
+    }
+
+    SECTION("throttle works with the default clock")
+    {
+        auto a = value<int> { 1 };
+        auto result = observe(throttle(a, 1h));
+
+        a = 2;
+
+        REQUIRE(result.get() == 1);
+    }
+}
+
+TEST_CASE("timing/debounce", "[timing]")
+{
+    SECTION("debounce has the initial value")
+    {
+        auto a = value<int> { 5 };
+        auto tick = value<int> { 0 };
+        auto result = observe(debounce<test_clock>(a, 10ms, tick));
+
+        REQUIRE(result.get() == 5);
+    }
+
+    SECTION("changes are not let through before the input settles")
+    {
+        auto a = value<int> { 1 };
+        auto tick = value<int> { 0 };
+        auto result = observe(debounce<test_clock>(a, 10ms, tick));
+
+        a = 2;
+        test_clock::advance(5ms);
+        tick = 1;
+
+        REQUIRE(result.get() == 1);
+    }
+
+    SECTION("settled input is let through")
+    {
+        auto a = value<int> { 1 };
+        auto tick = value<int> { 0 };
+        auto result = observe(debounce<test_clock>(a, 10ms, tick));
+
+        a = 2;
+        test_clock::advance(10ms);
+        tick = 1;
+
+        REQUIRE(result.get() == 2);
+    }
+
+    SECTION("every change restarts the wait")
+    {
+        auto a = value<int> { 1 };
+        auto tick = value<int> { 0 };
+        auto result = observe(debounce<test_clock>(a, 10ms, tick));
+        auto calls = 0;
+        auto const sub = result.subscribe([&]() { ++calls; });
+
+        for(auto i = 2; i < 10; ++i)
+        {
+            a = i;
+            test_clock::advance(6ms);
+            tick = i;
+        }
+        REQUIRE(result.get() == 1);
+
+        test_clock::advance(6ms);
+        tick = 100;
+
+        REQUIRE(result.get() == 9);
+        REQUIRE(calls == 1);
+    }
+}
+
+TEST_CASE("timing/sample", "[timing]")
+{
+    SECTION("sample has the initial value")
+    {
+        auto a = value<int> { 5 };
+        auto tick = value<int> { 0 };
+        auto result = observe(sample(a, tick));
+
+        REQUIRE(result.get() == 5);
+    }
+
+    SECTION("changes between ticks are ignored")
+    {
+        auto a = value<int> { 1 };
+        auto tick = value<int> { 0 };
+        auto result = observe(sample(a, tick));
+        auto calls = 0;
+        auto const sub = result.subscribe([&]() { ++calls; });
+
+        a = 2;
+        a = 3;
+
+        REQUIRE(result.get() == 1);
+        REQUIRE(calls == 0);
+    }
+
+    SECTION("tick takes the current value")
+    {
+        auto a = value<int> { 1 };
+        auto tick = value<int> { 0 };
+        auto result = observe(sample(a, tick));
+        auto calls = 0;
+        auto const sub = result.subscribe([&]() { ++calls; });
+
+        a = 2;
+        a = 3;
+        tick = 1;
+
+        REQUIRE(result.get() == 3);
+        REQUIRE(calls == 1);
+    }
+}
+
+} } }
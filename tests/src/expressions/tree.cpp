@@ -1,3 +1,5 @@
+#include <cstddef>
+#include <vector>
 #include <catch/catch.hpp>
 #include <observable/value.hpp>
 #include <observable/expressions/tree.hpp>
@@ -137,6 +139,131 @@ TEST_CASE("expression tree/nodes are evaluated only if dirty", "[expression tree
     }
 }
 
+TEST_CASE("expression tree/lazy operands", "[expression tree]")
+{
+    using observable::expr::expr_detail::lazy_operands_tag;
+
+    auto cond = observable::value<bool> { true };
+    auto a = observable::value<int> { 1 };
+    auto b = observable::value<int> { 2 };
+    auto b_calls = 0;
+    auto dirty_count = 0;
+
+    auto node = expression_node<int> {
+        lazy_operands_tag { },
+        [](auto && c, auto && x, auto && y) { return c() ? x() : y(); },
+        expression_node<bool> { cond },
+        expression_node<int> { a },
+        expression_node<int> {
+            [&](int v) { ++b_calls; return v; },
+            expression_node<int> { b }
+        }
+    };
+    auto const sub = node.subscribe([&]() { ++dirty_count; });
+
+    SECTION("operands that are not called are not evaluated")
+    {
+        REQUIRE(node.get() == 1);
+        REQUIRE(b_calls == 1);
+
+        b = 3;
+        node.eval();
+
+        REQUIRE(b_calls == 1);
+    }
+
+    SECTION("changes to operands that are not called do not make the node dirty")
+    {
+        b = 3;
+        b = 4;
+
+        REQUIRE(dirty_count == 0);
+
+        a = 5;
+        REQUIRE(dirty_count == 1);
+    }
+
+    SECTION("operands are brought up to date when they are needed again")
+    {
+        b = 3;
+        cond = false;
+        node.eval();
+
+        REQUIRE(node.get() == 3);
+        REQUIRE(b_calls == 2);
+
+        a = 7;
+        b = 8;
+        REQUIRE(dirty_count == 2);
+
+        node.eval();
+        REQUIRE(node.get() == 8);
+    }
+}
+
+TEST_CASE("expression tree/results are not copied", "[expression tree]")
+{
+    SECTION("get() returns a reference to the result")
+    {
+        auto node = expression_node<int> { 5 };
+
+        REQUIRE(&node.get() == &node.get());
+    }
+
+    SECTION("operations receive their arguments by reference")
+    {
+        auto child = expression_node<std::vector<int>> { std::vector<int>(100) };
+        auto const data = child.get().data();
+        auto same = false;
+        auto node = expression_node<std::size_t> {
+            [&](auto const & v) { same = v.data() == data; return v.size(); },
+            std::move(child)
+        };
+
+        REQUIRE(same);
+        REQUIRE(node.get() == 100);
+    }
+}
+
+TEST_CASE("expression tree/versions", "[expression tree]")
+{
+    SECTION("constant nodes keep version zero")
+    {
+        auto node = expression_node<int> { 5 };
+        node.eval();
+
+        REQUIRE(node.version() == 0);
+    }
+
+    SECTION("version is incremented when a dirty node is evaluated")
+    {
+        auto val = value<int> { 1 };
+        auto node = expression_node<int> { val };
+        auto const initial = node.version();
+
+        val = 2;
+        REQUIRE(node.version() == initial);
+
+        node.eval();
+        REQUIRE(node.version() == initial + 1);
+    }
+
+    SECTION("version is not incremented when a clean node is evaluated")
+    {
+        auto val = value<int> { 1 };
+        auto node = expression_node<int> {
+            [](int v) { return v * 2; },
+            expression_node<int> { val }
+        };
+        node.eval();
+        auto const initial = node.version();
+
+        node.eval();
+
+        REQUIRE(node.version() == initial);
+    }
+}
+
 TEST_CASE("expression tree/nodes and values are safe to move", "[expression tree]")
 {
     SECTION("constant node can be evaluated after move")
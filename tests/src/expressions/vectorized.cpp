@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/observe.hpp>
+#include <observable/expressions/vectorized.hpp>
+
+namespace observable { inline namespace expr { namespace test {
+
+namespace {
+
+auto clamp_shape = [](auto a, auto k, auto b) {
+    return std::min(std::max(a * k + b, 0.0f), 10.0f);
+};
+
+using clamp_expression = vectorized_expression<float(float, float, float), updater>;
+
+}
+
+TEST_CASE("vectorized expression/evaluation", "[vectorized expression]")
+{
+    SECTION("results are initialized from the default inputs")
+    {
+        auto ud = updater { };
+        vectorized_expression<int(int, int), updater> e {
+            ud, 100, [](int a, int b) { return a + b + 1; } };
+
+        REQUIRE(e.size() == 100);
+        REQUIRE(e.get(0) == 1);
+        REQUIRE(e.get(99) == 1);
+    }
+
+    SECTION("changed lanes are evaluated by the updater")
+    {
+        auto ud = updater { };
+        clamp_expression e { ud, 1000, clamp_shape };
+
+        e.set<0>(10, 2.0f);
+        e.set<1>(10, 3.0f);
+        e.set<2>(999, 1.0f);
+
+        REQUIRE(e.get(10) == 0.0f);
+
+        ud.update_all();
+
+        REQUIRE(e.get(10) == 6.0f);
+        REQUIRE(e.get(999) == 1.0f);
+        REQUIRE(e.get(500) == 0.0f);
+        REQUIRE(e.input<0>(10) == 2.0f);
+    }
+
+    SECTION("math functions can be used")
+    {
+        auto ud = updater { };
+        vectorized_expression<float(float, float), updater> e {
+            ud, 200, [](float x, float y) { return std::sqrt(x * x + y * y); } };
+
+        for(auto i = std::size_t { 0 }; i < e.size(); ++i)
+        {
+            e.set<0>(i, 3.0f);
+            e.set<1>(i, 4.0f);
+        }
+
+        ud.update_all();
+
+        REQUIRE(std::all_of(e.results(), e.results() + e.size(),
+                            [](float r) { return r == Approx(5.0f); }));
+    }
+
+    SECTION("lanes are independent")
+    {
+        auto ud = updater { };
+        vectorized_expression<int(int), updater> e {
+            ud, 300, [](int a) { return a * 2; } };
+
+        for(auto i = std::size_t { 0 }; i < e.size(); ++i)
+            e.set<0>(i, static_cast<int>(i));
+
+        ud.update_all();
+
+        for(auto i = std::size_t { 0 }; i < e.size(); ++i)
+            REQUIRE(e.get(i) == static_cast<int>(i) * 2);
+    }
+
+    SECTION("expression with no lanes can be updated")
+    {
+        auto ud = updater { };
+        vectorized_expression<int(int), updater> e { ud, 0, [](int a) { return a; } };
+
+        ud.update_all();
+
+        REQUIRE(e.size() == 0);
+    }
+}
+
+TEST_CASE("vectorized expression/notification", "[vectorized expression]")
+{
+    SECTION("subscribers are notified of changed lanes")
+    {
+        auto ud = updater { };
+        clamp_expression e { ud, 1000, clamp_shape };
+
+        std::vector<std::pair<std::size_t, float>> changes;
+        auto const sub = e.subscribe([&](std::size_t lane, float r) {
+            changes.emplace_back(lane, r);
+        });
+
+        e.set<2>(3, 1.0f);
+        e.set<2>(700, 2.0f);
+        ud.update_all();
+
+        REQUIRE(changes == (std::vector<std::pair<std::size_t, float>> {
+                                { 3, 1.0f }, { 700, 2.0f } }));
+    }
+
+    SECTION("lanes whose result did not change are not notified")
+    {
+        auto ud = updater { };
+        clamp_expression e { ud, 64, clamp_shape };
+
+        auto calls = 0;
+        auto const sub = e.subscribe([&](std::size_t, float) { ++calls; });
+
+        e.set<0>(5, 1.0f); // k is still zero.
+        e.set<2>(6, 20.0f); // Clamped to 10.
+        ud.update_all();
+        REQUIRE(calls == 1);
+
+        e.set<2>(6, 30.0f); // Still clamped.
+        ud.update_all();
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("clean expression is not evaluated again")
+    {
+        auto ud = updater { };
+        auto evaluations = std::size_t { 0 };
+        vectorized_expression<int(int), updater> e {
+            ud, 128, [&](int a) { ++evaluations; return a; } };
+
+        evaluations = 0;
+        ud.update_all();
+        REQUIRE(evaluations == 0);
+
+        e.set<0>(1, 1);
+        ud.update_all();
+        REQUIRE(evaluations == 64);
+    }
+
+    SECTION("incremental updater evaluates changed expressions")
+    {
+        auto ud = incremental_updater { };
+        vectorized_expression<int(int), incremental_updater> e {
+            ud, 10, [](int a) { return a + 1; } };
+
+        e.set<0>(2, 5);
+        ud.update_all();
+        REQUIRE(e.get(2) == 6);
+
+        e.set<0>(2, 7);
+        ud.update_all();
+        REQUIRE(e.get(2) == 8);
+    }
+
+    SECTION("destroyed expression is not evaluated anymore")
+    {
+        auto ud = updater { };
+        {
+            vectorized_expression<int(int), updater> e {
+                ud, 10, [](int a) { return a; } };
+            e.set<0>(1, 1);
+        }
+
+        REQUIRE_NOTHROW(ud.update_all());
+    }
+}
+
+} } }
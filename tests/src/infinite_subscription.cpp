@@ -68,6 +68,41 @@ TEST_CASE("infinite_subscription/unsubscribing", "[infinite_subscription]")
     }
 }
 
+TEST_CASE("infinite_subscription/release", "[infinite_subscription]")
+{
+    SECTION("unsubscribe() has no effect after release()")
+    {
+        auto call_count = 0;
+        auto sub = infinite_subscription { [&]() { ++call_count; } };
+
+        auto unsubscribe = sub.release();
+        sub.unsubscribe();
+
+        REQUIRE(call_count == 0);
+    }
+
+    SECTION("released functor performs the unsubscribe")
+    {
+        auto call_count = 0;
+        auto sub = infinite_subscription { [&]() { ++call_count; } };
+
+        sub.release()();
+
+        REQUIRE(call_count == 1);
+    }
+
+    SECTION("released functor does nothing if already unsubscribed")
+    {
+        auto call_count = 0;
+        auto sub = infinite_subscription { [&]() { ++call_count; } };
+
+        sub.unsubscribe();
+        sub.release()();
+
+        REQUIRE(call_count == 1);
+    }
+}
+
 TEST_CASE("infinite_subscription/copy", "[infinite_subscription]")
 {
     SECTION("is not copy-constructible")
@@ -0,0 +1,255 @@
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <catch/catch.hpp>
+#include <observable/instrumentation.hpp>
+#include <observable/observe.hpp>
+#include <observable/subject.hpp>
+#include <observable/value.hpp>
+
+namespace observable { namespace test {
+
+namespace {
+
+using instrumented = instrumented_subject_policy<>;
+
+std::size_t fake_allocations = 0;
+auto count_fake_allocations() noexcept -> std::size_t { return fake_allocations; }
+
+auto visited(std::string const & name)
+{
+    auto count = 0;
+    for_each_instrumented([&](auto && n, auto &&) { count += n == name; });
+    return count;
+}
+
+}
+
+TEST_CASE("instrumentation/disabled", "[instrumentation]")
+{
+    SECTION("default subjects have no instrumentation state")
+    {
+        REQUIRE(sizeof(subject<void(int)>) == sizeof(std::shared_ptr<int>));
+        REQUIRE(sizeof(subject<void(int), inline_subject_policy>) ==
+                sizeof(std::shared_ptr<int>));
+    }
+
+    SECTION("instrumented policies are subject policies")
+    {
+        REQUIRE(is_subject_policy<instrumented>::value);
+        REQUIRE(is_subject_policy<instrumented_subject_policy<inline_contiguous_subject_policy>>::value);
+        REQUIRE_FALSE(is_subject_policy<instrumented_subject_policy<int>>::value);
+    }
+}
+
+TEST_CASE("instrumentation/subject", "[instrumentation]")
+{
+    SECTION("new subject has zero counters")
+    {
+        auto s = subject<void(int), instrumented> { };
+        auto const stats = s.instrumentation().stats();
+
+        REQUIRE(stats.notifications == 0);
+        REQUIRE(stats.observer_calls == 0);
+        REQUIRE(stats.observer_time.count() == 0);
+        REQUIRE(stats.allocations == 0);
+    }
+
+    SECTION("notifications and observer calls are counted")
+    {
+        auto s = subject<void(int), instrumented> { };
+        auto const a = s.subscribe([](int) { });
+        auto const b = s.subscribe([](int) { });
+
+        s.notify(1);
+        s.notify(2);
+        s.notify(3);
+
+        auto const stats = s.instrumentation().stats();
+        REQUIRE(stats.notifications == 3);
+        REQUIRE(stats.observer_calls == 6);
+    }
+
+    SECTION("observer time is measured")
+    {
+        auto s = subject<void(), instrumented> { };
+        auto const sub = s.subscribe([]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds { 2 });
+        });
+
+        s.notify();
+
+        auto const stats = s.instrumentation().stats();
+        REQUIRE(stats.max_observer_time >= std::chrono::milliseconds { 2 });
+        REQUIRE(stats.observer_time >= stats.max_observer_time);
+    }
+
+    SECTION("allocations are counted by the installed counter")
+    {
+        set_allocation_counter(&count_fake_allocations);
+
+        auto s = subject<void(), instrumented> { };
+        auto const sub = s.subscribe([]() { fake_allocations += 2; });
+
+        s.notify();
+        s.notify();
+
+        set_allocation_counter(nullptr);
+        REQUIRE(s.instrumentation().stats().allocations == 4);
+    }
+
+    SECTION("counters can be reset")
+    {
+        auto s = subject<void(), instrumented> { };
+        auto const sub = s.subscribe([]() { });
+        s.notify();
+
+        s.instrumentation().reset();
+
+        REQUIRE(s.instrumentation().stats().notifications == 0);
+        REQUIRE(s.instrumentation().stats().observer_calls == 0);
+    }
+
+    SECTION("moved subject keeps its counters")
+    {
+        auto s = subject<void(), instrumented> { };
+        auto const sub = s.subscribe([]() { });
+        s.notify();
+
+        auto moved = std::move(s);
+        moved.notify();
+
+        REQUIRE(moved.instrumentation().stats().notifications == 2);
+    }
+
+    SECTION("instrumentation works with other policies")
+    {
+        auto s = subject<void(int), instrumented_subject_policy<inline_contiguous_subject_policy>> { };
+        auto const sub = s.subscribe([](int) { });
+
+        s.notify(1);
+
+        REQUIRE(s.instrumentation().stats().observer_calls == 1);
+    }
+}
+
+TEST_CASE("instrumentation/registry", "[instrumentation]")
+{
+    SECTION("unnamed subjects are not visited")
+    {
+        auto s = subject<void(), instrumented> { };
+
+        REQUIRE(s.instrumentation().name().empty());
+        REQUIRE(visited("") == 0);
+    }
+
+    SECTION("named subjects are visited with their statistics")
+    {
+        auto s = subject<void(), instrumented> { };
+        auto const sub = s.subscribe([]() { });
+        s.instrumentation().name("registry test");
+        s.notify();
+
+        auto notifications = std::size_t { 0 };
+        for_each_instrumented([&](auto && name, auto && stats) {
+            if(name == "registry test")
+                notifications = stats.notifications;
+        });
+
+        REQUIRE(notifications == 1);
+    }
+
+    SECTION("renamed subjects are visited once")
+    {
+        auto s = subject<void(), instrumented> { };
+        s.instrumentation().name("first name");
+        s.instrumentation().name("second name");
+
+        REQUIRE(visited("first name") == 0);
+        REQUIRE(visited("second name") == 1);
+    }
+
+    SECTION("destroyed subjects are not visited")
+    {
+        {
+            auto s = subject<void(), instrumented> { };
+            s.instrumentation().name("destroyed subject");
+        }
+
+        REQUIRE(visited("destroyed subject") == 0);
+    }
+}
+
+TEST_CASE("instrumentation/value", "[instrumentation]")
+{
+    SECTION("value changes are counted once")
+    {
+        auto v = value<int, instrumented> { 1 };
+        auto const a = v.subscribe([]() { });
+        auto const b = v.subscribe([](int) { });
+
+        v = 2;
+        v = 2;
+        v = 3;
+
+        auto const stats = v.stats();
+        REQUIRE(stats.notifications == 2);
+        REQUIRE(stats.observer_calls == 4);
+    }
+
+    SECTION("named values are visited")
+    {
+        auto v = value<int, instrumented> { };
+        v.name("instrumented value");
+
+        REQUIRE(visited("instrumented value") == 2);
+    }
+}
+
+TEST_CASE("instrumentation/updater", "[instrumentation]")
+{
+    SECTION("updates and expressions are counted")
+    {
+        auto ud = instrumented_updater<> { };
+        auto a = value<int> { 1 };
+        auto r1 = observe(ud, a + 1);
+        auto r2 = observe(ud, a * 2);
+
+        a = 5;
+        ud.update_all();
+        ud.update_all();
+
+        auto const stats = ud.instrumentation().stats();
+        REQUIRE(r1.get() == 6);
+        REQUIRE(r2.get() == 10);
+        REQUIRE(stats.notifications == 2);
+        REQUIRE(stats.observer_calls == 4);
+    }
+
+    SECTION("copies share their statistics")
+    {
+        auto ud = instrumented_updater<> { };
+        auto copy = ud;
+
+        copy.update_all();
+
+        REQUIRE(ud.instrumentation().stats().notifications == 1);
+    }
+
+    SECTION("other updaters can be instrumented")
+    {
+        auto ud = instrumented_updater<incremental_updater> { };
+        auto a = value<int> { 1 };
+        auto r = observe(ud, a + 1);
+
+        a = 2;
+        ud.update_all();
+
+        REQUIRE(r.get() == 3);
+        REQUIRE(ud.instrumentation().stats().notifications == 1);
+    }
+}
+
+} }
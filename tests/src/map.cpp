@@ -0,0 +1,156 @@
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/map.hpp>
+
+namespace observable { namespace test {
+
+namespace {
+
+using change = map_change<std::string, int>;
+using kind = change::kind;
+
+struct entry
+{
+    kind type;
+    std::string key;
+    int old_value;
+    std::size_t old_size;
+};
+
+struct recorder
+{
+    void operator()(change const & c)
+    {
+        entries.push_back(entry {
+            c.type,
+            c.key ? *c.key : std::string { },
+            c.old_value ? *c.old_value : -1,
+            c.old_content ? c.old_content->size() : 0
+        });
+    }
+
+    std::vector<entry> entries;
+};
+
+}
+
+TEST_CASE("observable map/reading", "[observable map]")
+{
+    SECTION("new map is empty")
+    {
+        observable::map<std::string, int> m;
+
+        REQUIRE(m.empty());
+    }
+
+    SECTION("map can be created with entries")
+    {
+        observable::map<std::string, int> m { { "a", 1 }, { "b", 2 } };
+
+        REQUIRE(m.size() == 2);
+        REQUIRE(m.at("b") == 2);
+        REQUIRE(m.count("a") == 1);
+        REQUIRE(m.find("c") == m.end());
+    }
+}
+
+TEST_CASE("observable map/changes", "[observable map]")
+{
+    SECTION("set() with a new key reports an insert")
+    {
+        observable::map<std::string, int> m;
+        recorder r;
+        auto const sub = m.subscribe(std::ref(r));
+
+        REQUIRE(m.set("a", 1));
+
+        REQUIRE(m.at("a") == 1);
+        REQUIRE(r.entries.size() == 1);
+        REQUIRE(r.entries[0].type == kind::insert);
+        REQUIRE(r.entries[0].key == "a");
+    }
+
+    SECTION("set() with an existing key reports an update")
+    {
+        observable::map<std::string, int> m { { "a", 1 } };
+        recorder r;
+        auto const sub = m.subscribe(std::ref(r));
+
+        m.set("a", 5);
+
+        REQUIRE(m.at("a") == 5);
+        REQUIRE(r.entries[0].type == kind::update);
+        REQUIRE(r.entries[0].old_value == 1);
+    }
+
+    SECTION("set() with an equal value does not notify")
+    {
+        observable::map<std::string, int> m { { "a", 1 } };
+        recorder r;
+        auto const sub = m.subscribe(std::ref(r));
+
+        REQUIRE_FALSE(m.set("a", 1));
+        REQUIRE(r.entries.empty());
+    }
+
+    SECTION("update() modifies the value in place")
+    {
+        observable::map<std::string, int> m { { "a", 1 } };
+        recorder r;
+        auto const sub = m.subscribe(std::ref(r));
+
+        REQUIRE(m.update("a", [](int & v) { v += 2; return true; }));
+        REQUIRE_FALSE(m.update("a", [](int &) { return false; }));
+        REQUIRE_FALSE(m.update("b", [](int &) { return true; }));
+
+        REQUIRE(m.at("a") == 3);
+        REQUIRE(r.entries.size() == 1);
+        REQUIRE(r.entries[0].old_value == 1);
+    }
+
+    SECTION("erase() reports the erased entry")
+    {
+        observable::map<std::string, int> m { { "a", 1 }, { "b", 2 } };
+        recorder r;
+        auto const sub = m.subscribe(std::ref(r));
+
+        REQUIRE(m.erase("b"));
+        REQUIRE_FALSE(m.erase("c"));
+
+        REQUIRE(m.size() == 1);
+        REQUIRE(r.entries.size() == 1);
+        REQUIRE(r.entries[0].type == kind::erase);
+        REQUIRE(r.entries[0].key == "b");
+        REQUIRE(r.entries[0].old_value == 2);
+    }
+
+    SECTION("assign() reports a reset with the old content")
+    {
+        observable::map<std::string, int> m { { "a", 1 }, { "b", 2 } };
+        recorder r;
+        auto const sub = m.subscribe(std::ref(r));
+
+        m.assign({ { "c", 3 } });
+
+        REQUIRE(m.size() == 1);
+        REQUIRE(r.entries[0].type == kind::reset);
+        REQUIRE(r.entries[0].old_size == 2);
+    }
+
+    SECTION("clear() reports a reset")
+    {
+        observable::map<std::string, int> m { { "a", 1 } };
+        recorder r;
+        auto const sub = m.subscribe(std::ref(r));
+
+        m.clear();
+
+        REQUIRE(m.empty());
+        REQUIRE(r.entries[0].type == kind::reset);
+    }
+}
+
+} }
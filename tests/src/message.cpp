@@ -0,0 +1,175 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/async_subject.hpp>
+#include <observable/message.hpp>
+#include <observable/subject.hpp>
+#include <observable/value.hpp>
+
+namespace observable { namespace test {
+
+namespace {
+
+struct counted
+{
+    explicit counted(int v, int & c) : value { v }, copies { &c } { }
+
+    counted(counted const & other) : value { other.value }, copies { other.copies }
+    {
+        ++*copies;
+    }
+
+    counted(counted &&) =default;
+
+    int value;
+    int * copies;
+};
+
+}
+
+TEST_CASE("message/creation", "[message]")
+{
+    SECTION("message holds its payload")
+    {
+        auto const m = message<std::string> { "hello" };
+
+        REQUIRE(m.get() == "hello");
+        REQUIRE(*m == "hello");
+        REQUIRE(m->size() == 5);
+    }
+
+    SECTION("make_message constructs the payload in place")
+    {
+        auto copies = 0;
+        auto const m = make_message<counted>(5, copies);
+
+        REQUIRE(m->value == 5);
+        REQUIRE(copies == 0);
+    }
+
+    SECTION("moved payload is not copied")
+    {
+        auto copies = 0;
+        auto const m = message<counted> { counted { 1, copies } };
+
+        REQUIRE(copies == 0);
+    }
+
+    SECTION("copies share the payload")
+    {
+        auto copies = 0;
+        auto const m1 = make_message<counted>(1, copies);
+        auto const m2 = m1;
+
+        REQUIRE(&m1.get() == &m2.get());
+        REQUIRE(m1.use_count() == 2);
+        REQUIRE(copies == 0);
+    }
+
+    SECTION("message can share an existing buffer")
+    {
+        auto const data = std::make_shared<std::string const>("shared");
+        auto const m = message<std::string> { data };
+
+        REQUIRE(&m.get() == data.get());
+    }
+
+    SECTION("messages with equal payloads are equal")
+    {
+        REQUIRE(message<int> { 1 } == message<int> { 1 });
+        REQUIRE(message<int> { 1 } != message<int> { 2 });
+    }
+}
+
+TEST_CASE("message/notification", "[message]")
+{
+    SECTION("observers receive the payload without copies")
+    {
+        auto copies = 0;
+        auto s = subject<void(message<counted> const &)> { };
+        auto total = 0;
+
+        for(auto i = 0; i < 10; ++i)
+            s.subscribe([&](counted const & c) { total += c.value; }).release();
+
+        s.notify(counted { 3, copies });
+
+        REQUIRE(total == 30);
+        REQUIRE(copies == 0);
+    }
+
+    SECTION("observers can take the message itself")
+    {
+        auto s = subject<void(message<std::string> const &)> { };
+        std::string const * seen = nullptr;
+        long count = 0;
+
+        auto const sub = s.subscribe([&](message<std::string> const & m) {
+            seen = &m.get();
+            count = m.use_count();
+        });
+
+        auto const m = message<std::string> { "text" };
+        s.notify(m);
+
+        REQUIRE(seen == &m.get());
+        REQUIRE(count == 1);
+    }
+
+    SECTION("kept messages outlive the notification")
+    {
+        auto s = subject<void(message<std::string> const &)> { };
+        std::vector<message<std::string>> kept;
+
+        auto const sub = s.subscribe([&](message<std::string> const & m) {
+            kept.push_back(m);
+        });
+
+        s.notify(std::string(100, 'x'));
+
+        REQUIRE(kept.size() == 1);
+        REQUIRE(kept.front().get() == std::string(100, 'x'));
+        REQUIRE(kept.front().use_count() == 1);
+    }
+
+    SECTION("asynchronous observers see the same payload")
+    {
+        auto copies = 0;
+        std::vector<async_task> tasks;
+        auto const executor = [&](async_task t) { tasks.push_back(std::move(t)); };
+
+        auto s = async_subject<void(message<counted> const &)> { };
+        std::vector<counted const *> seen;
+
+        for(auto i = 0; i < 2; ++i)
+            s.subscribe(executor, [&](message<counted> const & m) {
+                seen.push_back(&m.get());
+            }).release();
+
+        s.notify(counted { 1, copies });
+
+        for(auto && t : tasks)
+            t();
+
+        REQUIRE(seen.size() == 2);
+        REQUIRE(seen[0] == seen[1]);
+        REQUIRE(copies == 0);
+    }
+
+    SECTION("values can hold messages")
+    {
+        auto v = value<message<std::string>> { std::string { "a" } };
+        auto calls = 0;
+        auto const sub = v.subscribe([&](std::string const &) { ++calls; });
+
+        v = std::string { "a" };
+        REQUIRE(calls == 0);
+
+        v = std::string { "b" };
+        REQUIRE(calls == 1);
+        REQUIRE(v.get().get() == "b");
+    }
+}
+
+} }
@@ -1,4 +1,10 @@
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
 #include <catch/catch.hpp>
+#include <observable/batch.hpp>
+#include <observable/expressions/filters.hpp>
 #include <observable/observe.hpp>
 #include <observable/value.hpp>
 
@@ -34,6 +40,16 @@ TEST_CASE("observe/single value evaluation", "[observe]")
         REQUIRE(result.get() == 7);
     }
 
+    SECTION("single-threaded values can be used in expressions")
+    {
+        auto a = value<int, single_threaded_subject_policy> { 1 };
+        auto b = value<int, single_threaded_subject_policy> { 2 };
+        auto const result = observe(a + b);
+        a = 5;
+
+        REQUIRE(result.get() == 7);
+    }
+
     SECTION("single value with manual update")
     {
         auto test_updater = updater { };
@@ -247,4 +263,634 @@ TEST_CASE("observe/expssion works after everything gets moved", "[observe]")
     REQUIRE(r.get() == Approx { (10 + 30) / 2.0 });
 }
 
+namespace {
+
+auto eval_count = 0;
+
+struct count_evals
+{
+    auto operator()(int x) const { ++eval_count; return x; }
+};
+
+OBSERVABLE_ADAPT_FILTER(counted, count_evals { })
+
+}
+
+TEST_CASE("observe/glitch-free propagation", "[observe]")
+{
+    SECTION("diamond expression is evaluated once per change")
+    {
+        auto a = value<int> { 3 };
+        auto b = value<int> { 1 };
+        auto result = observe(counted((a + b) * (a - b)));
+        eval_count = 0;
+
+        a = 5;
+
+        REQUIRE(eval_count == 1);
+        REQUIRE(result.get() == 24);
+    }
+
+    SECTION("observers only see consistent results")
+    {
+        auto a = value<int> { 3 };
+        auto b = value<int> { 1 };
+        auto result = observe((a + b) * (a - b));
+
+        std::vector<int> seen;
+        result.subscribe([&](int v) { seen.push_back(v); }).release();
+
+        a = 5;
+        a = 2;
+
+        REQUIRE(seen == (std::vector<int> { 24, 3 }));
+    }
+
+    SECTION("expression depending on another expression is evaluated last")
+    {
+        auto a = value<int> { 1 };
+        auto doubled = observe(a * 2);
+        auto sum = observe(doubled + a);
+
+        std::vector<int> seen;
+        sum.subscribe([&](int v) { seen.push_back(v); }).release();
+
+        a = 2;
+
+        REQUIRE(seen == (std::vector<int> { 6 }));
+    }
+
+    SECTION("values changed in a batch are propagated together")
+    {
+        auto a = value<int> { 1 };
+        auto b = value<int> { 1 };
+        auto result = observe(a + b);
+
+        std::vector<int> seen;
+        result.subscribe([&](int v) { seen.push_back(v); }).release();
+
+        {
+            batch bt;
+            a = 2;
+            b = 3;
+        }
+
+        REQUIRE(seen == (std::vector<int> { 5 }));
+    }
+}
+
+TEST_CASE("observe/parallel updater", "[observe]")
+{
+    SECTION("parallel updater updates all values")
+    {
+        auto ud = parallel_updater { 4 };
+        auto vals = std::vector<value<int>>(50);
+        auto results = std::vector<value<int>> { };
+
+        for(auto && v : vals)
+            results.push_back(observe(ud, v * 2 + 1));
+
+        for(auto i = 0u; i < vals.size(); ++i)
+            vals[i] = static_cast<int>(i);
+
+        ud.update_all();
+
+        for(auto i = 0u; i < vals.size(); ++i)
+            REQUIRE(results[i].get() == static_cast<int>(i) * 2 + 1);
+    }
+
+    SECTION("values are updated in registration order")
+    {
+        auto ud = parallel_updater { 4 };
+        auto a = value<int> { 0 };
+        auto order = std::vector<int> { };
+        auto results = std::vector<value<int>> { };
+        auto subs = std::vector<unique_subscription> { };
+
+        for(auto i = 0; i < 20; ++i)
+        {
+            results.push_back(observe(ud, a + i));
+            subs.emplace_back(results.back().subscribe([&, i]() {
+                order.push_back(i);
+            }));
+        }
+
+        a = 1;
+        ud.update_all();
+
+        for(auto i = 0; i < 20; ++i)
+            REQUIRE(order[i] == i);
+    }
+
+    SECTION("dependent expressions see updated values")
+    {
+        auto ud = parallel_updater { 4 };
+        auto a = value<int> { 1 };
+        auto b = observe(ud, a * 2);
+        auto c = observe(ud, b + 1);
+
+        a = 5;
+        ud.update_all();
+
+        REQUIRE(b.get() == 10);
+        REQUIRE(c.get() == 11);
+    }
+
+    SECTION("shared nodes are evaluated once")
+    {
+        auto ud = parallel_updater { 4 };
+        auto a = value<int> { 1 };
+        std::atomic<int> evals { 0 };
+        auto shared = expr::expr_detail::make_node([&](int x) {
+                                                       ++evals;
+                                                       return x * 10;
+                                                   },
+                                                   a);
+        evals = 0;
+
+        auto results = std::vector<value<int>> { };
+        for(auto i = 0; i < 16; ++i)
+        {
+            auto copy = shared;
+            results.push_back(observe(ud, std::move(copy) + i));
+        }
+
+        a = 2;
+        ud.update_all();
+
+        REQUIRE(evals.load() == 1);
+        for(auto i = 0; i < 16; ++i)
+            REQUIRE(results[i].get() == 20 + i);
+    }
+
+    SECTION("fused expressions can be updated in parallel")
+    {
+        auto ud = parallel_updater { 4 };
+        auto a = value<int> { 1 };
+        auto r1 = observe(ud, fuse(a) + 1);
+        auto r2 = observe(ud, fuse(a) * 3);
+
+        a = 4;
+        ud.update_all();
+
+        REQUIRE(r1.get() == 5);
+        REQUIRE(r2.get() == 12);
+    }
+}
+
+TEST_CASE("observe/incremental updater", "[observe]")
+{
+    SECTION("incremental updater updates changed values")
+    {
+        auto ud = incremental_updater { };
+        auto a = value<int> { 1 };
+        auto result = observe(ud, a * 2);
+
+        a = 5;
+        REQUIRE(result.get() == 2);
+
+        ud.update_all();
+        REQUIRE(result.get() == 10);
+    }
+
+    SECTION("unchanged expressions are not evaluated")
+    {
+        auto ud = incremental_updater { };
+        auto a = value<int> { 1 };
+        auto b = value<int> { 1 };
+        auto evals = 0;
+        auto result_a = observe(ud, expr::expr_detail::make_node([&](int x) {
+                                                                     ++evals;
+                                                                     return x;
+                                                                 },
+                                                                 a));
+        auto result_b = observe(ud, b + 1);
+        evals = 0;
+
+        b = 2;
+        ud.update_all();
+
+        REQUIRE(evals == 0);
+        REQUIRE(result_b.get() == 3);
+    }
+
+    SECTION("expression is evaluated once for multiple changes")
+    {
+        auto ud = incremental_updater { };
+        auto a = value<int> { 1 };
+        auto b = value<int> { 1 };
+        auto result = observe(ud, a + b);
+        auto calls = 0;
+        auto const sub = result.subscribe([&]() { ++calls; });
+
+        a = 2;
+        b = 3;
+        ud.update_all();
+
+        REQUIRE(result.get() == 5);
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("dependent expressions are updated by the same call")
+    {
+        auto ud = incremental_updater { };
+        auto a = value<int> { 1 };
+        auto b = observe(ud, a * 2);
+        auto c = observe(ud, b + 1);
+
+        a = 5;
+        ud.update_all();
+
+        REQUIRE(b.get() == 10);
+        REQUIRE(c.get() == 11);
+    }
+
+    SECTION("expression changed after an update is updated again")
+    {
+        auto ud = incremental_updater { };
+        auto a = value<int> { 1 };
+        auto result = observe(ud, a + 1);
+
+        a = 2;
+        ud.update_all();
+        a = 3;
+        ud.update_all();
+
+        REQUIRE(result.get() == 4);
+    }
+
+    SECTION("destroyed expressions are not evaluated")
+    {
+        auto ud = incremental_updater { };
+        auto a = value<int> { 1 };
+        auto result = std::make_unique<value<int>>(observe(ud, a + 1));
+
+        a = 2;
+        result.reset();
+
+        REQUIRE_NOTHROW(ud.update_all());
+    }
+
+    SECTION("fused expressions are tracked")
+    {
+        auto ud = incremental_updater { };
+        auto a = value<int> { 1 };
+        auto result = observe(ud, fuse(a) + 1);
+
+        a = 2;
+        ud.update_all();
+
+        REQUIRE(result.get() == 3);
+    }
+
+    SECTION("expressions can be changed from multiple threads")
+    {
+        auto ud = incremental_updater { };
+        auto vals = std::vector<value<int>>(8);
+        auto results = std::vector<value<int>> { };
+        for(auto && v : vals)
+            results.push_back(observe(ud, v + 1));
+
+        auto threads = std::vector<std::thread> { };
+        for(auto i = 0u; i < vals.size(); ++i)
+            threads.emplace_back([&, i]() { vals[i] = static_cast<int>(i); });
+
+        for(auto && t : threads)
+            t.join();
+
+        ud.update_all();
+
+        for(auto i = 0u; i < vals.size(); ++i)
+            REQUIRE(results[i].get() == static_cast<int>(i) + 1);
+    }
+
+    SECTION("base updater interface still updates all values")
+    {
+        auto ud = incremental_updater { };
+        auto a = value<int> { 1 };
+        auto result = observe(ud, a + 1);
+
+        a = 2;
+        static_cast<updater &>(ud).update_all();
+
+        REQUIRE(result.get() == 3);
+    }
+}
+
+TEST_CASE("observe/sharded updater", "[observe]")
+{
+    SECTION("sharded updater updates all values")
+    {
+        auto ud = sharded_updater { 4 };
+        auto a = value<int> { 1 };
+        auto results = std::vector<value<int>> { };
+        for(auto i = 0; i < 32; ++i)
+            results.push_back(observe(ud, a + i));
+
+        a = 10;
+        REQUIRE(results[3].get() == 4);
+
+        ud.update_all();
+        for(auto i = 0; i < 32; ++i)
+            REQUIRE(results[static_cast<std::size_t>(i)].get() == 10 + i);
+    }
+
+    SECTION("expressions are spread over the shards")
+    {
+        auto ud = sharded_updater { 4 };
+        auto a = value<int> { 1 };
+        auto results = std::vector<value<int>> { };
+        for(auto i = 0; i < 64; ++i)
+            results.push_back(observe(ud, a + i));
+
+        auto total = std::size_t { 0 };
+        auto used = 0;
+        for(auto i = std::size_t { 0 }; i < ud.shard_count(); ++i)
+        {
+            total += ud.shard_size(i);
+            used += ud.shard_size(i) > 0 ? 1 : 0;
+        }
+
+        REQUIRE(total == 64);
+        REQUIRE(used > 1);
+    }
+
+    SECTION("dependent expressions are updated in rank order")
+    {
+        auto ud = sharded_updater { 8 };
+        auto a = value<int> { 1 };
+        auto chain = std::vector<value<int>> { };
+        chain.push_back(observe(ud, a + 1));
+        for(auto i = 0; i < 16; ++i)
+            chain.push_back(observe(ud, chain.back() + 1));
+
+        a = 5;
+        ud.update_all();
+
+        REQUIRE(chain.back().get() == 5 + 17);
+    }
+
+    SECTION("single shards can be updated")
+    {
+        auto ud = sharded_updater { 2 };
+        auto a = value<int> { 1 };
+        auto results = std::vector<value<int>> { };
+        for(auto i = 0; i < 16; ++i)
+            results.push_back(observe(ud, a * 2));
+
+        a = 3;
+        ud.update_shard(0);
+
+        auto updated = std::size_t { 0 };
+        for(auto && r : results)
+            updated += r.get() == 6 ? 1 : 0;
+
+        REQUIRE(updated == ud.shard_size(0));
+    }
+
+    SECTION("destroyed expressions are not evaluated")
+    {
+        auto ud = sharded_updater { };
+        auto a = value<int> { 1 };
+        auto result = std::make_unique<value<int>>(observe(ud, a + 1));
+
+        a = 2;
+        result.reset();
+
+        REQUIRE_NOTHROW(ud.update_all());
+    }
+
+    SECTION("expressions can be destroyed by observers during an update")
+    {
+        auto ud = sharded_updater { 1 };
+        auto a = value<int> { 1 };
+        auto first = observe(ud, a + 1);
+        auto second = std::make_unique<value<int>>(observe(ud, a + 2));
+        auto const sub = first.subscribe([&]() { second.reset(); });
+
+        a = 2;
+        ud.update_all();
+
+        REQUIRE(first.get() == 3);
+        REQUIRE_FALSE(second);
+    }
+
+    SECTION("expressions can be created by observers during an update")
+    {
+        auto ud = sharded_updater { 1 };
+        auto a = value<int> { 1 };
+        auto first = observe(ud, a + 1);
+        auto created = std::vector<value<int>> { };
+        created.reserve(1);
+        auto const sub = first.subscribe([&]() {
+            created.push_back(observe(ud, a + 2));
+        });
+
+        a = 2;
+        ud.update_all();
+        REQUIRE(created.size() == 1);
+
+        a = 3;
+        ud.update_all();
+        REQUIRE(created.front().get() == 5);
+    }
+
+    SECTION("shards can be updated in parallel")
+    {
+        auto ud = sharded_updater { 4 };
+        auto vals = std::vector<value<int>>(64);
+        auto results = std::vector<value<int>> { };
+        for(auto && v : vals)
+            results.push_back(observe(ud, v + 1));
+
+        for(auto i = 0u; i < vals.size(); ++i)
+            vals[i] = static_cast<int>(i);
+
+        auto threads = std::vector<std::thread> { };
+        for(auto i = std::size_t { 0 }; i < ud.shard_count(); ++i)
+            threads.emplace_back([&, i]() { ud.update_shard(i); });
+
+        for(auto && t : threads)
+            t.join();
+
+        for(auto i = 0u; i < vals.size(); ++i)
+            REQUIRE(results[i].get() == static_cast<int>(i) + 1);
+    }
+
+    SECTION("expressions can be created and destroyed while updating")
+    {
+        auto ud = sharded_updater { 4 };
+        auto a = value<int> { 1 };
+        auto results = std::vector<value<int>> { };
+        for(auto i = 0; i < 16; ++i)
+            results.push_back(observe(ud, a + 1));
+
+        std::atomic<bool> done { false };
+        auto churn = std::thread { [&]() {
+            auto b = value<int> { 0 };
+            while(!done.load())
+                auto const r = observe(ud, b + 1);
+        } };
+
+        for(auto i = 0; i < 200; ++i)
+            ud.update_all();
+
+        done = true;
+        churn.join();
+
+        REQUIRE(results.front().get() == 2);
+    }
+
+    SECTION("instrumented sharded updater counts expressions")
+    {
+        auto ud = instrumented_updater<sharded_updater> { 2 };
+        auto a = value<int> { 1 };
+        auto r1 = observe(ud, a + 1);
+        auto r2 = observe(ud, a + 2);
+
+        ud.update_all();
+
+        REQUIRE(ud.instrumentation().stats().notifications == 1);
+        REQUIRE(ud.instrumentation().stats().observer_calls == 2);
+    }
+}
+
+TEST_CASE("observe/lazy evaluation", "[observe]")
+{
+    auto a = value<int> { 1 };
+    auto b = value<int> { 2 };
+    auto evals = 0;
+
+    auto const counted_sum = [&]() {
+        return expr::expression_node<int> {
+            [&](int x, int y) { ++evals; return x + y; },
+            expr::expression_node<int> { a },
+            expr::expression_node<int> { b }
+        };
+    };
+
+    SECTION("lazy value has the correct initial value")
+    {
+        auto result = observe_lazy(a + b);
+
+        REQUIRE(result.get() == 3);
+    }
+
+    SECTION("unobserved lazy value is not evaluated on change")
+    {
+        auto result = observe_lazy(counted_sum());
+        REQUIRE(result.get() == 3);
+        evals = 0;
+
+        a = 5;
+        b = 6;
+
+        REQUIRE(evals == 0);
+        REQUIRE(result.get() == 11);
+        REQUIRE(evals == 1);
+    }
+
+    SECTION("reading a fresh lazy value does not evaluate it")
+    {
+        auto result = observe_lazy(counted_sum());
+        result.get();
+        evals = 0;
+
+        result.get();
+        result.get();
+
+        REQUIRE(evals == 0);
+    }
+
+    SECTION("observed lazy value is updated immediately")
+    {
+        auto result = observe_lazy(counted_sum());
+        auto seen = 0;
+        auto const sub = result.subscribe([&](int v) { seen = v; });
+
+        a = 5;
+
+        REQUIRE(seen == 7);
+        REQUIRE(result.get() == 7);
+    }
+
+    SECTION("observers subscribed to a stale value are notified")
+    {
+        auto result = observe_lazy(a + b);
+        a = 5;
+
+        auto seen = 0;
+        auto const sub = result.subscribe([&](int v) { seen = v; });
+        REQUIRE(seen == 0);
+
+        b = 3;
+        REQUIRE(seen == 8);
+    }
+
+    SECTION("lazy value goes stale again after its observers are gone")
+    {
+        auto result = observe_lazy(counted_sum());
+        auto sub = result.subscribe([]() { });
+        sub.unsubscribe();
+        evals = 0;
+
+        a = 5;
+
+        REQUIRE(evals == 0);
+        REQUIRE(result.get() == 7);
+    }
+
+    SECTION("subscribe_and_call sees the fresh value")
+    {
+        auto result = observe_lazy(a + b);
+        a = 10;
+
+        auto seen = 0;
+        auto const sub = result.subscribe_and_call([&](int v) { seen = v; });
+
+        REQUIRE(seen == 12);
+    }
+
+    SECTION("builder does not evaluate the tree when it is built")
+    {
+        auto result = observe_lazy(counted_sum);
+
+        REQUIRE(evals == 0);
+        REQUIRE(result.get() == 3);
+        REQUIRE(evals == 1);
+    }
+
+    SECTION("lazy value can observe a single value")
+    {
+        auto result = observe_lazy(a);
+        a = 4;
+
+        REQUIRE(result.get() == 4);
+    }
+
+    SECTION("lazy values can be used inside other expressions")
+    {
+        auto inner = observe_lazy(a + b);
+        auto outer = observe(inner * 2);
+
+        a = 4;
+
+        REQUIRE(outer.get() == 12);
+    }
+
+    SECTION("moved lazy value is still evaluated")
+    {
+        auto result = observe_lazy(counted_sum());
+        auto moved = std::move(result);
+
+        a = 3;
+        REQUIRE(moved.get() == 5);
+
+        auto seen = 0;
+        auto const sub = moved.subscribe([&](int v) { seen = v; });
+        b = 3;
+        REQUIRE(seen == 6);
+    }
+}
+
 } }
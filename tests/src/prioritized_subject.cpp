@@ -0,0 +1,185 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/prioritized_subject.hpp>
+
+namespace observable { namespace test {
+
+TEST_CASE("prioritized_subject/ordering", "[prioritized_subject]")
+{
+    SECTION("new subject is empty")
+    {
+        auto const s = prioritized_subject<void()> { };
+
+        REQUIRE(s.empty());
+    }
+
+    SECTION("observers are called in priority order")
+    {
+        auto s = prioritized_subject<void(int)> { };
+        std::vector<std::string> calls;
+
+        auto const low = s.subscribe([&](int) { calls.push_back("low"); },
+                                     observer_priority::low);
+        auto const normal = s.subscribe([&](int) { calls.push_back("normal"); });
+        auto const high = s.subscribe([&](int) { calls.push_back("high"); },
+                                      observer_priority::high);
+
+        s.notify(1);
+
+        REQUIRE(calls == (std::vector<std::string> { "high", "normal", "low" }));
+    }
+
+    SECTION("all observers receive the arguments")
+    {
+        auto s = prioritized_subject<void(std::string)> { };
+        std::vector<std::string> values;
+
+        for(auto p : { observer_priority::high, observer_priority::normal,
+                       observer_priority::low })
+            s.subscribe([&](std::string const & v) { values.push_back(v); }, p).release();
+
+        s.notify("x");
+
+        REQUIRE(values == (std::vector<std::string> { "x", "x", "x" }));
+    }
+
+    SECTION("unsubscribed observers are not called")
+    {
+        auto s = prioritized_subject<void()> { };
+        auto calls = 0;
+
+        auto high = s.subscribe([&]() { ++calls; }, observer_priority::high);
+        auto low = s.subscribe([&]() { ++calls; }, observer_priority::low);
+        high.unsubscribe();
+        low.unsubscribe();
+
+        s.notify();
+
+        REQUIRE(calls == 0);
+        REQUIRE(s.empty());
+    }
+}
+
+TEST_CASE("prioritized_subject/budget", "[prioritized_subject]")
+{
+    SECTION("low priority observers run inline within the budget")
+    {
+        auto s = prioritized_subject<void()> { };
+        std::vector<async_task> deferred;
+        s.set_budget(std::chrono::hours { 1 },
+                     [&](async_task t) { deferred.push_back(std::move(t)); });
+
+        auto calls = 0;
+        auto const sub = s.subscribe([&]() { ++calls; }, observer_priority::low);
+
+        s.notify();
+
+        REQUIRE(calls == 1);
+        REQUIRE(deferred.empty());
+    }
+
+    SECTION("low priority observers are deferred once the budget is exceeded")
+    {
+        auto s = prioritized_subject<void(int)> { };
+        std::vector<async_task> deferred;
+        s.set_budget(std::chrono::milliseconds { 1 },
+                     [&](async_task t) { deferred.push_back(std::move(t)); });
+
+        auto high_calls = 0;
+        auto low_value = 0;
+        auto const slow = s.subscribe([&](int) {
+            ++high_calls;
+            std::this_thread::sleep_for(std::chrono::milliseconds { 5 });
+        }, observer_priority::high);
+        auto const low = s.subscribe([&](int v) { low_value = v; },
+                                     observer_priority::low);
+
+        s.notify(7);
+
+        REQUIRE(high_calls == 1);
+        REQUIRE(low_value == 0);
+        REQUIRE(deferred.size() == 1);
+
+        deferred.front()();
+        REQUIRE(low_value == 7);
+    }
+
+    SECTION("zero budget defers all low priority observers")
+    {
+        auto s = prioritized_subject<void()> { };
+        std::vector<async_task> deferred;
+        s.set_budget(std::chrono::nanoseconds { 0 },
+                     [&](async_task t) { deferred.push_back(std::move(t)); });
+
+        auto normal_calls = 0;
+        auto const normal = s.subscribe([&]() { ++normal_calls; });
+        auto const low1 = s.subscribe([]() { }, observer_priority::low);
+        auto const low2 = s.subscribe([]() { }, observer_priority::low);
+
+        s.notify();
+
+        REQUIRE(normal_calls == 1);
+        REQUIRE(deferred.size() == 2);
+    }
+
+    SECTION("deferred observers that have been unsubscribed are not called")
+    {
+        auto s = prioritized_subject<void()> { };
+        std::vector<async_task> deferred;
+        s.set_budget(std::chrono::nanoseconds { 0 },
+                     [&](async_task t) { deferred.push_back(std::move(t)); });
+
+        auto calls = 0;
+        auto low = s.subscribe([&]() { ++calls; }, observer_priority::low);
+        s.notify();
+        low.unsubscribe();
+
+        for(auto && t : deferred)
+            t();
+
+        REQUIRE(calls == 0);
+    }
+
+    SECTION("cleared budget runs all observers inline")
+    {
+        auto s = prioritized_subject<void()> { };
+        std::vector<async_task> deferred;
+        s.set_budget(std::chrono::nanoseconds { 0 },
+                     [&](async_task t) { deferred.push_back(std::move(t)); });
+        s.clear_budget();
+
+        auto calls = 0;
+        auto const low = s.subscribe([&]() { ++calls; }, observer_priority::low);
+        s.notify();
+
+        REQUIRE(calls == 1);
+        REQUIRE(deferred.empty());
+    }
+
+    SECTION("nested notifications keep their own budget")
+    {
+        auto outer = prioritized_subject<void()> { };
+        auto inner = prioritized_subject<void()> { };
+        std::vector<async_task> deferred;
+        outer.set_budget(std::chrono::hours { 1 },
+                         [&](async_task t) { deferred.push_back(std::move(t)); });
+        inner.set_budget(std::chrono::nanoseconds { 0 },
+                         [&](async_task t) { deferred.push_back(std::move(t)); });
+
+        auto calls = 0;
+        auto const o = outer.subscribe([&]() { inner.notify(); ++calls; },
+                                       observer_priority::low);
+        auto const o2 = outer.subscribe([&]() { ++calls; }, observer_priority::low);
+        auto const i = inner.subscribe([&]() { ++calls; }, observer_priority::low);
+
+        outer.notify();
+
+        REQUIRE(calls == 2);
+        REQUIRE(deferred.size() == 1);
+    }
+}
+
+} }
@@ -0,0 +1,271 @@
+#include <iterator>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/batch.hpp>
+#include <observable/property_column.hpp>
+
+namespace observable { namespace test {
+
+TEST_CASE("property_column/rows", "[property_column]")
+{
+    SECTION("new column is empty")
+    {
+        auto const c = property_column<int> { };
+
+        REQUIRE(c.empty());
+        REQUIRE(c.size() == 0);
+    }
+
+    SECTION("rows are stored contiguously")
+    {
+        auto c = property_column<int> { };
+        auto const r0 = c.push_back(1);
+        auto const r1 = c.push_back(2);
+
+        REQUIRE(r0 == 0);
+        REQUIRE(r1 == 1);
+        REQUIRE(c.data()[0] == 1);
+        REQUIRE(c.data()[1] == 2);
+        REQUIRE(c[1] == 2);
+        REQUIRE(c.get(0) == 1);
+    }
+
+    SECTION("can create column with initial rows")
+    {
+        auto const c = property_column<int> { std::vector<int> { 1, 2, 3 } };
+
+        REQUIRE(c.size() == 3);
+        REQUIRE(c[2] == 3);
+    }
+
+    SECTION("columns are not copyable")
+    {
+        REQUIRE_FALSE(std::is_copy_constructible<property_column<int>>::value);
+        REQUIRE_FALSE(std::is_copy_assignable<property_column<int>>::value);
+    }
+
+    SECTION("observers follow the moved column")
+    {
+        auto c = property_column<int> { std::vector<int> { 1 } };
+        auto seen = 0;
+        auto const sub = c.subscribe(0, [&](int v) { seen = v; });
+
+        auto moved = std::move(c);
+        moved.set(0, 5);
+
+        REQUIRE(seen == 5);
+    }
+
+    SECTION("batched changes follow the moved column")
+    {
+        auto c = property_column<int> { std::vector<int> { 1 } };
+        auto seen = 0;
+        auto const sub = c.subscribe(0, [&](int v) { seen = v; });
+
+        auto moved = property_column<int> { };
+        {
+            batch b;
+            c.set(0, 5);
+            moved = std::move(c);
+        }
+
+        REQUIRE(seen == 5);
+    }
+}
+
+TEST_CASE("property_column/notifications", "[property_column]")
+{
+    auto c = property_column<int> { std::vector<int> { 1, 2, 3, 4 } };
+
+    SECTION("column observers receive the changed row")
+    {
+        auto changes = std::vector<std::size_t> { };
+        auto const sub = c.subscribe([&](auto const & change) {
+            for(auto i = std::size_t { 0 }; i < c.size(); ++i)
+                if(change.contains(i))
+                    changes.push_back(i);
+        });
+
+        c.set(2, 10);
+
+        REQUIRE(changes == (std::vector<std::size_t> { 2 }));
+        REQUIRE(c[2] == 10);
+    }
+
+    SECTION("setting an equal value does not notify")
+    {
+        auto call_count = 0;
+        auto const sub = c.subscribe([&](auto const &) { ++call_count; });
+
+        c.set(0, 1);
+
+        REQUIRE(call_count == 0);
+    }
+
+    SECTION("row observers are only called for their row")
+    {
+        auto seen = 0;
+        auto call_count = 0;
+        auto const sub = c.subscribe(1, [&](int v) { seen = v; ++call_count; });
+
+        c.set(0, 7);
+        REQUIRE(call_count == 0);
+
+        c.set(1, 8);
+        REQUIRE(call_count == 1);
+        REQUIRE(seen == 8);
+    }
+
+    SECTION("row observers can take no arguments")
+    {
+        auto call_count = 0;
+        auto const sub = c.subscribe(3, [&]() { ++call_count; });
+
+        c.set(3, 5);
+
+        REQUIRE(call_count == 1);
+    }
+
+    SECTION("update modifies a row in place")
+    {
+        auto call_count = 0;
+        auto const sub = c.subscribe(0, [&]() { ++call_count; });
+
+        REQUIRE_FALSE(c.update(0, [](int &) { return false; }));
+        REQUIRE(call_count == 0);
+
+        REQUIRE(c.update(0, [](int & v) { v = 9; return true; }));
+        REQUIRE(call_count == 1);
+        REQUIRE(c[0] == 9);
+    }
+
+    SECTION("unsubscribed row observers are not called")
+    {
+        auto call_count = 0;
+        auto sub = c.subscribe(0, [&]() { ++call_count; });
+        sub.unsubscribe();
+
+        c.set(0, 5);
+
+        REQUIRE(call_count == 0);
+    }
+}
+
+TEST_CASE("property_column/bulk updates", "[property_column]")
+{
+    auto c = property_column<int> { std::vector<int> { 1, 2, 3, 4 } };
+
+    SECTION("transform updates every row with one notification")
+    {
+        auto call_count = 0;
+        auto const sub = c.subscribe([&](auto const & change) {
+            ++call_count;
+            REQUIRE(change.first == 0);
+            REQUIRE(change.count == 4);
+            REQUIRE(change.rows == nullptr);
+        });
+
+        c.transform([](int v) { return v * 10; });
+
+        REQUIRE(call_count == 1);
+        REQUIRE(c[3] == 40);
+    }
+
+    SECTION("transform notifies every row observer")
+    {
+        auto sum = 0;
+        std::vector<infinite_subscription> subs;
+        for(auto i = std::size_t { 0 }; i < c.size(); ++i)
+            subs.push_back(c.subscribe(i, [&](int v) { sum += v; }));
+
+        c.transform([](int v) { return v + 1; });
+
+        REQUIRE(sum == 2 + 3 + 4 + 5);
+
+        for(auto && s : subs)
+            s.unsubscribe();
+    }
+
+    SECTION("transform can update a range of rows")
+    {
+        auto row0 = 0;
+        auto row2 = 0;
+        auto const s0 = c.subscribe(0, [&]() { ++row0; });
+        auto const s2 = c.subscribe(2, [&]() { ++row2; });
+
+        c.transform(1, 2, [](int v) { return -v; });
+
+        REQUIRE(row0 == 0);
+        REQUIRE(row2 == 1);
+        REQUIRE(c[1] == -2);
+        REQUIRE(c[2] == -3);
+        REQUIRE(c[3] == 4);
+    }
+
+    SECTION("assign overwrites rows")
+    {
+        auto call_count = 0;
+        auto const sub = c.subscribe([&](auto const &) { ++call_count; });
+
+        auto const v = std::vector<int> { 7, 8 };
+        c.assign(2, v.begin(), v.end());
+
+        REQUIRE(call_count == 1);
+        REQUIRE(c[2] == 7);
+        REQUIRE(c[3] == 8);
+    }
+
+    SECTION("assign accepts single-pass ranges")
+    {
+        auto in = std::istringstream { "7 8" };
+        c.assign(2, std::istream_iterator<int> { in }, std::istream_iterator<int> { });
+
+        REQUIRE(c[1] == 2);
+        REQUIRE(c[2] == 7);
+        REQUIRE(c[3] == 8);
+    }
+
+    SECTION("batches deliver all row changes in one notification")
+    {
+        auto call_count = 0;
+        auto changed = std::vector<std::size_t> { };
+        auto const sub = c.subscribe([&](auto const & change) {
+            ++call_count;
+            for(auto i = std::size_t { 0 }; i < c.size(); ++i)
+                if(change.contains(i))
+                    changed.push_back(i);
+        });
+
+        {
+            batch b;
+            c.set(3, 30);
+            c.set(1, 10);
+            c.set(3, 31);
+            REQUIRE(call_count == 0);
+        }
+
+        REQUIRE(call_count == 1);
+        REQUIRE(changed == (std::vector<std::size_t> { 1, 3 }));
+    }
+
+    SECTION("batches merge row changes with bulk changes")
+    {
+        auto call_count = 0;
+        auto row3 = 0;
+        auto const sub = c.subscribe([&](auto const &) { ++call_count; });
+        auto const s3 = c.subscribe(3, [&](int v) { row3 = v; });
+
+        {
+            batch b;
+            c.transform(0, 2, [](int v) { return v * 2; });
+            c.set(3, 40);
+        }
+
+        REQUIRE(call_count == 1);
+        REQUIRE(row3 == 40);
+    }
+}
+
+} }
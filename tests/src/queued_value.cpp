@@ -0,0 +1,125 @@
+#include <thread>
+#include <utility>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/observe.hpp>
+#include <observable/queued_value.hpp>
+
+namespace observable { namespace test {
+
+TEST_CASE("queued_value/draining", "[queued_value]")
+{
+    SECTION("queued value has the initial value")
+    {
+        auto v = queued_value<int> { 4, 5 };
+
+        REQUIRE(v.get() == 5);
+    }
+
+    SECTION("pushed values are not applied before drain()")
+    {
+        auto v = queued_value<int> { 4, 5 };
+        v.push(6);
+
+        REQUIRE(v.get() == 5);
+    }
+
+    SECTION("drain() applies all pushed values")
+    {
+        auto v = queued_value<int> { 4 };
+        v.push(1);
+        v.push(2);
+
+        REQUIRE(v.drain() == 2);
+        REQUIRE(v.get() == 2);
+    }
+
+    SECTION("push() fails if the queue is full")
+    {
+        auto v = queued_value<int> { 2 };
+
+        REQUIRE(v.push(1));
+        REQUIRE(v.push(2));
+        REQUIRE_FALSE(v.push(3));
+    }
+
+    SECTION("observers are called for every drained value, in order")
+    {
+        auto v = queued_value<int> { 4 };
+        std::vector<int> seen;
+        auto const sub = v.output().subscribe([&](int x) { seen.push_back(x); });
+
+        v.push(1);
+        v.push(2);
+        v.push(3);
+        v.drain();
+
+        REQUIRE(seen == (std::vector<int> { 1, 2, 3 }));
+    }
+
+    SECTION("equal values do not notify observers")
+    {
+        auto v = queued_value<int> { 4, 1 };
+        auto calls = 0;
+        auto const sub = v.output().subscribe([&]() { ++calls; });
+
+        v.push(1);
+        v.push(2);
+        v.push(2);
+        v.drain();
+
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("output can be used in expressions")
+    {
+        auto v = queued_value<int> { 4, 1 };
+        auto doubled = observe(v.output() * 2);
+
+        v.push(5);
+        v.drain();
+
+        REQUIRE(doubled.get() == 10);
+    }
+
+    SECTION("queued value can be moved")
+    {
+        auto v = queued_value<int> { 4 };
+        v.push(3);
+
+        auto moved = std::move(v);
+        moved.drain();
+
+        REQUIRE(moved.get() == 3);
+    }
+}
+
+TEST_CASE("queued_value/threads", "[queued_value]")
+{
+    SECTION("values pushed from another thread are observed in order")
+    {
+        auto v = queued_value<int> { 8 };
+        auto const count = 1000;
+        auto last = 0;
+        auto ordered = true;
+        auto const sub = v.output().subscribe([&](int x) {
+            ordered = ordered && x == last + 1;
+            last = x;
+        });
+
+        auto producer = std::thread { [&]() {
+            for(auto i = 1; i <= count; ++i)
+                while(!v.push(i))
+                    std::this_thread::yield();
+        } };
+
+        while(last < count)
+            if(v.drain() == 0)
+                std::this_thread::yield();
+
+        producer.join();
+        REQUIRE(ordered);
+    }
+}
+
+} }
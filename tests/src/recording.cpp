@@ -0,0 +1,414 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include <unistd.h>
+#include <catch/catch.hpp>
+#include <observable/recording.hpp>
+#include <observable/subject.hpp>
+#include <observable/value.hpp>
+
+namespace observable {
+
+namespace test { namespace {
+
+struct quote
+{
+    double bid;
+    double ask;
+};
+
+struct tag
+{
+    std::string text;
+};
+
+} }
+
+//! Serializer that stores tags in upper case, to check that it is used.
+template <>
+struct serializer<test::tag>
+{
+    static auto size(test::tag const & t) noexcept -> std::size_t
+    {
+        return t.text.size();
+    }
+
+    static void write(test::tag const & t, char * out) noexcept
+    {
+        for(auto c : t.text)
+            *out++ = static_cast<char>(c - 'a' + 'A');
+    }
+
+    static auto read(char const * in, std::size_t size) -> test::tag
+    {
+        return test::tag { std::string(in, size) };
+    }
+};
+
+namespace test {
+
+namespace {
+
+//! Path of a recording file that is removed at the end of the test.
+struct temp_file
+{
+    explicit temp_file(char const * suffix) :
+        path { "observable_test_" + std::to_string(::getpid()) + "_" + suffix + ".rec" }
+    { }
+
+    ~temp_file() { std::remove(path.c_str()); }
+
+    std::string path;
+};
+
+auto file_size(std::string const & path)
+{
+    std::ifstream f { path, std::ios::binary | std::ios::ate };
+    return static_cast<std::size_t>(f.tellg());
+}
+
+}
+
+TEST_CASE("recording/values", "[recording]")
+{
+    SECTION("value changes are replayed")
+    {
+        temp_file const file { "values" };
+        {
+            auto v = value<int> { 1 };
+            auto rec = recorder { file.path, 4096 };
+            rec.record(v, 7);
+
+            v = 2;
+            v = 3;
+        }
+
+        auto v = value<int> { 0 };
+        auto seen = std::vector<int> { };
+        auto const sub = v.subscribe([&](int x) { seen.push_back(x); });
+
+        auto rep = replayer { file.path };
+        rep.bind(7, v);
+
+        REQUIRE(rep.replay(replay_rate::maximum) == 3);
+        REQUIRE(seen == (std::vector<int> { 1, 2, 3 }));
+    }
+
+    SECTION("trivially copyable structs are recorded")
+    {
+        temp_file const file { "structs" };
+        {
+            auto v = value<quote> { quote { 1.5, 2.5 } };
+            auto rec = recorder { file.path, 4096 };
+            rec.record(v, 1);
+        }
+
+        auto v = value<quote> { };
+        auto rep = replayer { file.path };
+        rep.bind(1, v);
+        rep.replay(replay_rate::maximum);
+
+        REQUIRE(v.get().bid == 1.5);
+        REQUIRE(v.get().ask == 2.5);
+    }
+
+    SECTION("strings are recorded")
+    {
+        temp_file const file { "strings" };
+        {
+            auto v = value<std::string> { "" };
+            auto rec = recorder { file.path, 4096 };
+            rec.record(v, 1);
+
+            v = "hello";
+        }
+
+        auto v = value<std::string> { "x" };
+        auto rep = replayer { file.path };
+        rep.bind(1, v);
+        rep.replay(replay_rate::maximum);
+
+        REQUIRE(v.get() == "hello");
+    }
+
+    SECTION("custom serializers are used")
+    {
+        temp_file const file { "custom" };
+        {
+            auto s = subject<void(tag)> { };
+            auto rec = recorder { file.path, 4096 };
+            rec.record(s, 1);
+
+            s.notify(tag { "abc" });
+        }
+
+        auto s = subject<void(tag const &)> { };
+        auto seen = std::string { };
+        auto const sub = s.subscribe([&](tag const & t) { seen = t.text; });
+
+        auto rep = replayer { file.path };
+        rep.bind(1, s);
+        rep.replay(replay_rate::maximum);
+
+        REQUIRE(seen == "ABC");
+    }
+}
+
+TEST_CASE("recording/subjects", "[recording]")
+{
+    SECTION("all arguments are replayed, in order")
+    {
+        temp_file const file { "arguments" };
+        {
+            auto s = subject<void(int, std::string const &, double)> { };
+            auto rec = recorder { file.path, 4096 };
+            rec.record(s, 1);
+
+            s.notify(1, "one", 1.5);
+            s.notify(2, "two", 2.5);
+        }
+
+        auto s = subject<void(int, std::string, double)> { };
+        auto seen = std::vector<std::tuple<int, std::string, double>> { };
+        auto const sub = s.subscribe([&](int i, std::string t, double d) {
+            seen.emplace_back(i, t, d);
+        });
+
+        auto rep = replayer { file.path };
+        rep.bind(1, s);
+        rep.replay(replay_rate::maximum);
+
+        REQUIRE(seen == (std::vector<std::tuple<int, std::string, double>> {
+                            std::make_tuple(1, "one", 1.5),
+                            std::make_tuple(2, "two", 2.5) }));
+    }
+
+    SECTION("subjects without arguments are replayed")
+    {
+        temp_file const file { "void" };
+        {
+            auto s = subject<void()> { };
+            auto rec = recorder { file.path, 4096 };
+            rec.record(s, 1);
+
+            s.notify();
+            s.notify();
+        }
+
+        auto s = subject<void()> { };
+        auto call_count = 0;
+        auto const sub = s.subscribe([&]() { ++call_count; });
+
+        auto rep = replayer { file.path };
+        rep.bind(1, s);
+        rep.replay(replay_rate::maximum);
+
+        REQUIRE(call_count == 2);
+    }
+
+    SECTION("channels are replayed in recording order")
+    {
+        temp_file const file { "channels" };
+        {
+            auto a = subject<void(int)> { };
+            auto b = subject<void(int)> { };
+            auto rec = recorder { file.path, 4096 };
+            rec.record(a, 1);
+            rec.record(b, 2);
+
+            a.notify(1);
+            b.notify(2);
+            a.notify(3);
+        }
+
+        auto s = subject<void(int)> { };
+        auto seen = std::vector<int> { };
+        auto const sub = s.subscribe([&](int x) { seen.push_back(x); });
+
+        auto rep = replayer { file.path };
+        rep.bind(1, s);
+        rep.bind(2, s);
+        rep.replay(replay_rate::maximum);
+
+        REQUIRE(seen == (std::vector<int> { 1, 2, 3 }));
+    }
+
+    SECTION("unbound channels are skipped")
+    {
+        temp_file const file { "unbound" };
+        {
+            auto a = subject<void(int)> { };
+            auto b = subject<void(int)> { };
+            auto rec = recorder { file.path, 4096 };
+            rec.record(a, 1);
+            rec.record(b, 2);
+
+            a.notify(1);
+            b.notify(2);
+        }
+
+        auto s = subject<void(int)> { };
+        auto seen = std::vector<int> { };
+        auto const sub = s.subscribe([&](int x) { seen.push_back(x); });
+
+        auto rep = replayer { file.path };
+        rep.bind(2, s);
+
+        REQUIRE(rep.replay(replay_rate::maximum) == 1);
+        REQUIRE(seen == (std::vector<int> { 2 }));
+
+        rep.unbind(2);
+        REQUIRE(rep.replay(replay_rate::maximum) == 0);
+    }
+
+    SECTION("notifications from multiple threads are recorded")
+    {
+        temp_file const file { "threads" };
+        {
+            auto s = subject<void(int)> { };
+            auto rec = recorder { file.path, 1 << 20 };
+            rec.record(s, 1);
+
+            auto threads = std::vector<std::thread> { };
+            for(auto t = 0; t < 4; ++t)
+                threads.emplace_back([&]() {
+                    for(auto i = 1; i <= 1000; ++i)
+                        s.notify(i);
+                });
+
+            for(auto && t : threads)
+                t.join();
+
+            REQUIRE(rec.dropped() == 0);
+        }
+
+        auto s = subject<void(int)> { };
+        auto total = 0L;
+        auto const sub = s.subscribe([&](int x) { total += x; });
+
+        auto rep = replayer { file.path };
+        rep.bind(1, s);
+
+        REQUIRE(rep.replay(replay_rate::maximum) == 4000);
+        REQUIRE(total == 4 * 500500L);
+    }
+}
+
+TEST_CASE("recording/file", "[recording]")
+{
+    SECTION("notifications that do not fit are dropped")
+    {
+        temp_file const file { "full" };
+        {
+            auto s = subject<void(int)> { };
+            auto rec = recorder { file.path, 8 + 2 * 24 };
+            rec.record(s, 1);
+
+            s.notify(1);
+            s.notify(2);
+            s.notify(3);
+
+            REQUIRE(rec.dropped() == 1);
+        }
+
+        auto rep = replayer { file.path };
+        auto s = subject<void(int)> { };
+        rep.bind(1, s);
+
+        REQUIRE(rep.replay(replay_rate::maximum) == 2);
+    }
+
+    SECTION("file is truncated to the recorded size")
+    {
+        temp_file const file { "truncated" };
+        auto size = std::size_t { 0 };
+        {
+            auto s = subject<void(int)> { };
+            auto rec = recorder { file.path, 1 << 20 };
+            rec.record(s, 1);
+
+            s.notify(1);
+            size = rec.size();
+        }
+
+        REQUIRE(size == 8 + 24);
+        REQUIRE(file_size(file.path) == size);
+    }
+
+    SECTION("recording stops when the recorder is destroyed")
+    {
+        temp_file const file { "stopped" };
+        auto s = subject<void(int)> { };
+        {
+            auto rec = recorder { file.path, 4096 };
+            rec.record(s, 1);
+            s.notify(1);
+        }
+
+        REQUIRE(s.empty());
+    }
+
+    SECTION("missing file throws")
+    {
+        REQUIRE_THROWS_AS(replayer { "observable_test_missing.rec" }, std::system_error);
+    }
+
+    SECTION("other files throw")
+    {
+        temp_file const file { "other" };
+        {
+            std::ofstream f { file.path, std::ios::binary };
+            f << "not a recording";
+        }
+
+        REQUIRE_THROWS_AS(replayer { file.path }, std::runtime_error);
+    }
+}
+
+TEST_CASE("recording/rate", "[recording]")
+{
+    temp_file const file { "rate" };
+    {
+        auto s = subject<void(int)> { };
+        auto rec = recorder { file.path, 4096 };
+        rec.record(s, 1);
+
+        s.notify(1);
+        std::this_thread::sleep_for(std::chrono::milliseconds { 20 });
+        s.notify(2);
+    }
+
+    auto s = subject<void(int)> { };
+    auto times = std::vector<std::chrono::steady_clock::time_point> { };
+    auto const sub = s.subscribe([&](int) {
+        times.push_back(std::chrono::steady_clock::now());
+    });
+
+    auto rep = replayer { file.path };
+    rep.bind(1, s);
+
+    SECTION("original rate keeps the recorded delays")
+    {
+        rep.replay(replay_rate::original);
+
+        REQUIRE(times.size() == 2);
+        REQUIRE(times[1] - times[0] >= std::chrono::milliseconds { 20 });
+    }
+
+    SECTION("maximum rate does not wait")
+    {
+        rep.replay(replay_rate::maximum);
+
+        REQUIRE(times.size() == 2);
+        REQUIRE(times[1] - times[0] < std::chrono::milliseconds { 20 });
+    }
+}
+
+} }
@@ -0,0 +1,411 @@
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/observe.hpp>
+#include <observable/replication.hpp>
+#include <observable/value.hpp>
+
+namespace observable { namespace test {
+
+namespace {
+
+//! Packets sent by a publisher.
+struct network
+{
+    auto sink()
+    {
+        return [this](char const * data, std::size_t size) {
+            packets.emplace_back(data, data + size);
+        };
+    }
+
+    void deliver_to(replication_subscriber & sub)
+    {
+        for(auto && p : packets)
+            sub.apply(p.data(), p.size());
+
+        packets.clear();
+    }
+
+    std::vector<std::vector<char>> packets;
+};
+
+}
+
+TEST_CASE("replication/ticks", "[replication]")
+{
+    SECTION("initial values are sent by the first tick")
+    {
+        auto net = network { };
+        replication_publisher pub { net.sink() };
+        auto a = value<int> { 5 };
+        pub.publish(a, 1);
+
+        REQUIRE(pub.tick() == 1);
+        REQUIRE(pub.sequence() == 1);
+
+        auto sub = replication_subscriber { };
+        net.deliver_to(sub);
+
+        auto r = sub.get<int>(1);
+        auto v = 0;
+        REQUIRE(r.read(v) == 1);
+        REQUIRE(v == 5);
+    }
+
+    SECTION("nothing is sent if nothing changed")
+    {
+        auto net = network { };
+        replication_publisher pub { net.sink() };
+        auto a = value<int> { 5 };
+        pub.publish(a, 1);
+        pub.tick();
+
+        REQUIRE(pub.tick() == 0);
+        REQUIRE(pub.sequence() == 1);
+    }
+
+    SECTION("changes are coalesced per tick")
+    {
+        auto net = network { };
+        replication_publisher pub { net.sink() };
+        auto a = value<int> { 1 };
+        auto b = value<std::string> { "x" };
+        pub.publish(a, 1);
+        pub.publish(b, 2);
+
+        auto sub = replication_subscriber { };
+        pub.tick();
+        net.deliver_to(sub);
+
+        a = 2;
+        a = 3;
+        pub.tick();
+
+        REQUIRE(net.packets.size() == 1);
+        net.deliver_to(sub);
+
+        auto v = 0;
+        sub.get<int>(1).read(v);
+        REQUIRE(v == 3);
+        REQUIRE(sub.get<int>(1).version() == 2);
+        REQUIRE(sub.get<std::string>(2).version() == 1);
+    }
+
+    SECTION("only changed values are sent")
+    {
+        auto net = network { };
+        replication_publisher pub { net.sink() };
+        auto a = value<int> { 1 };
+        auto b = value<int> { 2 };
+        pub.publish(a, 1);
+        pub.publish(b, 2);
+        pub.tick();
+        auto const full = net.packets.back().size();
+
+        b = 3;
+        pub.tick();
+
+        REQUIRE(net.packets.back().size() < full);
+    }
+
+    SECTION("packets are split to stay under the maximum size")
+    {
+        auto net = network { };
+        replication_publisher pub { net.sink(), 16 + 2 * (8 + 4) };
+        auto values = std::vector<value<int>>(5);
+        for(auto i = 0u; i < values.size(); ++i)
+            pub.publish(values[i], i);
+
+        REQUIRE(pub.tick() == 3);
+        REQUIRE(pub.sequence() == 3);
+        for(auto && p : net.packets)
+            REQUIRE(p.size() <= 16 + 2 * (8 + 4));
+
+        auto sub = replication_subscriber { };
+        net.deliver_to(sub);
+
+        REQUIRE_FALSE(sub.needs_snapshot());
+        for(auto i = 0u; i < values.size(); ++i)
+            REQUIRE(sub.get<int>(i).version() == 1);
+    }
+
+    SECTION("large values are sent in their own packet")
+    {
+        auto net = network { };
+        replication_publisher pub { net.sink(), 32 };
+        auto a = value<std::string> { std::string(100, 'a') };
+        pub.publish(a, 1);
+
+        REQUIRE(pub.tick() == 1);
+
+        auto sub = replication_subscriber { };
+        net.deliver_to(sub);
+
+        auto v = std::string { };
+        sub.get<std::string>(1).read(v);
+        REQUIRE(v == std::string(100, 'a'));
+    }
+
+    SECTION("destroyed values stop being replicated")
+    {
+        auto net = network { };
+        replication_publisher pub { net.sink() };
+        {
+            auto a = value<int> { 1 };
+            pub.publish(a, 1);
+        }
+
+        REQUIRE(pub.tick() == 1);
+        REQUIRE(pub.tick() == 0);
+    }
+}
+
+TEST_CASE("replication/snapshots", "[replication]")
+{
+    SECTION("late joiners get all values")
+    {
+        auto net = network { };
+        replication_publisher pub { net.sink() };
+        auto a = value<int> { 1 };
+        auto b = value<int> { 2 };
+        pub.publish(a, 1);
+        pub.publish(b, 2);
+        pub.tick();
+        net.packets.clear();
+
+        a = 3;
+        pub.tick();
+
+        auto sub = replication_subscriber { };
+        net.deliver_to(sub);
+        REQUIRE(sub.needs_snapshot());
+
+        auto snapshot = network { };
+        REQUIRE(pub.snapshot(snapshot.sink()) == 1);
+        snapshot.deliver_to(sub);
+
+        REQUIRE_FALSE(sub.needs_snapshot());
+
+        auto v = 0;
+        sub.get<int>(1).read(v);
+        REQUIRE(v == 3);
+        sub.get<int>(2).read(v);
+        REQUIRE(v == 2);
+    }
+
+    SECTION("snapshots do not consume sequence numbers")
+    {
+        auto net = network { };
+        replication_publisher pub { net.sink() };
+        auto a = value<int> { 1 };
+        pub.publish(a, 1);
+        pub.tick();
+
+        pub.snapshot();
+
+        REQUIRE(pub.sequence() == 1);
+    }
+
+    SECTION("lost deltas are detected")
+    {
+        auto net = network { };
+        replication_publisher pub { net.sink() };
+        auto a = value<int> { 1 };
+        pub.publish(a, 1);
+
+        auto sub = replication_subscriber { };
+        pub.tick();
+        net.deliver_to(sub);
+        REQUIRE_FALSE(sub.needs_snapshot());
+
+        a = 2;
+        pub.tick();
+        net.packets.clear();
+
+        a = 3;
+        pub.tick();
+        net.deliver_to(sub);
+        REQUIRE(sub.needs_snapshot());
+
+        pub.snapshot();
+        net.deliver_to(sub);
+        REQUIRE_FALSE(sub.needs_snapshot());
+    }
+
+    SECTION("old packets do not overwrite newer states")
+    {
+        auto net = network { };
+        replication_publisher pub { net.sink() };
+        auto a = value<int> { 1 };
+        pub.publish(a, 1);
+        pub.tick();
+
+        a = 2;
+        pub.tick();
+
+        auto sub = replication_subscriber { };
+        sub.apply(net.packets[1].data(), net.packets[1].size());
+        sub.apply(net.packets[0].data(), net.packets[0].size());
+        sub.apply(net.packets[1].data(), net.packets[1].size());
+
+        auto v = 0;
+        REQUIRE(sub.get<int>(1).read(v) == 1);
+        REQUIRE(v == 2);
+    }
+
+    SECTION("snapshots win ties against deltas")
+    {
+        auto net = network { };
+        replication_publisher pub { net.sink() };
+        auto a = value<int> { 1 };
+        pub.publish(a, 1);
+        pub.tick();
+
+        auto sub = replication_subscriber { };
+        net.deliver_to(sub);
+
+        // Not sent by a tick yet, but part of the snapshot.
+        a = 2;
+        pub.snapshot();
+        net.deliver_to(sub);
+
+        auto v = 0;
+        sub.get<int>(1).read(v);
+        REQUIRE(v == 2);
+    }
+}
+
+TEST_CASE("replication/subscriber", "[replication]")
+{
+    SECTION("replicas can be retrieved before any state is received")
+    {
+        auto sub = replication_subscriber { };
+        auto const r = sub.get<int>(1);
+
+        auto v = 7;
+        REQUIRE(r.version() == 0);
+        REQUIRE(r.read(v) == 0);
+        REQUIRE(v == 7);
+    }
+
+    SECTION("subscriber needs a snapshot before any packet is received")
+    {
+        auto const sub = replication_subscriber { };
+
+        REQUIRE(sub.needs_snapshot());
+    }
+
+    SECTION("invalid packets throw")
+    {
+        auto sub = replication_subscriber { };
+        auto const garbage = std::string(32, 'x');
+
+        REQUIRE_THROWS_AS(sub.apply(garbage.data(), 4), std::runtime_error);
+        REQUIRE_THROWS_AS(sub.apply(garbage.data(), garbage.size()), std::runtime_error);
+    }
+
+    SECTION("truncated packets throw")
+    {
+        auto net = network { };
+        replication_publisher pub { net.sink() };
+        auto a = value<int> { 1 };
+        pub.publish(a, 1);
+        pub.tick();
+
+        auto sub = replication_subscriber { };
+        auto const & p = net.packets.front();
+
+        REQUIRE_THROWS_AS(sub.apply(p.data(), p.size() - 1), std::runtime_error);
+    }
+}
+
+TEST_CASE("replication/observe", "[replication]")
+{
+    SECTION("value is initialized from the replica")
+    {
+        auto net = network { };
+        replication_publisher pub { net.sink() };
+        auto a = value<int> { 3 };
+        pub.publish(a, 1);
+        pub.tick();
+
+        auto sub = replication_subscriber { };
+        net.deliver_to(sub);
+
+        auto ud = updater { };
+        auto const val = observe(ud, sub.get<int>(1));
+
+        REQUIRE(val.get() == 3);
+    }
+
+    SECTION("value is updated by the updater")
+    {
+        auto net = network { };
+        replication_publisher pub { net.sink() };
+        auto a = value<int> { 1 };
+        pub.publish(a, 1);
+
+        auto sub = replication_subscriber { };
+        auto ud = updater { };
+        auto val = observe(ud, sub.get<int>(1));
+
+        auto seen = std::vector<int> { };
+        auto const s = val.subscribe([&](int v) { seen.push_back(v); });
+
+        pub.tick();
+        net.deliver_to(sub);
+        REQUIRE(val.get() == 0);
+
+        ud.update_all();
+        REQUIRE(val.get() == 1);
+
+        a = 2;
+        pub.tick();
+        net.deliver_to(sub);
+        ud.update_all();
+        ud.update_all();
+
+        REQUIRE(seen == (std::vector<int> { 1, 2 }));
+    }
+
+    SECTION("replicated values are read-only")
+    {
+        auto sub = replication_subscriber { };
+        auto ud = updater { };
+        auto val = observe(ud, sub.get<int>(1));
+
+        REQUIRE_THROWS_AS(val.set(1), readonly_value);
+    }
+
+    SECTION("packets can be applied from another thread")
+    {
+        auto net = network { };
+        replication_publisher pub { net.sink() };
+        auto a = value<int> { 0 };
+        pub.publish(a, 1);
+
+        auto sub = replication_subscriber { };
+        auto ud = updater { };
+        auto val = observe(ud, sub.get<int>(1));
+
+        for(auto i = 1; i <= 100; ++i)
+        {
+            a = i;
+            pub.tick();
+        }
+
+        std::thread t { [&]() { net.deliver_to(sub); } };
+        while(val.get() != 100)
+            ud.update_all();
+
+        t.join();
+        REQUIRE_FALSE(sub.needs_snapshot());
+    }
+}
+
+} }
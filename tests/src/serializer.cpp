@@ -0,0 +1,61 @@
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/serializer.hpp>
+
+namespace observable { namespace test {
+
+namespace {
+
+struct point
+{
+    std::int32_t x;
+    double y;
+};
+
+template <typename T>
+auto round_trip(T const & v)
+{
+    auto bytes = std::vector<char>(serializer<T>::size(v));
+    serializer<T>::write(v, bytes.data());
+    return serializer<T>::read(bytes.data(), bytes.size());
+}
+
+}
+
+TEST_CASE("serializer/trivially copyable types", "[serializer]")
+{
+    SECTION("bytes are copied")
+    {
+        REQUIRE(serializer<int>::size(5) == sizeof(int));
+        REQUIRE(round_trip(5) == 5);
+
+        auto const p = round_trip(point { 3, 1.5 });
+        REQUIRE(p.x == 3);
+        REQUIRE(p.y == 1.5);
+    }
+
+    SECTION("wrong size throws")
+    {
+        char const bytes[2] = { };
+        REQUIRE_THROWS_AS(serializer<int>::read(bytes, sizeof(bytes)), std::runtime_error);
+    }
+}
+
+TEST_CASE("serializer/strings", "[serializer]")
+{
+    SECTION("characters are copied")
+    {
+        REQUIRE(serializer<std::string>::size("abc") == 3);
+        REQUIRE(round_trip(std::string { "abc" }) == "abc");
+    }
+
+    SECTION("empty strings are copied")
+    {
+        REQUIRE(round_trip(std::string { }).empty());
+    }
+}
+
+} }
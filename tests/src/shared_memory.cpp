@@ -0,0 +1,221 @@
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <catch/catch.hpp>
+#include <observable/observe.hpp>
+#include <observable/shared_memory.hpp>
+
+namespace observable { namespace test {
+
+namespace {
+
+struct quote
+{
+    double bid;
+    double ask;
+    std::uint32_t size;
+};
+
+auto unique_name(char const * suffix)
+{
+    return "/observable_test_" + std::to_string(::getpid()) + "_" + suffix;
+}
+
+}
+
+TEST_CASE("shared memory/publishing", "[shared memory]")
+{
+    SECTION("reader sees the initial value")
+    {
+        shared_memory_publisher<int> const pub { unique_name("initial"), 5 };
+        auto const reader = shared_memory_reader<int> { pub.name() };
+
+        REQUIRE(reader.read() == 5);
+    }
+
+    SECTION("reader sees published values")
+    {
+        shared_memory_publisher<quote> pub { unique_name("published") };
+        auto const reader = shared_memory_reader<quote> { pub.name() };
+
+        pub.publish(quote { 1.5, 2.5, 100 });
+
+        auto q = quote { };
+        reader.read(q);
+        REQUIRE(q.bid == 1.5);
+        REQUIRE(q.ask == 2.5);
+        REQUIRE(q.size == 100);
+    }
+
+    SECTION("sequence changes when a value is published")
+    {
+        shared_memory_publisher<int> pub { unique_name("sequence") };
+        auto const reader = shared_memory_reader<int> { pub.name() };
+
+        auto const before = reader.sequence();
+        pub.publish(1);
+
+        REQUIRE(reader.sequence() != before);
+        REQUIRE(reader.sequence() % 2 == 0);
+    }
+
+    SECTION("missing name throws")
+    {
+        REQUIRE_THROWS_AS(shared_memory_reader<int> { unique_name("missing") },
+                          std::system_error);
+    }
+
+    SECTION("different type throws")
+    {
+        shared_memory_publisher<std::uint32_t> const pub { unique_name("type") };
+
+        REQUIRE_THROWS_AS(shared_memory_reader<quote> { pub.name() },
+                          std::runtime_error);
+    }
+}
+
+TEST_CASE("shared memory/waiting", "[shared memory]")
+{
+    SECTION("wait returns when a value is published")
+    {
+        shared_memory_publisher<int> pub { unique_name("wait") };
+        auto const reader = shared_memory_reader<int> { pub.name() };
+        auto const since = reader.sequence();
+
+        std::thread t { [&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds { 10 });
+            pub.publish(7);
+        } };
+
+        auto const changed = reader.wait(since, std::chrono::seconds { 10 });
+        t.join();
+
+        REQUIRE(changed);
+        REQUIRE(reader.read() == 7);
+    }
+
+    SECTION("wait times out if nothing is published")
+    {
+        shared_memory_publisher<int> const pub { unique_name("timeout") };
+        auto const reader = shared_memory_reader<int> { pub.name() };
+
+        REQUIRE_FALSE(reader.wait(reader.sequence(), std::chrono::milliseconds { 5 }));
+    }
+
+    SECTION("wait returns immediately for an old sequence")
+    {
+        shared_memory_publisher<int> pub { unique_name("old") };
+        auto const reader = shared_memory_reader<int> { pub.name() };
+        auto const since = reader.sequence();
+
+        pub.publish(1);
+
+        REQUIRE(reader.wait(since, std::chrono::seconds { 10 }));
+    }
+}
+
+TEST_CASE("shared memory/observe", "[shared memory]")
+{
+    SECTION("value is initialized from the shared value")
+    {
+        shared_memory_publisher<int> const pub { unique_name("observe_init"), 3 };
+        auto ud = updater { };
+        auto const val = observe(ud, shared_memory_reader<int> { pub.name() });
+
+        REQUIRE(val.get() == 3);
+    }
+
+    SECTION("value is updated by the updater")
+    {
+        shared_memory_publisher<int> pub { unique_name("observe_update") };
+        auto ud = updater { };
+        auto val = observe(ud, shared_memory_reader<int> { pub.name() });
+
+        auto calls = 0;
+        auto const sub = val.subscribe([&](int) { ++calls; });
+
+        pub.publish(4);
+        REQUIRE(val.get() == 0);
+
+        ud.update_all();
+        REQUIRE(val.get() == 4);
+        REQUIRE(calls == 1);
+
+        ud.update_all();
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("equal values do not notify observers")
+    {
+        shared_memory_publisher<int> pub { unique_name("observe_equal"), 2 };
+        auto ud = updater { };
+        auto val = observe(ud, shared_memory_reader<int> { pub.name() });
+
+        auto calls = 0;
+        auto const sub = val.subscribe([&](int) { ++calls; });
+
+        pub.publish(2);
+        ud.update_all();
+
+        REQUIRE(calls == 0);
+    }
+
+    SECTION("value can be used in expressions of the same updater")
+    {
+        shared_memory_publisher<int> pub { unique_name("observe_expr"), 1 };
+        auto ud = updater { };
+        auto val = observe(ud, shared_memory_reader<int> { pub.name() });
+        auto const doubled = observe(ud, val * 2);
+
+        pub.publish(5);
+        ud.update_all();
+
+        REQUIRE(doubled.get() == 10);
+    }
+
+    SECTION("destroyed updater does not poll the value anymore")
+    {
+        shared_memory_publisher<int> pub { unique_name("observe_destroyed") };
+        auto ud = updater { };
+        {
+            auto const val = observe(ud, shared_memory_reader<int> { pub.name() });
+        }
+
+        pub.publish(1);
+        REQUIRE_NOTHROW(ud.update_all());
+    }
+}
+
+TEST_CASE("shared memory/processes", "[shared memory]")
+{
+    SECTION("value published by one process is read by another")
+    {
+        shared_memory_publisher<int> pub { unique_name("process") };
+
+        auto const child = ::fork();
+        REQUIRE(child >= 0);
+
+        if(child == 0)
+        {
+            auto const reader = shared_memory_reader<int> { pub.name() };
+            auto const ok = reader.wait(0, std::chrono::seconds { 10 }) &&
+                            reader.read() == 42;
+            ::_exit(ok ? 0 : 1);
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds { 10 });
+        pub.publish(42);
+
+        auto status = 0;
+        REQUIRE(::waitpid(child, &status, 0) == child);
+        REQUIRE(WIFEXITED(status));
+        REQUIRE(WEXITSTATUS(status) == 0);
+    }
+}
+
+} }
@@ -0,0 +1,141 @@
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/static_subject.hpp>
+#include <observable/subject.hpp>
+#include <observable/value.hpp>
+
+namespace observable { namespace test {
+
+namespace {
+
+struct counter
+{
+    void operator()(int v) { sum += v; }
+
+    int sum = 0;
+};
+
+}
+
+TEST_CASE("static_subject/creation", "[static_subject]")
+{
+    SECTION("can create subject without observers")
+    {
+        static_subject<void()> s;
+
+        REQUIRE(s.empty());
+        REQUIRE(s.size() == 0);
+    }
+
+    SECTION("can create subject with default-constructible observers")
+    {
+        static_subject<void(int), counter, counter> s;
+
+        REQUIRE_FALSE(s.empty());
+        REQUIRE(s.size() == 2);
+    }
+
+    SECTION("can create subject from observers")
+    {
+        auto s = make_static_subject<void(int)>([](int) { }, counter { });
+
+        REQUIRE(s.size() == 2);
+    }
+}
+
+TEST_CASE("static_subject/notification", "[static_subject]")
+{
+    SECTION("all observers are called")
+    {
+        auto a = 0;
+        auto b = 0;
+        auto s = make_static_subject<void(int)>([&](int v) { a = v; },
+                                                [&](int v) { b = v * 2; });
+
+        s.notify(3);
+
+        REQUIRE(a == 3);
+        REQUIRE(b == 6);
+    }
+
+    SECTION("observers are called in order")
+    {
+        std::vector<int> calls;
+        auto s = make_static_subject<void()>([&]() { calls.push_back(1); },
+                                             [&]() { calls.push_back(2); },
+                                             [&]() { calls.push_back(3); });
+
+        s.notify();
+
+        REQUIRE(calls == (std::vector<int> { 1, 2, 3 }));
+    }
+
+    SECTION("stateful observers keep their state")
+    {
+        static_subject<void(int), counter> s;
+
+        s.notify(2);
+        s.notify(3);
+
+        REQUIRE(s.get<0>().sum == 5);
+    }
+
+    SECTION("notifying subject without observers does nothing")
+    {
+        static_subject<void(int)> s;
+
+        s.notify(1);
+    }
+}
+
+TEST_CASE("static_subject/integration", "[static_subject]")
+{
+    SECTION("can subscribe static subject to a subject")
+    {
+        static_subject<void(int), counter, counter> fan_out;
+        subject<void(int)> s;
+
+        s.subscribe([&](int v) { fan_out(v); }).release();
+        s.notify(4);
+
+        REQUIRE(fan_out.get<0>().sum == 4);
+        REQUIRE(fan_out.get<1>().sum == 4);
+    }
+
+    SECTION("can subscribe static subject to a value")
+    {
+        auto val = value<int, inline_subject_policy> { 1 };
+        auto seen = 0;
+        auto fan_out = make_static_subject<void(int)>([&](int v) { seen = v; });
+
+        val.subscribe([&](int v) { fan_out(v); }).release();
+        val = 7;
+
+        REQUIRE(seen == 7);
+    }
+}
+
+TEST_CASE("static_subject/copy", "[static_subject]")
+{
+    SECTION("is copy-constructible with copyable observers")
+    {
+        REQUIRE(std::is_copy_constructible<
+                    static_subject<void(int), counter>>::value);
+    }
+
+    SECTION("copying copies the observers")
+    {
+        static_subject<void(int), counter> s;
+        s.notify(1);
+
+        auto copy = s;
+        copy.notify(1);
+
+        REQUIRE(s.get<0>().sum == 1);
+        REQUIRE(copy.get<0>().sum == 2);
+    }
+}
+
+} }
@@ -4,8 +4,11 @@
 #include <thread>
 #include <type_traits>
 #include <chrono>
+#include <memory>
+#include <stdexcept>
 #include <vector>
 #include <catch/catch.hpp>
+#include <observable/async_subject.hpp>
 #include <observable/subject.hpp>
 
 namespace observable { namespace test {
@@ -91,6 +94,22 @@ TEST_CASE("subject/observer is not called after unsubscribing", "[subject]")
     REQUIRE(call_count == 0);
 }
 
+TEST_CASE("subject/unsubscribed observer is released", "[subject]")
+{
+    auto s = subject<void()> { };
+    auto subs = std::vector<unique_subscription> { };
+    for(auto i = 0; i < 10; ++i)
+        subs.emplace_back(s.subscribe([]() { }));
+
+    auto const p = std::make_shared<int>(1);
+    auto sub = s.subscribe([p]() { });
+    s.notify();
+
+    sub.unsubscribe();
+
+    REQUIRE(p.use_count() == 1);
+}
+
 TEST_CASE("subject/copying", "[subject]")
 {
     SECTION("subjects are not copy-constructible")
@@ -254,4 +273,300 @@ TEST_CASE("subject/empty", "[subject]")
     }
 }
 
+TEST_CASE("subject/policies", "[subject]")
+{
+    SECTION("can notify subject with contiguous storage")
+    {
+        auto s = subject<void(int), contiguous_subject_policy> { };
+        auto sum = 0;
+
+        for(auto i = 0; i < 100; ++i)
+            s.subscribe([&](int v) { sum += v; }).release();
+        s.notify(2);
+
+        REQUIRE(sum == 200);
+    }
+
+    SECTION("observer of contiguous subject is not called after unsubscribing")
+    {
+        auto s = subject<void(), contiguous_subject_policy> { };
+        auto call_count = 0;
+
+        auto sub = s.subscribe([&]() { ++call_count; });
+        sub.unsubscribe();
+        s.notify();
+
+        REQUIRE(call_count == 0);
+        REQUIRE(s.empty());
+    }
+
+    SECTION("can use enclosed subject with a policy")
+    {
+        struct Foo
+        {
+            subject<void(), Foo, contiguous_subject_policy> test;
+
+            void notify_test() { test.notify(); }
+        } foo;
+
+        auto called = false;
+        foo.test.subscribe([&]() { called = true; }).release();
+        foo.notify_test();
+
+        REQUIRE(called);
+    }
+
+    SECTION("can notify subject with inline observers")
+    {
+        auto s = subject<void(int), inline_subject_policy> { };
+        auto sum = 0;
+
+        for(auto i = 0; i < 10; ++i)
+            s.subscribe([&](int v) { sum += v; }).release();
+        s.notify(3);
+
+        REQUIRE(sum == 30);
+    }
+
+    SECTION("inline observers can be move-only")
+    {
+        auto s = subject<void(), inline_subject_policy> { };
+        auto p = std::make_unique<int>(5);
+        auto value = 0;
+
+        s.subscribe([&, p = std::move(p)]() { value = *p; }).release();
+        s.notify();
+
+        REQUIRE(value == 5);
+    }
+
+    SECTION("can combine policies")
+    {
+        auto s = subject<void(int), inline_contiguous_subject_policy> { };
+        auto sum = 0;
+
+        auto sub = s.subscribe([&](int v) { sum += v; });
+        s.notify(4);
+        sub.unsubscribe();
+        s.notify(4);
+
+        REQUIRE(sum == 4);
+    }
+
+    SECTION("can notify single-threaded subject")
+    {
+        auto s = subject<void(int), single_threaded_subject_policy> { };
+        auto sum = 0;
+
+        auto sub = s.subscribe([&](int v) { sum += v; });
+        for(auto i = 0; i < 10; ++i)
+            s.subscribe([&](int v) { sum += v; }).release();
+
+        s.notify(1);
+        sub.unsubscribe();
+        s.notify(1);
+
+        REQUIRE(sum == 21);
+        REQUIRE(s.size() == 10);
+    }
+
+    SECTION("single-threaded observer can unsubscribe itself")
+    {
+        auto s = subject<void(), single_threaded_subject_policy> { };
+        auto call_count = 0;
+
+        auto sub = infinite_subscription { };
+        sub = s.subscribe([&]() { ++call_count; sub.unsubscribe(); });
+        s.notify();
+        s.notify();
+
+        REQUIRE(call_count == 1);
+        REQUIRE(s.empty());
+    }
+
+    SECTION("can notify pooled subject after unsubscribe churn")
+    {
+        auto s = subject<void(int), pooled_subject_policy> { };
+        auto sum = 0;
+
+        for(auto i = 0; i < 100; ++i)
+            s.subscribe([&](int v) { sum += v; }).unsubscribe();
+
+        auto const sub = unique_subscription {
+            s.subscribe([&](int v) { sum += v; })
+        };
+        s.notify(2);
+
+        REQUIRE(sum == 2);
+        REQUIRE(s.size() == 1);
+    }
+
+    SECTION("subjects with policies are nothrow movable")
+    {
+        using s = subject<void(), contiguous_subject_policy>;
+
+        REQUIRE(std::is_nothrow_move_constructible<s>::value);
+        REQUIRE(std::is_nothrow_move_assignable<s>::value);
+    }
+}
+
+namespace {
+
+//! Executor that runs each task on a new thread.
+struct thread_executor
+{
+    void operator()(async_task task) const
+    {
+        threads->emplace_back([t = std::move(task)]() mutable { t(); });
+    }
+
+    std::vector<std::thread> * threads;
+};
+
+//! Executor that keeps tasks until the test runs them.
+struct queue_executor
+{
+    void operator()(async_task task) const { tasks->push_back(std::move(task)); }
+
+    std::vector<async_task> * tasks;
+};
+
+}
+
+TEST_CASE("subject/notify_parallel", "[subject]")
+{
+    auto const observer_count = 3 * subject<void(int)>::parallel_group_size + 1;
+
+    SECTION("every observer is called exactly once")
+    {
+        auto s = subject<void(int)> { };
+        auto calls = std::vector<std::atomic<int>>(observer_count);
+        auto subs = std::vector<infinite_subscription> { };
+        for(auto && c : calls)
+            subs.push_back(s.subscribe([&c](int v) { c += v; }));
+
+        auto threads = std::vector<std::thread> { };
+        s.notify_parallel(thread_executor { &threads }, 1);
+
+        for(auto && t : threads)
+            t.join();
+
+        REQUIRE(threads.size() == 3);
+        for(auto && c : calls)
+            REQUIRE(c.load() == 1);
+    }
+
+    SECTION("contiguous subjects can notify in parallel")
+    {
+        using policy = contiguous_subject_policy;
+        auto s = subject<void(), policy> { };
+        std::atomic<std::size_t> calls { 0 };
+        auto subs = std::vector<infinite_subscription> { };
+        for(auto i = std::size_t { 0 }; i < observer_count; ++i)
+            subs.push_back(s.subscribe([&]() { ++calls; }));
+
+        auto threads = std::vector<std::thread> { };
+        s.notify_parallel(thread_executor { &threads });
+
+        for(auto && t : threads)
+            t.join();
+
+        REQUIRE(calls == observer_count);
+        REQUIRE(threads.size() > 0);
+    }
+
+    SECTION("observers removed before being called are not called")
+    {
+        auto s = subject<void()> { };
+        auto calls = 0;
+        auto subs = std::vector<infinite_subscription> { };
+        for(auto i = std::size_t { 0 }; i < observer_count; ++i)
+            subs.push_back(s.subscribe([&]() {
+                ++calls;
+                for(auto && sub : subs)
+                    sub.unsubscribe();
+            }));
+
+        auto tasks = std::vector<async_task> { };
+        s.notify_parallel(queue_executor { &tasks });
+
+        for(auto && t : tasks)
+            t();
+
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("observers subscribed while notifying are not called")
+    {
+        auto s = subject<void()> { };
+        auto calls = 0;
+        auto subs = std::vector<infinite_subscription> { };
+        subs.push_back(s.subscribe([&]() {
+            ++calls;
+            subs.push_back(s.subscribe([&]() { ++calls; }));
+        }));
+
+        auto tasks = std::vector<async_task> { };
+        s.notify_parallel(queue_executor { &tasks });
+
+        REQUIRE(calls == 1);
+        REQUIRE(s.size() == 2);
+    }
+
+    SECTION("exceptions are rethrown once all observers have been called")
+    {
+        auto s = subject<void()> { };
+        std::atomic<std::size_t> calls { 0 };
+        auto subs = std::vector<infinite_subscription> { };
+        for(auto i = std::size_t { 0 }; i < observer_count; ++i)
+            subs.push_back(s.subscribe([&, i]() {
+                ++calls;
+                if(i == 0)
+                    throw std::runtime_error { "failed" };
+            }));
+
+        auto threads = std::vector<std::thread> { };
+        REQUIRE_THROWS_AS(s.notify_parallel(thread_executor { &threads }),
+                          std::runtime_error);
+
+        for(auto && t : threads)
+            t.join();
+
+        REQUIRE(calls >= observer_count - subject<void()>::parallel_group_size);
+    }
+}
+
+TEST_CASE("subject/member function observers", "[subject]")
+{
+    struct receiver
+    {
+        void add(int v) { sum += v; }
+
+        int sum = 0;
+    };
+
+    SECTION("member function is called on notify")
+    {
+        auto s = subject<void(int)> { };
+        receiver r;
+
+        s.subscribe(r, &receiver::add).release();
+        s.notify(5);
+
+        REQUIRE(r.sum == 5);
+    }
+
+    SECTION("member function is not called after unsubscribing")
+    {
+        auto s = subject<void(int), inline_subject_policy> { };
+        receiver r;
+
+        auto sub = s.subscribe(r, &receiver::add);
+        sub.unsubscribe();
+        s.notify(5);
+
+        REQUIRE(r.sum == 0);
+    }
+}
+
 } }
@@ -0,0 +1,157 @@
+#include <sstream>
+#include <string>
+#include <thread>
+#include <catch/catch.hpp>
+#include <observable/observe.hpp>
+#include <observable/tracing.hpp>
+#include <observable/value.hpp>
+
+namespace observable { namespace test {
+
+namespace {
+
+// Discard events left over by other tests.
+void clear_trace()
+{
+    std::ostringstream discard;
+    write_chrome_trace(discard);
+}
+
+auto contains(std::string const & text, std::string const & what)
+{
+    return text.find(what) != std::string::npos;
+}
+
+}
+
+TEST_CASE("tracing/recorder", "[tracing]")
+{
+    clear_trace();
+
+    SECTION("nothing is recorded while tracing is stopped")
+    {
+        {
+            trace_scope const s { "ignored" };
+        }
+
+        std::ostringstream out;
+        REQUIRE(write_chrome_trace(out) == 0);
+        REQUIRE_FALSE(contains(out.str(), "ignored"));
+    }
+
+    SECTION("scopes are written as complete events")
+    {
+        start_tracing();
+        {
+            trace_scope const s { "my event", 3 };
+        }
+        stop_tracing();
+
+        std::ostringstream out;
+        REQUIRE(write_chrome_trace(out) == 1);
+
+        auto const trace = out.str();
+        REQUIRE(contains(trace, "\"traceEvents\""));
+        REQUIRE(contains(trace, "\"name\":\"my event\""));
+        REQUIRE(contains(trace, "\"ph\":\"X\""));
+        REQUIRE(contains(trace, "\"depth\":3"));
+    }
+
+    SECTION("writing the trace discards the events")
+    {
+        start_tracing();
+        {
+            trace_scope const s { "once" };
+        }
+        stop_tracing();
+
+        std::ostringstream first;
+        std::ostringstream second;
+
+        REQUIRE(write_chrome_trace(first) == 1);
+        REQUIRE(write_chrome_trace(second) == 0);
+    }
+
+    SECTION("names are escaped")
+    {
+        start_tracing();
+        {
+            trace_scope const s { "a \"quoted\" name" };
+        }
+        stop_tracing();
+
+        std::ostringstream out;
+        write_chrome_trace(out);
+
+        REQUIRE(contains(out.str(), "a \\\"quoted\\\" name"));
+    }
+
+    SECTION("events of other threads are recorded")
+    {
+        start_tracing();
+        {
+            trace_scope const s { "main thread" };
+        }
+        std::thread { []() { trace_scope const s { "other thread" }; } }.join();
+        stop_tracing();
+
+        std::ostringstream out;
+        REQUIRE(write_chrome_trace(out) == 2);
+        REQUIRE(contains(out.str(), "other thread"));
+    }
+
+    SECTION("stream formatting is restored")
+    {
+        std::ostringstream out;
+        write_chrome_trace(out);
+        out << 1.5;
+
+        REQUIRE(contains(out.str(), "1.5"));
+        REQUIRE_FALSE(contains(out.str(), "1.500"));
+    }
+}
+
+#if defined(OBSERVABLE_TRACING)
+TEST_CASE("tracing/propagation", "[tracing]")
+{
+    clear_trace();
+
+    SECTION("value changes, evaluations and observer calls are traced")
+    {
+        auto a = value<int> { 1 };
+        auto result = observe(a + 1);
+        auto const sub = result.subscribe([](int) { });
+
+        start_tracing();
+        a = 2;
+        stop_tracing();
+
+        std::ostringstream out;
+        write_chrome_trace(out);
+
+        auto const trace = out.str();
+        REQUIRE(contains(trace, "\"name\":\"value::set\""));
+        REQUIRE(contains(trace, "\"name\":\"+\",\"ph\":\"X\""));
+        REQUIRE(contains(trace, "\"name\":\"observer\""));
+        REQUIRE(contains(trace, "\"depth\":1"));
+    }
+
+    SECTION("clean nodes are not traced")
+    {
+        auto a = value<int> { 1 };
+        auto ud = updater { };
+        auto result = observe(ud, a + 1);
+
+        start_tracing();
+        ud.update_all();
+        stop_tracing();
+
+        std::ostringstream out;
+        write_chrome_trace(out);
+
+        REQUIRE_FALSE(contains(out.str(), "\"name\":\"+\""));
+    }
+}
+#endif
+
+} }
@@ -1,4 +1,11 @@
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
 #include <type_traits>
+#include <utility>
+#include <vector>
 #include <catch/catch.hpp>
 #include <observable/value.hpp>
 
@@ -13,6 +20,11 @@ struct throwing_value
     auto operator=(throwing_value &&) noexcept(false) { }
 };
 
+struct abs_equal
+{
+    auto operator()(int a, int b) const { return std::abs(a) == std::abs(b); }
+};
+
 struct mock_updater : value_updater<int>
 {
     mock_updater(int initial) : v_ { initial }
@@ -337,7 +349,22 @@ TEST_CASE("value/equality comparators", "[value]")
 
     SECTION("can create value with custom equality comparator")
     {
-        auto v = value<int> {
+        auto v = value<int, compare_with<abs_equal>> { 5 };
+
+        auto call_count = 0u;
+        v.subscribe([&]() { ++call_count; });
+
+        v = 5;
+        v = -5;
+
+        REQUIRE(call_count == 0);
+        REQUIRE(v.get() == 5);
+    }
+
+    SECTION("can create value with runtime equality comparator")
+    {
+        using runtime_equal = std::function<bool(int const &, int const &)>;
+        auto v = value<int, compare_with<runtime_equal>> {
                         5,
                         [](auto a, auto b) {
                             return std::abs(a) == std::abs(b);
@@ -347,21 +374,38 @@ TEST_CASE("value/equality comparators", "[value]")
         auto call_count = 0u;
         v.subscribe([&]() { ++call_count; });
 
-        v = 5;
         v = -5;
 
         REQUIRE(call_count == 0);
         REQUIRE(v.get() == 5);
     }
 
+    SECTION("empty comparator does not take any space")
+    {
+        REQUIRE(sizeof(value<int, compare_with<abs_equal>>) == sizeof(value<int>));
+
+        using runtime_equal = std::function<bool(int const &, int const &)>;
+        REQUIRE(sizeof(value<int>) < sizeof(value<int, compare_with<runtime_equal>>));
+    }
+
+    SECTION("custom comparator can be combined with a subject policy")
+    {
+        auto v = value<int,
+                       compare_with<abs_equal>,
+                       contiguous_subject_policy> { 5 };
+
+        auto call_count = 0u;
+        v.subscribe([&]() { ++call_count; });
+
+        v = -5;
+        v = 6;
+
+        REQUIRE(call_count == 1);
+    }
+
     SECTION("moved value keeps custom equality comparator")
     {
-        auto v = value<int> {
-            5,
-            [](auto a, auto b) {
-                return std::abs(a) == std::abs(b);
-            }
-        };
+        auto v = value<int, compare_with<abs_equal>> { 5 };
 
         auto moved = std::move(v);
 
@@ -374,6 +418,393 @@ TEST_CASE("value/equality comparators", "[value]")
         REQUIRE(call_count == 0);
         REQUIRE(moved.get() == 5);
     }
+
+    SECTION("hash comparator suppresses equal values")
+    {
+        auto v = value<std::string, compare_with<hash_equal_to<>>> { "a" };
+
+        auto call_count = 0u;
+        v.subscribe([&]() { ++call_count; });
+
+        v = "a";
+        REQUIRE(call_count == 0);
+
+        v = "b";
+        v = "b";
+        REQUIRE(call_count == 1);
+
+        v = "a";
+        REQUIRE(call_count == 2);
+        REQUIRE(v.get() == "a");
+    }
+
+    SECTION("hash comparator sees values changed in place")
+    {
+        auto v = value<std::string, compare_with<hash_equal_to<>>> { "a" };
+
+        auto call_count = 0u;
+        v.subscribe([&]() { ++call_count; });
+
+        v = "b";
+        v.modify([](auto & s) { s = "c"; });
+        v = "b";
+        REQUIRE(call_count == 3);
+        REQUIRE(v.get() == "b");
+
+        v.update([](auto & s) { s = "c"; return true; });
+        v = "b";
+        REQUIRE(call_count == 5);
+        REQUIRE(v.get() == "b");
+    }
+
+    SECTION("hash comparator can use a custom hash")
+    {
+        struct length_hash
+        {
+            auto operator()(std::string const & s) const { return s.size(); }
+        };
+
+        auto v = value<std::string, compare_with<hash_equal_to<length_hash>>> { "a" };
+
+        auto call_count = 0u;
+        v.subscribe([&]() { ++call_count; });
+
+        v = "b";
+        v = "cc";
+
+        REQUIRE(call_count == 1);
+        REQUIRE(v.get() == "cc");
+    }
+
+    SECTION("version comparator only compares versions")
+    {
+        struct versioned
+        {
+            auto version() const noexcept { return v; }
+
+            int v;
+            int payload;
+        };
+
+        auto v = value<versioned, compare_with<version_equal_to>> { { 1, 10 } };
+
+        auto call_count = 0u;
+        v.subscribe([&]() { ++call_count; });
+
+        v = versioned { 1, 20 };
+        REQUIRE(call_count == 0);
+        REQUIRE(v.get().payload == 10);
+
+        v = versioned { 2, 20 };
+        REQUIRE(call_count == 1);
+        REQUIRE(v.get().payload == 20);
+    }
+}
+
+TEST_CASE("value/policies", "[value]")
+{
+    SECTION("value with a policy notifies observers")
+    {
+        auto val = value<int, contiguous_subject_policy> { 1 };
+        auto call_value = 0;
+
+        val.subscribe([&](int v) { call_value = v; }).release();
+        val = 5;
+
+        REQUIRE(call_value == 5);
+    }
+
+    SECTION("value with a policy can be moved")
+    {
+        auto val = value<int, inline_subject_policy> { 1 };
+        auto call_count = 0;
+        val.subscribe([&]() { ++call_count; }).release();
+
+        auto moved = std::move(val);
+        moved = 5;
+
+        REQUIRE(call_count == 1);
+        REQUIRE(moved.get() == 5);
+    }
+
+    SECTION("moved subject receives the value with a policy")
+    {
+        using value_type = value<int, contiguous_subject_policy>;
+        auto val = value_type { 1 };
+        value_type const * moved_to = nullptr;
+        val.moved.subscribe([&](value_type & v) { moved_to = &v; }).release();
+
+        auto moved = std::move(val);
+
+        REQUIRE(moved_to == &moved);
+    }
+
+    SECTION("single-threaded value notifies observers")
+    {
+        auto val = value<int, single_threaded_subject_policy> { 1 };
+        auto call_value = 0;
+
+        auto sub = val.subscribe([&](int v) { call_value = v; });
+        val = 5;
+        sub.unsubscribe();
+        val = 6;
+
+        REQUIRE(call_value == 5);
+    }
+
+    SECTION("single-threaded value can be moved")
+    {
+        auto val = value<int, single_threaded_subject_policy> { 1 };
+        auto call_count = 0;
+        val.subscribe([&]() { ++call_count; }).release();
+
+        auto moved = std::move(val);
+        moved = 5;
+
+        REQUIRE(call_count == 1);
+    }
+
+    SECTION("can use enclosed value with a policy")
+    {
+        struct mock
+        {
+            value<int, mock, contiguous_subject_policy> val { 0 };
+            void set_value(int v) { val = v; }
+        } foo;
+
+        auto called = false;
+        foo.val.subscribe([&]() { called = true; }).release();
+        foo.set_value(5);
+
+        REQUIRE(foo.val.get() == 5);
+        REQUIRE(called);
+    }
+}
+
+TEST_CASE("value/modifying in place", "[value]")
+{
+    SECTION("modify() changes the stored value")
+    {
+        auto val = value<std::vector<int>> { std::vector<int> { 1, 2, 3 } };
+
+        val.modify([](auto & v) { v[1] = 5; });
+
+        REQUIRE(val.get() == (std::vector<int> { 1, 5, 3 }));
+    }
+
+    SECTION("modify() does not copy the stored value")
+    {
+        auto val = value<std::vector<int>> { std::vector<int>(1000) };
+        auto const data = val.get().data();
+
+        val.modify([](auto & v) { v[0] = 1; });
+
+        REQUIRE(val.get().data() == data);
+    }
+
+    SECTION("modify() notifies observers")
+    {
+        auto val = value<std::vector<int>> { std::vector<int> { 1 } };
+        auto seen = 0;
+        val.subscribe([&](auto const & v) { seen = v[0]; }).release();
+
+        val.modify([](auto & v) { v[0] = 7; });
+
+        REQUIRE(seen == 7);
+    }
+
+    SECTION("observers are not notified if modify() throws")
+    {
+        auto val = value<int> { 1 };
+        auto called = false;
+        val.subscribe([&]() { called = true; }).release();
+
+        REQUIRE_THROWS(val.modify([](auto &) { throw 1; }));
+        REQUIRE_FALSE(called);
+    }
+
+    SECTION("modify() is deferred by a batch")
+    {
+        auto val = value<int> { 1 };
+        auto calls = 0;
+        val.subscribe([&]() { ++calls; }).release();
+
+        {
+            batch b;
+            val.modify([](auto & v) { ++v; });
+            val.modify([](auto & v) { ++v; });
+            REQUIRE(calls == 0);
+        }
+
+        REQUIRE(val.get() == 3);
+        REQUIRE(calls == 1);
+    }
+}
+
+TEST_CASE("value/updating in place", "[value]")
+{
+    SECTION("update() changes the stored value")
+    {
+        auto val = value<std::vector<int>> { std::vector<int> { 1, 2, 3 } };
+
+        val.update([](auto & v) { v[2] = 4; return true; });
+
+        REQUIRE(val.get() == (std::vector<int> { 1, 2, 4 }));
+    }
+
+    SECTION("update() notifies observers if the functor reports a change")
+    {
+        auto val = value<std::vector<int>> { std::vector<int> { 1 } };
+        auto calls = 0;
+        val.subscribe([&]() { ++calls; }).release();
+
+        REQUIRE(val.update([](auto & v) { v[0] = 2; return true; }));
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("update() does not notify observers if nothing changed")
+    {
+        auto val = value<std::vector<int>> { std::vector<int> { 1 } };
+        auto calls = 0;
+        val.subscribe([&]() { ++calls; }).release();
+
+        REQUIRE_FALSE(val.update([](auto &) { return false; }));
+        REQUIRE(calls == 0);
+    }
+
+    SECTION("update() does not compare values")
+    {
+        auto val = value<int> { 1 };
+        auto calls = 0;
+        val.subscribe([&]() { ++calls; }).release();
+
+        val.update([](auto &) { return true; });
+
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("update() throws for values with an updater")
+    {
+        auto val = value<int> { std::make_unique<mock_updater>(5) };
+
+        REQUIRE_THROWS_AS(val.update([](auto &) { return true; }), readonly_value);
+    }
+}
+
+TEST_CASE("value/versions", "[value]")
+{
+    SECTION("version starts at zero")
+    {
+        auto const val = value<int> { 5 };
+
+        REQUIRE(val.version() == 0);
+    }
+
+    SECTION("version is incremented when the value changes")
+    {
+        auto val = value<int> { 1 };
+
+        val = 2;
+        REQUIRE(val.version() == 1);
+
+        val.modify([](auto & v) { v = 3; });
+        val.update([](auto & v) { v = 4; return true; });
+        REQUIRE(val.version() == 3);
+    }
+
+    SECTION("version is not incremented if the value does not change")
+    {
+        auto val = value<int> { 1 };
+
+        val = 1;
+        val.update([](auto &) { return false; });
+
+        REQUIRE(val.version() == 0);
+    }
+
+    SECTION("version is incremented before observers are called")
+    {
+        auto val = value<int> { 1 };
+        auto seen = std::uint64_t { 0 };
+        auto const sub = val.subscribe([&]() { seen = val.version(); });
+
+        val = 2;
+
+        REQUIRE(seen == 1);
+    }
+
+    SECTION("values updated by an updater have versions")
+    {
+        auto ud = std::make_unique<mock_updater>(5);
+        auto const u = ud.get();
+        auto val = value<int> { std::move(ud) };
+        auto const initial = val.version();
+
+        u->set(6);
+
+        REQUIRE(val.version() == initial + 1);
+    }
+
+    SECTION("moved values keep their version")
+    {
+        auto val = value<int> { 1 };
+        val = 2;
+
+        auto moved = std::move(val);
+
+        REQUIRE(moved.version() == 1);
+    }
+
+    SECTION("move-assigned values get a new version")
+    {
+        auto a = value<int> { 1 };
+        auto b = value<int> { 2 };
+        a = 3;
+        a = 4;
+        b = 5;
+
+        b = std::move(a);
+
+        REQUIRE(b.version() == 3);
+    }
+}
+
+TEST_CASE("value/move-only types", "[value]")
+{
+    SECTION("value can store move-only types")
+    {
+        auto val = value<std::unique_ptr<int>> { std::make_unique<int>(5) };
+
+        REQUIRE(*val.get() == 5);
+    }
+
+    SECTION("move-only value can be set")
+    {
+        auto val = value<std::unique_ptr<int>> { };
+        auto seen = 0;
+        val.subscribe([&](auto const & p) { seen = *p; }).release();
+
+        val = std::make_unique<int>(7);
+
+        REQUIRE(seen == 7);
+    }
+
+    SECTION("move-only value can be modified")
+    {
+        auto val = value<std::unique_ptr<int>> { std::make_unique<int>(1) };
+
+        val.modify([](auto & p) { *p = 3; });
+
+        REQUIRE(*val.get() == 3);
+    }
+
+    SECTION("move-only value can be moved")
+    {
+        auto val = value<std::unique_ptr<int>> { std::make_unique<int>(1) };
+        auto moved = std::move(val);
+
+        REQUIRE(*moved.get() == 1);
+    }
 }
 
 } }
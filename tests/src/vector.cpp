@@ -0,0 +1,209 @@
+#include <functional>
+#include <string>
+#include <vector>
+#include <catch/catch.hpp>
+#include <observable/vector.hpp>
+
+namespace observable { namespace test {
+
+namespace {
+
+using change = vector_change<int>;
+using kind = change::kind;
+
+struct recorder
+{
+    void operator()(change const & c)
+    {
+        changes.push_back(c);
+        removed.emplace_back(c.removed, c.removed + c.removed_count);
+    }
+
+    std::vector<change> changes;
+    std::vector<std::vector<int>> removed;
+};
+
+}
+
+TEST_CASE("observable vector/reading", "[observable vector]")
+{
+    SECTION("new vector is empty")
+    {
+        observable::vector<int> v;
+
+        REQUIRE(v.empty());
+        REQUIRE(v.size() == 0);
+    }
+
+    SECTION("vector can be created with elements")
+    {
+        observable::vector<int> v { 1, 2, 3 };
+
+        REQUIRE(v.size() == 3);
+        REQUIRE(v[1] == 2);
+        REQUIRE(v.at(2) == 3);
+        REQUIRE(v.get() == (std::vector<int> { 1, 2, 3 }));
+    }
+
+    SECTION("vector can be iterated")
+    {
+        observable::vector<int> v { 1, 2, 3 };
+        auto sum = 0;
+        for(auto x : v)
+            sum += x;
+
+        REQUIRE(sum == 6);
+    }
+}
+
+TEST_CASE("observable vector/changes", "[observable vector]")
+{
+    SECTION("push_back() reports an insert at the end")
+    {
+        observable::vector<int> v { 1 };
+        recorder r;
+        auto const sub = v.subscribe(std::ref(r));
+
+        v.push_back(2);
+
+        REQUIRE(r.changes.size() == 1);
+        REQUIRE(r.changes[0].type == kind::insert);
+        REQUIRE(r.changes[0].first == 1);
+        REQUIRE(r.changes[0].count == 1);
+        REQUIRE(r.changes[0].removed_count == 0);
+    }
+
+    SECTION("range insert reports all inserted elements")
+    {
+        observable::vector<int> v { 1, 4 };
+        recorder r;
+        auto const sub = v.subscribe(std::ref(r));
+        auto const more = std::vector<int> { 2, 3 };
+
+        v.insert(1, more.begin(), more.end());
+
+        REQUIRE(v.get() == (std::vector<int> { 1, 2, 3, 4 }));
+        REQUIRE(r.changes[0].first == 1);
+        REQUIRE(r.changes[0].count == 2);
+    }
+
+    SECTION("erase() reports the erased elements")
+    {
+        observable::vector<int> v { 1, 2, 3, 4 };
+        recorder r;
+        auto const sub = v.subscribe(std::ref(r));
+
+        v.erase(1, 2);
+
+        REQUIRE(v.get() == (std::vector<int> { 1, 4 }));
+        REQUIRE(r.changes[0].type == kind::erase);
+        REQUIRE(r.changes[0].first == 1);
+        REQUIRE(r.changes[0].count == 0);
+        REQUIRE(r.removed[0] == (std::vector<int> { 2, 3 }));
+    }
+
+    SECTION("set() reports the old element")
+    {
+        observable::vector<int> v { 1, 2 };
+        recorder r;
+        auto const sub = v.subscribe(std::ref(r));
+
+        v.set(1, 5);
+
+        REQUIRE(v[1] == 5);
+        REQUIRE(r.changes[0].type == kind::update);
+        REQUIRE(r.changes[0].first == 1);
+        REQUIRE(r.removed[0] == (std::vector<int> { 2 }));
+    }
+
+    SECTION("set() with an equal element does not notify")
+    {
+        observable::vector<int> v { 1, 2 };
+        recorder r;
+        auto const sub = v.subscribe(std::ref(r));
+
+        v.set(1, 2);
+
+        REQUIRE(r.changes.empty());
+    }
+
+    SECTION("update() notifies only if the functor reports a change")
+    {
+        observable::vector<int> v { 1, 2 };
+        recorder r;
+        auto const sub = v.subscribe(std::ref(r));
+
+        v.update(0, [](int &) { return false; });
+        v.update(0, [](int & x) { x = 9; return true; });
+
+        REQUIRE(v[0] == 9);
+        REQUIRE(r.changes.size() == 1);
+        REQUIRE(r.removed[0] == (std::vector<int> { 1 }));
+    }
+
+    SECTION("assign() reports a reset")
+    {
+        observable::vector<int> v { 1, 2 };
+        recorder r;
+        auto const sub = v.subscribe(std::ref(r));
+
+        v.assign({ 3, 4, 5 });
+
+        REQUIRE(r.changes[0].type == kind::reset);
+        REQUIRE(r.changes[0].count == 3);
+        REQUIRE(r.removed[0] == (std::vector<int> { 1, 2 }));
+    }
+
+    SECTION("new elements can be read from the vector during notification")
+    {
+        observable::vector<std::string> v;
+        auto seen = std::string { };
+        auto const sub = v.subscribe([&](auto const & c) {
+            seen = v[c.first];
+        });
+
+        v.push_back("hello");
+
+        REQUIRE(seen == "hello");
+    }
+
+    SECTION("changes point to the new elements")
+    {
+        observable::vector<int> v { 1, 2 };
+        auto seen = std::vector<int> { };
+        auto const sub = v.subscribe([&](auto const & c) {
+            seen.assign(c.values, c.values + c.count);
+        });
+
+        auto const more = std::vector<int> { 7, 8 };
+        v.insert(1, more.begin(), more.end());
+
+        REQUIRE(seen == more);
+    }
+
+    SECTION("unsubscribed observers are not notified")
+    {
+        observable::vector<int> v;
+        recorder r;
+        auto sub = v.subscribe(std::ref(r));
+
+        sub.unsubscribe();
+        v.push_back(1);
+
+        REQUIRE(r.changes.empty());
+    }
+
+    SECTION("vector can be moved with its observers")
+    {
+        observable::vector<int> v;
+        recorder r;
+        auto const sub = v.subscribe(std::ref(r));
+
+        auto moved = std::move(v);
+        moved.push_back(1);
+
+        REQUIRE(r.changes.size() == 1);
+    }
+}
+
+} }